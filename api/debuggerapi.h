@@ -349,6 +349,24 @@ namespace BinaryNinjaDebuggerAPI {
 		std::uintptr_t m_value {};
 		std::size_t m_width {}, m_registerIndex {};
 		std::string m_hint {};
+		// Whether the value differs from the one at the previous stop
+		bool m_changed {};
+	};
+
+
+	// A slot of the stack window, and what its value leads to when it is dereferenced
+	struct DebugStackSlot
+	{
+		// Relative to the stack pointer
+		int64_t m_offset {};
+		uint64_t m_address {};
+		uint64_t m_value {};
+		// False if the slot cannot be read
+		bool m_valid {};
+		// The values read by dereferencing the value over and over, e.g., *value and **value
+		std::vector<uint64_t> m_chain {};
+		// What the last value of the chain is, e.g., a string or a symbol
+		std::string m_hint {};
 	};
 
 
@@ -358,6 +376,70 @@ namespace BinaryNinjaDebuggerAPI {
 		uint64_t offset;
 		uint64_t address;
 		bool enabled;
+		std::string condition;
+		std::string logTemplate;
+		bool tracepoint;
+		uint64_t ignoreCount;
+		uint64_t hitCount;
+	};
+
+
+	struct BreakpointRecord
+	{
+		// The number of the hit that wrote the record, starting from 1
+		uint64_t hit;
+		std::string message;
+	};
+
+
+	struct DebuggerMemoryCacheStatistics
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t adapterReads;
+		uint64_t retainedPages;
+		uint64_t cachedPages;
+		uint64_t prefetchedPages;
+		uint64_t prefetchHits;
+		uint64_t unmappedReads;
+	};
+
+
+	// A mapped range of the target's address space
+	struct DebugMemoryRegion
+	{
+		uint64_t m_start;
+		uint64_t m_end;
+		bool m_readable;
+		bool m_writable;
+		bool m_executable;
+		// The file that backs the region, if any
+		std::string m_name;
+	};
+
+
+	// The addresses in [m_start, m_end)
+	struct DebugAddressRange
+	{
+		uint64_t m_start;
+		uint64_t m_end;
+	};
+
+
+	// A byte pattern to search the memory for. A mask byte of 0xff is an exact byte and 0x00 is a wildcard; an empty
+	// mask means all bytes are exact.
+	struct MemorySearchPattern
+	{
+		std::vector<uint8_t> m_bytes;
+		std::vector<uint8_t> m_mask;
+
+		// Hex bytes separated by optional whitespace, where a `?` nibble is a wildcard, e.g., "48 8b ?? 05 1?".
+		// Returns an empty pattern if the string is not valid.
+		static MemorySearchPattern FromHex(const std::string& hex);
+		// The lowest `size` bytes of the value, in the given byte order
+		static MemorySearchPattern FromInteger(uint64_t value, size_t size, bool bigEndian = false);
+		// The characters of the string, without a terminator. UTF-16 only widens the characters.
+		static MemorySearchPattern FromString(const std::string& str, bool utf16 = false);
 	};
 
 
@@ -391,6 +473,32 @@ namespace BinaryNinjaDebuggerAPI {
 
 	typedef BNDebuggerEventType DebuggerEventType;
 	typedef BNDebugStopReason DebugStopReason;
+	typedef BNDebuggerEventDeliveryPolicy DebuggerEventDeliveryPolicy;
+	typedef BNDebuggerOutputStream DebuggerOutputStream;
+	typedef BNDebugWatchpointType DebugWatchpointType;
+	typedef BNDebugTraceGranularity DebugTraceGranularity;
+
+	struct ExecutionTraceOptions
+	{
+		std::string path;
+		DebugTraceGranularity granularity = TraceInstructions;
+		// 0 means no limit
+		uint64_t maxRecords = 0;
+		// The trace ends after it reaches one of these addresses, or a breakpoint
+		std::vector<uint64_t> stopAddresses;
+		// The registers whose changes are recorded along with the addresses
+		std::vector<std::string> registers;
+	};
+
+	struct DebugWatchpoint
+	{
+		std::string module;
+		uint64_t offset;
+		uint64_t address;
+		size_t size;
+		DebugWatchpointType type;
+	};
+
 
 	struct TargetStoppedEventData
 	{
@@ -398,6 +506,9 @@ namespace BinaryNinjaDebuggerAPI {
 		std::uint32_t lastActiveThread;
 		size_t exitCode;
 		void* data;
+		// Only valid when the reason is Watchpoint
+		uint64_t watchpointAddress;
+		DebugWatchpointType watchpointType;
 	};
 
 
@@ -469,18 +580,42 @@ namespace BinaryNinjaDebuggerAPI {
 
 		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size);
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer);
+		DebuggerMemoryCacheStatistics GetMemoryCacheStatistics();
+		void ResetMemoryCacheStatistics();
+		// The mapped regions of the target, sorted by their start. Empty if the adapter does not know the memory map.
+		std::vector<DebugMemoryRegion> GetMemoryRegions();
+		// Call `callback` with the address of every match of the pattern in the readable memory within [start, end),
+		// in ascending order, until it returns false or `maxResults` matches are found. A `maxResults` of 0 means no
+		// limit. Returns the number of matches found.
+		size_t SearchMemory(const MemorySearchPattern& pattern, uint64_t start, uint64_t end, size_t maxResults,
+			const std::function<bool(uint64_t)>& callback);
+		void CancelMemorySearch();
+		// Save the memory, the registers of all threads and the modules of the stopped target into an ELF core file.
+		// `progress` is called with the number of bytes written so far and the total, and cancels when it returns false.
+		bool SaveCoreFile(const std::string& path, const std::function<bool(size_t, size_t)>& progress = {});
+		// Hash the memory within [start, end) at every stop, to find out what changed since the previous stop. The
+		// changes are accurate to 256 bytes.
+		void TrackMemoryChanges(uint64_t start, uint64_t end);
+		void UntrackMemoryChanges(uint64_t start, uint64_t end);
+		std::vector<DebugAddressRange> GetTrackedMemoryRanges();
+		// What changed in the tracked memory between the last two stops
+		std::vector<DebugAddressRange> GetChangedMemoryRanges();
+		std::vector<uint64_t> GetChangedMemoryPages();
 
 		std::vector<DebugProcess> GetProcessList();
 
 		std::vector<DebugThread> GetThreads();
 		DebugThread GetActiveThread();
 		void SetActiveThread(const DebugThread& thread);
-		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid);
+		// If maxFrames is not zero, only the innermost maxFrames frames are unwound and returned
+		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid, size_t maxFrames = 0);
 		bool SuspendThread(std::uint32_t tid);
 		bool ResumeThread(std::uint32_t tid);
 
 		std::vector<DebugModule> GetModules();
-		std::vector<DebugRegister> GetRegisters();
+		// The hints tell what the registers point to. They read the memory of the target, which makes them much slower
+		// than the values.
+		std::vector<DebugRegister> GetRegisters(bool withHints = true);
 		uint64_t GetRegisterValue(const std::string& name);
 		bool SetRegisterValue(const std::string& name, uint64_t value);
 
@@ -518,6 +653,15 @@ namespace BinaryNinjaDebuggerAPI {
 		DebugStopReason RunToAndWait(const std::vector<uint64_t>& remoteAddresses);
 		DebugStopReason PauseAndWait();
 
+		// Records the executed instructions or basic blocks to a trace file. It is much faster than stepping, since the
+		// event callbacks only see the start and the end of the trace. Pausing the target cancels the trace.
+		bool Trace(const ExecutionTraceOptions& options);
+		DebugStopReason TraceAndWait(const ExecutionTraceOptions& options);
+		void CancelTrace();
+		bool IsTracing();
+		// Returns the number of instructions highlighted, or -1 if the trace cannot be read
+		int64_t HighlightTrace(const std::string& path, BNHighlightStandardColor color = BlueHighlightColor);
+
 		std::string GetAdapterType();
 		void SetAdapterType(const std::string& adapter);
 
@@ -547,8 +691,42 @@ namespace BinaryNinjaDebuggerAPI {
 		void DeleteBreakpoint(const ModuleNameAndOffset& breakpoint);
 		void AddBreakpoint(uint64_t address);
 		void AddBreakpoint(const ModuleNameAndOffset& breakpoint);
+		size_t DeleteBreakpoints(const std::vector<uint64_t>& addresses);
+		size_t DeleteBreakpoints(const std::vector<ModuleNameAndOffset>& breakpoints);
+		size_t AddBreakpoints(const std::vector<uint64_t>& addresses);
+		size_t AddBreakpoints(const std::vector<ModuleNameAndOffset>& breakpoints);
 		bool ContainsBreakpoint(uint64_t address);
 		bool ContainsBreakpoint(const ModuleNameAndOffset& breakpoint);
+		// The target only stops at the breakpoint when the condition is non-zero, e.g.,
+		// "rdi == 0x1234 && [rsp + 8] > 5".
+		// An empty condition makes the breakpoint unconditional again.
+		bool SetBreakpointCondition(uint64_t address, const std::string& condition);
+		bool SetBreakpointCondition(const ModuleNameAndOffset& breakpoint, const std::string& condition);
+		std::string GetBreakpointCondition(uint64_t address);
+		std::string GetBreakpointCondition(const ModuleNameAndOffset& breakpoint);
+		// A tracepoint never stops the target. It counts its hits, and records its log message if it has one. The log
+		// template has {expr} placeholders, printed in hex, or with {expr:d} in decimal and {expr:s} as a C string.
+		// The first ignoreCount hits of a breakpoint do not stop the target either.
+		bool SetBreakpointTracepoint(uint64_t address, bool tracepoint);
+		bool SetBreakpointTracepoint(const ModuleNameAndOffset& breakpoint, bool tracepoint);
+		bool SetBreakpointLogTemplate(uint64_t address, const std::string& logTemplate);
+		bool SetBreakpointLogTemplate(const ModuleNameAndOffset& breakpoint, const std::string& logTemplate);
+		bool SetBreakpointIgnoreCount(uint64_t address, uint64_t ignoreCount);
+		bool SetBreakpointIgnoreCount(const ModuleNameAndOffset& breakpoint, uint64_t ignoreCount);
+		uint64_t GetBreakpointHitCount(uint64_t address);
+		uint64_t GetBreakpointHitCount(const ModuleNameAndOffset& breakpoint);
+		std::vector<BreakpointRecord> GetBreakpointRecords(uint64_t address);
+		std::vector<BreakpointRecord> GetBreakpointRecords(const ModuleNameAndOffset& breakpoint);
+		bool ResetBreakpointHits(uint64_t address);
+		bool ResetBreakpointHits(const ModuleNameAndOffset& breakpoint);
+
+		// Hardware watchpoints of 1, 2, 4 or 8 bytes, aligned to their size. Only one watchpoint can be at an address.
+		std::vector<DebugWatchpoint> GetWatchpoints();
+		bool AddWatchpoint(uint64_t address, size_t size, DebugWatchpointType type = WatchpointWrite);
+		bool AddWatchpoint(
+			const ModuleNameAndOffset& watchpoint, size_t size, DebugWatchpointType type = WatchpointWrite);
+		bool DeleteWatchpoint(uint64_t address);
+		bool DeleteWatchpoint(const ModuleNameAndOffset& watchpoint);
 
 		uint64_t IP();
 		uint64_t GetLastIP();
@@ -558,13 +736,17 @@ namespace BinaryNinjaDebuggerAPI {
 		uint64_t RelativeAddressToAbsolute(const ModuleNameAndOffset& address);
 		ModuleNameAndOffset AbsoluteAddressToRelative(uint64_t address);
 
-		size_t RegisterEventCallback(
-			std::function<void(const DebuggerEvent& event)> callback, const std::string& name = "");
+		size_t RegisterEventCallback(std::function<void(const DebuggerEvent& event)> callback,
+			const std::string& name = "", DebuggerEventDeliveryPolicy policy = SynchronousEventDelivery);
 		static void DebuggerEventCallback(void* ctxt, BNDebuggerEvent* view);
 
 		void RemoveEventCallback(size_t index);
 
 		void WriteStdin(const std::string& msg);
+		// Pull the buffered output of the target, without going through the event callbacks
+		DataBuffer ReadTargetOutput(DebuggerOutputStream stream, size_t maxLength = 0);
+		size_t GetTargetOutputAvailable(DebuggerOutputStream stream);
+		uint64_t GetTargetOutputDropped(DebuggerOutputStream stream);
 
 		std::string InvokeBackendCommand(const std::string& command);
 
@@ -577,6 +759,9 @@ namespace BinaryNinjaDebuggerAPI {
 		bool ActivateDebugAdapter();
 
 		std::string GetAddressInformation(uint64_t address);
+		// The slots around the stack pointer, each followed through up to `depth` pointers. This reads the whole
+		// window at once, and the result is cached for the current stop.
+		std::vector<DebugStackSlot> GetStackWindow(size_t before = 8, size_t after = 60, size_t depth = 3);
 		bool IsFirstLaunch();
 
 		void PostDebuggerEvent(const DebuggerEvent& event);
@@ -116,6 +116,200 @@ bool DebuggerController::WriteMemory(std::uintptr_t address, const DataBuffer& b
 	return BNDebuggerWriteMemory(m_object, address, buffer.GetBufferObject());
 }
 
+
+DebuggerMemoryCacheStatistics DebuggerController::GetMemoryCacheStatistics()
+{
+	BNDebuggerMemoryCacheStatistics statistics = BNDebuggerGetMemoryCacheStatistics(m_object);
+	DebuggerMemoryCacheStatistics result;
+	result.hits = statistics.hits;
+	result.misses = statistics.misses;
+	result.adapterReads = statistics.adapterReads;
+	result.retainedPages = statistics.retainedPages;
+	result.cachedPages = statistics.cachedPages;
+	result.prefetchedPages = statistics.prefetchedPages;
+	result.prefetchHits = statistics.prefetchHits;
+	result.unmappedReads = statistics.unmappedReads;
+	return result;
+}
+
+
+void DebuggerController::ResetMemoryCacheStatistics()
+{
+	BNDebuggerResetMemoryCacheStatistics(m_object);
+}
+
+
+std::vector<DebugMemoryRegion> DebuggerController::GetMemoryRegions()
+{
+	size_t count;
+	BNDebugMemoryRegion* regions = BNDebuggerGetMemoryRegions(m_object, &count);
+
+	std::vector<DebugMemoryRegion> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugMemoryRegion region;
+		region.m_start = regions[i].start;
+		region.m_end = regions[i].end;
+		region.m_readable = regions[i].readable;
+		region.m_writable = regions[i].writable;
+		region.m_executable = regions[i].executable;
+		region.m_name = regions[i].name;
+		result.push_back(region);
+	}
+	BNDebuggerFreeMemoryRegions(regions, count);
+
+	return result;
+}
+
+
+MemorySearchPattern MemorySearchPattern::FromHex(const std::string& hex)
+{
+	auto nibble = [](char c) -> int {
+		if ((c >= '0') && (c <= '9'))
+			return c - '0';
+		if ((c >= 'a') && (c <= 'f'))
+			return c - 'a' + 10;
+		if ((c >= 'A') && (c <= 'F'))
+			return c - 'A' + 10;
+		return -1;
+	};
+
+	MemorySearchPattern result;
+	std::string digits;
+	for (char c : hex)
+	{
+		if (!isspace((unsigned char)c))
+			digits += c;
+	}
+	if (digits.empty() || ((digits.size() % 2) != 0))
+		return {};
+
+	for (size_t i = 0; i < digits.size(); i += 2)
+	{
+		uint8_t byte = 0, mask = 0;
+		for (size_t j = 0; j < 2; j++)
+		{
+			int shift = j == 0 ? 4 : 0;
+			if (digits[i + j] == '?')
+				continue;
+			int value = nibble(digits[i + j]);
+			if (value < 0)
+				return {};
+			byte |= value << shift;
+			mask |= 0xf << shift;
+		}
+		result.m_bytes.push_back(byte);
+		result.m_mask.push_back(mask);
+	}
+	return result;
+}
+
+
+MemorySearchPattern MemorySearchPattern::FromInteger(uint64_t value, size_t size, bool bigEndian)
+{
+	MemorySearchPattern result;
+	size = std::min<size_t>(size, 8);
+	for (size_t i = 0; i < size; i++)
+		result.m_bytes.push_back((uint8_t)(value >> (8 * (bigEndian ? size - 1 - i : i))));
+	return result;
+}
+
+
+MemorySearchPattern MemorySearchPattern::FromString(const std::string& str, bool utf16)
+{
+	MemorySearchPattern result;
+	for (char c : str)
+	{
+		result.m_bytes.push_back((uint8_t)c);
+		if (utf16)
+			result.m_bytes.push_back(0);
+	}
+	return result;
+}
+
+
+size_t DebuggerController::SearchMemory(const MemorySearchPattern& pattern, uint64_t start, uint64_t end,
+	size_t maxResults, const std::function<bool(uint64_t)>& callback)
+{
+	if (pattern.m_bytes.empty())
+		return 0;
+
+	std::vector<uint8_t> mask = pattern.m_mask;
+	mask.resize(pattern.m_bytes.size(), 0xff);
+	return BNDebuggerSearchMemory(m_object, pattern.m_bytes.data(), mask.data(), pattern.m_bytes.size(), start, end,
+		maxResults, (void*)&callback, [](void* ctxt, uint64_t address) {
+			return (*(const std::function<bool(uint64_t)>*)ctxt)(address);
+		});
+}
+
+
+void DebuggerController::CancelMemorySearch()
+{
+	BNDebuggerCancelMemorySearch(m_object);
+}
+
+
+bool DebuggerController::SaveCoreFile(const std::string& path, const std::function<bool(size_t, size_t)>& progress)
+{
+	if (!progress)
+		return BNDebuggerSaveCoreFile(m_object, path.c_str(), nullptr, nullptr);
+
+	return BNDebuggerSaveCoreFile(m_object, path.c_str(), (void*)&progress, [](void* ctxt, size_t done, size_t total) {
+		return (*(const std::function<bool(size_t, size_t)>*)ctxt)(done, total);
+	});
+}
+
+
+void DebuggerController::TrackMemoryChanges(uint64_t start, uint64_t end)
+{
+	BNDebuggerTrackMemoryChanges(m_object, start, end);
+}
+
+
+void DebuggerController::UntrackMemoryChanges(uint64_t start, uint64_t end)
+{
+	BNDebuggerUntrackMemoryChanges(m_object, start, end);
+}
+
+
+static std::vector<DebugAddressRange> ConvertAddressRanges(BNDebugAddressRange* ranges, size_t count)
+{
+	std::vector<DebugAddressRange> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		result.push_back({ranges[i].start, ranges[i].end});
+	BNDebuggerFreeAddressRanges(ranges);
+	return result;
+}
+
+
+std::vector<DebugAddressRange> DebuggerController::GetTrackedMemoryRanges()
+{
+	size_t count;
+	BNDebugAddressRange* ranges = BNDebuggerGetTrackedMemoryRanges(m_object, &count);
+	return ConvertAddressRanges(ranges, count);
+}
+
+
+std::vector<DebugAddressRange> DebuggerController::GetChangedMemoryRanges()
+{
+	size_t count;
+	BNDebugAddressRange* ranges = BNDebuggerGetChangedMemoryRanges(m_object, &count);
+	return ConvertAddressRanges(ranges, count);
+}
+
+
+std::vector<uint64_t> DebuggerController::GetChangedMemoryPages()
+{
+	size_t count;
+	uint64_t* pages = BNDebuggerGetChangedMemoryPages(m_object, &count);
+	std::vector<uint64_t> result(pages, pages + count);
+	BNDebuggerFreeChangedMemoryPages(pages);
+	return result;
+}
+
+
 std::vector<DebugProcess> DebuggerController::GetProcessList()
 {
 	size_t count;
@@ -188,10 +382,10 @@ bool DebuggerController::ResumeThread(std::uint32_t tid)
 }
 
 
-std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint32_t tid)
+std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint32_t tid, size_t maxFrames)
 {
 	size_t count;
-	BNDebugFrame* frames = BNDebuggerGetFramesOfThread(m_object, tid, &count);
+	BNDebugFrame* frames = BNDebuggerGetTopFramesOfThread(m_object, tid, maxFrames, &count);
 
 	std::vector<DebugFrame> result;
 	result.reserve(count);
@@ -237,10 +431,14 @@ std::vector<DebugModule> DebuggerController::GetModules()
 }
 
 
-std::vector<DebugRegister> DebuggerController::GetRegisters()
+std::vector<DebugRegister> DebuggerController::GetRegisters(bool withHints)
 {
 	size_t count;
-	BNDebugRegister* registers = BNDebuggerGetRegisters(m_object, &count);
+	BNDebugRegister* registers;
+	if (withHints)
+		registers = BNDebuggerGetRegisters(m_object, &count);
+	else
+		registers = BNDebuggerGetRegistersWithoutHints(m_object, &count);
 
 	vector<DebugRegister> result;
 	result.reserve(count);
@@ -252,6 +450,7 @@ std::vector<DebugRegister> DebuggerController::GetRegisters()
 		reg.m_width = registers[i].m_width;
 		reg.m_registerIndex = registers[i].m_registerIndex;
 		reg.m_hint = registers[i].m_hint;
+		reg.m_changed = registers[i].m_changed;
 		result.push_back(reg);
 	}
 	BNDebuggerFreeRegisters(registers, count);
@@ -442,6 +641,50 @@ DebugStopReason DebuggerController::PauseAndWait()
 }
 
 
+// The C strings point into options, so they are only valid as long as it is
+static std::vector<const char*> GetTraceRegisters(const ExecutionTraceOptions& options)
+{
+	std::vector<const char*> registers;
+	for (const std::string& name : options.registers)
+		registers.push_back(name.c_str());
+	return registers;
+}
+
+
+bool DebuggerController::Trace(const ExecutionTraceOptions& options)
+{
+	std::vector<const char*> registers = GetTraceRegisters(options);
+	return BNDebuggerTrace(m_object, options.path.c_str(), options.granularity, options.maxRecords,
+		options.stopAddresses.data(), options.stopAddresses.size(), registers.data(), registers.size());
+}
+
+
+DebugStopReason DebuggerController::TraceAndWait(const ExecutionTraceOptions& options)
+{
+	std::vector<const char*> registers = GetTraceRegisters(options);
+	return BNDebuggerTraceAndWait(m_object, options.path.c_str(), options.granularity, options.maxRecords,
+		options.stopAddresses.data(), options.stopAddresses.size(), registers.data(), registers.size());
+}
+
+
+void DebuggerController::CancelTrace()
+{
+	BNDebuggerCancelTrace(m_object);
+}
+
+
+bool DebuggerController::IsTracing()
+{
+	return BNDebuggerIsTracing(m_object);
+}
+
+
+int64_t DebuggerController::HighlightTrace(const std::string& path, BNHighlightStandardColor color)
+{
+	return BNDebuggerHighlightTrace(m_object, path.c_str(), color);
+}
+
+
 std::string DebuggerController::GetAdapterType()
 {
 	char* adapter = BNDebuggerGetAdapterType(m_object);
@@ -614,6 +857,11 @@ std::vector<DebugBreakpoint> DebuggerController::GetBreakpoints()
 		bp.offset = breakpoints[i].offset;
 		bp.address = breakpoints[i].address;
 		bp.enabled = breakpoints[i].enabled;
+		bp.condition = breakpoints[i].condition;
+		bp.logTemplate = breakpoints[i].logTemplate;
+		bp.tracepoint = breakpoints[i].tracepoint;
+		bp.ignoreCount = breakpoints[i].ignoreCount;
+		bp.hitCount = breakpoints[i].hitCount;
 		result[i] = bp;
 	}
 
@@ -646,6 +894,45 @@ void DebuggerController::AddBreakpoint(const ModuleNameAndOffset& breakpoint)
 }
 
 
+static std::vector<BNModuleNameAndOffset> ConvertRelativeAddresses(const std::vector<ModuleNameAndOffset>& breakpoints)
+{
+	// The strings are owned by the input, and only need to live until the call returns
+	std::vector<BNModuleNameAndOffset> result(breakpoints.size());
+	for (size_t i = 0; i < breakpoints.size(); i++)
+	{
+		result[i].module = const_cast<char*>(breakpoints[i].module.c_str());
+		result[i].offset = breakpoints[i].offset;
+	}
+	return result;
+}
+
+
+size_t DebuggerController::DeleteBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	return BNDebuggerDeleteAbsoluteBreakpoints(m_object, addresses.data(), addresses.size());
+}
+
+
+size_t DebuggerController::DeleteBreakpoints(const std::vector<ModuleNameAndOffset>& breakpoints)
+{
+	std::vector<BNModuleNameAndOffset> addresses = ConvertRelativeAddresses(breakpoints);
+	return BNDebuggerDeleteRelativeBreakpoints(m_object, addresses.data(), addresses.size());
+}
+
+
+size_t DebuggerController::AddBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	return BNDebuggerAddAbsoluteBreakpoints(m_object, addresses.data(), addresses.size());
+}
+
+
+size_t DebuggerController::AddBreakpoints(const std::vector<ModuleNameAndOffset>& breakpoints)
+{
+	std::vector<BNModuleNameAndOffset> addresses = ConvertRelativeAddresses(breakpoints);
+	return BNDebuggerAddRelativeBreakpoints(m_object, addresses.data(), addresses.size());
+}
+
+
 bool DebuggerController::ContainsBreakpoint(uint64_t address)
 {
 	return BNDebuggerContainsAbsoluteBreakpoint(m_object, address);
@@ -658,6 +945,181 @@ bool DebuggerController::ContainsBreakpoint(const ModuleNameAndOffset& breakpoin
 }
 
 
+bool DebuggerController::SetBreakpointCondition(uint64_t address, const std::string& condition)
+{
+	return BNDebuggerSetAbsoluteBreakpointCondition(m_object, address, condition.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointCondition(const ModuleNameAndOffset& breakpoint, const std::string& condition)
+{
+	return BNDebuggerSetRelativeBreakpointCondition(
+		m_object, breakpoint.module.c_str(), breakpoint.offset, condition.c_str());
+}
+
+
+std::string DebuggerController::GetBreakpointCondition(uint64_t address)
+{
+	char* condition = BNDebuggerGetAbsoluteBreakpointCondition(m_object, address);
+	if (!condition)
+		return "";
+
+	std::string result = condition;
+	BNDebuggerFreeString(condition);
+	return result;
+}
+
+
+std::string DebuggerController::GetBreakpointCondition(const ModuleNameAndOffset& breakpoint)
+{
+	char* condition = BNDebuggerGetRelativeBreakpointCondition(m_object, breakpoint.module.c_str(), breakpoint.offset);
+	if (!condition)
+		return "";
+
+	std::string result = condition;
+	BNDebuggerFreeString(condition);
+	return result;
+}
+
+
+bool DebuggerController::SetBreakpointTracepoint(uint64_t address, bool tracepoint)
+{
+	return BNDebuggerSetAbsoluteBreakpointTracepoint(m_object, address, tracepoint);
+}
+
+
+bool DebuggerController::SetBreakpointTracepoint(const ModuleNameAndOffset& breakpoint, bool tracepoint)
+{
+	return BNDebuggerSetRelativeBreakpointTracepoint(m_object, breakpoint.module.c_str(), breakpoint.offset, tracepoint);
+}
+
+
+bool DebuggerController::SetBreakpointLogTemplate(uint64_t address, const std::string& logTemplate)
+{
+	return BNDebuggerSetAbsoluteBreakpointLogTemplate(m_object, address, logTemplate.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointLogTemplate(const ModuleNameAndOffset& breakpoint, const std::string& logTemplate)
+{
+	return BNDebuggerSetRelativeBreakpointLogTemplate(
+		m_object, breakpoint.module.c_str(), breakpoint.offset, logTemplate.c_str());
+}
+
+
+bool DebuggerController::SetBreakpointIgnoreCount(uint64_t address, uint64_t ignoreCount)
+{
+	return BNDebuggerSetAbsoluteBreakpointIgnoreCount(m_object, address, ignoreCount);
+}
+
+
+bool DebuggerController::SetBreakpointIgnoreCount(const ModuleNameAndOffset& breakpoint, uint64_t ignoreCount)
+{
+	return BNDebuggerSetRelativeBreakpointIgnoreCount(
+		m_object, breakpoint.module.c_str(), breakpoint.offset, ignoreCount);
+}
+
+
+uint64_t DebuggerController::GetBreakpointHitCount(uint64_t address)
+{
+	return BNDebuggerGetAbsoluteBreakpointHitCount(m_object, address);
+}
+
+
+uint64_t DebuggerController::GetBreakpointHitCount(const ModuleNameAndOffset& breakpoint)
+{
+	return BNDebuggerGetRelativeBreakpointHitCount(m_object, breakpoint.module.c_str(), breakpoint.offset);
+}
+
+
+static std::vector<BreakpointRecord> ConvertBreakpointRecords(BNBreakpointRecord* records, size_t count)
+{
+	std::vector<BreakpointRecord> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		result.push_back({records[i].hit, records[i].message});
+
+	BNDebuggerFreeBreakpointRecords(records, count);
+	return result;
+}
+
+
+std::vector<BreakpointRecord> DebuggerController::GetBreakpointRecords(uint64_t address)
+{
+	size_t count;
+	BNBreakpointRecord* records = BNDebuggerGetAbsoluteBreakpointRecords(m_object, address, &count);
+	return ConvertBreakpointRecords(records, count);
+}
+
+
+std::vector<BreakpointRecord> DebuggerController::GetBreakpointRecords(const ModuleNameAndOffset& breakpoint)
+{
+	size_t count;
+	BNBreakpointRecord* records =
+		BNDebuggerGetRelativeBreakpointRecords(m_object, breakpoint.module.c_str(), breakpoint.offset, &count);
+	return ConvertBreakpointRecords(records, count);
+}
+
+
+bool DebuggerController::ResetBreakpointHits(uint64_t address)
+{
+	return BNDebuggerResetAbsoluteBreakpointHits(m_object, address);
+}
+
+
+bool DebuggerController::ResetBreakpointHits(const ModuleNameAndOffset& breakpoint)
+{
+	return BNDebuggerResetRelativeBreakpointHits(m_object, breakpoint.module.c_str(), breakpoint.offset);
+}
+
+
+std::vector<DebugWatchpoint> DebuggerController::GetWatchpoints()
+{
+	size_t count;
+	BNDebugWatchpoint* watchpoints = BNDebuggerGetWatchpoints(m_object, &count);
+
+	std::vector<DebugWatchpoint> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugWatchpoint watchpoint;
+		watchpoint.module = watchpoints[i].module;
+		watchpoint.offset = watchpoints[i].offset;
+		watchpoint.address = watchpoints[i].address;
+		watchpoint.size = watchpoints[i].size;
+		watchpoint.type = watchpoints[i].type;
+		result.push_back(watchpoint);
+	}
+
+	BNDebuggerFreeWatchpoints(watchpoints, count);
+	return result;
+}
+
+
+bool DebuggerController::AddWatchpoint(uint64_t address, size_t size, DebugWatchpointType type)
+{
+	return BNDebuggerAddAbsoluteWatchpoint(m_object, address, size, type);
+}
+
+
+bool DebuggerController::AddWatchpoint(const ModuleNameAndOffset& watchpoint, size_t size, DebugWatchpointType type)
+{
+	return BNDebuggerAddRelativeWatchpoint(m_object, watchpoint.module.c_str(), watchpoint.offset, size, type);
+}
+
+
+bool DebuggerController::DeleteWatchpoint(uint64_t address)
+{
+	return BNDebuggerDeleteAbsoluteWatchpoint(m_object, address);
+}
+
+
+bool DebuggerController::DeleteWatchpoint(const ModuleNameAndOffset& watchpoint)
+{
+	return BNDebuggerDeleteRelativeWatchpoint(m_object, watchpoint.module.c_str(), watchpoint.offset);
+}
+
+
 uint64_t DebuggerController::RelativeAddressToAbsolute(const ModuleNameAndOffset& address)
 {
 	return BNDebuggerRelativeAddressToAbsolute(m_object, address.module.c_str(), address.offset);
@@ -699,12 +1161,13 @@ uint32_t DebuggerController::GetExitCode()
 }
 
 
-size_t DebuggerController::RegisterEventCallback(
-	std::function<void(const DebuggerEvent& event)> callback, const std::string& name)
+size_t DebuggerController::RegisterEventCallback(std::function<void(const DebuggerEvent& event)> callback,
+	const std::string& name, DebuggerEventDeliveryPolicy policy)
 {
 	DebuggerEventCallbackObject* object = new DebuggerEventCallbackObject;
 	object->action = callback;
-	return BNDebuggerRegisterEventCallback(GetObject(), DebuggerEventCallback, name.c_str(), object);
+	return BNDebuggerRegisterEventCallbackWithPolicy(
+		GetObject(), DebuggerEventCallback, name.c_str(), object, policy);
 }
 
 
@@ -717,6 +1180,8 @@ void DebuggerController::DebuggerEventCallback(void* ctxt, BNDebuggerEvent* even
 	evt.data.targetStoppedData.exitCode = event->data.targetStoppedData.exitCode;
 	evt.data.targetStoppedData.lastActiveThread = event->data.targetStoppedData.lastActiveThread;
 	evt.data.targetStoppedData.data = event->data.targetStoppedData.data;
+	evt.data.targetStoppedData.watchpointAddress = event->data.targetStoppedData.watchpointAddress;
+	evt.data.targetStoppedData.watchpointType = event->data.targetStoppedData.watchpointType;
 
 	evt.data.errorData.error = string(event->data.errorData.error);
 	evt.data.errorData.shortError = string(event->data.errorData.shortError);
@@ -747,6 +1212,24 @@ void DebuggerController::WriteStdin(const std::string& msg)
 }
 
 
+DataBuffer DebuggerController::ReadTargetOutput(DebuggerOutputStream stream, size_t maxLength)
+{
+	return DataBuffer(BNDebuggerReadTargetOutput(m_object, stream, maxLength));
+}
+
+
+size_t DebuggerController::GetTargetOutputAvailable(DebuggerOutputStream stream)
+{
+	return BNDebuggerGetTargetOutputAvailable(m_object, stream);
+}
+
+
+uint64_t DebuggerController::GetTargetOutputDropped(DebuggerOutputStream stream)
+{
+	return BNDebuggerGetTargetOutputDropped(m_object, stream);
+}
+
+
 std::string DebuggerController::InvokeBackendCommand(const std::string& command)
 {
 	char* output = BNDebuggerInvokeBackendCommand(m_object, command.c_str());
@@ -801,6 +1284,30 @@ std::string DebuggerController::GetAddressInformation(uint64_t address)
 }
 
 
+std::vector<DebugStackSlot> DebuggerController::GetStackWindow(size_t before, size_t after, size_t depth)
+{
+	size_t count;
+	BNDebugStackSlot* slots = BNDebuggerGetStackWindow(m_object, before, after, depth, &count);
+
+	std::vector<DebugStackSlot> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugStackSlot slot;
+		slot.m_offset = slots[i].offset;
+		slot.m_address = slots[i].address;
+		slot.m_value = slots[i].value;
+		slot.m_valid = slots[i].valid;
+		slot.m_chain.assign(slots[i].chain, slots[i].chain + slots[i].chainCount);
+		slot.m_hint = slots[i].hint;
+		result.push_back(slot);
+	}
+	BNDebuggerFreeStackWindow(slots, count);
+
+	return result;
+}
+
+
 bool DebuggerController::IsFirstLaunch()
 {
 	return BNDebuggerIsFirstLaunch(m_object);
@@ -816,6 +1323,8 @@ void DebuggerController::PostDebuggerEvent(const DebuggerEvent &event)
 	evt->data.targetStoppedData.exitCode = event.data.targetStoppedData.exitCode;
 	evt->data.targetStoppedData.lastActiveThread = event.data.targetStoppedData.lastActiveThread;
 	evt->data.targetStoppedData.data = event.data.targetStoppedData.data;
+	evt->data.targetStoppedData.watchpointAddress = event.data.targetStoppedData.watchpointAddress;
+	evt->data.targetStoppedData.watchpointType = event.data.targetStoppedData.watchpointType;
 
 	evt->data.errorData.error = BNDebuggerAllocString(event.data.errorData.error.c_str());
 	evt->data.errorData.shortError = BNDebuggerAllocString(event.data.errorData.shortError.c_str());
@@ -116,6 +116,8 @@ extern "C"
 		size_t m_width;
 		size_t m_registerIndex;
 		char* m_hint;
+		// Whether the value differs from the one at the previous stop
+		bool m_changed;
 	} BNDebugRegister;
 
 
@@ -126,9 +128,93 @@ extern "C"
 		uint64_t offset;
 		uint64_t address;
 		bool enabled;
+		// Empty if the breakpoint is unconditional
+		char* condition;
+		// Empty if the breakpoint does not log anything
+		char* logTemplate;
+		bool tracepoint;
+		uint64_t ignoreCount;
+		uint64_t hitCount;
 	} BNDebugBreakpoint;
 
 
+	typedef enum BNDebugWatchpointType
+	{
+		WatchpointRead = 1,
+		WatchpointWrite = 2,
+		// Triggers on both reads and writes
+		WatchpointAccess = 3,
+	} BNDebugWatchpointType;
+
+
+	typedef struct BNDebugStackSlot
+	{
+		int64_t offset;
+		uint64_t address;
+		uint64_t value;
+		bool valid;
+		uint64_t* chain;
+		size_t chainCount;
+		char* hint;
+	} BNDebugStackSlot;
+
+
+	typedef struct BNDebugWatchpoint
+	{
+		char* module;
+		uint64_t offset;
+		uint64_t address;
+		size_t size;
+		BNDebugWatchpointType type;
+	} BNDebugWatchpoint;
+
+
+	typedef enum BNDebugTraceGranularity
+	{
+		TraceInstructions,
+		// Only the first instruction of every basic block that is entered is recorded
+		TraceBasicBlocks,
+	} BNDebugTraceGranularity;
+
+
+	typedef struct BNBreakpointRecord
+	{
+		uint64_t hit;
+		char* message;
+	} BNBreakpointRecord;
+
+
+	typedef struct BNDebuggerMemoryCacheStatistics
+	{
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t adapterReads;
+		uint64_t retainedPages;
+		uint64_t cachedPages;
+		uint64_t prefetchedPages;
+		uint64_t prefetchHits;
+		uint64_t unmappedReads;
+	} BNDebuggerMemoryCacheStatistics;
+
+
+	typedef struct BNDebugMemoryRegion
+	{
+		uint64_t start;
+		uint64_t end;
+		bool readable;
+		bool writable;
+		bool executable;
+		char* name;
+	} BNDebugMemoryRegion;
+
+
+	typedef struct BNDebugAddressRange
+	{
+		uint64_t start;
+		uint64_t end;
+	} BNDebugAddressRange;
+
+
 	typedef struct BNModuleNameAndOffset
 	{
 		char* module;
@@ -191,7 +277,9 @@ extern "C"
 
 		UserRequestedBreak,
 
-		OperationNotSupported
+		OperationNotSupported,
+
+		Watchpoint
 	} BNDebugStopReason;
 
 
@@ -259,6 +347,9 @@ extern "C"
 
 		ForceMemoryCacheUpdateEvent,
 		ModuleLoadedEvent,
+		// Posted once for the breakpoints added or removed in bulk. It carries no data, the current breakpoints are
+		// returned by BNDebuggerGetBreakpoints().
+		BreakpointsChangedEvent,
 	} BNDebuggerEventType;
 
 
@@ -268,6 +359,10 @@ extern "C"
 		uint32_t lastActiveThread;
 		size_t exitCode;
 		void* data;
+		// Only valid when the reason is Watchpoint. The type is the one of the watchpoint, since the adapters cannot
+		// always tell a read from a write.
+		uint64_t watchpointAddress;
+		BNDebugWatchpointType watchpointType;
 	} BNTargetStoppedEventData;
 
 
@@ -309,6 +404,26 @@ extern "C"
 		BNDebuggerEventData data;
 	} BNDebuggerEvent;
 
+
+	typedef enum BNDebuggerOutputStream
+	{
+		StdoutOutputStream,
+		StderrOutputStream,
+	} BNDebuggerOutputStream;
+
+
+	typedef enum BNDebuggerEventDeliveryPolicy
+	{
+		// The callback runs on the thread that posts the event, e.g., the listener thread of the adapter
+		InlineEventDelivery,
+		// The callback runs on the main thread, without blocking the thread that posts the event
+		MainThreadEventDelivery,
+		// The callback runs on a worker thread that is dedicated to event delivery
+		WorkerEventDelivery,
+		// The callback runs on the main thread, and the thread that posts the event waits for it. This is the default.
+		SynchronousEventDelivery,
+	} BNDebuggerEventDeliveryPolicy;
+
     typedef enum BNDebuggerAdapterOperation
     {
 		DebugAdapterLaunch,
@@ -349,6 +464,28 @@ extern "C"
 		BNDebuggerController* controller, uint64_t address, size_t size);
 	DEBUGGER_FFI_API bool BNDebuggerWriteMemory(
 		BNDebuggerController* controller, uint64_t address, BNDataBuffer* buffer);
+	DEBUGGER_FFI_API BNDebuggerMemoryCacheStatistics BNDebuggerGetMemoryCacheStatistics(
+		BNDebuggerController* controller);
+	DEBUGGER_FFI_API void BNDebuggerResetMemoryCacheStatistics(BNDebuggerController* controller);
+	DEBUGGER_FFI_API BNDebugMemoryRegion* BNDebuggerGetMemoryRegions(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeMemoryRegions(BNDebugMemoryRegion* regions, size_t count);
+	// The mask can be nullptr, in which case all bytes of the pattern must match exactly
+	DEBUGGER_FFI_API size_t BNDebuggerSearchMemory(BNDebuggerController* controller, const uint8_t* pattern,
+		const uint8_t* mask, size_t length, uint64_t start, uint64_t end, size_t maxResults, void* ctxt,
+		bool (*callback)(void* ctxt, uint64_t address));
+	DEBUGGER_FFI_API void BNDebuggerCancelMemorySearch(BNDebuggerController* controller);
+	// The progress callback can be nullptr. Returning false from it cancels, and the partial file is deleted.
+	DEBUGGER_FFI_API bool BNDebuggerSaveCoreFile(BNDebuggerController* controller, const char* path, void* ctxt,
+		bool (*progress)(void* ctxt, size_t done, size_t total));
+	DEBUGGER_FFI_API void BNDebuggerTrackMemoryChanges(BNDebuggerController* controller, uint64_t start, uint64_t end);
+	DEBUGGER_FFI_API void BNDebuggerUntrackMemoryChanges(BNDebuggerController* controller, uint64_t start, uint64_t end);
+	DEBUGGER_FFI_API BNDebugAddressRange* BNDebuggerGetTrackedMemoryRanges(
+		BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API BNDebugAddressRange* BNDebuggerGetChangedMemoryRanges(
+		BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeAddressRanges(BNDebugAddressRange* ranges);
+	DEBUGGER_FFI_API uint64_t* BNDebuggerGetChangedMemoryPages(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeChangedMemoryPages(uint64_t* pages);
 
 	DEBUGGER_FFI_API BNDebugProcess* BNDebuggerGetProcessList(BNDebuggerController* controller, size_t* count);
 	DEBUGGER_FFI_API void BNDebuggerFreeProcessList(BNDebugProcess* processes, size_t count);
@@ -363,12 +500,17 @@ extern "C"
 
 	DEBUGGER_FFI_API BNDebugFrame* BNDebuggerGetFramesOfThread(
 		BNDebuggerController* controller, uint32_t tid, size_t* count);
+	// Only unwinds the innermost maxFrames frames of the thread. A maxFrames of zero returns all frames.
+	DEBUGGER_FFI_API BNDebugFrame* BNDebuggerGetTopFramesOfThread(
+		BNDebuggerController* controller, uint32_t tid, size_t maxFrames, size_t* count);
 	DEBUGGER_FFI_API void BNDebuggerFreeFrames(BNDebugFrame* frames, size_t count);
 
 	DEBUGGER_FFI_API BNDebugModule* BNDebuggerGetModules(BNDebuggerController* controller, size_t* count);
 	DEBUGGER_FFI_API void BNDebuggerFreeModules(BNDebugModule* modules, size_t count);
 
 	DEBUGGER_FFI_API BNDebugRegister* BNDebuggerGetRegisters(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API BNDebugRegister* BNDebuggerGetRegistersWithoutHints(
+		BNDebuggerController* controller, size_t* count);
 	DEBUGGER_FFI_API void BNDebuggerFreeRegisters(BNDebugRegister* modules, size_t count);
 	DEBUGGER_FFI_API bool BNDebuggerSetRegisterValue(
 		BNDebuggerController* controller, const char* name, uint64_t value);
@@ -435,6 +577,29 @@ extern "C"
 
 	DEBUGGER_FFI_API BNDebugBreakpoint* BNDebuggerGetBreakpoints(BNDebuggerController* controller, size_t* count);
 	DEBUGGER_FFI_API void BNDebuggerFreeBreakpoints(BNDebugBreakpoint* breakpoints, size_t count);
+	DEBUGGER_FFI_API BNDebugWatchpoint* BNDebuggerGetWatchpoints(BNDebuggerController* controller, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeWatchpoints(BNDebugWatchpoint* watchpoints, size_t count);
+	DEBUGGER_FFI_API bool BNDebuggerAddAbsoluteWatchpoint(
+		BNDebuggerController* controller, uint64_t address, size_t size, BNDebugWatchpointType type);
+	DEBUGGER_FFI_API bool BNDebuggerAddRelativeWatchpoint(BNDebuggerController* controller, const char* module,
+		uint64_t offset, size_t size, BNDebugWatchpointType type);
+	DEBUGGER_FFI_API bool BNDebuggerDeleteAbsoluteWatchpoint(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API bool BNDebuggerDeleteRelativeWatchpoint(
+		BNDebuggerController* controller, const char* module, uint64_t offset);
+
+	// Execution trace
+	DEBUGGER_FFI_API bool BNDebuggerTrace(BNDebuggerController* controller, const char* path,
+		BNDebugTraceGranularity granularity, uint64_t maxRecords, const uint64_t* stopAddresses, size_t stopCount,
+		const char** registers, size_t registerCount);
+	DEBUGGER_FFI_API BNDebugStopReason BNDebuggerTraceAndWait(BNDebuggerController* controller, const char* path,
+		BNDebugTraceGranularity granularity, uint64_t maxRecords, const uint64_t* stopAddresses, size_t stopCount,
+		const char** registers, size_t registerCount);
+	DEBUGGER_FFI_API void BNDebuggerCancelTrace(BNDebuggerController* controller);
+	DEBUGGER_FFI_API bool BNDebuggerIsTracing(BNDebuggerController* controller);
+	// The color is a BNHighlightStandardColor. Returns the number of instructions highlighted, or -1 if the trace
+	// cannot be read.
+	DEBUGGER_FFI_API int64_t BNDebuggerHighlightTrace(
+		BNDebuggerController* controller, const char* path, uint32_t color);
 
 	DEBUGGER_FFI_API void BNDebuggerDeleteAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t address);
 	DEBUGGER_FFI_API void BNDebuggerDeleteRelativeBreakpoint(
@@ -442,9 +607,48 @@ extern "C"
 	DEBUGGER_FFI_API void BNDebuggerAddAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t address);
 	DEBUGGER_FFI_API void BNDebuggerAddRelativeBreakpoint(
 		BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API size_t BNDebuggerDeleteAbsoluteBreakpoints(
+		BNDebuggerController* controller, const uint64_t* addresses, size_t count);
+	DEBUGGER_FFI_API size_t BNDebuggerDeleteRelativeBreakpoints(
+		BNDebuggerController* controller, const BNModuleNameAndOffset* addresses, size_t count);
+	DEBUGGER_FFI_API size_t BNDebuggerAddAbsoluteBreakpoints(
+		BNDebuggerController* controller, const uint64_t* addresses, size_t count);
+	DEBUGGER_FFI_API size_t BNDebuggerAddRelativeBreakpoints(
+		BNDebuggerController* controller, const BNModuleNameAndOffset* addresses, size_t count);
 	DEBUGGER_FFI_API bool BNDebuggerContainsAbsoluteBreakpoint(BNDebuggerController* controller, uint64_t address);
 	DEBUGGER_FFI_API bool BNDebuggerContainsRelativeBreakpoint(
 		BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointCondition(
+		BNDebuggerController* controller, uint64_t address, const char* condition);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointCondition(
+		BNDebuggerController* controller, const char* module, uint64_t offset, const char* condition);
+	DEBUGGER_FFI_API char* BNDebuggerGetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API char* BNDebuggerGetRelativeBreakpointCondition(
+		BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointTracepoint(
+		BNDebuggerController* controller, uint64_t address, bool tracepoint);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointTracepoint(
+		BNDebuggerController* controller, const char* module, uint64_t offset, bool tracepoint);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointLogTemplate(
+		BNDebuggerController* controller, uint64_t address, const char* logTemplate);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointLogTemplate(
+		BNDebuggerController* controller, const char* module, uint64_t offset, const char* logTemplate);
+	DEBUGGER_FFI_API bool BNDebuggerSetAbsoluteBreakpointIgnoreCount(
+		BNDebuggerController* controller, uint64_t address, uint64_t ignoreCount);
+	DEBUGGER_FFI_API bool BNDebuggerSetRelativeBreakpointIgnoreCount(
+		BNDebuggerController* controller, const char* module, uint64_t offset, uint64_t ignoreCount);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetAbsoluteBreakpointHitCount(
+		BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetRelativeBreakpointHitCount(
+		BNDebuggerController* controller, const char* module, uint64_t offset);
+	DEBUGGER_FFI_API BNBreakpointRecord* BNDebuggerGetAbsoluteBreakpointRecords(
+		BNDebuggerController* controller, uint64_t address, size_t* count);
+	DEBUGGER_FFI_API BNBreakpointRecord* BNDebuggerGetRelativeBreakpointRecords(
+		BNDebuggerController* controller, const char* module, uint64_t offset, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeBreakpointRecords(BNBreakpointRecord* records, size_t count);
+	DEBUGGER_FFI_API bool BNDebuggerResetAbsoluteBreakpointHits(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API bool BNDebuggerResetRelativeBreakpointHits(
+		BNDebuggerController* controller, const char* module, uint64_t offset);
 
 	DEBUGGER_FFI_API uint64_t BNDebuggerGetIP(BNDebuggerController* controller);
 	DEBUGGER_FFI_API uint64_t BNDebuggerGetLastIP(BNDebuggerController* controller);
@@ -458,6 +662,12 @@ extern "C"
 	DEBUGGER_FFI_API uint32_t BNDebuggerGetExitCode(BNDebuggerController* controller);
 
 	DEBUGGER_FFI_API void BNDebuggerWriteStdin(BNDebuggerController* controller, const char* data, size_t len);
+	DEBUGGER_FFI_API BNDataBuffer* BNDebuggerReadTargetOutput(
+		BNDebuggerController* controller, BNDebuggerOutputStream stream, size_t maxLength);
+	DEBUGGER_FFI_API size_t BNDebuggerGetTargetOutputAvailable(
+		BNDebuggerController* controller, BNDebuggerOutputStream stream);
+	DEBUGGER_FFI_API uint64_t BNDebuggerGetTargetOutputDropped(
+		BNDebuggerController* controller, BNDebuggerOutputStream stream);
 
 	DEBUGGER_FFI_API char* BNDebuggerInvokeBackendCommand(BNDebuggerController* controller, const char* cmd);
 
@@ -467,6 +677,9 @@ extern "C"
 	DEBUGGER_FFI_API bool BNDebuggerActivateDebugAdapter(BNDebuggerController* controller);
 
 	DEBUGGER_FFI_API char* BNDebuggerGetAddressInformation(BNDebuggerController* controller, uint64_t address);
+	DEBUGGER_FFI_API BNDebugStackSlot* BNDebuggerGetStackWindow(
+		BNDebuggerController* controller, size_t before, size_t after, size_t depth, size_t* count);
+	DEBUGGER_FFI_API void BNDebuggerFreeStackWindow(BNDebugStackSlot* slots, size_t count);
 	DEBUGGER_FFI_API bool BNDebuggerIsFirstLaunch(BNDebuggerController* controller);
 
 	DEBUGGER_FFI_API void BNDebuggerPostDebuggerEvent(BNDebuggerController* controller, BNDebuggerEvent* event);
@@ -485,6 +698,9 @@ extern "C"
 	// Debugger events
 	DEBUGGER_FFI_API size_t BNDebuggerRegisterEventCallback(BNDebuggerController* controller,
 		void (*callback)(void* ctx, BNDebuggerEvent* event), const char* name, void* ctx);
+	DEBUGGER_FFI_API size_t BNDebuggerRegisterEventCallbackWithPolicy(BNDebuggerController* controller,
+		void (*callback)(void* ctx, BNDebuggerEvent* event), const char* name, void* ctx,
+		BNDebuggerEventDeliveryPolicy policy);
 	DEBUGGER_FFI_API void BNDebuggerRemoveEventCallback(BNDebuggerController* controller, size_t index);
 
 	DEBUGGER_FFI_API BNMetadata* BNDebuggerGetAdapterProperty(BNDebuggerController* controller, const char* name);
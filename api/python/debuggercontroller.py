@@ -20,7 +20,7 @@ import binaryninja
 # import debugger
 from . import _debuggercore as dbgcore
 from .debugger_enums import *
-from typing import Callable, List
+from typing import Callable, List, Tuple
 
 
 class DebugProcess:
@@ -153,14 +153,16 @@ class DebugRegister:
     * ``index``: the index of the register. This is reported by the DebugAdapter and should remain unchanged
     * ``hint``: a string that shows the content of the memory pointed to by the register. It is empty if the register\
                 value do not point to a valid (mapped) memory region
+    * ``changed``: whether the value differs from the one at the previous stop
 
     """
-    def __init__(self, name, value, width, index, hint):
+    def __init__(self, name, value, width, index, hint, changed=False):
         self.name = name
         self.value = value
         self.width = width
         self.index = index
         self.hint = hint
+        self.changed = changed
 
     def __eq__(self, other):
         if not isinstance(other, self.__class__):
@@ -191,14 +193,18 @@ class DebugRegisters:
     """
     DebugRegisters represents all registers of the target.
     """
-    def __init__(self, handle):
+    def __init__(self, handle, hints: bool = True):
         self.handle = handle
         self.regs = {}
         count = ctypes.c_ulonglong()
-        registers = dbgcore.BNDebuggerGetRegisters(handle, count)
+        if hints:
+            registers = dbgcore.BNDebuggerGetRegisters(handle, count)
+        else:
+            registers = dbgcore.BNDebuggerGetRegistersWithoutHints(handle, count)
         for i in range(0, count.value):
             bp = DebugRegister(registers[i].m_name, registers[i].m_value,
-                               registers[i].m_width, registers[i].m_registerIndex, registers[i].m_hint)
+                               registers[i].m_width, registers[i].m_registerIndex, registers[i].m_hint,
+                               registers[i].m_changed)
             self.regs[registers[i].m_name] = bp
         dbgcore.BNDebuggerFreeRegisters(registers, count.value)
 
@@ -226,19 +232,32 @@ class DebugBreakpoint:
     * ``offset``: the offset of the breakpoint to the start of the module
     * ``address``: the absolute address of the breakpoint
     * ``enabled``: not used
+    * ``condition``: the condition of the breakpoint, or an empty string if it is unconditional
+    * ``log_template``: the message that is recorded on every hit, or an empty string
+    * ``tracepoint``: whether the breakpoint never stops the target
+    * ``ignore_count``: the number of hits that do not stop the target
+    * ``hit_count``: the number of times the breakpoint is hit while the target runs
 
     """
-    def __init__(self, module, offset, address, enabled):
+    def __init__(self, module, offset, address, enabled, condition='', log_template='', tracepoint=False,
+                 ignore_count=0, hit_count=0):
         self.module = module
         self.offset = offset
         self.address = address
         self.enabled = enabled
+        self.condition = condition
+        self.log_template = log_template
+        self.tracepoint = tracepoint
+        self.ignore_count = ignore_count
+        self.hit_count = hit_count
 
     def __eq__(self, other):
         if not isinstance(other, self.__class__):
             return NotImplemented
         return self.module == other.module and self.offset == other.offset and self.address == other.address \
-               and self.enabled == other.enabled
+               and self.enabled == other.enabled and self.condition == other.condition \
+               and self.log_template == other.log_template and self.tracepoint == other.tracepoint \
+               and self.ignore_count == other.ignore_count
 
     def __ne__(self, other):
         if not isinstance(other, self.__class__):
@@ -258,6 +277,90 @@ class DebugBreakpoint:
         return f"<DebugBreakpoint: {self.module}:{self.offset:#x}, {self.address:#x}>"
 
 
+class BreakpointRecord:
+    """
+    BreakpointRecord is a message recorded by a tracepoint. It has the following fields:
+
+    * ``hit``: the number of the hit that recorded the message, starting from 1
+    * ``message``: the log template of the tracepoint, with the placeholders filled in
+
+    """
+    def __init__(self, hit, message):
+        self.hit = hit
+        self.message = message
+
+    def __eq__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return self.hit == other.hit and self.message == other.message
+
+    def __repr__(self):
+        return f"<BreakpointRecord: #{self.hit}, {self.message}>"
+
+
+class DebugWatchpoint:
+    """
+    DebugWatchpoint represents a hardware watchpoint in the target. It has the following fields:
+
+    * ``module``: the name of the module for which the watchpoint is in
+    * ``offset``: the offset of the watchpoint to the start of the module
+    * ``address``: the absolute address of the watchpoint
+    * ``size``: the number of bytes that are watched, which is 1, 2, 4 or 8
+    * ``type``: whether the watchpoint triggers on reads, writes, or both
+
+    """
+    def __init__(self, module, offset, address, size, type):
+        self.module = module
+        self.offset = offset
+        self.address = address
+        self.size = size
+        self.type = type
+
+    def __eq__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return self.module == other.module and self.offset == other.offset and self.address == other.address \
+               and self.size == other.size and self.type == other.type
+
+    def __repr__(self):
+        return f"<DebugWatchpoint: {self.module}:{self.offset:#x}, {self.address:#x}, {self.size} bytes, {self.type}>"
+
+
+class DebugStackSlot:
+    """
+    DebugStackSlot represents a slot of the stack window. It has the following fields:
+
+    * ``offset``: the offset of the slot to the stack pointer
+    * ``address``: the address of the slot
+    * ``value``: the value in the slot
+    * ``valid``: whether the slot could be read
+    * ``chain``: the values read by dereferencing the value over and over, e.g., ``*value`` and ``**value``
+    * ``hint``: what the last value of the chain is, e.g., a string or a symbol
+
+    """
+    def __init__(self, offset, address, value, valid, chain, hint):
+        self.offset = offset
+        self.address = address
+        self.value = value
+        self.valid = valid
+        self.chain = chain
+        self.hint = hint
+
+    def __eq__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return self.offset == other.offset and self.address == other.address and self.value == other.value \
+               and self.valid == other.valid and self.chain == other.chain and self.hint == other.hint
+
+    def __repr__(self):
+        if not self.valid:
+            return f"<DebugStackSlot: {self.offset:#x}, {self.address:#x}, ??>"
+        telescope = " -> ".join(f"{value:#x}" for value in [self.value] + self.chain)
+        if self.hint:
+            telescope += f" -> {self.hint}"
+        return f"<DebugStackSlot: {self.offset:#x}, {self.address:#x}, {telescope}>"
+
+
 class ModuleNameAndOffset:
     """
     ModuleNameAndOffset represents an address that is relative to the start of module. It is useful when ASLR is on.
@@ -352,6 +455,135 @@ class DebugFrame:
         return f"<DebugFrame: {self.module}`{self.func_name} + {offset:#x}, sp: {self.sp:#x}, fp: {self.fp:#x}>"
 
 
+class DebugMemoryCacheStatistics:
+    """
+    DebugMemoryCacheStatistics reports how effective the debugger memory cache is. It has the following fields:
+
+    * ``hits``: number of page lookups served from the cache
+    * ``misses``: number of page lookups that had to read from the target
+    * ``adapter_reads``: number of memory reads sent to the debug adapter
+    * ``retained_pages``: number of read-only or executable pages kept in the cache at the last resume of the target
+    * ``cached_pages``: number of pages currently in the cache
+    * ``prefetched_pages``: number of pages read ahead of time by the prefetcher
+    * ``prefetch_hits``: number of prefetched pages that were actually requested afterwards
+    * ``unmapped_reads``: number of reads rejected without asking the target, because the memory map says they are \
+      unmapped
+
+    """
+    def __init__(self, hits, misses, adapter_reads, retained_pages, cached_pages, prefetched_pages, prefetch_hits,
+                 unmapped_reads=0):
+        self.hits = hits
+        self.misses = misses
+        self.adapter_reads = adapter_reads
+        self.retained_pages = retained_pages
+        self.cached_pages = cached_pages
+        self.prefetched_pages = prefetched_pages
+        self.prefetch_hits = prefetch_hits
+        self.unmapped_reads = unmapped_reads
+
+    def __repr__(self):
+        return f"<DebugMemoryCacheStatistics: {self.hits} hits, {self.misses} misses, " \
+               f"{self.adapter_reads} adapter reads, {self.cached_pages} pages>"
+
+
+class DebugMemoryRegion:
+    """
+    DebugMemoryRegion represents a mapped range of the target's address space. It has the following fields:
+
+    * ``start``: the start address of the region
+    * ``end``: the end address of the region, which is not part of it
+    * ``readable``: whether the region is readable
+    * ``writable``: whether the region is writable
+    * ``executable``: whether the region is executable
+    * ``name``: the file that backs the region, or an empty string
+
+    """
+    def __init__(self, start, end, readable, writable, executable, name):
+        self.start = start
+        self.end = end
+        self.readable = readable
+        self.writable = writable
+        self.executable = executable
+        self.name = name
+
+    def __eq__(self, other):
+        if not isinstance(other, self.__class__):
+            return NotImplemented
+        return self.start == other.start and self.end == other.end and self.readable == other.readable \
+               and self.writable == other.writable and self.executable == other.executable and self.name == other.name
+
+    def __repr__(self):
+        permissions = ("r" if self.readable else "-") + ("w" if self.writable else "-") \
+                      + ("x" if self.executable else "-")
+        return f"<DebugMemoryRegion: {self.start:#x}-{self.end:#x} {permissions} {self.name}>"
+
+
+class DebugMemorySearchPattern:
+    """
+    DebugMemorySearchPattern is a byte pattern to search the memory for. It has the following fields:
+
+    * ``data``: the bytes of the pattern
+    * ``mask``: the mask of the pattern, as long as ``data``. A mask byte of 0xff is an exact byte and 0x00 is a \
+      wildcard.
+
+    """
+    def __init__(self, data: bytes, mask: bytes = None):
+        self.data = bytes(data)
+        self.mask = bytes(mask) if mask is not None else b'\xff' * len(self.data)
+        if len(self.mask) != len(self.data):
+            raise ValueError("the mask must be as long as the pattern")
+
+    @classmethod
+    def from_hex(cls, pattern: str) -> 'DebugMemorySearchPattern':
+        """
+        Create a pattern from hex bytes separated by optional whitespace, where a ``?`` nibble is a wildcard, e.g.,
+        ``"48 8b ?? 05 1?"``.
+        """
+        digits = ''.join(pattern.split())
+        if not digits or len(digits) % 2 != 0:
+            raise ValueError(f"invalid hex pattern: {pattern}")
+
+        data = bytearray()
+        mask = bytearray()
+        for i in range(0, len(digits), 2):
+            byte = 0
+            byte_mask = 0
+            for c in digits[i:i + 2]:
+                byte <<= 4
+                byte_mask <<= 4
+                if c != '?':
+                    try:
+                        byte |= int(c, 16)
+                    except ValueError:
+                        raise ValueError(f"invalid hex pattern: {pattern}")
+                    byte_mask |= 0xf
+            data.append(byte)
+            mask.append(byte_mask)
+        return cls(data, mask)
+
+    @classmethod
+    def from_int(cls, value: int, size: int = 8, byteorder: str = 'little') -> 'DebugMemorySearchPattern':
+        """
+        Create a pattern from the lowest ``size`` bytes of an integer
+        """
+        return cls((value & ((1 << (8 * size)) - 1)).to_bytes(size, byteorder))
+
+    @classmethod
+    def from_str(cls, value: str, encoding: str = 'utf-8') -> 'DebugMemorySearchPattern':
+        """
+        Create a pattern from the characters of a string, without a terminator, e.g., ``encoding='utf-16-le'`` for
+        wide strings
+        """
+        return cls(value.encode(encoding))
+
+    def __len__(self):
+        return len(self.data)
+
+    def __repr__(self):
+        return "<DebugMemorySearchPattern: " + " ".join(
+            "??" if m == 0 else f"{d:02x}" for d, m in zip(self.data, self.mask)) + ">"
+
+
 class TargetStoppedEventData:
     """
     TargetStoppedEventData is the data associated with a TargetStoppedEvent
@@ -360,13 +592,18 @@ class TargetStoppedEventData:
     * ``last_active_thread``: not used
     * ``exit_code``: not used
     * ``data``: extra data. Not used.
+    * ``watchpoint_address``: the address of the watchpoint that is hit, when the reason is ``Watchpoint``
+    * ``watchpoint_type``: the type of the watchpoint that is hit, when the reason is ``Watchpoint``
 
     """
-    def __init__(self, reason: DebugStopReason, last_active_thread: int, exit_code: int, data):
+    def __init__(self, reason: DebugStopReason, last_active_thread: int, exit_code: int, data,
+                 watchpoint_address: int = 0, watchpoint_type: DebugWatchpointType = 0):
         self.reason = reason
         self.last_active_thread = last_active_thread
         self.exit_code = exit_code
         self.data = data
+        self.watchpoint_address = watchpoint_address
+        self.watchpoint_type = watchpoint_type
 
 
 class ErrorEventData:
@@ -453,10 +690,11 @@ class DebuggerEventWrapper:
     _debugger_events = {}
 
     @classmethod
-    def register(cls, controller: 'DebuggerController', callback: DebuggerEventCallback, name: str) -> int:
+    def register(cls, controller: 'DebuggerController', callback: DebuggerEventCallback, name: str,
+                 policy: DebuggerEventDeliveryPolicy) -> int:
         callback_obj = ctypes.CFUNCTYPE(None, ctypes.c_void_p, ctypes.POINTER(dbgcore.BNDebuggerEvent))\
                                         (lambda ctxt, event: cls._notify(event[0], callback))
-        handle = dbgcore.BNDebuggerRegisterEventCallback(controller.handle, callback_obj, name, None)
+        handle = dbgcore.BNDebuggerRegisterEventCallbackWithPolicy(controller.handle, callback_obj, name, None, policy)
         cls._debugger_events[handle] = callback_obj
         return handle
 
@@ -475,7 +713,9 @@ class DebuggerEventWrapper:
             target_stopped_data = TargetStoppedEventData(data.targetStoppedData.reason,
                                                          data.targetStoppedData.lastActiveThread,
                                                          data.targetStoppedData.exitCode,
-                                                         data.targetStoppedData.data)
+                                                         data.targetStoppedData.data,
+                                                         data.targetStoppedData.watchpointAddress,
+                                                         data.targetStoppedData.watchpointType)
             error_data = ErrorEventData(data.errorData.error, data.errorData.data)
             absolute_addr = data.absoluteAddress
             relative_addr = ModuleNameAndOffset(data.relativeAddress.module, data.relativeAddress.offset)
@@ -620,6 +860,177 @@ class DebuggerController:
         buffer_obj = ctypes.cast(buffer.handle, ctypes.POINTER(dbgcore.BNDataBuffer))
         return dbgcore.BNDebuggerWriteMemory(self.handle, address, buffer_obj)
 
+    @property
+    def memory_cache_statistics(self) -> DebugMemoryCacheStatistics:
+        """
+        Statistics of the memory cache (read-only). They are useful for finding out how many reads each stop of the
+        target costs.
+        """
+        stats = dbgcore.BNDebuggerGetMemoryCacheStatistics(self.handle)
+        return DebugMemoryCacheStatistics(stats.hits, stats.misses, stats.adapterReads, stats.retainedPages,
+                                          stats.cachedPages, stats.prefetchedPages, stats.prefetchHits,
+                                          stats.unmappedReads)
+
+    @property
+    def memory_regions(self) -> List[DebugMemoryRegion]:
+        """
+        The mapped regions of the target, sorted by their start (read-only). The list is empty if the adapter does not
+        know the memory map.
+
+        The memory map is cached, and it is refreshed when a module is loaded. Reads of addresses that are not in it
+        are rejected without asking the target.
+        """
+        count = ctypes.c_ulonglong()
+        regions = dbgcore.BNDebuggerGetMemoryRegions(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            result.append(DebugMemoryRegion(regions[i].start, regions[i].end, regions[i].readable,
+                                            regions[i].writable, regions[i].executable, regions[i].name))
+
+        dbgcore.BNDebuggerFreeMemoryRegions(regions, count.value)
+        return result
+
+    def reset_memory_cache_statistics(self) -> None:
+        """
+        Reset the statistics of the memory cache. The cached memory content is not affected.
+        """
+        dbgcore.BNDebuggerResetMemoryCacheStatistics(self.handle)
+
+    def search(self, pattern, start: int = 0, end: int = 0xffffffffffffffff, limit: int = 0,
+               match_callback: Callable[[int], bool] = None) -> List[int]:
+        """
+        Search the readable memory within [start, end) for a pattern, and return the addresses of the matches in
+        ascending order. The target must be stopped.
+
+        The pattern is either a ``DebugMemorySearchPattern``, ``bytes``, or a hex string like ``"48 8b ?? 05"``. The
+        search stops after ``limit`` matches, unless ``limit`` is 0. If ``match_callback`` is given, it is called
+        with the address of every match as it is found, and the search stops when it returns False.
+
+        The search runs on the calling thread and blocks until it is done. Call ``cancel_search()`` from another
+        thread to stop it early.
+
+        :param pattern: the pattern to search for
+        :param start: the start of the range to search
+        :param end: the end of the range to search, which is not part of it
+        :param limit: the maximum number of matches, or 0 for no limit
+        :param match_callback: called with the address of every match
+        :return: the addresses of the matches
+        """
+        if isinstance(pattern, str):
+            pattern = DebugMemorySearchPattern.from_hex(pattern)
+        elif not isinstance(pattern, DebugMemorySearchPattern):
+            pattern = DebugMemorySearchPattern(pattern)
+        if len(pattern) == 0:
+            return []
+
+        result = []
+
+        def on_match(ctxt, address):
+            try:
+                result.append(address)
+                if match_callback is not None:
+                    return match_callback(address) is not False
+                return True
+            except:
+                binaryninja.log_error(traceback.format_exc())
+                return False
+
+        callback_obj = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.c_ulonglong)(on_match)
+        data = (ctypes.c_ubyte * len(pattern))(*pattern.data)
+        mask = (ctypes.c_ubyte * len(pattern))(*pattern.mask)
+        dbgcore.BNDebuggerSearchMemory(self.handle, data, mask, len(pattern), start, end, limit, None, callback_obj)
+        return result
+
+    def cancel_search(self) -> None:
+        """
+        Stop the memory searches that are running. The searches return the matches found so far.
+        """
+        dbgcore.BNDebuggerCancelMemorySearch(self.handle)
+
+    def save_core_file(self, path: str, progress_callback: Callable[[int, int], bool] = None) -> bool:
+        """
+        Save the memory, the registers of all threads and the modules of the stopped target into an ELF core file,
+        which can be loaded by gdb, lldb, or the debugger itself later.
+
+        The memory is streamed into the file, so saving a large process does not need as much memory. Each readable
+        region is written in full; the parts that cannot be read are filled with zeros.
+
+        :param path: the path of the core file
+        :param progress_callback: called with the number of bytes written so far and the total. Return False to \
+            cancel, in which case the partial file is deleted.
+        :return: whether the core file is saved
+        """
+        if progress_callback is None:
+            return dbgcore.BNDebuggerSaveCoreFile(self.handle, path, None, None)
+
+        def on_progress(ctxt, done, total):
+            try:
+                return progress_callback(done, total) is not False
+            except:
+                binaryninja.log_error(traceback.format_exc())
+                return False
+
+        callback_obj = ctypes.CFUNCTYPE(ctypes.c_bool, ctypes.c_void_p, ctypes.c_ulonglong, ctypes.c_ulonglong)\
+            (on_progress)
+        return dbgcore.BNDebuggerSaveCoreFile(self.handle, path, None, callback_obj)
+
+    def track_memory_changes(self, start: int, end: int) -> None:
+        """
+        Hash the memory within [start, end) at every stop, to find out what changed since the previous stop. The
+        range is extended to whole pages. Every stop reads the whole tracked memory, so only track the ranges of
+        interest, e.g., a heap buffer or the data section of a module.
+
+        The changes are read from ``changed_memory_ranges`` and ``changed_memory_pages`` after the next stop. With
+        memory tracked, the debugger view only updates the analysis of the ranges that changed.
+
+        :param start: the start of the range to track
+        :param end: the end of the range to track, which is not part of it
+        """
+        dbgcore.BNDebuggerTrackMemoryChanges(self.handle, start, end)
+
+    def untrack_memory_changes(self, start: int = 0, end: int = 0xffffffffffffffff) -> None:
+        """
+        Stop tracking the memory within [start, end). By default, nothing is tracked anymore.
+
+        :param start: the start of the range to stop tracking
+        :param end: the end of the range to stop tracking, which is not part of it
+        """
+        dbgcore.BNDebuggerUntrackMemoryChanges(self.handle, start, end)
+
+    @property
+    def tracked_memory_ranges(self) -> List[Tuple[int, int]]:
+        """
+        The (start, end) ranges whose changes are tracked, sorted by their start (read-only)
+        """
+        count = ctypes.c_ulonglong()
+        ranges = dbgcore.BNDebuggerGetTrackedMemoryRanges(self.handle, count)
+        result = [(ranges[i].start, ranges[i].end) for i in range(0, count.value)]
+        dbgcore.BNDebuggerFreeAddressRanges(ranges)
+        return result
+
+    @property
+    def changed_memory_ranges(self) -> List[Tuple[int, int]]:
+        """
+        The (start, end) ranges of the tracked memory that changed between the last two stops, sorted by their start
+        (read-only). The ranges are accurate to 256 bytes, since only the hashes of the memory are kept.
+        """
+        count = ctypes.c_ulonglong()
+        ranges = dbgcore.BNDebuggerGetChangedMemoryRanges(self.handle, count)
+        result = [(ranges[i].start, ranges[i].end) for i in range(0, count.value)]
+        dbgcore.BNDebuggerFreeAddressRanges(ranges)
+        return result
+
+    @property
+    def changed_memory_pages(self) -> List[int]:
+        """
+        The start addresses of the tracked pages that changed between the last two stops, sorted (read-only)
+        """
+        count = ctypes.c_ulonglong()
+        pages = dbgcore.BNDebuggerGetChangedMemoryPages(self.handle, count)
+        result = [pages[i] for i in range(0, count.value)]
+        dbgcore.BNDebuggerFreeChangedMemoryPages(pages)
+        return result
+
     @property
     def processes(self) -> List[DebugProcess]:
         """
@@ -707,6 +1118,18 @@ class DebuggerController:
         """
         return DebugRegisters(self.handle)
 
+    def get_registers(self, hints: bool = True) -> DebugRegisters:
+        """
+        All registers of the target
+
+        The hints read the memory the registers point to, which makes them much slower than the values. Pass
+        ``hints=False`` if only the values are needed.
+
+        :param hints: whether to compute the ``hint`` of each register
+        :return: a list of ``DebugRegister``
+        """
+        return DebugRegisters(self.handle, hints)
+
     def get_reg_value(self, reg: str) -> int:
         """
         Get the value of one register by its name
@@ -1021,6 +1444,75 @@ class DebuggerController:
         """
         dbgcore.BNDebuggerPauseAndWait(self.handle)
 
+    def _trace_arguments(self, path: str, granularity, max_records: int, stop_addresses, registers):
+        if isinstance(stop_addresses, int):
+            stop_addresses = [stop_addresses]
+        addr_list = (ctypes.c_uint64 * len(stop_addresses))()
+        for i in range(len(stop_addresses)):
+            addr_list[i] = stop_addresses[i]
+
+        reg_list = (ctypes.c_char_p * len(registers))()
+        for i in range(len(registers)):
+            reg_list[i] = registers[i].encode('utf-8')
+
+        return self.handle, path, granularity, max_records, addr_list, len(stop_addresses), reg_list, len(registers)
+
+    def trace(self, path: str, granularity: DebugTraceGranularity = DebugTraceGranularity.TraceInstructions,
+              max_records: int = 0, stop_addresses=[], registers: List[str] = []) -> bool:
+        """
+        Record the executed instructions to a trace file, by stepping the target in a tight loop. This is much faster
+        than calling ``step_into`` repeatedly, since the debugger event callbacks only see the start and the end of the
+        trace. Pausing the target cancels the trace.
+
+        The call is asynchronous and returns before the trace ends. See ``trace_and_wait`` for the parameters.
+        """
+        return dbgcore.BNDebuggerTrace(*self._trace_arguments(path, granularity, max_records, stop_addresses,
+                                                              registers))
+
+    def trace_and_wait(self, path: str, granularity: DebugTraceGranularity = DebugTraceGranularity.TraceInstructions,
+                       max_records: int = 0, stop_addresses=[], registers: List[str] = []) -> DebugStopReason:
+        """
+        Record the executed instructions to a trace file, by stepping the target in a tight loop. This is much faster
+        than calling ``step_into_and_wait`` repeatedly, since the debugger event callbacks only see the start and the
+        end of the trace.
+
+        The call is blocking and only returns when the trace ends.
+
+        :param path: the trace file to create
+        :param granularity: ``TraceInstructions`` records every instruction. ``TraceBasicBlocks`` only records the first
+            instruction of every basic block, and runs through the rest of the block at full speed.
+        :param max_records: the trace ends after this many records. 0 means no limit.
+        :param stop_addresses: the trace ends when it reaches any of these addresses. It also ends at breakpoints.
+        :param registers: the names of the registers whose changes are recorded along with the addresses
+        :return: the reason the trace ends
+        """
+        return DebugStopReason(dbgcore.BNDebuggerTraceAndWait(*self._trace_arguments(path, granularity, max_records,
+                                                                                     stop_addresses, registers)))
+
+    def cancel_trace(self) -> None:
+        """
+        Cancel the running trace. The trace file keeps the records up to this point.
+        """
+        dbgcore.BNDebuggerCancelTrace(self.handle)
+
+    @property
+    def is_tracing(self) -> bool:
+        """
+        Whether a trace is running
+        """
+        return dbgcore.BNDebuggerIsTracing(self.handle)
+
+    def highlight_trace(self, path: str, color=binaryninja.HighlightStandardColor.BlueHighlightColor) -> int:
+        """
+        Highlight the instructions in a trace file in the live view. Use ``HighlightStandardColor.NoHighlightColor``
+        to remove the highlights.
+
+        :param path: the trace file
+        :param color: the color of the highlights
+        :return: the number of instructions highlighted, or -1 if the trace file cannot be read
+        """
+        return dbgcore.BNDebuggerHighlightTrace(self.handle, path, int(color))
+
     @property
     def adapter_type(self) -> str:
         """
@@ -1196,7 +1688,9 @@ class DebuggerController:
         breakpoints = dbgcore.BNDebuggerGetBreakpoints(self.handle, count)
         result = []
         for i in range(0, count.value):
-            bp = DebugBreakpoint(breakpoints[i].module, breakpoints[i].offset, breakpoints[i].address, breakpoints[i].enabled)
+            bp = DebugBreakpoint(breakpoints[i].module, breakpoints[i].offset, breakpoints[i].address,
+                                 breakpoints[i].enabled, breakpoints[i].condition, breakpoints[i].logTemplate,
+                                 breakpoints[i].tracepoint, breakpoints[i].ignoreCount, breakpoints[i].hitCount)
             result.append(bp)
 
         dbgcore.BNDebuggerFreeBreakpoints(breakpoints, count.value)
@@ -1234,6 +1728,64 @@ class DebuggerController:
         else:
             raise NotImplementedError
 
+    def _split_breakpoint_addresses(self, addresses):
+        absolute = []
+        relative = []
+        for address in addresses:
+            if isinstance(address, int):
+                absolute.append(address)
+            elif isinstance(address, ModuleNameAndOffset):
+                relative.append(address)
+            else:
+                raise NotImplementedError
+
+        absolute_list = (ctypes.c_uint64 * len(absolute))()
+        for i in range(len(absolute)):
+            absolute_list[i] = absolute[i]
+
+        relative_list = (dbgcore.BNModuleNameAndOffset * len(relative))()
+        for i in range(len(relative)):
+            relative_list[i].module = relative[i].module
+            relative_list[i].offset = relative[i].offset
+
+        return absolute_list, relative_list
+
+    def delete_breakpoints(self, addresses) -> int:
+        """
+        Delete a list of breakpoints
+
+        This is much faster than calling ``delete_breakpoint`` repeatedly, since the breakpoint metadata is only
+        updated once. Each element can be either an absolute address, or a ModuleNameAndOffset.
+
+        :param addresses: the addresses of breakpoints to delete
+        :return: the number of breakpoints deleted
+        """
+        absolute, relative = self._split_breakpoint_addresses(addresses)
+        result = 0
+        if len(absolute) > 0:
+            result += dbgcore.BNDebuggerDeleteAbsoluteBreakpoints(self.handle, absolute, len(absolute))
+        if len(relative) > 0:
+            result += dbgcore.BNDebuggerDeleteRelativeBreakpoints(self.handle, relative, len(relative))
+        return result
+
+    def add_breakpoints(self, addresses) -> int:
+        """
+        Add a list of breakpoints
+
+        This is much faster than calling ``add_breakpoint`` repeatedly, since the breakpoint metadata is only
+        updated once. Each element can be either an absolute address, or a ModuleNameAndOffset.
+
+        :param addresses: the addresses of breakpoints to add
+        :return: the number of breakpoints added
+        """
+        absolute, relative = self._split_breakpoint_addresses(addresses)
+        result = 0
+        if len(absolute) > 0:
+            result += dbgcore.BNDebuggerAddAbsoluteBreakpoints(self.handle, absolute, len(absolute))
+        if len(relative) > 0:
+            result += dbgcore.BNDebuggerAddRelativeBreakpoints(self.handle, relative, len(relative))
+        return result
+
     def has_breakpoint(self, address) -> bool:
         """
         Checks whether a breakpoint exists at the specified address
@@ -1250,6 +1802,200 @@ class DebuggerController:
         else:
             raise NotImplementedError
 
+    def set_breakpoint_condition(self, address, condition: str) -> bool:
+        """
+        Set the condition of a breakpoint. The target only stops at the breakpoint when the condition is non-zero.
+
+        The condition is compiled once, and evaluated in the debugger core without notifying the UI, so it is cheap
+        even for breakpoints that are hit very often. It supports numbers, register names, ``[expr]`` to read a
+        pointer-sized value (``byte[expr]``, ``word[expr]``, ``dword[expr]`` and ``qword[expr]`` for other sizes),
+        and the C arithmetic, comparison and logical operators, e.g., ``rdi == 0x1234 && [rsp + 8] > 5``.
+
+        The address can be either an absolute address, or a ModuleNameAndOffset.
+
+        :param address: the address of the breakpoint
+        :param condition: the condition, or an empty string to make the breakpoint unconditional
+        :return: False if there is no breakpoint at the address, or the condition is invalid
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointCondition(self.handle, address, condition)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointCondition(self.handle, address.module, address.offset,
+                                                                    condition)
+        else:
+            raise NotImplementedError
+
+    def get_breakpoint_condition(self, address) -> str:
+        """
+        Get the condition of a breakpoint, or an empty string if it is unconditional
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerGetAbsoluteBreakpointCondition(self.handle, address)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerGetRelativeBreakpointCondition(self.handle, address.module, address.offset)
+        else:
+            raise NotImplementedError
+
+    def set_tracepoint(self, address, tracepoint: bool = True) -> bool:
+        """
+        Turn a breakpoint into a tracepoint, or back into a breakpoint
+
+        A tracepoint never stops the target. Every hit is counted, and if the breakpoint has a log template, the
+        message is recorded, see ``set_breakpoint_log_template``. This is handled in the debugger core without
+        notifying the UI, so it keeps up with thousands of hits per second.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :param tracepoint: whether the breakpoint is a tracepoint
+        :return: False if there is no breakpoint at the address
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointTracepoint(self.handle, address, tracepoint)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointTracepoint(self.handle, address.module, address.offset,
+                                                                     tracepoint)
+        else:
+            raise NotImplementedError
+
+    def set_breakpoint_log_template(self, address, log_template: str) -> bool:
+        """
+        Set the message that a breakpoint records every time it is hit, e.g., ``open({rdi:s}, {rsi})``
+
+        The placeholders are expressions with the syntax of the breakpoint conditions. ``{expr}`` prints the value in
+        hex, ``{expr:d}`` in decimal, and ``{expr:s}`` prints the C string at the address. Use ``{{`` and ``}}`` for
+        literal braces. The recorded messages are returned by ``get_breakpoint_records``.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :param log_template: the template, or an empty string to stop recording
+        :return: False if there is no breakpoint at the address, or the template is invalid
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointLogTemplate(self.handle, address, log_template)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointLogTemplate(self.handle, address.module, address.offset,
+                                                                      log_template)
+        else:
+            raise NotImplementedError
+
+    def set_breakpoint_ignore_count(self, address, ignore_count: int) -> bool:
+        """
+        Let the target run through the first ``ignore_count`` hits of a breakpoint. The hits are still counted.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :param ignore_count: the number of hits to ignore
+        :return: False if there is no breakpoint at the address
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerSetAbsoluteBreakpointIgnoreCount(self.handle, address, ignore_count)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerSetRelativeBreakpointIgnoreCount(self.handle, address.module, address.offset,
+                                                                      ignore_count)
+        else:
+            raise NotImplementedError
+
+    def get_breakpoint_hit_count(self, address) -> int:
+        """
+        Get the number of times a breakpoint is hit while the target runs. Hits that fail the condition of the
+        breakpoint are not counted.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerGetAbsoluteBreakpointHitCount(self.handle, address)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerGetRelativeBreakpointHitCount(self.handle, address.module, address.offset)
+        else:
+            raise NotImplementedError
+
+    def get_breakpoint_records(self, address) -> List[BreakpointRecord]:
+        """
+        Get the messages recorded by a breakpoint with a log template. Only the latest messages are kept, see the
+        ``debugger.tracepointBufferSize`` setting.
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        """
+        count = ctypes.c_ulonglong()
+        if isinstance(address, int):
+            records = dbgcore.BNDebuggerGetAbsoluteBreakpointRecords(self.handle, address, count)
+        elif isinstance(address, ModuleNameAndOffset):
+            records = dbgcore.BNDebuggerGetRelativeBreakpointRecords(self.handle, address.module, address.offset,
+                                                                     count)
+        else:
+            raise NotImplementedError
+
+        result = []
+        for i in range(0, count.value):
+            result.append(BreakpointRecord(records[i].hit, records[i].message))
+
+        dbgcore.BNDebuggerFreeBreakpointRecords(records, count.value)
+        return result
+
+    def reset_breakpoint_hits(self, address) -> bool:
+        """
+        Reset the hit count of a breakpoint, and discard its recorded messages
+
+        :param address: the address of the breakpoint, either an absolute address or a ModuleNameAndOffset
+        :return: False if there is no breakpoint at the address
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerResetAbsoluteBreakpointHits(self.handle, address)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerResetRelativeBreakpointHits(self.handle, address.module, address.offset)
+        else:
+            raise NotImplementedError
+
+    @property
+    def watchpoints(self) -> List[DebugWatchpoint]:
+        """
+        The list of hardware watchpoints
+        """
+        count = ctypes.c_ulonglong()
+        watchpoints = dbgcore.BNDebuggerGetWatchpoints(self.handle, count)
+        result = []
+        for i in range(0, count.value):
+            result.append(DebugWatchpoint(watchpoints[i].module, watchpoints[i].offset, watchpoints[i].address,
+                                          watchpoints[i].size, DebugWatchpointType(watchpoints[i].type)))
+
+        dbgcore.BNDebuggerFreeWatchpoints(watchpoints, count.value)
+        return result
+
+    def add_watchpoint(self, address, size: int,
+                       type: DebugWatchpointType = DebugWatchpointType.WatchpointWrite) -> bool:
+        """
+        Add a hardware watchpoint, which stops the target when it accesses the memory. The stop reason is
+        ``DebugStopReason.Watchpoint``, and the TargetStoppedEventData carries the address and the type of the
+        watchpoint.
+
+        Watchpoints added before the target is launched are applied when it stops for the first time. The number of
+        watchpoints is limited by the hardware, e.g., x86 has four debug registers and cannot watch reads only.
+
+        :param address: the address to watch, either an absolute address or a ModuleNameAndOffset
+        :param size: the number of bytes to watch, which must be 1, 2, 4 or 8. The address must be aligned to it.
+        :param type: whether to stop on reads, writes, or both
+        :return: False if the watchpoint is invalid, there is already one at the address, or the adapter cannot add it
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerAddAbsoluteWatchpoint(self.handle, address, size, type)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerAddRelativeWatchpoint(self.handle, address.module, address.offset, size, type)
+        else:
+            raise NotImplementedError
+
+    def delete_watchpoint(self, address) -> bool:
+        """
+        Delete a hardware watchpoint
+
+        :param address: the address of the watchpoint, either an absolute address or a ModuleNameAndOffset
+        :return: False if there is no watchpoint at the address
+        """
+        if isinstance(address, int):
+            return dbgcore.BNDebuggerDeleteAbsoluteWatchpoint(self.handle, address)
+        elif isinstance(address, ModuleNameAndOffset):
+            return dbgcore.BNDebuggerDeleteRelativeWatchpoint(self.handle, address.module, address.offset)
+        else:
+            raise NotImplementedError
+
     @property
     def ip(self) -> int:
         """
@@ -1295,17 +2041,27 @@ class DebuggerController:
         """
         return dbgcore.BNDebuggerGetExitCode(self.handle)
 
-    def register_event_callback(self, callback: DebuggerEventCallback, name: str = '') -> int:
+    def register_event_callback(self, callback: DebuggerEventCallback, name: str = '',
+                                policy: DebuggerEventDeliveryPolicy =
+                                DebuggerEventDeliveryPolicy.SynchronousEventDelivery) -> int:
         """
         Register a debugger event callback to receive notification when various events happen.
 
         The callback receives DebuggerEvent object that contains the type of the event and associated data.
 
+        By default, the callback runs on the main thread, and the debugger waits for it before it carries on, e.g., a
+        ``TargetStoppedEventType`` callback runs before the target can be resumed. The other policies do not make the
+        debugger wait. ``MainThreadEventDelivery`` queues the events for the main thread, and ``WorkerEventDelivery``
+        queues them for a worker thread, which suits headless scripts that do not need the UI. Redundant events, e.g.,
+        several ``RegisterChangedEvent`` queued at once, are delivered only once. ``InlineEventDelivery`` runs the
+        callback on the thread that posts the event, so it must return quickly.
+
         :param callback: the callback to register
         :param name: name of the callback
+        :param policy: the thread on which the callback is run
         :return: an integer handle to the registered event callback
         """
-        return DebuggerEventWrapper.register(self, callback, name)
+        return DebuggerEventWrapper.register(self, callback, name, policy)
 
     def remove_event_callback(self, index: int):
         """
@@ -1313,15 +2069,19 @@ class DebuggerController:
         """
         DebuggerEventWrapper.remove(self, index)
 
-    def frames_of_thread(self, tid: int) -> List[DebugFrame]:
+    def frames_of_thread(self, tid: int, max_frames: int = 0) -> List[DebugFrame]:
         """
         Get the stack frames of the thread specified by ``tid``
 
+        The stack is unwound the first time it is requested after the target stops, and cached until the target
+        resumes. Unwinding deep stacks can be slow, so pass ``max_frames`` if only the innermost frames are needed.
+
         :param tid: thread id
+        :param max_frames: maximum number of frames to return, starting from the innermost one. 0 means all frames
         :return: list of stack frames
         """
         count = ctypes.c_ulonglong()
-        frames = dbgcore.BNDebuggerGetFramesOfThread(self.handle, tid, count)
+        frames = dbgcore.BNDebuggerGetTopFramesOfThread(self.handle, tid, max_frames, count)
         result = []
         for i in range(0, count.value):
             bp = DebugFrame(frames[i].m_index, frames[i].m_pc, frames[i].m_sp, frames[i].m_fp, frames[i].m_functionName,
@@ -1354,6 +2114,37 @@ class DebuggerController:
         """
         dbgcore.BNDebuggerWriteStdin(self.handle, data, len(data))
 
+    def read_output(self, stream: DebuggerOutputStream = DebuggerOutputStream.StdoutOutputStream,
+                    max_length: int = 0) -> bytes:
+        """
+        Read the buffered stdout or stderr of the target, without registering an event callback.
+
+        The output is kept in a bounded buffer for each stream. What happens when the target writes faster than the
+        output is read depends on the ``debugger.outputOverflowPolicy`` setting. The output read here is removed from
+        the buffer, but it is still delivered to the event callbacks as ``StdoutMessageEventType``.
+
+        :param stream: the stream to read, either ``StdoutOutputStream`` or ``StderrOutputStream``
+        :param max_length: maximum number of bytes to read. 0 means everything that is available
+        :return: the output
+        """
+        result = dbgcore.BNDebuggerReadTargetOutput(self.handle, stream, max_length)
+        if result is None:
+            return b''
+        buffer = ctypes.cast(result, ctypes.POINTER(binaryninja.core.BNDataBuffer))
+        return bytes(binaryninja.DataBuffer(handle=buffer))
+
+    def output_available(self, stream: DebuggerOutputStream = DebuggerOutputStream.StdoutOutputStream) -> int:
+        """
+        The number of bytes of the stream that are buffered and not read yet
+        """
+        return dbgcore.BNDebuggerGetTargetOutputAvailable(self.handle, stream)
+
+    def output_dropped(self, stream: DebuggerOutputStream = DebuggerOutputStream.StdoutOutputStream) -> int:
+        """
+        The number of bytes of the stream that are discarded because the buffer is full
+        """
+        return dbgcore.BNDebuggerGetTargetOutputDropped(self.handle, stream)
+
     def execute_backend_command(self, command: str) -> str:
         """
         Execute a backend command and get the output
@@ -1388,6 +2179,29 @@ class DebuggerController:
     def get_addr_info(self, addr: int):
         return dbgcore.BNDebuggerGetAddressInformation(self.handle, addr)
 
+    def get_stack_window(self, before: int = 8, after: int = 60, depth: int = 3) -> List[DebugStackSlot]:
+        """
+        The slots around the stack pointer, each followed through up to ``depth`` pointers
+
+        The whole window is read at once, and the result is cached until the target runs again, so the stack widget,
+        the CLI and scripts share the same reads.
+
+        :param before: the number of slots below the stack pointer
+        :param after: the number of slots from the stack pointer upwards
+        :param depth: the number of times the value of a slot is dereferenced
+        :return: a list of ``DebugStackSlot``
+        """
+        count = ctypes.c_ulonglong()
+        slots = dbgcore.BNDebuggerGetStackWindow(self.handle, before, after, depth, count)
+        result = []
+        for i in range(0, count.value):
+            chain = [slots[i].chain[j] for j in range(0, slots[i].chainCount)]
+            result.append(DebugStackSlot(slots[i].offset, slots[i].address, slots[i].value, slots[i].valid, chain,
+                                         slots[i].hint))
+
+        dbgcore.BNDebuggerFreeStackWindow(slots, count.value)
+        return result
+
     @property
     def is_first_launch(self):
         return dbgcore.BNDebuggerIsFirstLaunch(self.handle)
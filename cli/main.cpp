@@ -49,31 +49,33 @@ void RegisterDisplay(DbgRef<DebuggerController> debugger)
 	if (!arch)
 		return;
 
-	auto all_regs = debugger->GetRegisters();
+	// Read all registers at once, rather than one call per register
+	std::unordered_map<std::string, DebugRegister> all_regs;
+	for (const DebugRegister& r : debugger->GetRegisters(false))
+		all_regs[r.m_name] = r;
 
-	auto reg = [debugger](std::string reg_name) {
+	auto format_reg = [&all_regs](std::string reg_name, size_t digits) {
 		auto original_name = reg_name;
 		reg_name.erase(std::remove(reg_name.begin(), reg_name.end(), ' '), reg_name.end());
 
-		return fmt::format(
-			"{}{}\033[0m={:016X}", Log::Style(255, 165, 0), original_name, debugger->GetRegisterValue(reg_name));
-	};
-
-	auto reg32 = [debugger](std::string reg_name) {
-		auto original_name = reg_name;
-		reg_name.erase(std::remove(reg_name.begin(), reg_name.end(), ' '), reg_name.end());
+		uint64_t value = 0;
+		bool changed = false;
+		auto iter = all_regs.find(reg_name);
+		if (iter != all_regs.end())
+		{
+			value = iter->second.m_value;
+			changed = iter->second.m_changed;
+		}
 
-		return fmt::format(
-			"{}{}\033[0m={:08X}", Log::Style(255, 165, 0), original_name, debugger->GetRegisterValue(reg_name));
+		// The registers that changed since the previous stop are highlighted
+		const auto value_style = changed ? Log::Style(255, 99, 71) : Log::Style();
+		return fmt::format("{}{}\033[0m={}{:0{}X}\033[0m", Log::Style(255, 165, 0), original_name, value_style, value,
+			digits);
 	};
 
-	auto reg16 = [debugger](std::string reg_name) {
-		auto original_name = reg_name;
-		reg_name.erase(std::remove(reg_name.begin(), reg_name.end(), ' '), reg_name.end());
-
-		return fmt::format(
-			"{}{}\033[0m={:04X}", Log::Style(255, 165, 0), original_name, debugger->GetRegisterValue(reg_name));
-	};
+	auto reg = [&format_reg](std::string reg_name) { return format_reg(reg_name, 16); };
+	auto reg32 = [&format_reg](std::string reg_name) { return format_reg(reg_name, 8); };
+	auto reg16 = [&format_reg](std::string reg_name) { return format_reg(reg_name, 4); };
 
 	if (arch->GetName() == "x86_64")
 	{
@@ -82,20 +84,15 @@ void RegisterDisplay(DbgRef<DebuggerController> debugger)
 			reg("r10"), reg("r11"), reg("r12"), reg("r13"), reg("r14"), reg("r15"), reg("rip"));
 		Log::print(reg_list);
 
-		const auto register_list = debugger->GetRegisters();
-
-		for (const DebugRegister& r : register_list)
+		if (all_regs.find("rflags") != all_regs.end())
 		{
-			if (r.m_name == "rflags")
-			{
-				Log::print(reg("rflags"));
-				Log::print("\n");
-			}
-			else if (r.m_name == "eflags")
-			{
-				Log::print(reg32("eflags"));
-				Log::print("\n");
-			}
+			Log::print(reg("rflags"));
+			Log::print("\n");
+		}
+		else if (all_regs.find("eflags") != all_regs.end())
+		{
+			Log::print(reg32("eflags"));
+			Log::print("\n");
 		}
 	}
 	else if (arch->GetName() == "x86")
@@ -123,6 +120,72 @@ void RegisterDisplay(DbgRef<DebuggerController> debugger)
 }
 
 
+void StackDisplay(DbgRef<DebuggerController> debugger, size_t count)
+{
+	// Take the slots from the same window as the stack widget, so both are served by one read
+	for (const DebugStackSlot& slot : debugger->GetStackWindow())
+	{
+		if (slot.m_offset < 0)
+			continue;
+		if (count-- == 0)
+			break;
+
+		if (!slot.m_valid)
+		{
+			Log::print("{}{:+#06x}\033[0m 0x{:X}: ??\n", Log::Style(255, 165, 0), slot.m_offset, slot.m_address);
+			continue;
+		}
+
+		std::string telescope = fmt::format("0x{:X}", slot.m_value);
+		for (uint64_t value : slot.m_chain)
+			telescope += fmt::format(" -> 0x{:X}", value);
+		if (!slot.m_hint.empty())
+			telescope += fmt::format(" -> {}", slot.m_hint);
+
+		Log::print("{}{:+#06x}\033[0m 0x{:X}: {}\n", Log::Style(255, 165, 0), slot.m_offset, slot.m_address,
+			telescope);
+	}
+}
+
+
+// `args` is the kind of the value followed by the value, e.g., "hex 48 8b ?? 05", "str hello", or "u32 0x1234"
+void SearchDisplay(DbgRef<DebuggerController> debugger, const std::string& args)
+{
+	auto space = args.find(' ');
+	if (space == std::string::npos)
+	{
+		Log::print<Log::Error>("usage: search <hex|str|wstr|u16|u32|u64> <value>\n");
+		return;
+	}
+	std::string kind = args.substr(0, space);
+	std::string value = args.substr(space + 1);
+
+	MemorySearchPattern pattern;
+	if (kind == "hex")
+		pattern = MemorySearchPattern::FromHex(value);
+	else if (kind == "str")
+		pattern = MemorySearchPattern::FromString(value);
+	else if (kind == "wstr")
+		pattern = MemorySearchPattern::FromString(value, true);
+	else if ((kind == "u16") || (kind == "u32") || (kind == "u64"))
+		pattern = MemorySearchPattern::FromInteger(std::stoull(value, nullptr, 0), std::stoul(kind.substr(1)) / 8);
+
+	if (pattern.m_bytes.empty())
+	{
+		Log::print<Log::Error>("invalid search pattern\n");
+		return;
+	}
+
+	// Print the matches as they are found, and stop at a screenful
+	const size_t limit = 64;
+	size_t count = debugger->SearchMemory(pattern, 0, UINT64_MAX, limit, [&](uint64_t address) {
+		Log::print("    0x{:X}\n", address);
+		return true;
+	});
+	Log::print<Log::Info>("{} match[es] found{}\n", count, count == limit ? ", stopped at the limit" : "");
+}
+
+
 void DisasmDisplay(DbgRef<DebuggerController> debugger, const std::uint32_t count)
 {
 	using namespace BinaryNinja;
@@ -462,6 +525,9 @@ int main(int argc, const char* argv[])
 			print_arg("lm", "list all modules");
 			print_arg("lbp", "list all breakpoints");
 			print_arg("reg", "display registers");
+			print_arg("stack", "display the stack", "slot count");
+			print_arg("search", "search the memory", "hex|str|wstr|u16|u32|u64 and value");
+			print_arg("savecore", "save an ELF core file of the target", "path");
 			print_arg("disasm", "disassemble & lift instructions", "instruction count");
 			print_arg("sr", "display stop reason");
 			print_arg("es", "display execution status");
@@ -510,6 +576,29 @@ int main(int argc, const char* argv[])
 		{
 			RegisterDisplay(debugger);
 		}
+		else if (input.rfind("search ", 0) == 0)
+		{
+			SearchDisplay(debugger, input.substr(7));
+		}
+		else if (input.rfind("savecore ", 0) == 0)
+		{
+			std::string path = input.substr(9);
+			if (debugger->SaveCoreFile(path))
+				Log::print<Log::Info>("core file saved to {}\n", path);
+			else
+				Log::print<Log::Error>("failed to save the core file\n");
+		}
+		else if (input == "stack")
+		{
+			StackDisplay(debugger, 16);
+		}
+		else if (auto loc = input.find("stack "); loc != std::string::npos)
+		{
+			auto count = std::stoul(input.substr(loc + 6), nullptr, 10);
+			if (count == 0)
+				count = 16;
+			StackDisplay(debugger, count);
+		}
 		else if (auto loc = input.find("ts "); loc != std::string::npos)
 		{
 			auto thread_id = std::stoul(input.substr(loc + 3), nullptr, 10);
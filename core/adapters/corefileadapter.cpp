@@ -0,0 +1,651 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <map>
+#include "corefileadapter.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+// The maximum number of frames to unwind when the caller does not limit it, in case the frame pointers form a loop
+static constexpr size_t MaxFrames = 512;
+
+
+CoreFileAdapter::CoreFileAdapter(BinaryView* data) : DebugAdapter(data) {}
+
+
+bool CoreFileAdapter::Execute(const std::string& path, const LaunchConfigurations& configs)
+{
+	return ExecuteWithArgs(path, "", "", configs);
+}
+
+
+bool CoreFileAdapter::ExecuteWithArgs(const std::string& path, const std::string& args, const std::string& workingDir,
+	const LaunchConfigurations& configs)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (!m_core.Open(path))
+		{
+			DebuggerEvent event;
+			event.type = LaunchFailureEventType;
+			event.data.errorData.error = fmt::format("Failed to open the core file {}: {}", path, m_core.GetError());
+			event.data.errorData.shortError = "Failed to open the core file";
+			PostDebuggerEvent(event);
+			return false;
+		}
+
+		m_activeThread = 0;
+		m_mappedFiles.clear();
+		switch (m_core.GetLayout()->machine)
+		{
+		case 62:
+			m_pcName = "rip", m_spName = "rsp", m_fpName = "rbp";
+			m_walkFramePointers = true;
+			break;
+		case 3:
+			m_pcName = "eip", m_spName = "esp", m_fpName = "ebp";
+			m_walkFramePointers = true;
+			break;
+		case 183:
+			m_pcName = "pc", m_spName = "sp", m_fpName = "x29";
+			m_walkFramePointers = true;
+			break;
+		default:
+			// The layout of the frames on ARM depends on the compiler and the instruction set
+			m_pcName = "pc", m_spName = "sp", m_fpName = "r11";
+			m_walkFramePointers = false;
+			break;
+		}
+	}
+
+	// The core file is opened in the state it was saved in, which is reported as the stop of the launch
+	DebuggerEvent event;
+	event.type = AdapterStoppedEventType;
+	event.data.targetStoppedData.reason = StopReason();
+	PostDebuggerEvent(event);
+	return true;
+}
+
+
+bool CoreFileAdapter::Attach(std::uint32_t pid)
+{
+	return false;
+}
+
+
+bool CoreFileAdapter::Connect(const std::string& server, std::uint32_t port)
+{
+	return false;
+}
+
+
+bool CoreFileAdapter::Detach()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_core.Close();
+		m_mappedFiles.clear();
+	}
+
+	DebuggerEvent event;
+	event.type = DetachedEventType;
+	PostDebuggerEvent(event);
+	return true;
+}
+
+
+bool CoreFileAdapter::Quit()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_core.Close();
+		m_mappedFiles.clear();
+	}
+
+	DebuggerEvent event;
+	event.type = TargetExitedEventType;
+	event.data.exitData.exitCode = 0;
+	PostDebuggerEvent(event);
+	return true;
+}
+
+
+std::vector<DebugProcess> CoreFileAdapter::GetProcessList()
+{
+	return {};
+}
+
+
+const ElfCoreThread* CoreFileAdapter::FindThread(std::uint32_t tid) const
+{
+	for (const ElfCoreThread& thread : m_core.GetThreads())
+	{
+		if (thread.tid == tid)
+			return &thread;
+	}
+	return nullptr;
+}
+
+
+uint64_t CoreFileAdapter::GetRegisterValue(const ElfCoreThread& thread, const std::string& name) const
+{
+	auto iter = thread.registers.find(name);
+	return iter != thread.registers.end() ? iter->second : 0;
+}
+
+
+std::vector<DebugThread> CoreFileAdapter::GetThreadList()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::vector<DebugThread> result;
+	for (const ElfCoreThread& thread : m_core.GetThreads())
+		result.emplace_back(thread.tid, GetRegisterValue(thread, m_pcName));
+	return result;
+}
+
+
+DebugThread CoreFileAdapter::GetActiveThreadLocked() const
+{
+	const auto& threads = m_core.GetThreads();
+	if (m_activeThread >= threads.size())
+		return {};
+
+	return DebugThread(threads[m_activeThread].tid, GetRegisterValue(threads[m_activeThread], m_pcName));
+}
+
+
+DebugThread CoreFileAdapter::GetActiveThread() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return GetActiveThreadLocked();
+}
+
+
+std::uint32_t CoreFileAdapter::GetActiveThreadId() const
+{
+	return GetActiveThread().m_tid;
+}
+
+
+bool CoreFileAdapter::SetActiveThread(const DebugThread& thread)
+{
+	return SetActiveThreadId(thread.m_tid);
+}
+
+
+bool CoreFileAdapter::SetActiveThreadId(std::uint32_t tid)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const auto& threads = m_core.GetThreads();
+	for (size_t i = 0; i < threads.size(); i++)
+	{
+		if (threads[i].tid == tid)
+		{
+			m_activeThread = i;
+			return true;
+		}
+	}
+	return false;
+}
+
+
+bool CoreFileAdapter::SuspendThread(std::uint32_t tid)
+{
+	return false;
+}
+
+
+bool CoreFileAdapter::ResumeThread(std::uint32_t tid)
+{
+	return false;
+}
+
+
+bool CoreFileAdapter::ReadPointer(uint64_t address, uint64_t& value)
+{
+	size_t size = m_core.GetLayout()->GetWordSize();
+	DataBuffer buffer = ReadMemoryLocked(address, size);
+	if (buffer.GetLength() != size)
+		return false;
+
+	value = 0;
+	memcpy(&value, buffer.GetData(), size);
+	return true;
+}
+
+
+std::string CoreFileAdapter::GetModuleNameAt(uint64_t address) const
+{
+	for (const ElfCoreMappedFile& file : m_core.GetMappedFiles())
+	{
+		if ((address >= file.start) && (address < file.end))
+			return DebugModule::GetPathBaseName(file.path);
+	}
+	return "";
+}
+
+
+// The core file has no unwind information, so the stack is unwound by following the saved frame pointers. A frame
+// whose function does not maintain the frame pointer hides its caller.
+std::vector<DebugFrame> CoreFileAdapter::GetFramesOfThread(std::uint32_t tid, size_t maxFrames)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::vector<DebugFrame> frames;
+	if (!m_core.IsOpen())
+		return frames;
+
+	const ElfCoreThread* thread = FindThread(tid);
+	if (!thread)
+		return frames;
+
+	size_t wordSize = m_core.GetLayout()->GetWordSize();
+	uint64_t pc = GetRegisterValue(*thread, m_pcName);
+	uint64_t sp = GetRegisterValue(*thread, m_spName);
+	uint64_t fp = GetRegisterValue(*thread, m_fpName);
+	size_t limit = maxFrames != 0 ? maxFrames : MaxFrames;
+	while (frames.size() < limit)
+	{
+		frames.emplace_back(frames.size(), pc, sp, fp, "", 0, GetModuleNameAt(pc));
+
+		// Each frame saves the frame pointer of its caller, followed by the return address
+		uint64_t callerFp = 0, returnAddress = 0;
+		if (!m_walkFramePointers || (fp == 0) || !ReadPointer(fp, callerFp)
+			|| !ReadPointer(fp + wordSize, returnAddress) || (returnAddress == 0))
+			break;
+
+		// The stack grows down, so the frame of the caller must be above this one. Otherwise, the chain is broken, and
+		// the unwinding stops after the caller.
+		if (callerFp <= fp)
+			callerFp = 0;
+
+		pc = returnAddress;
+		sp = fp + 2 * wordSize;
+		fp = callerFp;
+	}
+	return frames;
+}
+
+
+DebugBreakpoint CoreFileAdapter::AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type)
+{
+	// The target never runs, so the breakpoints are only kept to be listed
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), DebugBreakpoint(address));
+	if (iter != m_breakpoints.end())
+		return *iter;
+
+	DebugBreakpoint breakpoint(address, m_nextBreakpointId++, true);
+	m_breakpoints.push_back(breakpoint);
+	return breakpoint;
+}
+
+
+DebugBreakpoint CoreFileAdapter::AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type)
+{
+	for (const DebugModule& module : GetModuleList())
+	{
+		if (module.IsSameBaseModule(address.module))
+			return AddBreakpoint(module.m_address + address.offset, breakpoint_type);
+	}
+	return {};
+}
+
+
+bool CoreFileAdapter::RemoveBreakpoint(const DebugBreakpoint& breakpoint)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), breakpoint);
+	if (iter == m_breakpoints.end())
+		return false;
+
+	m_breakpoints.erase(iter);
+	return true;
+}
+
+
+std::vector<DebugBreakpoint> CoreFileAdapter::GetBreakpointList() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_breakpoints;
+}
+
+
+std::unordered_map<std::string, DebugRegister> CoreFileAdapter::ReadAllRegisters()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::unordered_map<std::string, DebugRegister> result;
+	const auto& threads = m_core.GetThreads();
+	if (m_activeThread >= threads.size())
+		return result;
+
+	const ElfCoreLayout* layout = m_core.GetLayout();
+	const ElfCoreThread& thread = threads[m_activeThread];
+	for (size_t i = 0; i < layout->registers.size(); i++)
+	{
+		std::string name = layout->registers[i].substr(0, layout->registers[i].find('|'));
+		result[name] = DebugRegister(name, GetRegisterValue(thread, name), layout->GetWordSize() * 8, i);
+	}
+	return result;
+}
+
+
+DebugRegister CoreFileAdapter::ReadRegister(const std::string& reg)
+{
+	std::unordered_map<std::string, DebugRegister> registers = ReadAllRegisters();
+	if (auto iter = registers.find(reg); iter != registers.end())
+		return iter->second;
+
+	// The register can also be asked for by one of its other names, e.g., "fp" for "x29"
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const ElfCoreLayout* layout = m_core.GetLayout();
+	if (!layout)
+		return {};
+
+	for (const std::string& names : layout->registers)
+	{
+		std::string aliases = "|" + names + "|";
+		if (aliases.find("|" + reg + "|") != std::string::npos)
+			return registers[names.substr(0, names.find('|'))];
+	}
+	return {};
+}
+
+
+bool CoreFileAdapter::WriteRegister(const std::string& reg, std::uintptr_t value)
+{
+	LogWarn("The registers of a core file cannot be modified");
+	return false;
+}
+
+
+size_t CoreFileAdapter::ReadMappedFile(uint64_t address, size_t size, DataBuffer& buffer)
+{
+	for (const ElfCoreMappedFile& file : m_core.GetMappedFiles())
+	{
+		if ((address < file.start) || (address >= file.end))
+			continue;
+
+		// Prefer the input binary, which may have been moved since the core file was saved
+		std::string path = file.path;
+		if (DebugModule::IsSameBaseModule(path, m_originalFileName) && std::filesystem::exists(m_originalFileName))
+			path = m_originalFileName;
+
+		auto iter = m_mappedFiles.find(path);
+		if (iter == m_mappedFiles.end())
+		{
+			auto stream = std::make_unique<std::ifstream>(path, std::ios::binary);
+			if (!stream->is_open())
+				stream.reset();
+			iter = m_mappedFiles.emplace(path, std::move(stream)).first;
+		}
+		if (!iter->second)
+			return 0;
+
+		std::ifstream& stream = *iter->second;
+		std::vector<char> data(std::min<uint64_t>(size, file.end - address));
+		stream.clear();
+		stream.seekg(file.offset + (address - file.start));
+		stream.read(data.data(), data.size());
+		size_t bytesRead = stream.gcount();
+		buffer.Append(data.data(), bytesRead);
+		return bytesRead;
+	}
+	return 0;
+}
+
+
+DataBuffer CoreFileAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return ReadMemoryLocked(address, size);
+}
+
+
+DataBuffer CoreFileAdapter::ReadMemoryLocked(std::uintptr_t address, std::size_t size)
+{
+	DataBuffer result;
+	if (!m_core.IsOpen())
+		return result;
+
+	// The range can span several segments, as long as they are adjacent
+	while (result.GetLength() < size)
+	{
+		uint64_t current = address + result.GetLength();
+		size_t remaining = size - result.GetLength();
+		size_t available = 0;
+		if (const uint8_t* data = m_core.GetPointer(current, available))
+			result.Append(data, std::min(available, remaining));
+		else if (ReadMappedFile(current, remaining, result) == 0)
+			break;
+	}
+	return result;
+}
+
+
+bool CoreFileAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+	LogWarn("The memory of a core file cannot be modified");
+	return false;
+}
+
+
+std::vector<DebugModule> CoreFileAdapter::GetModuleList()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+
+	// A module is mapped in several parts, one for each segment of the file
+	std::map<std::string, std::pair<uint64_t, uint64_t>> ranges;
+	for (const ElfCoreMappedFile& file : m_core.GetMappedFiles())
+	{
+		auto iter = ranges.find(file.path);
+		if (iter == ranges.end())
+		{
+			ranges[file.path] = {file.start, file.end};
+			continue;
+		}
+		iter->second.first = std::min(iter->second.first, file.start);
+		iter->second.second = std::max(iter->second.second, file.end);
+	}
+
+	std::vector<DebugModule> modules;
+	for (const auto& [path, range] : ranges)
+		modules.emplace_back(path, DebugModule::GetPathBaseName(path), range.first, range.second - range.first, true);
+	std::sort(modules.begin(), modules.end(),
+		[](const DebugModule& a, const DebugModule& b) { return a.m_address < b.m_address; });
+	return modules;
+}
+
+
+std::vector<DebugMemoryRegion> CoreFileAdapter::GetMemoryRegions()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	std::vector<DebugMemoryRegion> regions;
+	for (const ElfCoreReader::Segment& segment : m_core.GetSegments())
+	{
+		std::string name;
+		for (const ElfCoreMappedFile& file : m_core.GetMappedFiles())
+		{
+			if ((segment.start >= file.start) && (segment.start < file.end))
+			{
+				name = file.path;
+				break;
+			}
+		}
+		regions.emplace_back(
+			segment.start, segment.end, segment.readable, segment.writable, segment.executable, name);
+	}
+	return regions;
+}
+
+
+std::string CoreFileAdapter::GetTargetArchitecture()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const ElfCoreLayout* layout = m_core.GetLayout();
+	if (!layout)
+		return "";
+
+	switch (layout->machine)
+	{
+	case 62:
+		return "x86_64";
+	case 3:
+		return "i386";
+	case 183:
+		return "aarch64";
+	case 40:
+		return "arm";
+	default:
+		return "";
+	}
+}
+
+
+DebugStopReason CoreFileAdapter::StopReason()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_core.IsOpen())
+		return ProcessExited;
+
+	static const std::unordered_map<uint32_t, DebugStopReason> signals = {
+		{1, SignalHup},
+		{2, SignalInt},
+		{3, SignalQuit},
+		{4, SignalIll},
+		{5, Breakpoint},
+		{6, SignalAbrt},
+		{7, SignalBus},
+		{8, SignalFpe},
+		{9, SignalKill},
+		{11, SignalSegv},
+		{13, SignalPipe},
+		{14, SignalAlrm},
+		{15, SignalTerm},
+	};
+
+	// The core files saved by the debugger have no signal
+	auto iter = signals.find(m_core.GetSignal());
+	return iter != signals.end() ? iter->second : UnknownReason;
+}
+
+
+uint64_t CoreFileAdapter::ExitCode()
+{
+	return 0;
+}
+
+
+bool CoreFileAdapter::BreakInto()
+{
+	return false;
+}
+
+
+bool CoreFileAdapter::Go()
+{
+	LogWarn("The target of a core file cannot be resumed");
+	return false;
+}
+
+
+bool CoreFileAdapter::StepInto()
+{
+	LogWarn("The target of a core file cannot be resumed");
+	return false;
+}
+
+
+bool CoreFileAdapter::StepOver()
+{
+	LogWarn("The target of a core file cannot be resumed");
+	return false;
+}
+
+
+std::string CoreFileAdapter::InvokeBackendCommand(const std::string& command)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_core.IsOpen())
+		return "No core file is open\n";
+
+	return fmt::format("Core file of {} (pid {}), {} thread(s), {} segment(s), signal {}\n"
+					   "The core file adapter does not support backend commands\n",
+		m_core.GetCommandLine().empty() ? m_core.GetProcessName() : m_core.GetCommandLine(), m_core.GetPid(),
+		m_core.GetThreads().size(), m_core.GetSegments().size(), m_core.GetSignal());
+}
+
+
+uint64_t CoreFileAdapter::GetInstructionOffset()
+{
+	return GetActiveThread().m_rip;
+}
+
+
+uint64_t CoreFileAdapter::GetStackPointer()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const auto& threads = m_core.GetThreads();
+	if (m_activeThread >= threads.size())
+		return 0;
+
+	return GetRegisterValue(threads[m_activeThread], m_spName);
+}
+
+
+bool CoreFileAdapter::SupportFeature(DebugAdapterCapacity feature)
+{
+	return (feature == DebugAdapterSupportModules) || (feature == DebugAdapterSupportThreads);
+}
+
+
+CoreFileAdapterType::CoreFileAdapterType() : DebugAdapterType("CORE_FILE") {}
+
+
+DebugAdapter* CoreFileAdapterType::Create(BinaryNinja::BinaryView* data)
+{
+	// TODO: someone should free this.
+	return new CoreFileAdapter(data);
+}
+
+
+bool CoreFileAdapterType::IsValidForData(BinaryNinja::BinaryView* data)
+{
+	return data->GetTypeName() == "ELF" || data->GetTypeName() == "Raw";
+}
+
+
+bool CoreFileAdapterType::CanExecute(BinaryNinja::BinaryView* data)
+{
+	// Opening a core file needs no debugger on the host
+	return true;
+}
+
+
+bool CoreFileAdapterType::CanConnect(BinaryNinja::BinaryView* data)
+{
+	return false;
+}
+
+
+void BinaryNinjaDebugger::InitCoreFileAdapterType()
+{
+	static CoreFileAdapterType localType;
+	DebugAdapterType::Register(&localType);
+}
@@ -0,0 +1,123 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include "../debugadapter.h"
+#include "../debugadaptertype.h"
+#include "../elfcore.h"
+
+namespace BinaryNinjaDebugger {
+	// Debugs an ELF core file instead of a live process. "Launching" opens the core file set as the executable path,
+	// and the target stays stopped at the state saved in it until the debugger quits. The core file is mapped into
+	// memory, so the memory of the target is read without copying the file.
+	class CoreFileAdapter : public DebugAdapter
+	{
+	private:
+		// Guards everything below. The controller, the widgets and the memory cache call in from different threads.
+		mutable std::mutex m_mutex;
+		ElfCoreReader m_core;
+		size_t m_activeThread = 0;
+		std::vector<DebugBreakpoint> m_breakpoints;
+		unsigned long m_nextBreakpointId = 1;
+
+		// The names of the instruction, stack and frame pointers in the registers of the core file
+		std::string m_pcName;
+		std::string m_spName;
+		std::string m_fpName;
+		// Whether the frame pointers form a chain of saved frame pointers and return addresses that can be walked
+		bool m_walkFramePointers = false;
+
+		// The kernel does not save the memory that is mapped from files and not modified, e.g., the code. It is read
+		// from the mapped files instead, if they can be found on this system.
+		std::unordered_map<std::string, std::unique_ptr<std::ifstream>> m_mappedFiles;
+		size_t ReadMappedFile(uint64_t address, size_t size, DataBuffer& buffer);
+
+		// These expect m_mutex to be held
+		const ElfCoreThread* FindThread(std::uint32_t tid) const;
+		uint64_t GetRegisterValue(const ElfCoreThread& thread, const std::string& name) const;
+		DebugThread GetActiveThreadLocked() const;
+		DataBuffer ReadMemoryLocked(std::uintptr_t address, std::size_t size);
+		bool ReadPointer(uint64_t address, uint64_t& value);
+		std::string GetModuleNameAt(uint64_t address) const;
+
+	public:
+		CoreFileAdapter(BinaryView* data);
+
+		[[nodiscard]] bool Execute(const std::string& path, const LaunchConfigurations& configs = {}) override;
+		[[nodiscard]] bool ExecuteWithArgs(const std::string& path, const std::string& args,
+			const std::string& workingDir, const LaunchConfigurations& configs = {}) override;
+		[[nodiscard]] bool Attach(std::uint32_t pid) override;
+		[[nodiscard]] bool Connect(const std::string& server, std::uint32_t port) override;
+		bool Detach() override;
+		bool Quit() override;
+
+		std::vector<DebugProcess> GetProcessList() override;
+		std::vector<DebugThread> GetThreadList() override;
+		DebugThread GetActiveThread() const override;
+		std::uint32_t GetActiveThreadId() const override;
+		bool SetActiveThread(const DebugThread& thread) override;
+		bool SetActiveThreadId(std::uint32_t tid) override;
+		bool SuspendThread(std::uint32_t tid) override;
+		bool ResumeThread(std::uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(std::uint32_t tid, size_t maxFrames = 0) override;
+
+		DebugBreakpoint AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type = 0) override;
+		DebugBreakpoint AddBreakpoint(const ModuleNameAndOffset& address, unsigned long breakpoint_type = 0) override;
+		bool RemoveBreakpoint(const DebugBreakpoint& breakpoint) override;
+		std::vector<DebugBreakpoint> GetBreakpointList() const override;
+
+		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
+		DebugRegister ReadRegister(const std::string& reg) override;
+		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
+
+		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
+		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
+		std::vector<DebugModule> GetModuleList() override;
+		std::vector<DebugMemoryRegion> GetMemoryRegions() override;
+
+		std::string GetTargetArchitecture() override;
+		DebugStopReason StopReason() override;
+		uint64_t ExitCode() override;
+
+		bool BreakInto() override;
+		bool Go() override;
+		bool StepInto() override;
+		bool StepOver() override;
+
+		std::string InvokeBackendCommand(const std::string& command) override;
+		uint64_t GetInstructionOffset() override;
+		uint64_t GetStackPointer() override;
+		bool SupportFeature(DebugAdapterCapacity feature) override;
+	};
+
+
+	class CoreFileAdapterType : public DebugAdapterType
+	{
+	public:
+		CoreFileAdapterType();
+		virtual DebugAdapter* Create(BinaryNinja::BinaryView* data);
+		virtual bool IsValidForData(BinaryNinja::BinaryView* data);
+		virtual bool CanExecute(BinaryNinja::BinaryView* data);
+		virtual bool CanConnect(BinaryNinja::BinaryView* data);
+	};
+
+
+	void InitCoreFileAdapterType();
+};  // namespace BinaryNinjaDebugger
@@ -1554,7 +1554,7 @@ bool DbgEngAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer
 }
 
 
-std::vector<DebugFrame> DbgEngAdapter::GetFramesOfThread(uint32_t tid)
+std::vector<DebugFrame> DbgEngAdapter::GetFramesOfThread(uint32_t tid, size_t maxFrames)
 {
 	std::vector<DebugFrame> result;
 	// Due to https://github.com/Vector35/debugger/issues/304 and that we pause the target before killing it, we would
@@ -1568,7 +1568,7 @@ std::vector<DebugFrame> DbgEngAdapter::GetFramesOfThread(uint32_t tid)
 
 	SetActiveThreadId(tid);
 
-	const size_t numFrames = 16;
+	const size_t numFrames = (maxFrames == 0) ? 16 : maxFrames;
 	PDEBUG_STACK_FRAME_EX frames = new DEBUG_STACK_FRAME_EX[numFrames];
 	unsigned long framesFilled = 0;
 	if (m_debugControl->GetStackTraceEx(0, 0, 0, frames, numFrames, &framesFilled) != S_OK)
@@ -225,7 +225,7 @@ namespace BinaryNinjaDebugger {
 
 		bool SupportFeature(DebugAdapterCapacity feature) override;
 
-		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid, size_t maxFrames = 0) override;
 
 		bool SuspendThread(std::uint32_t tid) override;
 		bool ResumeThread(std::uint32_t tid) override;
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include <inttypes.h>
+#include <unordered_set>
 #include "lldbadapter.h"
 #include "thread"
 
@@ -532,52 +533,52 @@ bool LldbAdapter::ResumeThread(std::uint32_t tid)
 }
 
 
-std::vector<DebugFrame> LldbAdapter::GetFramesOfThread(uint32_t tid)
+std::vector<DebugFrame> LldbAdapter::GetFramesOfThread(uint32_t tid, size_t maxFrames)
 {
-	size_t threadCount = m_process.GetNumThreads();
 	std::vector<DebugFrame> result;
-	result.reserve(threadCount);
-	for (size_t i = 0; i < threadCount; i++)
+	SBThread thread = m_process.GetThreadByID(tid);
+	if (!thread.IsValid())
+		return result;
+
+	// GetNumFrames() unwinds the whole stack, so avoid it when the caller only wants the innermost frames
+	size_t frameCount = maxFrames;
+	if (frameCount == 0)
+		frameCount = thread.GetNumFrames();
+	result.reserve(frameCount);
+
+	for (size_t j = 0; j < frameCount; j++)
 	{
-		SBThread thread = m_process.GetThreadAtIndex(i);
-		if (!thread.IsValid())
-			continue;
-		if (tid == thread.GetThreadID())
+		SBFrame frame = thread.GetFrameAtIndex(j);
+		if (!frame.IsValid())
 		{
-			size_t frameCount = thread.GetNumFrames();
-			for (size_t j = 0; j < frameCount; j++)
-			{
-				SBFrame frame = thread.GetFrameAtIndex(j);
-				if (!frame.IsValid())
-					continue;
-				SBModule module = frame.GetModule();
-				SBFileSpec fileSpec = module.GetFileSpec();
-				std::string modulePath;
-				if (fileSpec.GetFilename())
-					modulePath = fileSpec.GetFilename();
-
-				uint64_t startAddress = 0;
-				SBFunction function = frame.GetFunction();
-				if (function.IsValid())
-				{
-					startAddress = function.GetStartAddress().GetLoadAddress(m_target);
-				}
-				else
-				{
-					SBSymbol symbol = frame.GetSymbol();
-					if (symbol.IsValid())
-						startAddress = symbol.GetStartAddress().GetLoadAddress(m_target);
-				}
+			if (maxFrames != 0)
+				break;
+			continue;
+		}
+		SBModule module = frame.GetModule();
+		SBFileSpec fileSpec = module.GetFileSpec();
+		std::string modulePath;
+		if (fileSpec.GetFilename())
+			modulePath = fileSpec.GetFilename();
 
-				std::string frameFunctionName;
-				if (frame.GetFunctionName())
-					frameFunctionName = std::string(frame.GetFunctionName());
-				DebugFrame f(
-					j, frame.GetPC(), frame.GetSP(), frame.GetFP(), frameFunctionName, startAddress, modulePath);
-				result.push_back(f);
-			}
-			return result;
+		uint64_t startAddress = 0;
+		SBFunction function = frame.GetFunction();
+		if (function.IsValid())
+		{
+			startAddress = function.GetStartAddress().GetLoadAddress(m_target);
 		}
+		else
+		{
+			SBSymbol symbol = frame.GetSymbol();
+			if (symbol.IsValid())
+				startAddress = symbol.GetStartAddress().GetLoadAddress(m_target);
+		}
+
+		std::string frameFunctionName;
+		if (frame.GetFunctionName())
+			frameFunctionName = std::string(frame.GetFunctionName());
+		DebugFrame f(j, frame.GetPC(), frame.GetSP(), frame.GetFP(), frameFunctionName, startAddress, modulePath);
+		result.push_back(f);
 	}
 	return result;
 }
@@ -654,6 +655,79 @@ bool LldbAdapter::RemoveBreakpoint(const ModuleNameAndOffset& breakpoint)
 }
 
 
+bool LldbAdapter::AddWatchpoint(std::uintptr_t address, size_t size, DebugWatchpointType type)
+{
+	// The debug registers belong to the threads of a live process
+	if (!m_targetActive)
+		return false;
+
+	SBError error;
+	SBWatchpoint watchpoint =
+		m_target.WatchAddress(address, size, (type & WatchpointRead) != 0, (type & WatchpointWrite) != 0, error);
+	if (!error.Success() || !watchpoint.IsValid())
+	{
+		// e.g., x86 has no read-only watchpoints, and only four debug registers
+		const char* message = error.GetCString();
+		LogWarn("Failed to add a watchpoint at 0x%" PRIx64 ": %s", (uint64_t)address, message ? message : "");
+		return false;
+	}
+
+	std::unique_lock<std::mutex> lock(m_watchpointMutex);
+	m_watchpoints[watchpoint.GetID()] = {address, type};
+	return true;
+}
+
+
+bool LldbAdapter::RemoveWatchpoint(std::uintptr_t address)
+{
+	std::unique_lock<std::mutex> lock(m_watchpointMutex);
+	for (auto iter = m_watchpoints.begin(); iter != m_watchpoints.end(); iter++)
+	{
+		if (iter->second.address != address)
+			continue;
+
+		bool ok = m_target.DeleteWatchpoint(iter->first);
+		m_watchpoints.erase(iter);
+		return ok;
+	}
+	return false;
+}
+
+
+// The watchpoints stay in the target after the process is gone, but the debugger core adds them again on the next
+// launch
+void LldbAdapter::ClearWatchpoints()
+{
+	std::unique_lock<std::mutex> lock(m_watchpointMutex);
+	m_target.DeleteAllWatchpoints();
+	m_watchpoints.clear();
+}
+
+
+bool LldbAdapter::GetWatchpointHit(uint64_t& address, DebugWatchpointType& type)
+{
+	size_t numThreads = m_process.GetNumThreads();
+	for (size_t i = 0; i < numThreads; i++)
+	{
+		SBThread thread = m_process.GetThreadAtIndex(i);
+		if ((thread.GetStopReason() != lldb::eStopReasonWatchpoint) || (thread.GetStopReasonDataCount() == 0))
+			continue;
+
+		// The first stop reason data of a watchpoint stop is the ID of the watchpoint
+		lldb::watch_id_t id = thread.GetStopReasonDataAtIndex(0);
+		std::unique_lock<std::mutex> lock(m_watchpointMutex);
+		auto iter = m_watchpoints.find(id);
+		if (iter == m_watchpoints.end())
+			continue;
+
+		address = iter->second.address;
+		type = iter->second.type;
+		return true;
+	}
+	return false;
+}
+
+
 // TODO: this should be deprecated
 std::vector<DebugBreakpoint> LldbAdapter::GetBreakpointList() const
 {
@@ -661,49 +735,114 @@ std::vector<DebugBreakpoint> LldbAdapter::GetBreakpointList() const
 }
 
 
-std::unordered_map<std::string, DebugRegister> LldbAdapter::ReadAllRegisters()
+bool LldbAdapter::GetRegisterGroups(SBValueList& regGroups)
 {
-	std::unordered_map<std::string, DebugRegister> result;
-
 	SBThread thread = m_process.GetSelectedThread();
 	if (!thread.IsValid())
-		return result;
-
-	size_t frameCount = thread.GetNumFrames();
-	if (frameCount == 0)
-		return result;
+		return false;
 
+	// Do not ask for the number of frames, which unwinds the entire stack. The frame is invalid if there is none.
 	SBFrame frame = thread.GetFrameAtIndex(0);
 	if (!frame.IsValid())
-		return result;
+		return false;
+
+	regGroups = frame.GetRegisters();
+	return true;
+}
+
+
+bool LldbAdapter::RegisterGroupsMatch(SBValueList& regGroups)
+{
+	if (!m_registerSchema || (regGroups.GetSize() != m_registerGroupSizes.size()))
+		return false;
+
+	for (size_t i = 0; i < m_registerGroupSizes.size(); i++)
+	{
+		SBValue regGroupInfo = regGroups.GetValueAtIndex(i);
+		size_t numRegs = regGroupInfo.IsValid() ? regGroupInfo.GetNumChildren() : 0;
+		if (numRegs != m_registerGroupSizes[i])
+			return false;
+	}
+	return true;
+}
+
+
+// Looking up the names of all registers is the slow part of reading them, so it is only done when the register groups
+// change, e.g., on the first stop
+void LldbAdapter::BuildRegisterSchema(SBValueList& regGroups)
+{
+	std::vector<std::pair<std::string, size_t>> registers;
+	std::unordered_set<std::string> names;
+	m_registerLocations.clear();
+	m_registerGroupSizes.clear();
 
-	size_t regIndex = 0;
-	SBValueList regGroups = frame.GetRegisters();
 	size_t numGroups = regGroups.GetSize();
 	for (size_t i = 0; i < numGroups; i++)
 	{
 		SBValue regGroupInfo = regGroups.GetValueAtIndex(i);
-		if (!regGroupInfo.IsValid())
-			continue;
-
-		size_t numRegs = regGroupInfo.GetNumChildren();
+		size_t numRegs = regGroupInfo.IsValid() ? regGroupInfo.GetNumChildren() : 0;
+		m_registerGroupSizes.push_back(numRegs);
 		for (size_t j = 0; j < numRegs; j++)
 		{
 			SBValue reg = regGroupInfo.GetChildAtIndex(j);
-			// TODO: register width and internal index
-			// Right now we basically rely on LLDB to always return the registers in the same order
-
 			// SBValue::GetName() sometimes returns NULL on the second call. So we must get its value only once and save
 			// it. Calling it twice causes problem.
 			const char* regNameStr = reg.GetName();
-			if (reg.IsValid() && (regNameStr != nullptr))
-			{
-				std::string regName(regNameStr);
-				if (!regName.empty())
-					result[regName] = DebugRegister(regName, reg.GetValueAsUnsigned(), reg.GetByteSize() * 8, regIndex++);
-			}
+			if (!reg.IsValid() || (regNameStr == nullptr))
+				continue;
+
+			std::string regName(regNameStr);
+			if (regName.empty() || !names.insert(regName).second)
+				continue;
+
+			registers.emplace_back(regName, reg.GetByteSize() * 8);
+			m_registerLocations.emplace_back((uint32_t)i, (uint32_t)j);
 		}
 	}
+
+	m_registerSchema = RegisterSchema::Intern(GetTargetArchitecture(), registers);
+}
+
+
+bool LldbAdapter::ReadRegisterValues(std::shared_ptr<const RegisterSchema>& schema, std::vector<uint64_t>& values)
+{
+	SBValueList regGroups;
+	if (!GetRegisterGroups(regGroups))
+		return false;
+
+	std::unique_lock<std::mutex> lock(m_registerSchemaMutex);
+	if (!RegisterGroupsMatch(regGroups))
+		BuildRegisterSchema(regGroups);
+
+	schema = m_registerSchema;
+	values.assign(m_registerLocations.size(), 0);
+	SBValue regGroupInfo;
+	uint32_t currentGroup = UINT32_MAX;
+	for (size_t i = 0; i < m_registerLocations.size(); i++)
+	{
+		auto [group, index] = m_registerLocations[i];
+		if (group != currentGroup)
+		{
+			regGroupInfo = regGroups.GetValueAtIndex(group);
+			currentGroup = group;
+		}
+		values[i] = regGroupInfo.GetChildAtIndex(index).GetValueAsUnsigned();
+	}
+	return true;
+}
+
+
+std::unordered_map<std::string, DebugRegister> LldbAdapter::ReadAllRegisters()
+{
+	std::unordered_map<std::string, DebugRegister> result;
+
+	std::shared_ptr<const RegisterSchema> schema;
+	std::vector<uint64_t> values;
+	if (!ReadRegisterValues(schema, values))
+		return result;
+
+	for (size_t i = 0; i < schema->GetCount(); i++)
+		result[schema->GetName(i)] = DebugRegister(schema->GetName(i), values[i], schema->GetWidth(i), i);
 	return result;
 }
 
@@ -712,33 +851,21 @@ DebugRegister LldbAdapter::ReadRegister(const std::string& name)
 {
 	DebugRegister result {};
 
-	SBThread thread = m_process.GetSelectedThread();
-	if (!thread.IsValid())
+	SBValueList regGroups;
+	if (!GetRegisterGroups(regGroups))
 		return result;
 
-	size_t frameCount = thread.GetNumFrames();
-	if (frameCount == 0)
-		return result;
+	std::unique_lock<std::mutex> lock(m_registerSchemaMutex);
+	if (!RegisterGroupsMatch(regGroups))
+		BuildRegisterSchema(regGroups);
 
-	SBFrame frame = thread.GetFrameAtIndex(0);
-	if (!frame.IsValid())
+	size_t index = m_registerSchema->GetIndex(name);
+	if (index == RegisterSchema::InvalidIndex)
 		return result;
 
-	SBValueList regGroups = frame.GetRegisters();
-	size_t numGroups = regGroups.GetSize();
-	for (size_t i = 0; i < numGroups; i++)
-	{
-		SBValue regGroupInfo = regGroups.GetValueAtIndex(i);
-		size_t numRegs = regGroupInfo.GetNumChildren();
-		for (size_t j = 0; j < numRegs; j++)
-		{
-			SBValue reg = regGroupInfo.GetChildAtIndex(j);
-			if (name == reg.GetName())
-				// TODO: register width and internal index
-				return DebugRegister(name, reg.GetValueAsUnsigned(), 0, 0);
-		}
-	}
-	return result;
+	auto [group, child] = m_registerLocations[index];
+	SBValue reg = regGroups.GetValueAtIndex(group).GetChildAtIndex(child);
+	return DebugRegister(name, reg.GetValueAsUnsigned(), m_registerSchema->GetWidth(index), index);
 }
 
 
@@ -795,6 +922,68 @@ DataBuffer LldbAdapter::ReadMemory(std::uintptr_t address, std::size_t size)
 }
 
 
+std::vector<DataBuffer> LldbAdapter::ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges)
+{
+	std::vector<DataBuffer> results(ranges.size());
+	if (!m_quitingMutex.try_lock())
+		return results;
+
+	// Sort the requests and merge the ones that overlap or are adjacent, so that each contiguous span only costs one
+	// SBProcess::ReadMemory() call. This matters a lot when debugging remotely, where every call is a round trip.
+	std::vector<size_t> order(ranges.size());
+	for (size_t i = 0; i < order.size(); i++)
+		order[i] = i;
+	std::sort(order.begin(), order.end(),
+		[&](size_t lhs, size_t rhs) { return ranges[lhs].m_address < ranges[rhs].m_address; });
+
+	std::vector<uint8_t> buffer;
+	size_t i = 0;
+	while (i < order.size())
+	{
+		uint64_t spanStart = ranges[order[i]].m_address;
+		uint64_t spanEnd = spanStart + ranges[order[i]].m_size;
+		size_t j = i + 1;
+		while ((j < order.size()) && (ranges[order[j]].m_address <= spanEnd))
+		{
+			spanEnd = std::max<uint64_t>(spanEnd, ranges[order[j]].m_address + ranges[order[j]].m_size);
+			j++;
+		}
+
+		buffer.resize(spanEnd - spanStart);
+		SBError error;
+		size_t bytesRead = 0;
+		if (!buffer.empty())
+			bytesRead = m_process.ReadMemory(spanStart, buffer.data(), buffer.size(), error);
+		if (!error.Success())
+			bytesRead = 0;
+
+		for (size_t k = i; k < j; k++)
+		{
+			const DebugMemoryRange& range = ranges[order[k]];
+			uint64_t offset = range.m_address - spanStart;
+			if (offset + range.m_size <= bytesRead)
+			{
+				results[order[k]].Append(buffer.data() + offset, range.m_size);
+				continue;
+			}
+
+			// The span is only partially readable. Read this range on its own, so that it gets exactly what
+			// ReadMemory() would have returned for it.
+			std::vector<uint8_t> rangeBuffer(range.m_size);
+			SBError rangeError;
+			size_t rangeBytesRead = m_process.ReadMemory(range.m_address, rangeBuffer.data(), range.m_size, rangeError);
+			if (rangeBytesRead > 0 && rangeError.Success())
+				results[order[k]].Append(rangeBuffer.data(), rangeBytesRead);
+		}
+
+		i = j;
+	}
+
+	m_quitingMutex.unlock();
+	return results;
+}
+
+
 bool LldbAdapter::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
 {
 	if (!m_quitingMutex.try_lock())
@@ -856,6 +1045,32 @@ std::vector<DebugModule> LldbAdapter::GetModuleList()
 }
 
 
+std::vector<DebugMemoryRegion> LldbAdapter::GetMemoryRegions()
+{
+	std::vector<DebugMemoryRegion> result;
+	if (!m_quitingMutex.try_lock())
+		return result;
+
+	// One request for the whole map, rather than one SBProcess::GetMemoryRegionInfo() call per region
+	SBMemoryRegionInfoList regions = m_process.GetMemoryRegions();
+	for (uint32_t i = 0; i < regions.GetSize(); i++)
+	{
+		SBMemoryRegionInfo info;
+		if (!regions.GetMemoryRegionAtIndex(i, info) || !info.IsMapped())
+			continue;
+
+		const char* name = info.GetName();
+		result.emplace_back(info.GetRegionBase(), info.GetRegionEnd(), info.IsReadable(), info.IsWritable(),
+			info.IsExecutable(), name ? name : "");
+	}
+
+	m_quitingMutex.unlock();
+	std::sort(result.begin(), result.end(),
+		[](const DebugMemoryRegion& lhs, const DebugMemoryRegion& rhs) { return lhs.m_start < rhs.m_start; });
+	return result;
+}
+
+
 std::string LldbAdapter::GetTargetArchitecture()
 {
 	SBPlatform platform = m_target.GetPlatform();
@@ -1020,6 +1235,10 @@ DebugStopReason LldbAdapter::StopReason()
 			{
 				reason = DebugStopReason::Breakpoint;
 			}
+			else if (threadReason == lldb::eStopReasonWatchpoint)
+			{
+				reason = DebugStopReason::Watchpoint;
+			}
 			else if (threadReason == lldb::eStopReasonSignal)
 			{
 				size_t dataCount = thread.GetStopReasonDataCount();
@@ -1269,14 +1488,11 @@ uint64_t LldbAdapter::GetInstructionOffset()
 	if (!thread.IsValid())
 		return 0;
 
+	// Do not ask for the number of frames, which unwinds the entire stack
 	uint64_t pc = 0;
-	size_t frameCount = thread.GetNumFrames();
-	if (frameCount > 0)
-	{
-		SBFrame frame = thread.GetFrameAtIndex(0);
-		if (frame.IsValid())
-			pc = frame.GetPC();
-	}
+	SBFrame frame = thread.GetFrameAtIndex(0);
+	if (frame.IsValid())
+		pc = frame.GetPC();
 
 	return pc;
 }
@@ -1303,7 +1519,7 @@ uint64_t LldbAdapter::GetStackPointer()
 
 bool LldbAdapter::SupportFeature(DebugAdapterCapacity feature)
 {
-	return false;
+	return feature == DebugAdapterSupportWatchpoints;
 }
 
 
@@ -1399,6 +1615,9 @@ void LldbAdapter::EventListener()
 					if (reason == ProcessExited)
 						reason = UnknownReason;
 					dbgevt.data.targetStoppedData.reason = reason;
+					if (reason == Watchpoint)
+						GetWatchpointHit(dbgevt.data.targetStoppedData.watchpointAddress,
+							dbgevt.data.targetStoppedData.watchpointType);
 					PostDebuggerEvent(dbgevt);
 					break;
 				}
@@ -1406,6 +1625,7 @@ void LldbAdapter::EventListener()
 				{
 					done = true;
 					m_targetActive = false;
+					ClearWatchpoints();
 					DebuggerEvent dbgevt;
 					dbgevt.type = TargetExitedEventType;
 					dbgevt.data.exitData.exitCode = ExitCode();
@@ -1416,6 +1636,7 @@ void LldbAdapter::EventListener()
 				{
 					done = true;
 					m_targetActive = false;
+					ClearWatchpoints();
 					DebuggerEvent dbgevt;
 					dbgevt.type = DetachedEventType;
 					PostDebuggerEvent(dbgevt);
@@ -1428,25 +1649,18 @@ void LldbAdapter::EventListener()
 			else if ((event_type & lldb::SBProcess::eBroadcastBitSTDOUT)
 				|| (event_type & lldb::SBProcess::eBroadcastBitSTDERR))
 			{
-				char buffer[1024];
+				// The output is buffered and delivered in batches by the controller, so drain it in large chunks
+				std::vector<char> buffer(0x10000);
 				size_t count = 0;
 				std::string output {};
-				// TODO: we should differentiate stdout and stderr
-				while ((count = process.GetSTDOUT(buffer, 1024)) > 0)
-					output += std::string(buffer, count);
-
-				DebuggerEvent event;
-				event.type = StdoutMessageEventType;
-				event.data.messageData.message = output;
-				PostDebuggerEvent(event);
+				while ((count = process.GetSTDOUT(buffer.data(), buffer.size())) > 0)
+					output.append(buffer.data(), count);
+				PostTargetOutput(StdoutOutputStream, output);
 
 				output.clear();
-				while ((count = process.GetSTDERR(buffer, 1024)) > 0)
-					output += std::string(buffer, count);
-
-				event.type = StdoutMessageEventType;
-				event.data.messageData.message = output;
-				PostDebuggerEvent(event);
+				while ((count = process.GetSTDERR(buffer.data(), buffer.size())) > 0)
+					output.append(buffer.data(), count);
+				PostTargetOutput(StderrOutputStream, output);
 			}
 		}
 		else if (lldb::SBTarget::EventIsTargetEvent(event))
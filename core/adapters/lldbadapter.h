@@ -36,6 +36,27 @@ namespace BinaryNinjaDebugger {
 		bool m_targetActive;
 		std::vector<ModuleNameAndOffset> m_pendingBreakpoints {};
 
+		struct WatchpointInfo
+		{
+			std::uintptr_t address;
+			DebugWatchpointType type;
+		};
+		// LLDB does not tell the type of a watchpoint that is hit, so it is remembered here
+		std::unordered_map<lldb::watch_id_t, WatchpointInfo> m_watchpoints;
+		std::mutex m_watchpointMutex;
+		bool GetWatchpointHit(uint64_t& address, DebugWatchpointType& type);
+		void ClearWatchpoints();
+
+		// Where each register of the schema is among the register groups of LLDB, as the index of the group and the
+		// index in the group. This reads a register without going through the names of the others.
+		std::shared_ptr<const RegisterSchema> m_registerSchema;
+		std::vector<std::pair<uint32_t, uint32_t>> m_registerLocations;
+		std::vector<size_t> m_registerGroupSizes;
+		std::mutex m_registerSchemaMutex;
+		bool RegisterGroupsMatch(lldb::SBValueList& regGroups);
+		void BuildRegisterSchema(lldb::SBValueList& regGroups);
+		bool GetRegisterGroups(lldb::SBValueList& regGroups);
+
 		// Since when SBProcess::Kill() and SBProcess::ReadMemory() are called at the same time, LLDB will hang,
 		// we must use this mutex to prevent the quit operation and read memory operation to happen at the same time.
 		std::mutex m_quitingMutex;
@@ -77,7 +98,7 @@ namespace BinaryNinjaDebugger {
 		bool SuspendThread(std::uint32_t tid) override;
 		bool ResumeThread(std::uint32_t tid) override;
 
-		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid) override;
+		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid, size_t maxFrames = 0) override;
 
 		DebugBreakpoint AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type) override;
 
@@ -90,18 +111,28 @@ namespace BinaryNinjaDebugger {
 
 		std::vector<DebugBreakpoint> GetBreakpointList() const override;
 
+		bool AddWatchpoint(std::uintptr_t address, size_t size, DebugWatchpointType type) override;
+
+		bool RemoveWatchpoint(std::uintptr_t address) override;
+
 		std::unordered_map<std::string, DebugRegister> ReadAllRegisters() override;
 
 		DebugRegister ReadRegister(const std::string& reg) override;
 
+		bool ReadRegisterValues(std::shared_ptr<const RegisterSchema>& schema, std::vector<uint64_t>& values) override;
+
 		bool WriteRegister(const std::string& reg, std::uintptr_t value) override;
 
 		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) override;
 
+		std::vector<DataBuffer> ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges) override;
+
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) override;
 
 		std::vector<DebugModule> GetModuleList() override;
 
+		std::vector<DebugMemoryRegion> GetMemoryRegions() override;
+
 		std::string GetTargetArchitecture() override;
 
 		DebugStopReason StopReason() override;
@@ -0,0 +1,198 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include "breakpointattributes.h"
+#include "debugadapter.h"
+
+using namespace BinaryNinjaDebugger;
+
+// The longest string that {expr:s} prints
+static constexpr size_t MaxTracepointString = 256;
+
+
+std::shared_ptr<TracepointTemplate> TracepointTemplate::Compile(const std::string& text, std::string& error)
+{
+	auto result = std::make_shared<TracepointTemplate>();
+	result->m_text = text;
+
+	std::string literal;
+	size_t pos = 0;
+	while (pos < text.size())
+	{
+		char c = text[pos];
+		if ((c == '{' || c == '}') && (pos + 1 < text.size()) && (text[pos + 1] == c))
+		{
+			literal += c;
+			pos += 2;
+			continue;
+		}
+
+		if (c == '}')
+		{
+			error = fmt::format("unmatched }} at offset {}", pos);
+			return nullptr;
+		}
+
+		if (c != '{')
+		{
+			literal += c;
+			pos++;
+			continue;
+		}
+
+		size_t end = text.find('}', pos + 1);
+		if (end == std::string::npos)
+		{
+			error = fmt::format("unmatched {{ at offset {}", pos);
+			return nullptr;
+		}
+
+		std::string placeholder = text.substr(pos + 1, end - pos - 1);
+		char format = 'x';
+		size_t colon = placeholder.find(':');
+		if (colon != std::string::npos)
+		{
+			std::string spec = placeholder.substr(colon + 1);
+			if ((spec != "x") && (spec != "d") && (spec != "s"))
+			{
+				error = fmt::format("unknown format \"{}\" at offset {}", spec, pos);
+				return nullptr;
+			}
+			format = spec[0];
+			placeholder = placeholder.substr(0, colon);
+		}
+
+		std::string expressionError;
+		auto expression = BreakpointCondition::Compile(placeholder, expressionError);
+		if (!expression)
+		{
+			error = fmt::format("invalid expression \"{}\": {}", placeholder, expressionError);
+			return nullptr;
+		}
+
+		result->m_segments.push_back({std::move(literal), expression, format});
+		literal.clear();
+		pos = end + 1;
+	}
+
+	if (!literal.empty())
+		result->m_segments.push_back({std::move(literal), nullptr, 0});
+
+	return result;
+}
+
+
+static std::string ReadString(DebugAdapter* adapter, uint64_t address)
+{
+	DataBuffer buffer = adapter->ReadMemory(address, MaxTracepointString);
+	// The string can end right before an unmapped page
+	if (buffer.GetLength() == 0)
+		buffer = adapter->ReadMemory(address, std::min<size_t>(MaxTracepointString, 0x1000 - (address & 0xfff)));
+
+	std::string result;
+	for (size_t i = 0; i < buffer.GetLength(); i++)
+	{
+		char c = (char)buffer[i];
+		if (c == 0)
+			break;
+		result += isprint((unsigned char)c) ? c : '.';
+	}
+	return result;
+}
+
+
+std::string TracepointTemplate::Format(DebugAdapter* adapter, size_t addressSize) const
+{
+	std::string result;
+	for (const Segment& segment : m_segments)
+	{
+		result += segment.text;
+		if (!segment.expression)
+			continue;
+
+		uint64_t value = 0;
+		if (!segment.expression->Evaluate(adapter, addressSize, value))
+		{
+			result += "?";
+			continue;
+		}
+
+		switch (segment.format)
+		{
+		case 'd':
+			result += std::to_string(value);
+			break;
+		case 's':
+			result += ReadString(adapter, value);
+			break;
+		default:
+			result += fmt::format("0x{:x}", value);
+			break;
+		}
+	}
+	return result;
+}
+
+
+uint64_t BreakpointHits::Hit()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return ++m_count;
+}
+
+
+void BreakpointHits::Record(uint64_t hit, std::string message)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (m_records.size() >= m_capacity)
+	{
+		m_records.pop_front();
+		m_dropped++;
+	}
+	m_records.push_back({hit, std::move(message)});
+}
+
+
+void BreakpointHits::Reset()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_count = 0;
+	m_records.clear();
+	m_dropped = 0;
+}
+
+
+uint64_t BreakpointHits::GetCount() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_count;
+}
+
+
+std::vector<BreakpointRecord> BreakpointHits::GetRecords() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return std::vector<BreakpointRecord>(m_records.begin(), m_records.end());
+}
+
+
+uint64_t BreakpointHits::GetDropped() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_dropped;
+}
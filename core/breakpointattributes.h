@@ -0,0 +1,103 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "breakpointcondition.h"
+
+namespace BinaryNinjaDebugger {
+	class DebugAdapter;
+
+	// The log message of a tracepoint, e.g., "open({rdi:s}, {rsi})". The placeholders are expressions with the syntax
+	// of the breakpoint conditions. {expr} and {expr:x} print the value in hex, {expr:d} in decimal, and {expr:s}
+	// prints the C string at the address. {{ and }} are literal braces.
+	class TracepointTemplate
+	{
+		struct Segment
+		{
+			// Printed before the placeholder
+			std::string text;
+			// nullptr for the text after the last placeholder
+			std::shared_ptr<BreakpointCondition> expression;
+			char format;
+		};
+
+		std::string m_text;
+		std::vector<Segment> m_segments;
+
+	public:
+		// Returns nullptr and sets error if the template cannot be parsed
+		static std::shared_ptr<TracepointTemplate> Compile(const std::string& text, std::string& error);
+
+		// A placeholder that cannot be evaluated is printed as "?"
+		std::string Format(DebugAdapter* adapter, size_t addressSize) const;
+
+		const std::string& GetText() const { return m_text; }
+	};
+
+
+	struct BreakpointRecord
+	{
+		// The number of the hit that wrote the record, starting from 1
+		uint64_t hit;
+		std::string message;
+	};
+
+
+	// The hits of a breakpoint. The adapter thread updates it while the target runs, so it has its own lock. Only the
+	// latest records are kept.
+	class BreakpointHits
+	{
+		mutable std::mutex m_mutex;
+		uint64_t m_count = 0;
+		std::deque<BreakpointRecord> m_records;
+		size_t m_capacity;
+		uint64_t m_dropped = 0;
+
+	public:
+		BreakpointHits(size_t capacity) : m_capacity(capacity) {}
+
+		// Counts a hit, and returns its number
+		uint64_t Hit();
+		void Record(uint64_t hit, std::string message);
+		void Reset();
+
+		uint64_t GetCount() const;
+		std::vector<BreakpointRecord> GetRecords() const;
+		// The number of records that are discarded because the buffer is full
+		uint64_t GetDropped() const;
+	};
+
+
+	// Everything about a breakpoint besides its address. It is immutable once the adapter thread can see it, so a
+	// change makes a new copy, which shares the hits with the old one.
+	struct BreakpointAttributes
+	{
+		std::shared_ptr<const BreakpointCondition> condition;
+		std::shared_ptr<const TracepointTemplate> logTemplate;
+		// A tracepoint never stops the target. It only counts the hits, and records the log message if there is one.
+		bool tracepoint = false;
+		// The number of hits that are counted without stopping the target
+		uint64_t ignoreCount = 0;
+		std::shared_ptr<BreakpointHits> hits;
+	};
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,444 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <initializer_list>
+#include <stdexcept>
+#include "breakpointcondition.h"
+#include "debugadapter.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+// Recursive descent parser that emits the bytecode as it goes
+class BreakpointCondition::Parser
+{
+	const std::string& m_text;
+	size_t m_pos = 0;
+	BreakpointCondition& m_condition;
+
+	void SkipSpaces()
+	{
+		while ((m_pos < m_text.size()) && isspace((unsigned char)m_text[m_pos]))
+			m_pos++;
+	}
+
+	bool Match(const char* token)
+	{
+		SkipSpaces();
+		size_t length = strlen(token);
+		if (m_text.compare(m_pos, length, token) != 0)
+			return false;
+
+		// Do not take the first character of a longer operator, e.g., "<" out of "<<" or "<=", or "&" out of "&&"
+		if ((length == 1) && (m_pos + 1 < m_text.size()))
+		{
+			char next = m_text[m_pos + 1];
+			switch (token[0])
+			{
+			case '<':
+			case '>':
+				if ((next == token[0]) || (next == '='))
+					return false;
+				break;
+			case '&':
+			case '|':
+			case '=':
+				if (next == token[0])
+					return false;
+				break;
+			case '!':
+				if (next == '=')
+					return false;
+				break;
+			default:
+				break;
+			}
+		}
+
+		m_pos += length;
+		return true;
+	}
+
+	[[noreturn]] void Fail(const std::string& message)
+	{
+		throw std::runtime_error(message + " at offset " + std::to_string(m_pos));
+	}
+
+	void Emit(Opcode opcode, uint64_t operand = 0) { m_condition.m_code.push_back({opcode, operand}); }
+
+	std::string ParseIdentifier()
+	{
+		size_t start = m_pos;
+		while ((m_pos < m_text.size()) && (isalnum((unsigned char)m_text[m_pos]) || m_text[m_pos] == '_'))
+			m_pos++;
+		return m_text.substr(start, m_pos - start);
+	}
+
+	void ParseDereference(uint64_t size)
+	{
+		ParseLogicalOr();
+		if (!Match("]"))
+			Fail("expecting ]");
+		Emit(Dereference, size);
+	}
+
+	void ParsePrimary()
+	{
+		SkipSpaces();
+		if (m_pos >= m_text.size())
+			Fail("unexpected end of condition");
+
+		if (Match("("))
+		{
+			ParseLogicalOr();
+			if (!Match(")"))
+				Fail("expecting )");
+			return;
+		}
+
+		if (Match("["))
+		{
+			// 0 means the address size of the target
+			ParseDereference(0);
+			return;
+		}
+
+		char c = m_text[m_pos];
+		if (isdigit((unsigned char)c))
+		{
+			std::string number = ParseIdentifier();
+			try
+			{
+				// Unlike C, a leading 0 does not mean octal
+				int base = ((number.size() > 2) && (number[0] == '0') && (tolower(number[1]) == 'x')) ? 16 : 10;
+				size_t parsed = 0;
+				uint64_t value = std::stoull(number, &parsed, base);
+				if (parsed != number.size())
+					Fail("invalid number " + number);
+				Emit(PushConstant, value);
+			}
+			catch (const std::logic_error&)
+			{
+				Fail("invalid number " + number);
+			}
+			return;
+		}
+
+		if (isalpha((unsigned char)c) || (c == '_') || (c == '$'))
+		{
+			if (c == '$')
+				m_pos++;
+			std::string name = ParseIdentifier();
+			std::string lower = name;
+			std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char ch) { return tolower(ch); });
+
+			static const std::pair<const char*, uint64_t> sizes[] = {
+				{"byte", 1}, {"word", 2}, {"dword", 4}, {"qword", 8}};
+			for (const auto& [sizeName, size] : sizes)
+			{
+				if ((lower == sizeName) && Match("["))
+				{
+					ParseDereference(size);
+					return;
+				}
+			}
+
+			auto& registers = m_condition.m_registers;
+			auto iter = std::find(registers.begin(), registers.end(), lower);
+			size_t index = iter - registers.begin();
+			if (iter == registers.end())
+				registers.push_back(lower);
+			Emit(PushRegister, index);
+			return;
+		}
+
+		Fail(std::string("unexpected character '") + c + "'");
+	}
+
+	void ParseUnary()
+	{
+		if (Match("-"))
+		{
+			ParseUnary();
+			Emit(Negate);
+		}
+		else if (Match("!"))
+		{
+			ParseUnary();
+			Emit(LogicalNot);
+		}
+		else if (Match("~"))
+		{
+			ParseUnary();
+			Emit(BitwiseNot);
+		}
+		else
+		{
+			ParsePrimary();
+		}
+	}
+
+	// Parses a left-associative level of binary operators
+	template <typename Next>
+	void ParseBinary(std::initializer_list<std::pair<const char*, Opcode>> operators, Next next)
+	{
+		(this->*next)();
+		while (true)
+		{
+			bool matched = false;
+			for (const auto& [token, opcode] : operators)
+			{
+				if (Match(token))
+				{
+					(this->*next)();
+					Emit(opcode);
+					matched = true;
+					break;
+				}
+			}
+			if (!matched)
+				return;
+		}
+	}
+
+	void ParseMultiplicative() { ParseBinary({{"*", Multiply}, {"/", Divide}, {"%", Modulo}}, &Parser::ParseUnary); }
+	void ParseAdditive() { ParseBinary({{"+", Add}, {"-", Subtract}}, &Parser::ParseMultiplicative); }
+	void ParseShift() { ParseBinary({{"<<", ShiftLeft}, {">>", ShiftRight}}, &Parser::ParseAdditive); }
+	void ParseRelational()
+	{
+		ParseBinary({{"<=", LessEqual}, {">=", GreaterEqual}, {"<", Less}, {">", Greater}}, &Parser::ParseShift);
+	}
+	void ParseEquality() { ParseBinary({{"==", Equal}, {"!=", NotEqual}}, &Parser::ParseRelational); }
+	void ParseBitwiseAnd() { ParseBinary({{"&", BitwiseAnd}}, &Parser::ParseEquality); }
+	void ParseBitwiseXor() { ParseBinary({{"^", BitwiseXor}}, &Parser::ParseBitwiseAnd); }
+	void ParseBitwiseOr() { ParseBinary({{"|", BitwiseOr}}, &Parser::ParseBitwiseXor); }
+
+	void ParseLogicalAnd()
+	{
+		ParseBitwiseOr();
+		while (Match("&&"))
+		{
+			size_t jump = m_condition.m_code.size();
+			Emit(JumpIfFalse);
+			ParseBitwiseOr();
+			Emit(ToBool);
+			m_condition.m_code[jump].operand = m_condition.m_code.size();
+		}
+	}
+
+	void ParseLogicalOr()
+	{
+		ParseLogicalAnd();
+		while (Match("||"))
+		{
+			size_t jump = m_condition.m_code.size();
+			Emit(JumpIfTrue);
+			ParseLogicalAnd();
+			Emit(ToBool);
+			m_condition.m_code[jump].operand = m_condition.m_code.size();
+		}
+	}
+
+public:
+	Parser(const std::string& text, BreakpointCondition& condition) : m_text(text), m_condition(condition) {}
+
+	void Parse()
+	{
+		ParseLogicalOr();
+		SkipSpaces();
+		if (m_pos != m_text.size())
+			Fail("unexpected trailing characters");
+	}
+};
+
+
+std::shared_ptr<BreakpointCondition> BreakpointCondition::Compile(const std::string& text, std::string& error)
+{
+	auto condition = std::make_shared<BreakpointCondition>();
+	condition->m_text = text;
+	try
+	{
+		Parser(text, *condition).Parse();
+	}
+	catch (const std::exception& e)
+	{
+		error = e.what();
+		return nullptr;
+	}
+	return condition;
+}
+
+
+bool BreakpointCondition::Evaluate(DebugAdapter* adapter, size_t addressSize, uint64_t& result) const
+{
+	if (!adapter)
+		return false;
+
+	// Registers are read at most once, and only when the execution reaches them
+	std::vector<uint64_t> registerValues(m_registers.size());
+	std::vector<bool> registerRead(m_registers.size(), false);
+
+	std::vector<uint64_t> stack;
+	stack.reserve(16);
+
+	auto pop = [&]() {
+		uint64_t value = stack.back();
+		stack.pop_back();
+		return value;
+	};
+
+	for (size_t pc = 0; pc < m_code.size(); pc++)
+	{
+		const Instruction& instruction = m_code[pc];
+		switch (instruction.opcode)
+		{
+		case PushConstant:
+			stack.push_back(instruction.operand);
+			break;
+		case PushRegister:
+		{
+			size_t index = instruction.operand;
+			if (!registerRead[index])
+			{
+				DebugRegister reg = adapter->ReadRegister(m_registers[index]);
+				// Adapters return an empty register if it does not exist
+				if (reg.m_name.empty())
+					return false;
+				registerValues[index] = reg.m_value;
+				registerRead[index] = true;
+			}
+			stack.push_back(registerValues[index]);
+			break;
+		}
+		case Dereference:
+		{
+			size_t size = instruction.operand ? instruction.operand : addressSize;
+			DataBuffer buffer = adapter->ReadMemory(pop(), size);
+			if (buffer.GetLength() != size)
+				return false;
+			uint64_t value = 0;
+			// Little-endian, like all the architectures the adapters support
+			for (size_t i = 0; i < size; i++)
+				value |= (uint64_t)buffer[i] << (8 * i);
+			stack.push_back(value);
+			break;
+		}
+		case Negate:
+			stack.back() = 0 - stack.back();
+			break;
+		case LogicalNot:
+			stack.back() = !stack.back();
+			break;
+		case BitwiseNot:
+			stack.back() = ~stack.back();
+			break;
+		case ToBool:
+			stack.back() = stack.back() != 0;
+			break;
+		case JumpIfFalse:
+			if (stack.back() == 0)
+				pc = instruction.operand - 1;
+			else
+				stack.pop_back();
+			break;
+		case JumpIfTrue:
+			if (stack.back() != 0)
+			{
+				stack.back() = 1;
+				pc = instruction.operand - 1;
+			}
+			else
+			{
+				stack.pop_back();
+			}
+			break;
+		default:
+		{
+			uint64_t right = pop();
+			uint64_t left = pop();
+			uint64_t value = 0;
+			switch (instruction.opcode)
+			{
+			case Multiply:
+				value = left * right;
+				break;
+			case Divide:
+				if (right == 0)
+					return false;
+				value = left / right;
+				break;
+			case Modulo:
+				if (right == 0)
+					return false;
+				value = left % right;
+				break;
+			case Add:
+				value = left + right;
+				break;
+			case Subtract:
+				value = left - right;
+				break;
+			case ShiftLeft:
+				value = (right >= 64) ? 0 : (left << right);
+				break;
+			case ShiftRight:
+				value = (right >= 64) ? 0 : (left >> right);
+				break;
+			case Less:
+				value = left < right;
+				break;
+			case LessEqual:
+				value = left <= right;
+				break;
+			case Greater:
+				value = left > right;
+				break;
+			case GreaterEqual:
+				value = left >= right;
+				break;
+			case Equal:
+				value = left == right;
+				break;
+			case NotEqual:
+				value = left != right;
+				break;
+			case BitwiseAnd:
+				value = left & right;
+				break;
+			case BitwiseXor:
+				value = left ^ right;
+				break;
+			case BitwiseOr:
+				value = left | right;
+				break;
+			default:
+				return false;
+			}
+			stack.push_back(value);
+			break;
+		}
+		}
+	}
+
+	if (stack.size() != 1)
+		return false;
+
+	result = stack.back();
+	return true;
+}
@@ -0,0 +1,91 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	class DebugAdapter;
+
+	// A breakpoint condition, e.g., `rdi == 0x1234 && [rsp + 8] > 5`. It is compiled once into a small stack-based
+	// bytecode, which only reads the registers and memory it references when it is evaluated.
+	//
+	// Supported syntax, with C precedence and unsigned 64-bit arithmetic:
+	//   - decimal and 0x-prefixed hexadecimal numbers, and register names
+	//   - [expr] reads a pointer-sized value; byte[expr], word[expr], dword[expr] and qword[expr] read 1, 2, 4, 8 bytes
+	//   - unary - ! ~, binary * / % + - << >> < <= > >= == != & ^ | && ||, and parentheses
+	class BreakpointCondition
+	{
+		enum Opcode : uint8_t
+		{
+			PushConstant,
+			PushRegister,
+			Dereference,
+			Negate,
+			LogicalNot,
+			BitwiseNot,
+			Multiply,
+			Divide,
+			Modulo,
+			Add,
+			Subtract,
+			ShiftLeft,
+			ShiftRight,
+			Less,
+			LessEqual,
+			Greater,
+			GreaterEqual,
+			Equal,
+			NotEqual,
+			BitwiseAnd,
+			BitwiseXor,
+			BitwiseOr,
+			ToBool,
+			// Short-circuit of && and ||. If the top of the stack decides the result, it is replaced with the result
+			// and the execution jumps to the operand; otherwise it is popped.
+			JumpIfFalse,
+			JumpIfTrue,
+		};
+
+		struct Instruction
+		{
+			Opcode opcode;
+			// The constant, the index of the register, the size of the dereference, or the target of the jump
+			uint64_t operand;
+		};
+
+		std::string m_text;
+		std::vector<Instruction> m_code;
+		std::vector<std::string> m_registers;
+
+		class Parser;
+
+	public:
+		// Returns nullptr and sets error if the condition cannot be parsed
+		static std::shared_ptr<BreakpointCondition> Compile(const std::string& text, std::string& error);
+
+		// Returns false if the condition cannot be evaluated, e.g., a register does not exist or the memory is not
+		// readable. The result is only valid when this returns true.
+		bool Evaluate(DebugAdapter* adapter, size_t addressSize, uint64_t& result) const;
+
+		const std::string& GetText() const { return m_text; }
+		const std::vector<std::string>& GetRegisters() const { return m_registers; }
+	};
+};  // namespace BinaryNinjaDebugger
@@ -14,14 +14,12 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
 #include <binaryninjacore.h>
 #include <binaryninjaapi.h>
 #include <lowlevelilinstruction.h>
 #include <mediumlevelilinstruction.h>
 #include <highlevelilinstruction.h>
-#ifndef WIN32
-	#include "libgen.h"
-#endif
 #include "debugadapter.h"
 
 using namespace BinaryNinjaDebugger;
@@ -59,16 +57,27 @@ void DebugAdapter::PostDebuggerEvent(const DebuggerEvent& event)
 }
 
 
+void DebugAdapter::PostTargetOutput(DebuggerOutputStream stream, const std::string& data)
+{
+	if (data.empty())
+		return;
+
+	if (m_outputCallback)
+	{
+		m_outputCallback(stream, data);
+		return;
+	}
+
+	DebuggerEvent event;
+	event.type = StdoutMessageEventType;
+	event.data.messageData.message = data;
+	PostDebuggerEvent(event);
+}
+
+
 std::string DebugModule::GetPathBaseName(const std::string& path)
 {
-#ifdef WIN32
-	// TODO: someone please write it on Windows!
-	char baseName[MAX_PATH];
-	_splitpath(path.c_str(), NULL, NULL, baseName, NULL);
-	return std::string(baseName);
-#else
-	return basename(strdup(path.c_str()));
-#endif
+	return ModuleNameAndOffset::GetPathBaseName(path);
 }
 
 
@@ -111,12 +120,50 @@ void DebugAdapter::WriteStdin(const std::string& msg)
 }
 
 
-std::vector<DebugFrame> DebugAdapter::GetFramesOfThread(std::uint32_t tid)
+std::vector<DebugFrame> DebugAdapter::GetFramesOfThread(std::uint32_t tid, size_t maxFrames)
 {
 	return {};
 }
 
 
+bool DebugAdapter::ReadRegisterValues(std::shared_ptr<const RegisterSchema>& schema, std::vector<uint64_t>& values)
+{
+	std::unordered_map<std::string, DebugRegister> registers = ReadAllRegisters();
+	if (registers.empty())
+		return false;
+
+	std::vector<const DebugRegister*> sorted;
+	sorted.reserve(registers.size());
+	for (const auto& [name, reg] : registers)
+		sorted.push_back(&reg);
+	std::sort(sorted.begin(), sorted.end(), [](const DebugRegister* lhs, const DebugRegister* rhs) {
+		return lhs->m_registerIndex < rhs->m_registerIndex;
+	});
+
+	std::vector<std::pair<std::string, size_t>> layout;
+	layout.reserve(sorted.size());
+	for (const DebugRegister* reg : sorted)
+		layout.emplace_back(reg->m_name, reg->m_width);
+	if (!schema || !schema->Matches(layout))
+		schema = RegisterSchema::Intern(GetTargetArchitecture(), layout);
+
+	values.resize(sorted.size());
+	for (size_t i = 0; i < sorted.size(); i++)
+		values[i] = sorted[i]->m_value;
+	return true;
+}
+
+
+std::vector<DataBuffer> DebugAdapter::ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges)
+{
+	std::vector<DataBuffer> result;
+	result.reserve(ranges.size());
+	for (const auto& range : ranges)
+		result.push_back(ReadMemory(range.m_address, range.m_size));
+	return result;
+}
+
+
 bool DebugAdapter::ConnectToDebugServer(const std::string& server, std::uint32_t port)
 {
 	return false;
@@ -30,6 +30,7 @@ limitations under the License.
 #include "ffi_global.h"
 #include "debuggercommon.h"
 #include "debuggerevent.h"
+#include "registerschema.h"
 
 DECLARE_DEBUGGER_API_OBJECT(BNDebugAdapter, DebugAdapter);
 
@@ -54,6 +55,7 @@ namespace BinaryNinjaDebugger {
 		DebugAdapterSupportStepOver,
 		DebugAdapterSupportModules,
 		DebugAdapterSupportThreads,
+		DebugAdapterSupportWatchpoints,
 	};
 
 
@@ -133,6 +135,8 @@ namespace BinaryNinjaDebugger {
 		std::uintptr_t m_value {};
 		std::size_t m_width {}, m_registerIndex {};
 		std::string m_hint {};
+		// Whether the value differs from the one at the previous stop
+		bool m_changed {};
 
 		DebugRegister() = default;
 
@@ -184,6 +188,40 @@ namespace BinaryNinjaDebugger {
 		{}
 	};
 
+	struct DebugMemoryRange
+	{
+		std::uintptr_t m_address {};
+		std::size_t m_size {};
+
+		DebugMemoryRange() = default;
+		DebugMemoryRange(std::uintptr_t address, std::size_t size) : m_address(address), m_size(size) {}
+	};
+
+	// A mapped range of the target's address space
+	struct DebugMemoryRegion
+	{
+		std::uintptr_t m_start {};
+		std::uintptr_t m_end {};
+		bool m_readable {};
+		bool m_writable {};
+		bool m_executable {};
+		// The file that backs the region, if any
+		std::string m_name {};
+
+		DebugMemoryRegion() = default;
+		DebugMemoryRegion(std::uintptr_t start, std::uintptr_t end, bool readable, bool writable, bool executable,
+			const std::string& name) :
+			m_start(start),
+			m_end(end), m_readable(readable), m_writable(writable), m_executable(executable), m_name(name)
+		{}
+
+		bool operator==(const DebugMemoryRegion& rhs) const
+		{
+			return (m_start == rhs.m_start) && (m_end == rhs.m_end) && (m_readable == rhs.m_readable)
+				&& (m_writable == rhs.m_writable) && (m_executable == rhs.m_executable) && (m_name == rhs.m_name);
+		}
+	};
+
 	class DebugAdapter
 	{
 		IMPLEMENT_DEBUGGER_API_OBJECT(BNDebugAdapter);
@@ -193,6 +231,8 @@ namespace BinaryNinjaDebugger {
 		// TODO: we should not use a vector here; only the DebuggerController should register one here;
 		// Other components should register their callbacks to the controller, who is responsible for notify them.
 		std::function<void(const DebuggerEvent& event)> m_eventCallback;
+		// Receives the output of the target. If it is not set, the output is posted as a StdoutMessageEventType.
+		std::function<void(DebuggerOutputStream stream, const std::string& data)> m_outputCallback;
 
 	protected:
 		uint64_t m_entryPoint;
@@ -213,6 +253,11 @@ namespace BinaryNinjaDebugger {
 			m_eventCallback = function;
 		}
 
+		virtual void SetOutputCallback(std::function<void(DebuggerOutputStream stream, const std::string& data)> function)
+		{
+			m_outputCallback = function;
+		}
+
 		[[nodiscard]] virtual bool Execute(const std::string& path, const LaunchConfigurations& configs = {}) = 0;
 
 		[[nodiscard]] virtual bool ExecuteWithArgs(const std::string& path, const std::string& args,
@@ -246,7 +291,8 @@ namespace BinaryNinjaDebugger {
 
 		virtual bool ResumeThread(std::uint32_t tid) = 0;
 
-		virtual std::vector<DebugFrame> GetFramesOfThread(std::uint32_t tid);
+		// Unwind the stack of a thread. If maxFrames is not zero, only the innermost maxFrames frames are returned.
+		virtual std::vector<DebugFrame> GetFramesOfThread(std::uint32_t tid, size_t maxFrames = 0);
 
 		virtual DebugBreakpoint AddBreakpoint(const std::uintptr_t address, unsigned long breakpoint_type = 0) = 0;
 
@@ -258,18 +304,37 @@ namespace BinaryNinjaDebugger {
 
 		virtual std::vector<DebugBreakpoint> GetBreakpointList() const = 0;
 
+		// Hardware watchpoints. The size is 1, 2, 4 or 8, and the address must be aligned to it. There is one
+		// watchpoint per address. Adapters that support them also report DebugAdapterSupportWatchpoints.
+		virtual bool AddWatchpoint(std::uintptr_t address, size_t size, DebugWatchpointType type) { return false; }
+
+		virtual bool RemoveWatchpoint(std::uintptr_t address) { return false; }
+
 		virtual std::unordered_map<std::string, DebugRegister> ReadAllRegisters() = 0;
 
 		virtual DebugRegister ReadRegister(const std::string& reg) = 0;
 
+		// Read the values of all registers into a flat array, in the order of the schema. The schema is replaced if
+		// the registers of the target do not match it. The default implementation is based on ReadAllRegisters();
+		// adapters should override it if they can read the values without looking up the names.
+		virtual bool ReadRegisterValues(std::shared_ptr<const RegisterSchema>& schema, std::vector<uint64_t>& values);
+
 		virtual bool WriteRegister(const std::string& reg, std::uintptr_t value) = 0;
 
 		virtual DataBuffer ReadMemory(std::uintptr_t address, std::size_t size) = 0;
 
+		// Read several ranges at once. The result has one entry per range, in the same order; an entry is empty if the
+		// range cannot be read. Adapters should override this if they can serve multiple ranges in fewer round trips.
+		virtual std::vector<DataBuffer> ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges);
+
 		virtual bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer) = 0;
 
 		virtual std::vector<DebugModule> GetModuleList() = 0;
 
+		// The mapped regions of the address space, sorted by their start. An empty list means the adapter does not know
+		// the memory map, in which case every address is assumed to be readable.
+		virtual std::vector<DebugMemoryRegion> GetMemoryRegions() { return {}; }
+
 		virtual std::string GetTargetArchitecture() = 0;
 
 		virtual DebugStopReason StopReason() = 0;
@@ -298,6 +363,8 @@ namespace BinaryNinjaDebugger {
 		// This is implemented by the (base) DebugAdapter class.
 		// Sub-classes should use it to post debugger events directly (only when needed).
 		void PostDebuggerEvent(const DebuggerEvent& event);
+		// Sub-classes should use it to forward the stdout/stderr of the target
+		void PostTargetOutput(DebuggerOutputStream stream, const std::string& data);
 
 		virtual void WriteStdin(const std::string& msg);
 
@@ -17,6 +17,7 @@ limitations under the License.
 #include <inttypes.h>
 #include "processview.h"
 #include "adapters/lldbadapter.h"
+#include "adapters/corefileadapter.h"
 #ifdef WIN32
 	#include "adapters/dbgengadapter.h"
 	#include "adapters/dbgengttdadapter.h"
@@ -44,6 +45,7 @@ void InitDebugAdapterTypes()
 	//InitGdbAdapterType();
 	//InitLldbRspAdapterType();
 	InitLldbAdapterType();
+	InitCoreFileAdapterType();
 }
 
 
@@ -122,6 +124,39 @@ static void RegisterSettings()
 			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
 			})");
 
+	settings->RegisterSetting("debugger.stackVariableAnnotationDepth",
+		R"({
+			"title" : "Stack Variable Annotation Depth",
+			"type" : "number",
+			"default" : 4,
+			"minValue" : 0,
+			"maxValue" : 64,
+			"description" : "How many pointers the debugger follows from a stack variable to annotate the data it points to. The first one is followed when the target stops, and the others in the background afterwards.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.stackVariableAnnotationElements",
+		R"({
+			"title" : "Stack Variable Annotation Array Elements",
+			"type" : "number",
+			"default" : 256,
+			"minValue" : 0,
+			"maxValue" : 65536,
+			"description" : "Maximum number of elements of an array on the stack whose pointers and structures are annotated.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.stackVariableAnnotationBudget",
+		R"({
+			"title" : "Stack Variable Annotation Time Budget",
+			"type" : "number",
+			"default" : 20,
+			"minValue" : 0,
+			"maxValue" : 10000,
+			"description" : "Milliseconds the debugger spends on following pointers from stack variables before it shows a stop. The rest is annotated in the background.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
 	settings->RegisterSetting("debugger.aggressiveAnalysisUpdate",
 		R"({
 			"title" : "Update the analysis aggressively",
@@ -131,6 +166,94 @@ static void RegisterSettings()
 			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
 			})");
 
+	settings->RegisterSetting("debugger.memoryPrefetchLimit",
+		R"({
+			"title" : "Memory Prefetch Limit",
+			"type" : "number",
+			"default" : 16,
+			"minValue" : 0,
+			"maxValue" : 1024,
+			"description" : "Maximum number of pages the debugger reads ahead when it detects sequential, strided or stack accesses to the target's memory. Set it to 0 to disable the read-ahead.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.memoryPrefetchInBackground",
+		R"({
+			"title" : "Prefetch Memory in Background",
+			"type" : "boolean",
+			"default" : true,
+			"description" : "Read ahead the target's memory on a background thread, rather than together with the read that triggers it.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.outputBufferSize",
+		R"({
+			"title" : "Target Output Buffer Size",
+			"type" : "number",
+			"default" : 1048576,
+			"minValue" : 4096,
+			"maxValue" : 268435456,
+			"description" : "Size in bytes of the buffer that keeps the stdout, and separately the stderr, of the target until it is read.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.outputOverflowPolicy",
+		R"({
+			"title" : "Target Output Overflow Policy",
+			"type" : "string",
+			"default" : "drop",
+			"enum" : ["drop", "spill"],
+			"enumDescriptions" : [
+				"Discard the oldest output.",
+				"Keep the output that does not fit in the buffer in a temporary file, up to the spill limit."],
+			"description" : "What to do when the target writes to stdout or stderr faster than the output is read.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.outputSpillLimit",
+		R"({
+			"title" : "Target Output Spill Limit",
+			"type" : "number",
+			"default" : 268435456,
+			"minValue" : 4096,
+			"maxValue" : 17179869184,
+			"description" : "Maximum size in bytes of the temporary file that keeps the stdout, and separately the stderr, of the target with the spill overflow policy. The output that does not fit is dropped until the file is read.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.outputFlushSize",
+		R"({
+			"title" : "Target Output Batch Size",
+			"type" : "number",
+			"default" : 65536,
+			"minValue" : 1,
+			"maxValue" : 16777216,
+			"description" : "The output of the target is delivered to the event callbacks in batches. A batch is delivered as soon as it reaches this many bytes.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.outputFlushInterval",
+		R"({
+			"title" : "Target Output Batch Interval",
+			"type" : "number",
+			"default" : 50,
+			"minValue" : 0,
+			"maxValue" : 10000,
+			"description" : "Maximum time in milliseconds the output of the target is held back to form a batch before it is delivered to the event callbacks.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
+	settings->RegisterSetting("debugger.tracepointBufferSize",
+		R"({
+			"title" : "Tracepoint Log Size",
+			"type" : "number",
+			"default" : 10000,
+			"minValue" : 1,
+			"maxValue" : 10000000,
+			"description" : "Number of log messages kept for each tracepoint. Older messages are discarded. Takes effect on the next launch.",
+			"ignore" : ["SettingsProjectScope", "SettingsResourceScope"]
+			})");
+
 	settings->RegisterSetting("debugger.safeMode",
 		R"({
 			"title" : "Safe Mode",
@@ -15,10 +15,8 @@ limitations under the License.
 */
 
 #pragma once
+#include <string>
 #include <string.h>
-#ifndef WIN32
-	#include "libgen.h"
-#endif
 
 namespace BinaryNinjaDebugger {
 	struct ModuleNameAndOffset
@@ -61,7 +59,17 @@ namespace BinaryNinjaDebugger {
 			_splitpath(path.c_str(), NULL, NULL, baseName, NULL);
 			return std::string(baseName);
 #else
-			return basename(strdup(path.c_str()));
+			// Same as basename(3), without having to make a modifiable (and leaked) copy of the path
+			if (path.empty())
+				return ".";
+
+			size_t end = path.find_last_not_of('/');
+			if (end == std::string::npos)
+				return "/";
+
+			size_t slash = path.find_last_of('/', end);
+			size_t start = (slash == std::string::npos) ? 0 : slash + 1;
+			return path.substr(start, end - start + 1);
 #endif
 		}
 
@@ -15,10 +15,13 @@ limitations under the License.
 */
 
 #include "debuggercontroller.h"
+#include <algorithm>
+#include <cstring>
 #include <thread>
 #include "lowlevelilinstruction.h"
 #include "mediumlevelilinstruction.h"
 #include "highlevelilinstruction.h"
+#include "memoryclassifier.h"
 
 using namespace BinaryNinjaDebugger;
 
@@ -28,12 +31,20 @@ DebuggerController::DebuggerController(BinaryViewRef data) : m_data(data)
 
 	m_state = new DebuggerState(data, this);
 	m_adapter = nullptr;
-	RegisterEventCallback([this](const DebuggerEvent& event) { EventHandler(event); }, "Debugger Core");
+	m_eventBus = std::make_shared<DebuggerEventBus>();
+	// The core handler updates the modules, the threads and the caches, which the UI reads on the main thread, so it
+	// runs there as well. It is registered first, so it runs before the other callbacks.
+	RegisterEventCallback(
+		[this](const DebuggerEvent& event) { EventHandler(event); }, "Debugger Core", SynchronousEventDelivery);
 }
 
 
 DebuggerController::~DebuggerController()
 {
+	// The worker thread of the bus keeps the bus alive, so it has to be told to quit
+	if (m_eventBus)
+		m_eventBus->Shutdown();
+
 	// This is not necessary since m_state should have been deleted by DebuggerController::Destroy()
 	if (m_state)
 	{
@@ -83,6 +94,139 @@ void DebuggerController::DeleteBreakpoint(const ModuleNameAndOffset& address)
 }
 
 
+void DebuggerController::NotifyBreakpointsChanged(size_t count)
+{
+	// A single event for the whole batch, since every breakpoint event refreshes the whole breakpoint list in the UI
+	if (count == 0)
+		return;
+
+	DebuggerEvent event;
+	event.type = BreakpointsChangedEvent;
+	PostDebuggerEvent(event);
+}
+
+
+size_t DebuggerController::AddBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	size_t result = m_state->AddBreakpoints(addresses);
+	NotifyBreakpointsChanged(result);
+	return result;
+}
+
+
+size_t DebuggerController::AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	size_t result = m_state->AddBreakpoints(addresses);
+	NotifyBreakpointsChanged(result);
+	return result;
+}
+
+
+size_t DebuggerController::DeleteBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	size_t result = m_state->DeleteBreakpoints(addresses);
+	NotifyBreakpointsChanged(result);
+	return result;
+}
+
+
+size_t DebuggerController::DeleteBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	size_t result = m_state->DeleteBreakpoints(addresses);
+	NotifyBreakpointsChanged(result);
+	return result;
+}
+
+
+bool DebuggerController::SetBreakpointCondition(uint64_t address, const std::string& condition)
+{
+	return SetBreakpointCondition(m_state->GetModules()->AbsoluteAddressToRelative(address), condition);
+}
+
+
+bool DebuggerController::SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition)
+{
+	return m_state->GetBreakpoints()->SetCondition(address, condition);
+}
+
+
+std::string DebuggerController::GetBreakpointCondition(uint64_t address)
+{
+	return GetBreakpointCondition(m_state->GetModules()->AbsoluteAddressToRelative(address));
+}
+
+
+std::string DebuggerController::GetBreakpointCondition(const ModuleNameAndOffset& address)
+{
+	auto attributes = m_state->GetBreakpoints()->GetAttributes(address);
+	if (!attributes || !attributes->condition)
+		return "";
+
+	return attributes->condition->GetText();
+}
+
+
+bool DebuggerController::SetBreakpointTracepoint(const ModuleNameAndOffset& address, bool tracepoint)
+{
+	return m_state->GetBreakpoints()->SetTracepoint(address, tracepoint);
+}
+
+
+bool DebuggerController::SetBreakpointLogTemplate(const ModuleNameAndOffset& address, const std::string& logTemplate)
+{
+	return m_state->GetBreakpoints()->SetLogTemplate(address, logTemplate);
+}
+
+
+bool DebuggerController::SetBreakpointIgnoreCount(const ModuleNameAndOffset& address, uint64_t ignoreCount)
+{
+	return m_state->GetBreakpoints()->SetIgnoreCount(address, ignoreCount);
+}
+
+
+std::shared_ptr<const BreakpointAttributes> DebuggerController::GetBreakpointAttributes(
+	const ModuleNameAndOffset& address)
+{
+	return m_state->GetBreakpoints()->GetAttributes(address);
+}
+
+
+bool DebuggerController::ResetBreakpointHits(const ModuleNameAndOffset& address)
+{
+	return m_state->GetBreakpoints()->ResetHits(address);
+}
+
+
+bool DebuggerController::AddWatchpoint(uint64_t address, size_t size, DebugWatchpointType type)
+{
+	return m_state->GetWatchpoints()->AddAbsolute(address, size, type);
+}
+
+
+bool DebuggerController::AddWatchpoint(const ModuleNameAndOffset& address, size_t size, DebugWatchpointType type)
+{
+	return m_state->GetWatchpoints()->AddOffset(address, size, type);
+}
+
+
+bool DebuggerController::DeleteWatchpoint(uint64_t address)
+{
+	return m_state->GetWatchpoints()->RemoveAbsolute(address);
+}
+
+
+bool DebuggerController::DeleteWatchpoint(const ModuleNameAndOffset& address)
+{
+	return m_state->GetWatchpoints()->RemoveOffset(address);
+}
+
+
+std::vector<DebuggerWatchpoint> DebuggerController::GetWatchpoints()
+{
+	return m_state->GetWatchpoints()->GetWatchpointList();
+}
+
+
 bool DebuggerController::SetIP(uint64_t address)
 {
 	std::string ipRegisterName;
@@ -143,7 +287,9 @@ DebugStopReason DebuggerController::LaunchAndWaitInternal()
 	if (!CreateDebuggerBinaryView())
 		return InternalError;
 
-	return ExecuteAdapterAndWait(DebugAdapterLaunch);
+	DebugStopReason reason = ExecuteAdapterAndWait(DebugAdapterLaunch);
+	ApplyWatchpoints(reason);
+	return reason;
 }
 
 
@@ -183,7 +329,9 @@ DebugStopReason DebuggerController::AttachAndWaitInternal()
 	if (!CreateDebuggerBinaryView())
 		return InternalError;
 
-	return ExecuteAdapterAndWait(DebugAdapterAttach);
+	DebugStopReason reason = ExecuteAdapterAndWait(DebugAdapterAttach);
+	ApplyWatchpoints(reason);
+	return reason;
 }
 
 
@@ -223,7 +371,9 @@ DebugStopReason DebuggerController::ConnectAndWaitInternal()
 	if (!CreateDebuggerBinaryView())
 		return InternalError;
 
-	return ExecuteAdapterAndWait(DebugAdapterConnect);
+	DebugStopReason reason = ExecuteAdapterAndWait(DebugAdapterConnect);
+	ApplyWatchpoints(reason);
+	return reason;
 }
 
 
@@ -293,7 +443,16 @@ bool DebuggerController::CreateDebugAdapter()
 	ApplyBreakpoints();
 
 	// Forward the DebuggerEvent from the adapters to the controller
-	m_adapter->SetEventCallback([this](const DebuggerEvent& event) { PostDebuggerEvent(event); });
+	m_adapter->SetEventCallback([this](const DebuggerEvent& event) {
+		// The output of the target is buffered and delivered in batches
+		if (event.type == StdoutMessageEventType)
+			m_state->GetOutput()->Write(StdoutOutputStream, event.data.messageData.message);
+		else if (!HandleTraceEvent(event) && !SkipBreakpointHit(event))
+			PostDebuggerEvent(event);
+	});
+	m_adapter->SetOutputCallback([this](DebuggerOutputStream stream, const std::string& data) {
+		m_state->GetOutput()->Write(stream, data);
+	});
 	return true;
 }
 
@@ -305,6 +464,73 @@ void DebuggerController::ApplyBreakpoints()
 }
 
 
+// Watchpoints need a live process, so they are added as soon as the launch, attach or connect returns with the target
+// stopped, whatever the reason of the stop is
+void DebuggerController::ApplyWatchpoints(DebugStopReason reason)
+{
+	if ((reason == ProcessExited) || (reason == InternalError))
+		return;
+
+	m_state->GetWatchpoints()->Apply();
+}
+
+
+// This runs on the adapter thread, before anyone sees the event. When the target hits a breakpoint whose condition is
+// false, a tracepoint, or a breakpoint that still ignores its hits, it is resumed right away, so neither the stop nor
+// the following resume reaches the callbacks, and the caches are not refreshed.
+bool DebuggerController::SkipBreakpointHit(const DebuggerEvent& event)
+{
+	if ((event.type == ResumeEventType) || (event.type == StepIntoEventType))
+		return m_hideNextResume.exchange(false);
+
+	if ((event.type != AdapterStoppedEventType) || (event.data.targetStoppedData.reason != Breakpoint)
+		|| !m_handleBreakpointHits)
+		return false;
+
+	// Only the active thread is checked, which is the one that hits the breakpoint
+	uint64_t address = m_adapter->GetInstructionOffset();
+	std::shared_ptr<const BreakpointAttributes> attributes = m_state->GetBreakpoints()->GetAttributesAt(address);
+	if (!attributes)
+		return false;
+
+	size_t addressSize = m_data->GetAddressSize();
+	if (attributes->condition)
+	{
+		uint64_t result = 0;
+		if (!attributes->condition->Evaluate(m_adapter, addressSize, result))
+		{
+			LogWarn("Failed to evaluate the breakpoint condition \"%s\" at 0x%" PRIx64,
+				attributes->condition->GetText().c_str(), address);
+			return false;
+		}
+
+		if (result == 0)
+			return ResumeAfterBreakpointHit();
+	}
+
+	uint64_t hit = attributes->hits->Hit();
+	if (attributes->logTemplate)
+		attributes->hits->Record(hit, attributes->logTemplate->Format(m_adapter, addressSize));
+
+	if (!attributes->tracepoint && (hit > attributes->ignoreCount))
+		return false;
+
+	return ResumeAfterBreakpointHit();
+}
+
+
+bool DebuggerController::ResumeAfterBreakpointHit()
+{
+	m_hideNextResume = true;
+	if (!m_adapter->Go())
+	{
+		m_hideNextResume = false;
+		return false;
+	}
+	return true;
+}
+
+
 bool DebuggerController::CanResumeTarget()
 {
 	return m_state->IsConnected() && (!m_state->IsRunning());
@@ -346,74 +572,134 @@ DebugStopReason DebuggerController::GoAndWait()
 }
 
 
-DebugStopReason DebuggerController::StepIntoIL(BNFunctionGraphType il)
+// Whether an IL step that reaches the address stops there, which is when an instruction of the IL starts at it. The
+// step also stops if the address is not in a function, or the IL is not available.
+bool DebuggerController::IsILStepStop(uint64_t address, BNFunctionGraphType il)
 {
-	switch (il)
+	std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(address);
+	if (functions.empty())
+		return true;
+
+	for (const FunctionRef& func : functions)
 	{
-	case NormalFunctionGraph:
+		auto starts = m_ilAddressCache.GetInstructionStarts(func, il);
+		if (!starts || starts->Contains(address))
+			return true;
+	}
+	return false;
+}
+
+
+// Steps to the next IL instruction by putting temporary breakpoints on the IL instructions that can follow the current
+// one, i.e., the rest of its block and the first instructions of the successor blocks, and on the return address of
+// the function, then resuming the target. A step into also stops at the calls, and steps into them. Returns false
+// without touching the target if the step cannot be done this way, e.g., the address is not the start of an IL
+// instruction, or the stack cannot be unwound, in which case the caller falls back to single stepping.
+bool DebuggerController::StepILWithBreakpoints(BNFunctionGraphType il, bool stepInto, DebugStopReason& reason)
+{
+	uint64_t address = m_state->IP();
+	std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(address);
+	if (functions.empty())
+		return false;
+
+	std::unordered_set<uint64_t> starts;
+	std::unordered_set<uint64_t> callSites;
+	for (const FunctionRef& func : functions)
 	{
-		return StepIntoAndWaitInternal();
+		auto flow = m_ilAddressCache.GetFlowGraph(func, il);
+		if (!flow || !flow->GetNextInstructionStarts(address, starts))
+			return false;
+
+		if (!stepInto)
+			continue;
+		auto funcCallSites = m_ilAddressCache.GetCallSites(func);
+		if (!funcCallSites)
+			return false;
+		callSites.insert(funcCallSites->GetAddresses().begin(), funcCallSites->GetAddresses().end());
 	}
-	case LowLevelILFunctionGraph:
+
+	// A step into at a call only needs to step into the callee
+	if (callSites.count(address) != 0)
 	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepIntoAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
+		reason = StepIntoAndWaitInternal();
+		return true;
+	}
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
+	// The caller of the current frame tells where the function returns to, and which activation of the function is
+	// the current one, in case it is recursive
+	uint32_t tid = m_adapter->GetActiveThreadId();
+	std::vector<DebugFrame> frames = m_adapter->GetFramesOfThread(tid, 2);
+	if (frames.size() < 2)
+		return false;
+	uint64_t returnAddress = frames[1].m_pc;
+	uint64_t callerStackPointer = frames[1].m_sp;
 
-			for (FunctionRef& func : functions)
-			{
-				LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
-				if (!llil)
-					return SingleStep;
+	std::unordered_set<uint64_t> targets(starts.begin(), starts.end());
+	targets.insert(callSites.begin(), callSites.end());
+	targets.insert(returnAddress);
 
-				size_t start = llil->GetInstructionStart(m_liveView->GetDefaultArchitecture(), newRemoteRip);
-				if (start < llil->GetInstructionCount())
-				{
-					if (llil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
-	}
-	case MediumLevelILFunctionGraph:
+	// The breakpoints stay for the whole step, including the resumes that run through a deeper activation
+	std::vector<uint64_t> added;
+	for (uint64_t target : targets)
 	{
-		// TODO: This might cause infinite loop
-		while (true)
+		if (!m_state->GetBreakpoints()->ContainsAbsolute(target))
 		{
-			DebugStopReason reason = StepIntoAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
+			m_adapter->AddBreakpoint(target);
+			added.push_back(target);
+		}
+	}
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
+	bool stepIntoCall = false;
+	while (true)
+	{
+		reason = GoAndWaitInternal();
+		if (reason != Breakpoint)
+			break;
 
-			for (FunctionRef& func : functions)
-			{
-				MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
-				if (!mlil)
-					return SingleStep;
+		address = m_state->IP();
+		// A breakpoint of the user, or a different thread runs into one of the temporary breakpoints
+		if (targets.count(address) == 0)
+			break;
+		if (m_adapter->GetActiveThreadId() != tid)
+			continue;
 
-				size_t start = mlil->GetInstructionStart(m_liveView->GetDefaultArchitecture(), newRemoteRip);
-				if (start < mlil->GetInstructionCount())
-				{
-					if (mlil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
+		if ((address != returnAddress) && !stepInto)
+		{
+			// A deeper activation of a recursive function, which a step over must run through
+			frames = m_adapter->GetFramesOfThread(tid, 2);
+			if ((frames.size() >= 2) && (frames[1].m_sp < callerStackPointer))
+				continue;
 		}
+
+		stepIntoCall = (callSites.count(address) != 0) && (starts.count(address) == 0);
+		reason = SingleStep;
 		break;
 	}
+
+	for (uint64_t target : added)
+		m_adapter->RemoveBreakpoint(target);
+
+	if (stepIntoCall)
+		reason = StepIntoAndWaitInternal();
+	return true;
+}
+
+
+DebugStopReason DebuggerController::StepIntoIL(BNFunctionGraphType il)
+{
+	// Stepping one machine instruction at a time is only the fallback
+	DebugStopReason reason;
+	if ((il != NormalFunctionGraph) && StepILWithBreakpoints(il, true, reason))
+		return reason;
+
+	switch (il)
+	{
+	case NormalFunctionGraph:
+	{
+		return StepIntoAndWaitInternal();
+	}
+	case LowLevelILFunctionGraph:
+	case MediumLevelILFunctionGraph:
 	case HighLevelILFunctionGraph:
 	case HighLevelLanguageRepresentationFunctionGraph:
 	{
@@ -424,23 +710,8 @@ DebugStopReason DebuggerController::StepIntoIL(BNFunctionGraphType il)
 			if (!ExpectSingleStep(reason))
 				return reason;
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
+			if (IsILStepStop(m_state->IP(), il))
 				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				HighLevelILFunctionRef hlil = func->GetHighLevelILIfAvailable();
-				if (!hlil)
-					return SingleStep;
-
-				for (size_t i = 0; i < hlil->GetInstructionCount(); i++)
-				{
-					if (hlil->GetInstruction(i).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
 		}
 		break;
 	}
@@ -478,6 +749,10 @@ DebugStopReason DebuggerController::StepIntoAndWait(BNFunctionGraphType il)
 
 DebugStopReason DebuggerController::StepOverIL(BNFunctionGraphType il)
 {
+	DebugStopReason reason;
+	if ((il != NormalFunctionGraph) && StepILWithBreakpoints(il, false, reason))
+		return reason;
+
 	switch (il)
 	{
 	case NormalFunctionGraph:
@@ -485,64 +760,7 @@ DebugStopReason DebuggerController::StepOverIL(BNFunctionGraphType il)
 		return StepOverAndWaitInternal();
 	}
 	case LowLevelILFunctionGraph:
-	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepOverAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
-
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
-				if (!llil)
-					return SingleStep;
-
-				size_t start = llil->GetInstructionStart(m_liveView->GetDefaultArchitecture(), newRemoteRip);
-				if (start < llil->GetInstructionCount())
-				{
-					if (llil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
-	}
 	case MediumLevelILFunctionGraph:
-	{
-		// TODO: This might cause infinite loop
-		while (true)
-		{
-			DebugStopReason reason = StepOverAndWaitInternal();
-			if (!ExpectSingleStep(reason))
-				return reason;
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
-				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
-				if (!mlil)
-					return SingleStep;
-
-				size_t start = mlil->GetInstructionStart(m_liveView->GetDefaultArchitecture(), newRemoteRip);
-				if (start < mlil->GetInstructionCount())
-				{
-					if (mlil->GetInstruction(start).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
-		}
-		break;
-	}
 	case HighLevelILFunctionGraph:
 	case HighLevelLanguageRepresentationFunctionGraph:
 	{
@@ -553,23 +771,8 @@ DebugStopReason DebuggerController::StepOverIL(BNFunctionGraphType il)
 			if (!ExpectSingleStep(reason))
 				return reason;
 
-			uint64_t newRemoteRip = m_state->IP();
-			std::vector<FunctionRef> functions = m_liveView->GetAnalysisFunctionsContainingAddress(newRemoteRip);
-			if (functions.empty())
+			if (IsILStepStop(m_state->IP(), il))
 				return SingleStep;
-
-			for (FunctionRef& func : functions)
-			{
-				HighLevelILFunctionRef hlil = func->GetHighLevelILIfAvailable();
-				if (!hlil)
-					return SingleStep;
-
-				for (size_t i = 0; i < hlil->GetInstructionCount(); i++)
-				{
-					if (hlil->GetInstruction(i).address == newRemoteRip)
-						return SingleStep;
-				}
-			}
 		}
 		break;
 	}
@@ -630,6 +833,11 @@ DebugStopReason DebuggerController::StepReturnAndWaitInternal()
 {
 	m_userRequestedBreak = false;
 
+	// The step of the adapter stops at every breakpoint, even the ones whose hits are handled in the core
+	DebugStopReason reason;
+	if (!m_state->GetBreakpoints()->GetBreakpointList().empty() && StepOutWithBreakpoints(true, reason))
+		return reason;
+
 	if (true /* StepReturnAvailable() */)
 	{
 		return ExecuteAdapterAndWait(DebugAdapterStepReturn);
@@ -689,7 +897,6 @@ DebugStopReason DebuggerController::RunToAndWaitInternal(const std::vector<uint6
 		}
 	}
 
-	NotifyStopped(reason);
 	return reason;
 }
 
@@ -720,6 +927,239 @@ DebugStopReason DebuggerController::RunToAndWait(const std::vector<uint64_t>& re
 }
 
 
+// While tracing, the target stops after every step. The stops and resumes are handed to the trace loop here, so
+// neither the events nor the cache updates that follow them slow it down. The exit of the target is still posted.
+bool DebuggerController::HandleTraceEvent(const DebuggerEvent& event)
+{
+	if (!m_tracing)
+		return false;
+
+	switch (event.type)
+	{
+	case ResumeEventType:
+	case StepIntoEventType:
+		return true;
+	case AdapterStoppedEventType:
+		m_traceStopReason = event.data.targetStoppedData.reason;
+		m_traceSemaphore.Release();
+		return true;
+	case TargetExitedEventType:
+	case DetachedEventType:
+		m_traceStopReason = ProcessExited;
+		m_traceSemaphore.Release();
+		return false;
+	default:
+		return false;
+	}
+}
+
+
+DebugStopReason DebuggerController::WaitForTraceStop(bool resumed)
+{
+	if (!resumed)
+		return InternalError;
+
+	m_traceSemaphore.Wait();
+	return m_traceStopReason;
+}
+
+
+// Returns the first instruction from the address that may transfer the control, which is where the basic block ends
+// as far as the CPU is concerned. This can be before the end of the basic block in the analysis, e.g., at a call.
+uint64_t DebuggerController::FindBlockEnd(uint64_t address, const std::unordered_set<uint64_t>& stopAddresses)
+{
+	static constexpr size_t MaxBlockInstructions = 256;
+
+	ArchitectureRef arch = m_state->GetRemoteArchitecture();
+	if (!arch)
+		return address;
+
+	size_t maxLength = arch->GetMaxInstructionLength();
+	for (size_t i = 0; i < MaxBlockInstructions; i++)
+	{
+		if ((i != 0) && (stopAddresses.count(address) != 0))
+			return address;
+
+		DataBuffer buffer = m_state->GetMemory()->ReadMemory(address, maxLength);
+		InstructionInfo info;
+		if ((buffer.GetLength() == 0)
+			|| !arch->GetInstructionInfo((const uint8_t*)buffer.GetData(), address, buffer.GetLength(), info)
+			|| (info.length == 0) || (info.branchCount != 0))
+			return address;
+
+		address += info.length;
+	}
+	return address;
+}
+
+
+DebugStopReason DebuggerController::TraceStep(
+	DebugTraceGranularity granularity, const std::unordered_set<uint64_t>& stopAddresses)
+{
+	if (granularity == TraceBasicBlocks)
+	{
+		// Run to the end of the block with a temporary breakpoint, then step over the branch
+		uint64_t address = m_adapter->GetInstructionOffset();
+		uint64_t end = FindBlockEnd(address, stopAddresses);
+		if (end != address)
+		{
+			bool hasBreakpoint = m_state->GetBreakpoints()->ContainsAbsolute(end);
+			if (!hasBreakpoint)
+				m_adapter->AddBreakpoint(end);
+
+			m_traceRunning = true;
+			DebugStopReason reason = WaitForTraceStop(m_adapter->Go());
+			m_traceRunning = false;
+
+			if (!hasBreakpoint && (reason != ProcessExited))
+				m_adapter->RemoveBreakpoint(DebugBreakpoint(end));
+
+			// The trace stops at a breakpoint or a stop address, so the branch is not stepped over
+			if (!ExpectSingleStep(reason) || m_traceCancelled || hasBreakpoint || (stopAddresses.count(end) != 0)
+				|| (m_adapter->GetInstructionOffset() != end))
+				return reason;
+		}
+	}
+
+	return WaitForTraceStop(m_adapter->StepInto());
+}
+
+
+DebugStopReason DebuggerController::TraceAndWaitInternal(const ExecutionTraceOptions& options)
+{
+	ExecutionTraceWriter writer;
+	std::string error;
+	if (!writer.Open(options.path, (uint32_t)m_data->GetAddressSize(), options.registers, error))
+	{
+		LogWarn("Failed to create the trace file %s: %s", options.path.c_str(), error.c_str());
+		return InternalError;
+	}
+
+	if (!m_adapterMutex.try_lock())
+		return InternalError;
+
+	std::unordered_set<uint64_t> stopAddresses(options.stopAddresses.begin(), options.stopAddresses.end());
+	std::vector<uint64_t> values(options.registers.size());
+	auto record = [&]() {
+		uint64_t address = m_adapter->GetInstructionOffset();
+		for (size_t i = 0; i < options.registers.size(); i++)
+			values[i] = m_adapter->ReadRegister(options.registers[i]).m_value;
+		writer.Append(m_adapter->GetActiveThreadId(), address, values);
+		return address;
+	};
+
+	m_userRequestedBreak = false;
+	m_traceCancelled = false;
+	m_tracing = true;
+	// The callbacks see the whole trace as one resume and one stop
+	NotifyEvent(ResumeEventType);
+
+	DebugStopReason reason = SingleStep;
+	record();
+	while (!m_traceCancelled && ((options.maxRecords == 0) || (writer.GetCount() < options.maxRecords)))
+	{
+		reason = TraceStep(options.granularity, stopAddresses);
+		if (!ExpectSingleStep(reason))
+			break;
+
+		uint64_t address = record();
+		if (stopAddresses.count(address) != 0)
+			break;
+
+		if (m_state->GetBreakpoints()->ContainsAbsolute(address))
+		{
+			reason = Breakpoint;
+			break;
+		}
+	}
+
+	if (m_traceCancelled && ExpectSingleStep(reason))
+		reason = UserRequestedBreak;
+
+	m_tracing = false;
+	m_adapterMutex.unlock();
+
+	if (!writer.Close())
+		LogWarn("Failed to write the trace file %s", options.path.c_str());
+
+	// The target has been running, so anything cached during the trace is stale
+	m_state->MarkDirty();
+	return reason;
+}
+
+
+bool DebuggerController::Trace(const ExecutionTraceOptions& options)
+{
+	if (!CanResumeTarget())
+		return false;
+
+	std::thread([&, options]() { TraceAndWait(options); }).detach();
+
+	return true;
+}
+
+
+DebugStopReason DebuggerController::TraceAndWait(const ExecutionTraceOptions& options)
+{
+	if (!CanResumeTarget())
+		return InvalidStatusOrOperation;
+
+	if (!m_targetControlMutex.try_lock())
+		return InternalError;
+
+	auto reason = TraceAndWaitInternal(options);
+	if (reason != ProcessExited)
+		NotifyStopped(reason);
+
+	m_targetControlMutex.unlock();
+	return reason;
+}
+
+
+void DebuggerController::CancelTrace()
+{
+	if (!m_tracing)
+		return;
+
+	m_traceCancelled = true;
+	// A step ends on its own, but running to the end of a block may not, e.g., in a blocking system call
+	if (m_traceRunning)
+		m_adapter->BreakInto();
+}
+
+
+int64_t DebuggerController::HighlightTrace(const std::string& path, BNHighlightStandardColor color)
+{
+	std::string error;
+	std::unique_ptr<ExecutionTrace> trace = ExecutionTrace::Open(path, error);
+	if (!trace)
+	{
+		LogWarn("Failed to open the trace file %s: %s", path.c_str(), error.c_str());
+		return -1;
+	}
+
+	// A trace has lots of repeated addresses, so they are collected first
+	std::unordered_set<uint64_t> addresses;
+	if (!trace->ForEach([&](const ExecutionTraceRecord& record) {
+			addresses.insert(record.address);
+			return true;
+		}))
+		LogWarn("The trace file %s is truncated", path.c_str());
+
+	BinaryViewRef view = m_liveView ? m_liveView : m_data;
+	int64_t count = 0;
+	for (uint64_t address : addresses)
+	{
+		for (const FunctionRef& func : view->GetAnalysisFunctionsContainingAddress(address))
+		{
+			func->SetAutoInstructionHighlight(func->GetArchitecture(), address, color);
+			count++;
+		}
+	}
+	return count;
+}
+
+
 bool DebuggerController::CreateDebuggerBinaryView()
 {
 	BinaryViewTypeRef viewType = BinaryViewType::GetByName("Debugger");
@@ -835,9 +1275,9 @@ bool DebuggerController::ResumeThread(std::uint32_t tid)
 }
 
 
-std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint64_t tid)
+std::vector<DebugFrame> DebuggerController::GetFramesOfThread(uint64_t tid, size_t maxFrames)
 {
-	return m_state->GetThreads()->GetFramesOfThread(tid);
+	return m_state->GetThreads()->GetFramesOfThread(tid, maxFrames);
 }
 
 
@@ -965,6 +1405,13 @@ DebugStopReason DebuggerController::PauseAndWaitInternal()
 
 DebugStopReason DebuggerController::PauseAndWait()
 {
+	// The trace loop reports the stop once it ends
+	if (m_tracing)
+	{
+		CancelTrace();
+		return UserRequestedBreak;
+	}
+
 	auto reason = PauseAndWaitInternal();
 	NotifyStopped(reason);
 	return reason;
@@ -986,45 +1433,101 @@ DebugStopReason DebuggerController::StepIntoAndWaitInternal()
 }
 
 
-DebugStopReason DebuggerController::EmulateStepOverAndWait()
+// Returns 0 if the instruction at the address is not a call, or it cannot be decoded
+size_t DebuggerController::GetCallInstructionLength(uint64_t address)
 {
-	uint64_t remoteIP = m_state->IP();
-
 	// TODO: support the case where we cannot determined the remote arch
 	ArchitectureRef remoteArch = m_state->GetRemoteArchitecture();
 	if (!remoteArch)
-		return InternalError;
+		return 0;
 
 	size_t size = remoteArch->GetMaxInstructionLength();
-	DataBuffer buffer = m_adapter->ReadMemory(remoteIP, size);
+	DataBuffer buffer = m_adapter->ReadMemory(address, size);
 	size_t bytesRead = buffer.GetLength();
 
 	Ref<LowLevelILFunction> ilFunc = new LowLevelILFunction(remoteArch, nullptr);
-	ilFunc->SetCurrentAddress(remoteArch, remoteIP);
-	remoteArch->GetInstructionLowLevelIL((const uint8_t*)buffer.GetData(), remoteIP, bytesRead, *ilFunc);
+	ilFunc->SetCurrentAddress(remoteArch, address);
+	remoteArch->GetInstructionLowLevelIL((const uint8_t*)buffer.GetData(), address, bytesRead, *ilFunc);
 
 	const auto& instr = (*ilFunc)[0];
 	if (instr.operation != LLIL_CALL)
-	{
+		return 0;
+
+	InstructionInfo info;
+	if (!remoteArch->GetInstructionInfo((const uint8_t*)buffer.GetData(), address, bytesRead, info))
+		return 0;
+
+	return info.length;
+}
+
+
+DebugStopReason DebuggerController::EmulateStepOverAndWait()
+{
+	uint64_t remoteIP = m_state->IP();
+	// Whenever there is a failure, we fail back to step into
+	size_t length = GetCallInstructionLength(remoteIP);
+	if (length == 0)
 		return StepIntoAndWaitInternal();
+
+	return RunToAndWaitInternal({remoteIP + length});
+}
+
+
+// Steps over the call at the current address, or out of the current function, by resuming the target until it returns
+// to the caller. Unlike the steps of the adapters, which end at the first breakpoint, this goes through
+// GoAndWaitInternal, so the conditions, ignore counts and tracepoints of the breakpoints hit on the way are honored.
+// Returns false without touching the target if the return address is not known, or the instruction is not a call.
+bool DebuggerController::StepOutWithBreakpoints(bool stepReturn, DebugStopReason& reason)
+{
+	uint32_t tid = m_adapter->GetActiveThreadId();
+	std::vector<DebugFrame> frames = m_adapter->GetFramesOfThread(tid, 2);
+	if (frames.empty())
+		return false;
+
+	// The stack pointer after the return tells which activation of a recursive function returns
+	uint64_t returnAddress = 0;
+	uint64_t callerStackPointer = 0;
+	if (stepReturn)
+	{
+		if (frames.size() < 2)
+			return false;
+		returnAddress = frames[1].m_pc;
+		callerStackPointer = frames[1].m_sp;
 	}
 	else
 	{
-		InstructionInfo info;
-		if (!remoteArch->GetInstructionInfo((const uint8_t*)buffer.GetData(), remoteIP, bytesRead, info))
-		{
-			// Whenever there is a failure, we fail back to step into
-			return StepIntoAndWaitInternal();
-		}
+		size_t length = GetCallInstructionLength(frames[0].m_pc);
+		if (length == 0)
+			return false;
+		returnAddress = frames[0].m_pc + length;
+		callerStackPointer = frames[0].m_sp;
+	}
 
-		if (info.length == 0)
-		{
-			return StepIntoAndWaitInternal();
-		}
+	// A breakpoint of the user at the return address could let the target run past it
+	if (m_state->GetBreakpoints()->ContainsAbsolute(returnAddress))
+		return false;
+
+	m_adapter->AddBreakpoint(returnAddress);
+
+	while (true)
+	{
+		reason = GoAndWaitInternal();
+		if ((reason != Breakpoint) || (m_state->IP() != returnAddress))
+			break;
+		if (m_adapter->GetActiveThreadId() != tid)
+			continue;
 
-		uint64_t remoteIPNext = remoteIP + info.length;
-		return RunToAndWaitInternal({remoteIPNext});
+		// A deeper activation of a recursive function returns to the same address
+		frames = m_adapter->GetFramesOfThread(tid, 1);
+		if (!frames.empty() && (frames[0].m_sp < callerStackPointer))
+			continue;
+
+		reason = SingleStep;
+		break;
 	}
+
+	m_adapter->RemoveBreakpoint(returnAddress);
+	return true;
 }
 
 
@@ -1032,6 +1535,11 @@ DebugStopReason DebuggerController::StepOverAndWaitInternal()
 {
 	m_userRequestedBreak = false;
 
+	// The step of the adapter stops at every breakpoint, even the ones whose hits are handled in the core
+	DebugStopReason reason;
+	if (!m_state->GetBreakpoints()->GetBreakpointList().empty() && StepOutWithBreakpoints(false, reason))
+		return reason;
+
 	if (true /* StepOverAvailable() */)
 	{
 		return ExecuteAdapterAndWait(DebugAdapterStepOver);
@@ -1148,9 +1656,17 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 {
 	switch (event.type)
 	{
+	case LaunchEventType:
+	{
+		m_state->GetOutput()->Clear();
+		break;
+	}
 	case ResumeEventType:
 	case StepIntoEventType:
 	{
+		// The memory the stack variables point to is about to change. The target can also be resumed by the adapter,
+		// e.g., when it steps over a breakpoint, so this does not only happen in ExecuteAdapterAndWait.
+		CancelStackVariableExpansion();
 		// Todo: this is just a temporary workaround. Otherwise, the connection status would not be set properly
 		m_state->SetConnectionStatus(DebugAdapterConnectedStatus);
 		m_state->SetExecutionStatus(DebugAdapterRunningStatus);
@@ -1165,10 +1681,27 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 	{
 		m_inputFileLoaded = false;
 		m_initialBreakpointSeen = false;
+		m_state->GetMemory()->Clear();
+		{
+			// The tracked ranges are kept for the next launch, but nothing is compared across targets
+			std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+			m_memoryDiff.Reset();
+			m_unseenChangedRanges.clear();
+		}
+		{
+			std::unique_lock<std::mutex> lock(m_writtenRangesMutex);
+			m_writtenRanges.clear();
+		}
+		// Deliver the remaining output before the others see the target is gone. It stays readable until the next
+		// launch.
+		m_state->GetOutput()->Close();
 		// The m_liveView can be nullptr if the launch attempt fails because of the safe mode
 		if (m_liveView)
 			m_liveView->GetFile()->UnregisterViewOfType("Debugger", m_liveView);
+		// Before the live view is gone, since the background expansion of the stack variables uses it
+		ResetStackVariables();
 		SetLiveView(nullptr);
+		m_ilAddressCache.Clear();
 		m_currentIP = 0;
 		m_lastIP = 0;
 		m_state->SetConnectionStatus(DebugAdapterNotConnectedStatus);
@@ -1182,6 +1715,7 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 		m_state->SetExecutionStatus(DebugAdapterPausedStatus);
 		m_lastIP = m_currentIP;
 		m_currentIP = m_state->IP();
+		UpdateMemoryDiff();
 
 		DetectLoadedModule();
 		UpdateStackVariables();
@@ -1196,6 +1730,12 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 		AddRegisterValuesToExpressionParser();
 		break;
 	}
+	case ForceMemoryCacheUpdateEvent:
+	{
+		// The user asked for a fresh copy of the memory, e.g., because the code modifies itself
+		m_state->GetMemory()->Clear();
+		break;
+	}
 	case RegisterChangedEvent:
 	{
 		m_lastIP = m_currentIP;
@@ -1215,166 +1755,482 @@ void DebuggerController::EventHandler(const DebuggerEvent& event)
 
 
 size_t DebuggerController::RegisterEventCallback(
-	std::function<void(const DebuggerEvent&)> callback, const std::string& name)
+	std::function<void(const DebuggerEvent&)> callback, const std::string& name, DebuggerEventDeliveryPolicy policy)
 {
-	std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
-	DebuggerEventCallback object;
-	object.function = callback;
-	object.index = m_callbackIndex++;
-	object.name = name;
-	m_eventCallbacks.push_back(object);
-	return object.index;
+	return m_eventBus->RegisterCallback(callback, name, policy);
 }
 
 
 bool DebuggerController::RemoveEventCallback(size_t index)
 {
-	std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
-	m_disabledCallbacks.insert(index);
-	return RemoveEventCallbackInternal(index);
+	return m_eventBus->RemoveCallback(index);
 }
 
 
-bool DebuggerController::RemoveEventCallbackInternal(size_t index)
+void DebuggerController::PostDebuggerEvent(const DebuggerEvent& event)
 {
-	for (auto it = m_eventCallbacks.begin(); it != m_eventCallbacks.end(); it++)
+	if (event.type == AdapterStoppedEventType)
+		m_lastAdapterStopEventConsumed = false;
+
+	DebuggerEvent eventToSend = event;
+	if ((eventToSend.type == TargetStoppedEventType) && !m_initialBreakpointSeen)
+	{
+		m_initialBreakpointSeen = true;
+		eventToSend.data.targetStoppedData.reason = InitialBreakpoint;
+	}
+
+	m_eventBus->Post(eventToSend);
+
+	// If the current event is an AdapterStoppedEvent, and it is not consumed by any callback, then the adapter
+	// stop is not caused by the debugger core. Notify a target stop reason in this case.
+	// The only callback that consumes it is the one in ExecuteAdapterAndWait(), which is delivered inline, so the
+	// flag is up-to-date here.
+	if (event.type == AdapterStoppedEventType && !m_lastAdapterStopEventConsumed)
 	{
-		if (it->index == index)
+		DebuggerEvent stopEvent = event;
+		stopEvent.type = TargetStoppedEventType;
+		if (!m_initialBreakpointSeen)
 		{
-			m_eventCallbacks.erase(it);
-			return true;
+			m_initialBreakpointSeen = true;
+			stopEvent.data.targetStoppedData.reason = InitialBreakpoint;
 		}
+		m_eventBus->Post(stopEvent);
 	}
-	return false;
 }
 
 
-void DebuggerController::PostDebuggerEvent(const DebuggerEvent& event)
+void DebuggerController::NotifyStopped(DebugStopReason reason, void* data)
 {
-	std::unique_lock<std::recursive_mutex> callbackLock(m_callbackMutex);
-	std::list<DebuggerEventCallback> eventCallbacks = m_eventCallbacks;
-	callbackLock.unlock();
+	DebuggerEvent event;
+	event.type = TargetStoppedEventType;
+	event.data.targetStoppedData.reason = reason;
+	event.data.targetStoppedData.data = data;
+	if (reason == Watchpoint)
+	{
+		event.data.targetStoppedData.watchpointAddress = m_lastWatchpointAddress;
+		event.data.targetStoppedData.watchpointType = m_lastWatchpointType;
+	}
+	PostDebuggerEvent(event);
+}
 
-	if (event.type == AdapterStoppedEventType)
-		m_lastAdapterStopEventConsumed = false;
 
-	ExecuteOnMainThreadAndWait([&]() {
-		DebuggerEvent eventToSend = event;
-		if ((eventToSend.type == TargetStoppedEventType) && !m_initialBreakpointSeen)
+void DebuggerController::NotifyError(const std::string& error, const std::string& shortError, void* data)
+{
+	DebuggerEvent event;
+	event.type = ErrorEventType;
+	event.data.errorData.error = error;
+	event.data.errorData.shortError = shortError;
+	event.data.errorData.data = data;
+	PostDebuggerEvent(event);
+}
+
+
+void DebuggerController::NotifyEvent(DebuggerEventType eventType)
+{
+	DebuggerEvent event;
+	event.type = eventType;
+	PostDebuggerEvent(event);
+}
+
+
+// We should call these two function instead of DebugAdapter::ReadMemory(), which will skip the memory cache
+DataBuffer DebuggerController::ReadMemory(std::uintptr_t address, std::size_t size)
+{
+	if (!m_liveView)
+		return DataBuffer {};
+
+	if (!m_state->IsConnected())
+		return DataBuffer {};
+
+	if (m_state->IsRunning())
+		return DataBuffer {};
+
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return DataBuffer {};
+
+	return memory->ReadMemory(address, size);
+}
+
+
+std::vector<DataBuffer> DebuggerController::ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges)
+{
+	if (!m_liveView || !m_state->IsConnected() || m_state->IsRunning())
+		return std::vector<DataBuffer>(ranges.size());
+
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return std::vector<DataBuffer>(ranges.size());
+
+	return memory->ReadMemoryBatch(ranges);
+}
+
+
+bool DebuggerController::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+{
+	if (!m_liveView)
+		return false;
+
+	if (!m_state->IsConnected())
+		return false;
+
+	if (m_state->IsRunning())
+		return false;
+
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return false;
+
+	if (!memory->WriteMemory(address, buffer))
+		return false;
+
+	std::unique_lock<std::mutex> lock(m_writtenRangesMutex);
+	m_writtenRanges.emplace_back(address, buffer.GetLength());
+	return true;
+}
+
+
+std::vector<DebugMemoryRange> DebuggerController::TakeWrittenMemoryRanges()
+{
+	std::unique_lock<std::mutex> lock(m_writtenRangesMutex);
+	std::vector<DebugMemoryRange> result;
+	result.swap(m_writtenRanges);
+	return result;
+}
+
+
+DebuggerMemoryCacheStatistics DebuggerController::GetMemoryCacheStatistics()
+{
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return DebuggerMemoryCacheStatistics {};
+
+	return memory->GetStatistics();
+}
+
+
+void DebuggerController::ResetMemoryCacheStatistics()
+{
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (memory)
+		memory->ResetStatistics();
+}
+
+
+std::vector<DebugMemoryRegion> DebuggerController::GetMemoryRegions()
+{
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return {};
+
+	return memory->GetMemoryRegions();
+}
+
+
+// The readable regions of the memory map within [start, end). Without a memory map, fall back to the modules.
+std::vector<MemorySearch::Range> DebuggerController::GetSearchRanges(uint64_t start, uint64_t end)
+{
+	std::vector<MemorySearch::Range> ranges;
+	auto addRange = [&](uint64_t rangeStart, uint64_t rangeEnd) {
+		rangeStart = std::max(rangeStart, start);
+		rangeEnd = std::min(rangeEnd, end);
+		if (rangeStart < rangeEnd)
+			ranges.push_back({rangeStart, rangeEnd});
+	};
+
+	std::vector<DebugMemoryRegion> regions = GetMemoryRegions();
+	if (!regions.empty())
+	{
+		for (const auto& region : regions)
 		{
-			m_initialBreakpointSeen = true;
-			eventToSend.data.targetStoppedData.reason = InitialBreakpoint;
+			if (region.m_readable)
+				addRange(region.m_start, region.m_end);
 		}
+		return ranges;
+	}
 
-		for (const DebuggerEventCallback& cb : eventCallbacks)
-		{
-			if (m_disabledCallbacks.find(cb.index) != m_disabledCallbacks.end())
-				continue;
+	LogWarn("The memory map is not available, only searching the modules");
+	std::vector<DebugModule> modules = GetAllModules();
+	std::sort(modules.begin(), modules.end(),
+		[](const DebugModule& a, const DebugModule& b) { return a.m_address < b.m_address; });
+	for (const auto& module : modules)
+	{
+		uint64_t moduleStart = module.m_address;
+		if (!ranges.empty() && (moduleStart < ranges.back().end))
+			moduleStart = ranges.back().end;
+		addRange(moduleStart, module.m_address + module.m_size);
+	}
+	return ranges;
+}
 
-			cb.function(eventToSend);
-		}
 
-		// If the current event is an AdapterStoppedEvent, and it is not consumed by any callback, then the adapter
-		// stop is not caused by the debugger core. Notify a target stop reason in this case.
-		if (event.type == AdapterStoppedEventType && !m_lastAdapterStopEventConsumed)
+size_t DebuggerController::SearchMemory(const std::vector<uint8_t>& pattern, const std::vector<uint8_t>& mask,
+	uint64_t start, uint64_t end, size_t maxResults, const std::function<bool(uint64_t)>& onMatch)
+{
+	if (pattern.empty())
+		return 0;
+
+	if (!m_state->IsConnected() || m_state->IsRunning())
+	{
+		LogWarn("Cannot search the memory unless the target is stopped");
+		return 0;
+	}
+
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return 0;
+
+	MemorySearchCancelToken cancel;
+	{
+		std::unique_lock<std::mutex> lock(m_memorySearchMutex);
+		m_memorySearches.insert(&cancel);
+	}
+
+	// The search reads far more memory than the cache holds, so it goes to the adapter directly
+	auto read = [&](uint64_t address, size_t size, std::vector<uint8_t>& data) -> size_t {
+		if (m_state->IsRunning())
 		{
-			DebuggerEvent stopEvent = event;
-			stopEvent.type = TargetStoppedEventType;
-			if (!m_initialBreakpointSeen)
-			{
-				m_initialBreakpointSeen = true;
-				stopEvent.data.targetStoppedData.reason = InitialBreakpoint;
-			}
-			for (const DebuggerEventCallback& cb : eventCallbacks)
-			{
-				if (m_disabledCallbacks.find(cb.index) != m_disabledCallbacks.end())
-					continue;
+			cancel.Cancel();
+			return 0;
+		}
+		DataBuffer buffer = memory->ReadUncached(address, size);
+		const uint8_t* bytes = (const uint8_t*)buffer.GetData();
+		data.assign(bytes, bytes + buffer.GetLength());
+		return data.size();
+	};
 
-				cb.function(stopEvent);
-			}
+	PatternMatcher matcher(pattern, mask);
+	MemorySearch search(matcher, read, onMatch, maxResults, &cancel);
+	size_t count = search.Run(GetSearchRanges(start, end));
+
+	std::unique_lock<std::mutex> lock(m_memorySearchMutex);
+	m_memorySearches.erase(&cancel);
+	return count;
+}
+
+
+void DebuggerController::CancelMemorySearch()
+{
+	std::unique_lock<std::mutex> lock(m_memorySearchMutex);
+	for (MemorySearchCancelToken* search : m_memorySearches)
+		search->Cancel();
+}
+
+
+bool DebuggerController::SaveCoreFile(const std::string& path, const std::function<bool(size_t, size_t)>& progress)
+{
+	// Nothing else may resume the target or switch its active thread until the whole file is written
+	std::unique_lock<std::recursive_mutex> controlLock(m_targetControlMutex, std::try_to_lock);
+	if (!controlLock.owns_lock())
+	{
+		LogWarn("Cannot save a core file while another operation is controlling the target");
+		return false;
+	}
+
+	if (!m_adapter || !m_state->IsConnected() || m_state->IsRunning())
+	{
+		LogWarn("Cannot save a core file unless the target is stopped");
+		return false;
+	}
+
+	ArchitectureRef arch = m_state->GetRemoteArchitecture();
+	const ElfCoreLayout* layout = arch ? ElfCoreLayout::ForArchitecture(arch->GetName()) : nullptr;
+	if (!layout)
+	{
+		LogWarn("Core files are not supported on %s", arch ? arch->GetName().c_str() : "this architecture");
+		return false;
+	}
+
+	DebuggerMemory* memory = m_state->GetMemory();
+	if (!memory)
+		return false;
+
+	// The registers are read through the adapter one thread at a time, which means switching the active thread. The
+	// active thread goes first, since that is the thread the debuggers select when they load the core file.
+	std::vector<DebugThread> threads = m_state->GetThreads()->GetAllThreads();
+	uint32_t activeThread = m_adapter->GetActiveThreadId();
+	std::stable_partition(
+		threads.begin(), threads.end(), [&](const DebugThread& thread) { return thread.m_tid == activeThread; });
+
+	// On Linux, the main thread has the same ID as the process, and it is the one with the smallest ID
+	uint32_t pid = m_state->GetPIDAttach();
+	if ((pid == 0) && !threads.empty())
+	{
+		pid = std::min_element(threads.begin(), threads.end(), [](const DebugThread& a, const DebugThread& b) {
+			return a.m_tid < b.m_tid;
+		})->m_tid;
+	}
+
+	std::string executablePath = m_state->GetExecutablePath();
+	std::string commandLine = executablePath;
+	if (!m_state->GetCommandLineArguments().empty())
+		commandLine += " " + m_state->GetCommandLineArguments();
+	ElfCoreWriter writer(*layout, pid, DebugModule::GetPathBaseName(executablePath), commandLine);
+
+	for (const DebugThread& thread : threads)
+	{
+		if (!m_adapter->SetActiveThreadId(thread.m_tid))
+			continue;
+
+		ElfCoreThread coreThread {thread.m_tid, {}};
+		for (const auto& [name, reg] : m_adapter->ReadAllRegisters())
+			coreThread.registers[name] = reg.m_value;
+		writer.AddThread(coreThread);
+	}
+	m_adapter->SetActiveThreadId(activeThread);
+
+	std::vector<DebugModule> modules = GetAllModules();
+	std::vector<DebugMemoryRegion> regions = GetMemoryRegions();
+	bool haveMemoryMap = !regions.empty();
+	if (!haveMemoryMap)
+	{
+		LogWarn("The memory map is not available, only saving the modules");
+		for (const auto& module : modules)
+			regions.emplace_back(module.m_address, module.m_address + module.m_size, true, false, true, module.m_name);
+		std::sort(regions.begin(), regions.end(),
+			[](const DebugMemoryRegion& a, const DebugMemoryRegion& b) { return a.m_start < b.m_start; });
+	}
+	for (const auto& region : regions)
+		writer.AddSegment({region.m_start, region.m_end, region.m_readable, region.m_writable, region.m_executable});
+	// NT_FILE needs the file offset of every mapping, which the memory map does not give. The mapping at the base of a
+	// module is the start of its file, so only that one is saved. Without the memory map, its size is not known.
+	if (haveMemoryMap)
+	{
+		for (const auto& module : modules)
+		{
+			auto region = std::find_if(regions.begin(), regions.end(),
+				[&](const DebugMemoryRegion& region) { return region.m_start == module.m_address; });
+			if (region != regions.end())
+				writer.AddMappedFile({region->m_start, region->m_end, 0, module.m_name});
 		}
-	});
+	}
 
-	CleanUpDisabledEvent();
+	// Read around the cache, which would otherwise be flushed by the whole address space passing through it
+	auto read = [&](uint64_t address, size_t size, std::vector<uint8_t>& data) -> size_t {
+		DataBuffer buffer = memory->ReadUncached(address, size);
+		const uint8_t* bytes = (const uint8_t*)buffer.GetData();
+		data.assign(bytes, bytes + buffer.GetLength());
+		return data.size();
+	};
+
+	bool cancelled = false;
+	auto report = [&](size_t done, size_t total) {
+		if (progress && !progress(done, total))
+			cancelled = true;
+		return !cancelled;
+	};
+	if (!writer.Write(path, read, report))
+	{
+		if (cancelled)
+			LogInfo("Saving the core file was cancelled");
+		else
+			LogWarn("Failed to save the core file: %s", writer.GetError().c_str());
+		return false;
+	}
+	return true;
+}
+
+
+// The hashing reads the whole tracked memory, which would only evict useful pages from the cache
+MemoryDiffTracker::ReadFunction DebuggerController::GetMemoryDiffReader(bool& aborted)
+{
+	return [this, &aborted](uint64_t address, size_t size, std::vector<uint8_t>& data) -> size_t {
+		DebuggerMemory* memory = m_state->GetMemory();
+		if (aborted || !memory || m_state->IsRunning())
+		{
+			aborted = true;
+			data.clear();
+			return 0;
+		}
+		DataBuffer buffer = memory->ReadUncached(address, size);
+		const uint8_t* bytes = (const uint8_t*)buffer.GetData();
+		data.assign(bytes, bytes + buffer.GetLength());
+		return data.size();
+	};
 }
 
 
-void DebuggerController::CleanUpDisabledEvent()
-{
-	std::unique_lock<std::recursive_mutex> lock(m_callbackMutex);
-	for (const auto index : m_disabledCallbacks)
+void DebuggerController::UpdateMemoryDiff()
+{
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	if (!m_memoryDiff.IsTracking())
+		return;
+
+	bool aborted = false;
+	m_memoryDiff.Update(GetMemoryDiffReader(aborted));
+	if (aborted)
+	{
+		// The target resumed halfway, so the hashes are a mix of two states. Start over at the next stop.
+		m_memoryDiff.Reset();
+		return;
+	}
+
+	// The cache keeps the read-only and executable pages across stops, which is wrong for the ones that changed
+	for (const MemoryDiffTracker::Range& range : m_memoryDiff.GetChangedRanges())
 	{
-		RemoveEventCallbackInternal(index);
+		m_state->GetMemory()->InvalidateRange(range.start, range.end - range.start);
+		// The live view takes them later on the main thread, possibly after several more stops
+		m_unseenChangedRanges.push_back(range);
 	}
-	m_disabledCallbacks.clear();
 }
 
 
-void DebuggerController::NotifyStopped(DebugStopReason reason, void* data)
+void DebuggerController::TrackMemoryChanges(uint64_t start, uint64_t end)
 {
-	DebuggerEvent event;
-	event.type = TargetStoppedEventType;
-	event.data.targetStoppedData.reason = reason;
-	event.data.targetStoppedData.data = data;
-	PostDebuggerEvent(event);
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	m_memoryDiff.Track(start, end);
+	if (!m_state->IsConnected() || m_state->IsRunning())
+		return;
+
+	// Take the hashes now, so that the next stop already reports the changes
+	bool aborted = false;
+	m_memoryDiff.TakeSnapshot(start, end, GetMemoryDiffReader(aborted));
+	if (aborted)
+		m_memoryDiff.Reset();
 }
 
 
-void DebuggerController::NotifyError(const std::string& error, const std::string& shortError, void* data)
+void DebuggerController::UntrackMemoryChanges(uint64_t start, uint64_t end)
 {
-	DebuggerEvent event;
-	event.type = ErrorEventType;
-	event.data.errorData.error = error;
-	event.data.errorData.shortError = shortError;
-	event.data.errorData.data = data;
-	PostDebuggerEvent(event);
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	m_memoryDiff.Untrack(start, end);
 }
 
 
-void DebuggerController::NotifyEvent(DebuggerEventType eventType)
+std::vector<MemoryDiffTracker::Range> DebuggerController::GetTrackedMemoryRanges()
 {
-	DebuggerEvent event;
-	event.type = eventType;
-	PostDebuggerEvent(event);
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	return m_memoryDiff.GetTrackedRanges();
 }
 
 
-// We should call these two function instead of DebugAdapter::ReadMemory(), which will skip the memory cache
-DataBuffer DebuggerController::ReadMemory(std::uintptr_t address, std::size_t size)
+bool DebuggerController::IsTrackingMemoryChanges()
 {
-	if (!m_liveView)
-		return DataBuffer {};
-
-	if (!m_state->IsConnected())
-		return DataBuffer {};
-
-	if (m_state->IsRunning())
-		return DataBuffer {};
-
-	DebuggerMemory* memory = m_state->GetMemory();
-	if (!memory)
-		return DataBuffer {};
-
-	return memory->ReadMemory(address, size);
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	return m_memoryDiff.IsTracking();
 }
 
 
-bool DebuggerController::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+std::vector<MemoryDiffTracker::Range> DebuggerController::GetChangedMemoryRanges()
 {
-	if (!m_liveView)
-		return false;
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	return m_memoryDiff.GetChangedRanges();
+}
 
-	if (!m_state->IsConnected())
-		return false;
 
-	if (m_state->IsRunning())
-		return false;
+std::vector<MemoryDiffTracker::Range> DebuggerController::TakeChangedMemoryRanges()
+{
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	std::vector<MemoryDiffTracker::Range> result;
+	result.swap(m_unseenChangedRanges);
+	return result;
+}
 
-	DebuggerMemory* memory = m_state->GetMemory();
-	if (!memory)
-		return false;
 
-	return memory->WriteMemory(address, buffer);
+std::vector<uint64_t> DebuggerController::GetChangedMemoryPages()
+{
+	std::unique_lock<std::mutex> lock(m_memoryDiffMutex);
+	return m_memoryDiff.GetChangedPages();
 }
 
 
@@ -1401,9 +2257,9 @@ std::vector<DebugThread> DebuggerController::GetAllThreads()
 }
 
 
-std::vector<DebugRegister> DebuggerController::GetAllRegisters()
+std::vector<DebugRegister> DebuggerController::GetAllRegisters(bool withHints)
 {
-	return m_state->GetRegisters()->GetAllRegisters();
+	return m_state->GetRegisters()->GetAllRegisters(withHints);
 }
 
 
@@ -1508,11 +2364,26 @@ void DebuggerController::ProcessOneVariable(uint64_t varAddress, Confidence<Ref<
 }
 
 
-void DebuggerController::DefineVariablesRecursive(uint64_t address, Confidence<Ref<Type>> type)
+// Whether annotating a value of the type can define any variable besides the value itself
+static bool CanContainPointers(const Ref<Type>& type)
+{
+	return type->IsPointer() || type->IsStructure() || type->IsArray();
+}
+
+
+void DebuggerController::DefineVariablesRecursive(
+	uint64_t address, Confidence<Ref<Type>> type, size_t depth, StackVariableBudget& budget)
 {
 	size_t addressSize = m_liveView->GetAddressSize();
 	if (type->IsPointer())
 	{
+		if ((depth >= budget.maxDepth) || (std::chrono::steady_clock::now() >= budget.deadline))
+		{
+			if (budget.deferred)
+				budget.deferred->push_back({address, type, depth});
+			return;
+		}
+
 		auto reader = BinaryReader(m_liveView);
 		reader.Seek(address);
 		uint64_t targetAddress = 0;
@@ -1533,32 +2404,106 @@ void DebuggerController::DefineVariablesRecursive(uint64_t address, Confidence<R
 			// Define a data variable for the child
 			ProcessOneVariable(targetAddress, type->GetChildType(), "");
 			// Recurse into the child
-			DefineVariablesRecursive(targetAddress, type->GetChildType());
+			DefineVariablesRecursive(targetAddress, type->GetChildType(), depth + 1, budget);
 		}
 	}
 	else if (type->IsStructure())
 	{
 		auto structure = type->GetStructure();
 		auto members = structure->GetMembers();
-		auto memberType = type->GetChildType();
 		for (size_t i = 0; i < members.size(); i++)
 		{
+			if (!CanContainPointers(members[i].type.GetValue()))
+				continue;
 			uint64_t memberOffset = address + members[i].offset;
-			DefineVariablesRecursive(memberOffset, members[i].type);
+			DefineVariablesRecursive(memberOffset, members[i].type, depth, budget);
 		}
 	}
 	else if (type->IsArray())
 	{
+		// A buffer of bytes or integers has nothing to follow, no matter how large it is
 		auto memberType = type->GetChildType();
-		for (size_t i = 0; i < type->GetElementCount(); i++)
+		if (!CanContainPointers(memberType.GetValue()))
+			return;
+
+		size_t count = std::min<size_t>(type->GetElementCount(), budget.maxElements);
+		for (size_t i = 0; i < count; i++)
 		{
 			uint64_t memberOffset = address + i * memberType->GetWidth();
-			DefineVariablesRecursive(memberOffset, memberType);
+			DefineVariablesRecursive(memberOffset, memberType, depth, budget);
 		}
 	}
 }
 
 
+void DebuggerController::RemoveStaleStackVariables()
+{
+	for (uint64_t address : m_oldAddresses)
+	{
+		m_debuggerVariables.erase(address);
+		m_liveView->UndefineDataVariable(address);
+		auto symbol = m_liveView->GetSymbolByAddress(address);
+		if (symbol)
+			m_liveView->UndefineUserSymbol(symbol);
+	}
+	m_oldAddresses.clear();
+}
+
+
+// Follows the pointers that did not fit in the budget of the stop, as deep as the settings allow, while the target
+// stays stopped. Each of them is followed with the lock held, so a new stop waits for at most one of them.
+void DebuggerController::ExpandStackVariables(uint64_t generation, std::vector<StackVariableWork> work)
+{
+	size_t maxDepth = Settings::Instance()->Get<uint64_t>("debugger.stackVariableAnnotationDepth");
+	size_t maxElements = Settings::Instance()->Get<uint64_t>("debugger.stackVariableAnnotationElements");
+	StackVariableBudget budget {maxDepth, maxElements, std::chrono::steady_clock::time_point::max(), nullptr};
+
+	while (!work.empty())
+	{
+		std::unique_lock<std::mutex> lock(m_stackVariableMutex);
+		if ((m_stackVariableGeneration != generation) || !m_liveView)
+			return;
+
+		StackVariableWork item = work.back();
+		work.pop_back();
+		auto id = m_liveView->BeginUndoActions();
+		DefineVariablesRecursive(item.address, item.type, item.depth, budget);
+		m_liveView->ForgetUndoActions(id);
+	}
+
+	std::unique_lock<std::mutex> lock(m_stackVariableMutex);
+	if ((m_stackVariableGeneration != generation) || !m_liveView)
+		return;
+
+	auto id = m_liveView->BeginUndoActions();
+	RemoveStaleStackVariables();
+	m_liveView->ForgetUndoActions(id);
+}
+
+
+void DebuggerController::CancelStackVariableExpansion()
+{
+	std::unique_lock<std::mutex> lock(m_stackVariableMutex);
+	m_stackVariableGeneration++;
+}
+
+
+void DebuggerController::ResetStackVariables()
+{
+	std::unique_lock<std::mutex> lock(m_stackVariableMutex);
+	m_stackVariableGeneration++;
+	m_debuggerVariables.clear();
+	m_addressesWithVariable.clear();
+	m_oldAddresses.clear();
+	m_addressesWithComment.clear();
+	m_stackFrameVariables.clear();
+}
+
+
+// The stack variables of a frame are only looked up again if the frame is new, i.e., its function or its stack
+// pointer on entry changed. The pointers from the variables are followed again on every stop, since the memory they
+// point to can change, but only for one level until the time budget runs out. The rest are followed on a background
+// thread after the stop is shown.
 void DebuggerController::UpdateStackVariables()
 {
 	if (!Settings::Instance()->Get<bool>("debugger.stackVariableAnnotations"))
@@ -1567,21 +2512,33 @@ void DebuggerController::UpdateStackVariables()
 	if (!m_liveView)
 		return;
 
-	auto id = m_liveView->BeginUndoActions();
-	std::vector<DebugThread> threads = GetAllThreads();
+	std::unique_lock<std::mutex> lock(m_stackVariableMutex);
+	uint64_t generation = ++m_stackVariableGeneration;
+
 	uint64_t frameAdjustment = 0;
 	if (!m_liveView->GetDefaultArchitecture())
 		return;
 
+	auto id = m_liveView->BeginUndoActions();
 	std::string archName = m_liveView->GetDefaultArchitecture()->GetName();
 	if ((archName == "x86") || (archName == "x86_64"))
 		frameAdjustment = 8;
 
-	m_oldAddresses = m_addressesWithVariable;
+	auto settings = Settings::Instance();
+	size_t maxDepth = settings->Get<uint64_t>("debugger.stackVariableAnnotationDepth");
+	size_t maxElements = settings->Get<uint64_t>("debugger.stackVariableAnnotationElements");
+	auto deadline = std::chrono::steady_clock::now()
+		+ std::chrono::milliseconds(settings->Get<uint64_t>("debugger.stackVariableAnnotationBudget"));
+	std::vector<StackVariableWork> deferred;
+	StackVariableBudget budget {std::min<size_t>(maxDepth, 1), maxElements, deadline, &deferred};
+
+	// The variables of the previous stop whose background expansion did not finish are also still old
+	m_oldAddresses.insert(m_addressesWithVariable.begin(), m_addressesWithVariable.end());
 	m_addressesWithVariable.clear();
 	auto oldAddressWithComment = m_addressesWithComment;
 	m_addressesWithComment.clear();
 
+	std::map<std::pair<uint64_t, uint64_t>, StackFrameVariables> frameVariables;
 	const DebugThread thread = GetActiveThread();
 	std::vector<DebugFrame> frames = GetFramesOfThread(thread.m_tid);
 	if (frames.size() >= 2)
@@ -1590,26 +2547,48 @@ void DebuggerController::UpdateStackVariables()
 		{
 			const DebugFrame& frame = frames[i];
 			const DebugFrame& prevFrame = frames[i + 1];
-			// If there is no function at a stacktrace function start, add one
+			// BN's variable storage offset is calculated against the entry status of the function, i.e.,
+			// before the current stack frame is created. Here we take the stack pointer of the previous stack frame,
+			// and subtract the size of return address from it
+			uint64_t framePointer = prevFrame.m_sp - frameAdjustment;
+			std::pair<uint64_t, uint64_t> key(frame.m_functionStart, framePointer);
+			if (frameVariables.find(key) != frameVariables.end())
+				continue;
+
 			auto functions = m_liveView->GetAnalysisFunctionsForAddress(frame.m_functionStart);
 			if (functions.empty())
 				continue;
 
 			FunctionRef func = functions[0];
-
-			auto vars = func->GetVariables();
-			// BN's variable storage offset is calculated against the entry status of the function, i.e.,
-			// before the current stack frame is created. Here we take the stack pointer of the previous stack frame,
-			// and subtract the size of return address from it
-			uint64_t framePointer = prevFrame.m_sp - frameAdjustment;
-			for (const auto& [var, varNameAndType] : vars)
+			MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
+			StackFrameVariables& variables = frameVariables[key];
+			std::vector<StackVariableRoot>& roots = variables.roots;
+			auto iter = m_stackFrameVariables.find(key);
+			if ((iter != m_stackFrameVariables.end()) && mlil && iter->second.mlil
+				&& (iter->second.function->GetObject() == func->GetObject())
+				&& (iter->second.mlil->GetObject() == mlil->GetObject()))
 			{
-				if (var.type != StackVariableSourceType)
-					continue;
+				variables = std::move(iter->second);
+			}
+			else
+			{
+				variables.function = func;
+				variables.mlil = mlil;
+				auto vars = func->GetVariables();
+				for (const auto& [var, varNameAndType] : vars)
+				{
+					if (var.type != StackVariableSourceType)
+						continue;
+
+					roots.push_back({framePointer + var.storage, varNameAndType.type, varNameAndType.name});
+				}
+			}
 
-				uint64_t varAddress = framePointer + var.storage;
-				ProcessOneVariable(varAddress, varNameAndType.type, varNameAndType.name);
-				DefineVariablesRecursive(varAddress, varNameAndType.type);
+			for (const StackVariableRoot& root : roots)
+			{
+				ProcessOneVariable(root.address, root.type, root.name);
+				if (CanContainPointers(root.type.GetValue()))
+					DefineVariablesRecursive(root.address, root.type, 0, budget);
 			}
 		}
 
@@ -1630,24 +2609,24 @@ void DebuggerController::UpdateStackVariables()
 				oldAddressWithComment.erase(iter2);
 		}
 	}
+	m_stackFrameVariables = std::move(frameVariables);
 
-	for (uint64_t address : m_oldAddresses)
-	{
-		auto iter = m_addressesWithVariable.find(address);
-		if (iter != m_addressesWithVariable.end())
-			m_addressesWithVariable.erase(iter);
-
-		m_liveView->UndefineDataVariable(address);
-		auto symbol = m_liveView->GetSymbolByAddress(address);
-		if (symbol)
-			m_liveView->UndefineUserSymbol(symbol);
-	}
+	// The old variables that the background expansion finds again stay, so they do not flicker
+	if (deferred.empty())
+		RemoveStaleStackVariables();
 
 	for (uint64_t address : oldAddressWithComment)
 	{
 		m_liveView->SetCommentForAddress(address, "");
 	}
 	m_liveView->ForgetUndoActions(id);
+
+	if (!deferred.empty())
+	{
+		std::thread([this, generation, deferred = std::move(deferred)]() mutable {
+			ExpandStackVariables(generation, std::move(deferred));
+		}).detach();
+	}
 }
 
 
@@ -1775,6 +2754,8 @@ std::string DebuggerController::GetStopReasonString(DebugStopReason reason)
 		return "UserRequestedBreak";
 	case OperationNotSupported:
 		return "OperationNotSupported";
+	case Watchpoint:
+		return "Watchpoint";
 	default:
 		return "";
 	}
@@ -1806,6 +2787,8 @@ DebugStopReason DebuggerController::ExecuteAdapterAndWait(const DebugAdapterOper
 			{
 			case AdapterStoppedEventType:
 				reason = event.data.targetStoppedData.reason;
+				m_lastWatchpointAddress = event.data.targetStoppedData.watchpointAddress;
+				m_lastWatchpointType = event.data.targetStoppedData.watchpointType;
 				sem.Release();
 				break;
 			// It is a little awkward to add two cases for these events, but we must take them into account,
@@ -1821,13 +2804,25 @@ DebugStopReason DebuggerController::ExecuteAdapterAndWait(const DebugAdapterOper
 			}
 			m_lastAdapterStopEventConsumed = true;
 		},
-		"WaitForAdapterStop");
+		"WaitForAdapterStop", InlineEventDelivery);
+
+	// The background readers of the target memory must be done before it runs
+	bool resume = (operation == DebugAdapterGo) || (operation == DebugAdapterStepInto)
+		|| (operation == DebugAdapterStepOver) || (operation == DebugAdapterStepReturn)
+		|| (operation == DebugAdapterQuit) || (operation == DebugAdapterDetach);
+	if (resume)
+	{
+		CancelStackVariableExpansion();
+		m_state->GetMemory()->SuspendPrefetch();
+	}
 
 	bool resumeOK = false;
 	bool operationRequested = false;
 	switch (operation)
 	{
 	case DebugAdapterGo:
+		m_state->GetBreakpoints()->UpdateAttributeSnapshot();
+		m_handleBreakpointHits = true;
 		resumeOK = m_adapter->Go();
 		break;
 	case DebugAdapterStepInto:
@@ -1884,6 +2879,9 @@ DebugStopReason DebuggerController::ExecuteAdapterAndWait(const DebugAdapterOper
 	else
 		reason = InternalError;
 
+	m_handleBreakpointHits = false;
+	if (resume)
+		m_state->GetMemory()->ResumePrefetch();
 	RemoveEventCallback(callback);
 	if ((operation != DebugAdapterPause) && (operation != DebugAdapterQuit) && (operation != DebugAdapterDetach))
 		m_adapterMutex.unlock();
@@ -1934,98 +2932,29 @@ static inline bool IsPrintableChar(uint8_t c)
 }
 
 
-static std::string CheckForASCIIString(const DataBuffer& memory)
-{
-	std::string result;
-	size_t i = 0;
-	while (true)
-	{
-		if (i > memory.GetLength() - 1)
-			break;
-		if (IsPrintableChar(memory[i]))
-		{
-			result += memory[i];
-			i++;
-		}
-		else
-		{
-			break;
-		}
-	}
-
-	if (result.length() >= 4)
-		return result;
-	else
-		return "";
-}
-
-
-static std::string CheckForUTF16String(const DataBuffer& memory)
-{
-	std::string result;
-	size_t i = 0;
-	while (true)
-	{
-		if (i > memory.GetLength() - 2)
-			break;
-		if (IsPrintableChar(memory[i]) && (memory[i + 1] == 0))
-		{
-			result += memory[i];
-			i += 2;
-		}
-		else
-		{
-			break;
-		}
-	}
-
-	if (result.length() >= 4)
-		return result;
-	else
-		return "";
-}
-
-
-static std::string CheckForUTF32String(const DataBuffer& memory)
+// Collects every `width`-th byte, i.e., the low bytes of the UTF-16 or UTF-32 characters
+static std::string ExtractCharacters(const uint8_t* data, size_t count, size_t width)
 {
-	std::string result;
-	size_t i = 0;
-	while (true)
-	{
-		if (i > memory.GetLength() - 4)
-			break;
-		if (IsPrintableChar(memory[i]) && (memory[i + 1] == 0) && (memory[i + 2] == 0) && (memory[i + 3] == 0))
-		{
-			result += memory[i];
-			i += 4;
-		}
-		else
-		{
-			break;
-		}
-	}
-
-	if (result.length() >= 4)
-		return result;
-	else
-		return "";
+	std::string result(count, '\0');
+	for (size_t i = 0; i < count; i++)
+		result[i] = data[i * width];
+	return result;
 }
 
 
 static std::string CheckForPrintableString(const DataBuffer& memory)
 {
-	std::string result;
-	result = CheckForASCIIString(memory);
-	if (!result.empty())
-		return fmt::format("\"{}\"", BinaryNinja::EscapeString(result));
+	// All three encodings are classified in one pass over the buffer, rather than one scan for each of them
+	const uint8_t* data = (const uint8_t*)memory.GetData();
+	PrintableRuns runs = ClassifyPrintable(data, memory.GetLength());
+	if (runs.ascii >= 4)
+		return fmt::format("\"{}\"", BinaryNinja::EscapeString(std::string((const char*)data, runs.ascii)));
 
-	result = CheckForUTF16String(memory);
-	if (!result.empty())
-		return fmt::format("L\"{}\"", BinaryNinja::EscapeString(result));;
+	if (runs.utf16 >= 4)
+		return fmt::format("L\"{}\"", BinaryNinja::EscapeString(ExtractCharacters(data, runs.utf16, 2)));
 
-	result = CheckForUTF32String(memory);
-	if (!result.empty())
-		return fmt::format("L\"{}\"", BinaryNinja::EscapeString(result));;
+	if (runs.utf32 >= 4)
+		return fmt::format("L\"{}\"", BinaryNinja::EscapeString(ExtractCharacters(data, runs.utf32, 4)));
 
 	return "";
 }
@@ -2088,6 +3017,21 @@ std::string DebuggerController::GetAddressInformation(uint64_t address)
 	}
 
 
+	result = GetSymbolInformation(address);
+	if (!result.empty())
+		return result;
+
+	// Check if the address itself is a printable string, e.g., 0x61626364 ==> "abcd"
+	result = CheckForLiteralString(address);
+	if (!result.empty())
+		return result;
+
+	return "";
+}
+
+
+std::string DebuggerController::GetSymbolInformation(uint64_t address)
+{
 	// Look for functions starting at the address
 	auto func = m_liveView->GetAnalysisFunction(m_liveView->GetDefaultPlatform(), address);
 	if (func)
@@ -2125,22 +3069,156 @@ std::string DebuggerController::GetAddressInformation(uint64_t address)
 		}
 		else
 		{
-			result = fmt::format("data_{:x}", var.address);
+			std::string result = fmt::format("data_{:x}", var.address);
 			if (address != var.address)
 				result += fmt::format(" + 0x{:x}", address - var.address);
 			return result;
 		}
 	}
 
-	// Check if the address itself is a printable string, e.g., 0x61626364 ==> "abcd"
-	result = CheckForLiteralString(address);
-	if (!result.empty())
-		return result;
-
 	return "";
 }
 
 
+// The chains of all slots are followed one level at a time, so the memory every level points to is read in one batch
+std::vector<DebugStackSlot> DebuggerController::ReadStackWindow(
+	uint64_t stackPointer, size_t before, size_t after, size_t depth)
+{
+	std::vector<DebugStackSlot> slots;
+	size_t addressSize = m_liveView->GetAddressSize();
+	if ((addressSize != 4) && (addressSize != 8))
+		return slots;
+
+	before = std::min<size_t>(before, stackPointer / addressSize);
+	uint64_t start = stackPointer - before * addressSize;
+	size_t count = before + after + 1;
+	DataBuffer window = ReadMemory(start, count * addressSize);
+
+	auto readPointer = [&](const DataBuffer& buffer, size_t offset) {
+		uint64_t value = 0;
+		memcpy(&value, (const uint8_t*)buffer.GetData() + offset, addressSize);
+		return value;
+	};
+
+	slots.resize(count);
+	for (size_t i = 0; i < count; i++)
+	{
+		DebugStackSlot& slot = slots[i];
+		slot.offset = ((int64_t)i - (int64_t)before) * (int64_t)addressSize;
+		slot.address = start + i * addressSize;
+		if ((i + 1) * addressSize <= window.GetLength())
+		{
+			slot.valid = true;
+			slot.value = readPointer(window, i * addressSize);
+			continue;
+		}
+
+		// The window runs into memory that cannot be read, e.g., the end of the stack. Fall back to reading the
+		// remaining slots one by one.
+		DataBuffer buffer = ReadMemory(slot.address, addressSize);
+		slot.valid = buffer.GetLength() == addressSize;
+		slot.value = slot.valid ? readPointer(buffer, 0) : 0;
+	}
+
+	// The memory each value points to, or an empty buffer if it cannot be read
+	std::unordered_map<uint64_t, DataBuffer> memory;
+	// The slots whose chain is not complete yet
+	std::vector<size_t> active;
+	for (size_t i = 0; i < count; i++)
+	{
+		if (slots[i].valid)
+			active.push_back(i);
+	}
+
+	// Only the values that point into a module can have a symbol, so the others skip the symbol lookups
+	std::vector<std::pair<uint64_t, uint64_t>> moduleRanges;
+	for (const DebugModule& module : m_state->GetModules()->GetAllModules())
+		moduleRanges.emplace_back(module.m_address, module.m_address + module.m_size);
+	AddressIntervals modules(std::move(moduleRanges));
+
+	std::vector<uint64_t> values;
+	std::vector<PointerKind> kinds;
+	for (size_t level = 0; (level <= depth) && !active.empty(); level++)
+	{
+		values.clear();
+		for (size_t i : active)
+			values.push_back(slots[i].chain.empty() ? slots[i].value : slots[i].chain.back());
+		// Small values are counters and offsets far more often than pointers
+		ClassifyPointers(values.data(), values.size(), modules, 0x1000, kinds);
+
+		std::vector<DebugMemoryRange> ranges;
+		for (size_t j = 0; j < values.size(); j++)
+		{
+			if ((kinds[j] != PointerKind::NotPointer) && (memory.find(values[j]) == memory.end()))
+			{
+				memory[values[j]] = DataBuffer();
+				ranges.emplace_back(values[j], 128);
+			}
+		}
+
+		std::vector<DataBuffer> buffers = ReadMemoryBatch(ranges);
+		for (size_t i = 0; i < ranges.size(); i++)
+			memory[ranges[i].m_address] = buffers[i];
+
+		std::vector<size_t> next;
+		for (size_t j = 0; j < active.size(); j++)
+		{
+			DebugStackSlot& slot = slots[active[j]];
+			uint64_t value = values[j];
+			if (value == 0)
+				continue;
+
+			if (kinds[j] == PointerKind::ModulePointer)
+			{
+				slot.hint = GetSymbolInformation(value);
+				if (!slot.hint.empty())
+					continue;
+			}
+
+			auto iter = memory.find(value);
+			if ((iter == memory.end()) || (iter->second.GetLength() == 0))
+			{
+				if (slot.chain.empty())
+					slot.hint = CheckForLiteralString(value);
+				continue;
+			}
+
+			slot.hint = CheckForPrintableString(iter->second);
+			if (!slot.hint.empty() || (iter->second.GetLength() < addressSize) || (level == depth))
+				continue;
+
+			slot.chain.push_back(readPointer(iter->second, 0));
+			next.push_back(active[j]);
+		}
+		active = std::move(next);
+	}
+
+	return slots;
+}
+
+
+std::vector<DebugStackSlot> DebuggerController::GetStackWindow(size_t before, size_t after, size_t depth)
+{
+	if (!m_liveView || !m_state->IsConnected() || m_state->IsRunning())
+		return {};
+
+	uint64_t stackPointer = m_state->StackPointer();
+	uint64_t memoryGeneration = m_state->GetMemory()->GetGeneration();
+	uint64_t moduleGeneration = m_state->GetModules()->GetGeneration();
+
+	std::unique_lock<std::mutex> lock(m_stackWindowMutex);
+	if (m_stackWindow && (m_stackWindow->stackPointer == stackPointer) && (m_stackWindow->before == before)
+		&& (m_stackWindow->after == after) && (m_stackWindow->depth == depth)
+		&& (m_stackWindow->memoryGeneration == memoryGeneration)
+		&& (m_stackWindow->moduleGeneration == moduleGeneration))
+		return m_stackWindow->slots;
+
+	std::vector<DebugStackSlot> slots = ReadStackWindow(stackPointer, before, after, depth);
+	m_stackWindow = StackWindow {stackPointer, before, after, depth, memoryGeneration, moduleGeneration, slots};
+	return slots;
+}
+
+
 bool DebuggerController::IsFirstLaunch()
 {
 	return m_firstLaunch;
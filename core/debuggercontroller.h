@@ -18,6 +18,15 @@ limitations under the License.
 #include "binaryninjaapi.h"
 #include "debuggerstate.h"
 #include "debuggerevent.h"
+#include "debuggereventbus.h"
+#include "executiontrace.h"
+#include "iladdresscache.h"
+#include "memorysearch.h"
+#include "elfcore.h"
+#include "memorydiff.h"
+#include <atomic>
+#include <chrono>
+#include <mutex>
 #include <queue>
 #include <list>
 #include "ffi_global.h"
@@ -26,13 +35,6 @@ limitations under the License.
 DECLARE_DEBUGGER_API_OBJECT(BNDebuggerController, DebuggerController);
 
 namespace BinaryNinjaDebugger {
-	struct DebuggerEventCallback
-	{
-		std::function<void(const DebuggerEvent& event)> function;
-		size_t index;
-		std::string name;
-	};
-
 	// This is used by the debugger to track stack variables it defined. It is simpler than
 	// BinaryNinja::VariableNameAndType that it does not track the Variable and autoDefined.
 	struct StackVariableNameAndType
@@ -52,6 +54,56 @@ namespace BinaryNinjaDebugger {
 		bool operator!=(const StackVariableNameAndType& other) { return !(*this == other); }
 	};
 
+	// A slot of the stack window, and what its value leads to when it is dereferenced
+	struct DebugStackSlot
+	{
+		// Relative to the stack pointer
+		int64_t offset;
+		uint64_t address;
+		uint64_t value;
+		// False if the slot cannot be read
+		bool valid;
+		// The values read by dereferencing the value over and over, e.g., *value and **value
+		std::vector<uint64_t> chain;
+		// What the last value of the chain is, e.g., a string or a symbol. Empty if nothing is known about it.
+		std::string hint;
+	};
+
+	// A stack variable of a frame
+	struct StackVariableRoot
+	{
+		uint64_t address;
+		Confidence<Ref<Type>> type;
+		std::string name;
+	};
+
+	// The stack variables of a frame. Renaming or retyping a variable re-analyzes the function, which creates a new
+	// MLIL function, so the MLIL function serves as the analysis generation of the roots.
+	struct StackFrameVariables
+	{
+		FunctionRef function;
+		MediumLevelILFunctionRef mlil;
+		std::vector<StackVariableRoot> roots;
+	};
+
+	// A pointer whose target is not annotated yet, and how many pointers are followed to reach it
+	struct StackVariableWork
+	{
+		uint64_t address;
+		Confidence<Ref<Type>> type;
+		size_t depth;
+	};
+
+	// Bounds how far the annotation follows the pointers from the stack variables
+	struct StackVariableBudget
+	{
+		size_t maxDepth;
+		size_t maxElements;
+		std::chrono::steady_clock::time_point deadline;
+		// Receives the pointers that are out of the budget. They are dropped if it is nullptr.
+		std::vector<StackVariableWork>* deferred;
+	};
+
 	// This is the controller class of the debugger. It receives the input from the UI/API, and then route them to
 	// the state and UI, etc. Most actions should reach here.
 	class DebuggerController : public DbgRefCountObject
@@ -68,10 +120,7 @@ namespace BinaryNinjaDebugger {
 		static DbgRef<DebuggerController>* g_debuggerControllers;
 		static size_t g_controllerCount;
 
-		std::atomic<size_t> m_callbackIndex = 0;
-		std::list<DebuggerEventCallback> m_eventCallbacks;
-		std::recursive_mutex m_callbackMutex;
-		std::set<size_t> m_disabledCallbacks;
+		std::shared_ptr<DebuggerEventBus> m_eventBus;
 
 		// m_adapterMutex is a low-level mutex that protects the adapter access. It cannot be locked recursively.
 		// m_targetControlMutex is a high-level mutex that prevents two threads from controlling the debugger at the
@@ -89,12 +138,27 @@ namespace BinaryNinjaDebugger {
 		bool m_userRequestedBreak = false;
 
 		bool m_lastAdapterStopEventConsumed = true;
+		// The watchpoint that the last adapter stop hits, which the stop reported by NotifyStopped() carries on
+		uint64_t m_lastWatchpointAddress = 0;
+		DebugWatchpointType m_lastWatchpointType {};
+
+		// Breakpoint conditions and tracepoints are only handled when the target is resumed with go, since some
+		// adapters report a single step as a breakpoint stop. A step over a call or a step return also resumes with
+		// go when there are breakpoints, see StepOutWithBreakpoints().
+		std::atomic<bool> m_handleBreakpointHits = false;
+		// Set when the target is resumed right after a breakpoint hit, so the resume is not reported
+		std::atomic<bool> m_hideNextResume = false;
+		bool SkipBreakpointHit(const DebuggerEvent& event);
+		bool ResumeAfterBreakpointHit();
+		void NotifyBreakpointsChanged(size_t count);
 
 		bool m_inputFileLoaded = false;
 		bool m_initialBreakpointSeen = false;
 
 		bool m_firstLaunch = true;
 
+		ILAddressCache m_ilAddressCache;
+
 		void EventHandler(const DebuggerEvent& event);
 		void UpdateStackVariables();
 		void AddRegisterValuesToExpressionParser();
@@ -103,6 +167,8 @@ namespace BinaryNinjaDebugger {
 
 		void SetLiveView(BinaryViewRef view) { m_liveView = view; }
 
+		bool IsILStepStop(uint64_t address, BNFunctionGraphType il);
+		bool StepILWithBreakpoints(BNFunctionGraphType il, bool stepInto, DebugStopReason& reason);
 		DebugStopReason StepIntoIL(BNFunctionGraphType il);
 		DebugStopReason StepOverIL(BNFunctionGraphType il);
 
@@ -115,31 +181,94 @@ namespace BinaryNinjaDebugger {
 		DebugStopReason PauseAndWaitInternal();
 		DebugStopReason GoAndWaitInternal();
 		DebugStopReason StepIntoAndWaitInternal();
+		size_t GetCallInstructionLength(uint64_t address);
+		bool StepOutWithBreakpoints(bool stepReturn, DebugStopReason& reason);
 		DebugStopReason EmulateStepOverAndWait();
 		DebugStopReason StepOverAndWaitInternal();
 		DebugStopReason EmulateStepReturnAndWait();
 		DebugStopReason StepReturnAndWaitInternal();
 		DebugStopReason RunToAndWaitInternal(const std::vector<uint64_t> &remoteAddresses);
 
+		// While tracing, the stops and resumes of the target are handled by the trace loop, and are never posted
+		std::atomic<bool> m_tracing = false;
+		std::atomic<bool> m_traceCancelled = false;
+		// Set while the trace runs to the end of a basic block, which must be interrupted to cancel the trace
+		std::atomic<bool> m_traceRunning = false;
+		Semaphore m_traceSemaphore;
+		DebugStopReason m_traceStopReason = UnknownReason;
+		bool HandleTraceEvent(const DebuggerEvent& event);
+		DebugStopReason WaitForTraceStop(bool resumed);
+		uint64_t FindBlockEnd(uint64_t address, const std::unordered_set<uint64_t>& stopAddresses);
+		DebugStopReason TraceStep(DebugTraceGranularity granularity, const std::unordered_set<uint64_t>& stopAddresses);
+		DebugStopReason TraceAndWaitInternal(const ExecutionTraceOptions& options);
+
 		// Whether we can resume the execution of the target, including stepping.
 		bool CanResumeTarget();
 
 		bool ExpectSingleStep(DebugStopReason reason);
 
+		// Guards the stack variable annotations, which the background expansion also updates
+		std::mutex m_stackVariableMutex;
+		// Incremented on every stop and resume, which tells a background expansion that its work is stale
+		std::atomic<uint64_t> m_stackVariableGeneration = 0;
 		std::map<uint64_t, StackVariableNameAndType> m_debuggerVariables;
 		std::set<uint64_t> m_addressesWithVariable;
+		// The variables of the previous stop that are not yet found again. They are removed once the annotation of
+		// the current stop is complete.
 		std::set<uint64_t> m_oldAddresses;
 		std::set<uint64_t> m_addressesWithComment;
+		// The stack variables of each frame, keyed by the function start and the stack pointer on entry
+		std::map<std::pair<uint64_t, uint64_t>, StackFrameVariables> m_stackFrameVariables;
 		void ProcessOneVariable(uint64_t address, Confidence<Ref<Type>> type, const std::string& name);
-		void DefineVariablesRecursive(uint64_t address, Confidence<Ref<Type>> type);
+		void DefineVariablesRecursive(
+			uint64_t address, Confidence<Ref<Type>> type, size_t depth, StackVariableBudget& budget);
+		void ExpandStackVariables(uint64_t generation, std::vector<StackVariableWork> work);
+		// Called with m_stackVariableMutex held
+		void RemoveStaleStackVariables();
+		void ResetStackVariables();
+		// Makes the background expansion stop, and waits for the pointer it is following, before the target resumes
+		void CancelStackVariableExpansion();
 
 		void ApplyBreakpoints();
+		void ApplyWatchpoints(DebugStopReason reason);
 
 		std::string m_lastAdapterName;
 		std::string m_lastCommand;
 
 		void DetectLoadedModule();
 
+		// Only the functions, symbols and data variables at the address, without reading the memory
+		std::string GetSymbolInformation(uint64_t address);
+
+		struct StackWindow
+		{
+			uint64_t stackPointer = 0;
+			size_t before = 0;
+			size_t after = 0;
+			size_t depth = 0;
+			uint64_t memoryGeneration = 0;
+			uint64_t moduleGeneration = 0;
+			std::vector<DebugStackSlot> slots;
+		};
+		std::mutex m_stackWindowMutex;
+		std::optional<StackWindow> m_stackWindow;
+		std::vector<DebugStackSlot> ReadStackWindow(uint64_t stackPointer, size_t before, size_t after, size_t depth);
+
+		std::mutex m_memorySearchMutex;
+		std::set<MemorySearchCancelToken*> m_memorySearches;
+		std::vector<MemorySearch::Range> GetSearchRanges(uint64_t start, uint64_t end);
+
+		std::mutex m_memoryDiffMutex;
+		MemoryDiffTracker m_memoryDiff;
+		// The changes found at every stop since the live view last took them
+		std::vector<MemoryDiffTracker::Range> m_unseenChangedRanges;
+		MemoryDiffTracker::ReadFunction GetMemoryDiffReader(bool& aborted);
+		void UpdateMemoryDiff();
+
+		// The ranges written since the live view last took them
+		std::mutex m_writtenRangesMutex;
+		std::vector<DebugMemoryRange> m_writtenRanges;
+
 	public:
 		DebuggerController(BinaryViewRef data);
 		static DbgRef<DebuggerController> GetController(BinaryViewRef data);
@@ -156,12 +285,36 @@ namespace BinaryNinjaDebugger {
 		void AddBreakpoint(const ModuleNameAndOffset& address);
 		void DeleteBreakpoint(uint64_t address);
 		void DeleteBreakpoint(const ModuleNameAndOffset& address);
+		// Adding or removing breakpoints in bulk only writes the breakpoint metadata once, and posts a single
+		// BreakpointsChangedEvent if any breakpoint is actually added or removed
+		size_t AddBreakpoints(const std::vector<uint64_t>& addresses);
+		size_t AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses);
+		size_t DeleteBreakpoints(const std::vector<uint64_t>& addresses);
+		size_t DeleteBreakpoints(const std::vector<ModuleNameAndOffset>& addresses);
 		DebugBreakpoint GetAllBreakpoints();
+		// An empty condition makes the breakpoint unconditional again
+		bool SetBreakpointCondition(uint64_t address, const std::string& condition);
+		bool SetBreakpointCondition(const ModuleNameAndOffset& address, const std::string& condition);
+		std::string GetBreakpointCondition(uint64_t address);
+		std::string GetBreakpointCondition(const ModuleNameAndOffset& address);
+		// A tracepoint counts its hits and records its log message, if any, without stopping the target
+		bool SetBreakpointTracepoint(const ModuleNameAndOffset& address, bool tracepoint);
+		bool SetBreakpointLogTemplate(const ModuleNameAndOffset& address, const std::string& logTemplate);
+		bool SetBreakpointIgnoreCount(const ModuleNameAndOffset& address, uint64_t ignoreCount);
+		std::shared_ptr<const BreakpointAttributes> GetBreakpointAttributes(const ModuleNameAndOffset& address);
+		bool ResetBreakpointHits(const ModuleNameAndOffset& address);
+
+		// watchpoints
+		bool AddWatchpoint(uint64_t address, size_t size, DebugWatchpointType type);
+		bool AddWatchpoint(const ModuleNameAndOffset& address, size_t size, DebugWatchpointType type);
+		bool DeleteWatchpoint(uint64_t address);
+		bool DeleteWatchpoint(const ModuleNameAndOffset& address);
+		std::vector<DebuggerWatchpoint> GetWatchpoints();
 
 		// registers
 		uint64_t GetRegisterValue(const std::string& name);
 		bool SetRegisterValue(const std::string& name, uint64_t value);
-		std::vector<DebugRegister> GetAllRegisters();
+		std::vector<DebugRegister> GetAllRegisters(bool withHints = false);
 
 		// processes
 		std::vector<DebugProcess> GetProcessList();
@@ -170,7 +323,7 @@ namespace BinaryNinjaDebugger {
 		DebugThread GetActiveThread() const;
 		void SetActiveThread(const DebugThread& thread);
 		std::vector<DebugThread> GetAllThreads();
-		std::vector<DebugFrame> GetFramesOfThread(uint64_t tid);
+		std::vector<DebugFrame> GetFramesOfThread(uint64_t tid, size_t maxFrames = 0);
 		bool SuspendThread(std::uint32_t tid);
 		bool ResumeThread(std::uint32_t tid);
 
@@ -192,18 +345,42 @@ namespace BinaryNinjaDebugger {
 
 		// memory
 		DataBuffer ReadMemory(std::uintptr_t address, std::size_t size);
+		std::vector<DataBuffer> ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges);
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer);
+		// The ranges written by WriteMemory() since the last call, so the live view can invalidate exactly those
+		std::vector<DebugMemoryRange> TakeWrittenMemoryRanges();
+		DebuggerMemoryCacheStatistics GetMemoryCacheStatistics();
+		void ResetMemoryCacheStatistics();
+		std::vector<DebugMemoryRegion> GetMemoryRegions();
+		// Report the matches of the pattern in the readable memory within [start, end), in ascending order, until
+		// `onMatch` returns false or `maxResults` matches are reported. Returns the number of matches reported.
+		size_t SearchMemory(const std::vector<uint8_t>& pattern, const std::vector<uint8_t>& mask, uint64_t start,
+			uint64_t end, size_t maxResults, const std::function<bool(uint64_t)>& onMatch);
+		// Stop the searches that are running
+		void CancelMemorySearch();
+		// Save the memory, the registers of all threads and the modules of the stopped target into an ELF core file.
+		// `progress` is called with the number of bytes written so far and the total, and cancels when it returns false.
+		bool SaveCoreFile(const std::string& path, const std::function<bool(size_t, size_t)>& progress = {});
+		// Hash the memory within [start, end) at every stop, to find out what changed since the previous stop. This
+		// costs a read of the whole range per stop, so only the ranges of interest should be tracked.
+		void TrackMemoryChanges(uint64_t start, uint64_t end);
+		void UntrackMemoryChanges(uint64_t start, uint64_t end);
+		std::vector<MemoryDiffTracker::Range> GetTrackedMemoryRanges();
+		bool IsTrackingMemoryChanges();
+		// What changed in the tracked memory between the last two stops
+		std::vector<MemoryDiffTracker::Range> GetChangedMemoryRanges();
+		std::vector<uint64_t> GetChangedMemoryPages();
+		// The changes found at all the stops since the last call, so the live view misses none of them
+		std::vector<MemoryDiffTracker::Range> TakeChangedMemoryRanges();
 
 		// debugger events
-		size_t RegisterEventCallback(
-			std::function<void(const DebuggerEvent& event)> callback, const std::string& name = "");
+		size_t RegisterEventCallback(std::function<void(const DebuggerEvent& event)> callback,
+			const std::string& name = "", DebuggerEventDeliveryPolicy policy = SynchronousEventDelivery);
 		bool RemoveEventCallback(size_t index);
-		bool RemoveEventCallbackInternal(size_t index);
 		void NotifyStopped(DebugStopReason reason, void* data = nullptr);
 		void NotifyError(const std::string& error, const std::string& shortError, void* data = nullptr);
 		void NotifyEvent(DebuggerEventType event);
 		void PostDebuggerEvent(const DebuggerEvent& event);
-		void CleanUpDisabledEvent();
 
 		// shortcut for instruction pointer
 		uint64_t GetLastIP() const { return m_lastIP; }
@@ -247,6 +424,16 @@ namespace BinaryNinjaDebugger {
 		void DetachAndWait();
 		void QuitAndWait();
 
+		// Execution trace. The target is stepped in a tight loop, and the callbacks only see the trace start and stop,
+		// so it is much faster than stepping repeatedly. Pausing the target cancels the trace.
+		bool Trace(const ExecutionTraceOptions& options);
+		DebugStopReason TraceAndWait(const ExecutionTraceOptions& options);
+		void CancelTrace();
+		bool IsTracing() const { return m_tracing; }
+		// Highlights the traced instructions in the live view. Returns the number of instructions highlighted, or -1
+		// if the trace cannot be read.
+		int64_t HighlightTrace(const std::string& path, BNHighlightStandardColor color);
+
 		// getters
 		DebugAdapter* GetAdapter() { return m_adapter; }
 		DebuggerState* GetState() { return m_state; }
@@ -271,6 +458,10 @@ namespace BinaryNinjaDebugger {
 		// Dereference an address and check for printable strings, functions, symbols, etc
 		std::string GetAddressInformation(uint64_t address);
 
+		// The slots from `before` slots below the stack pointer to `after` slots above it, each followed through up
+		// to `depth` pointers. The result is cached until the memory or the modules of the target change.
+		std::vector<DebugStackSlot> GetStackWindow(size_t before, size_t after, size_t depth);
+
 		bool IsFirstLaunch();
 	};
 };  // namespace BinaryNinjaDebugger
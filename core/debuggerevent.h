@@ -24,6 +24,9 @@ namespace BinaryNinjaDebugger {
 	typedef BNDebuggerEventType DebuggerEventType;
     typedef BNDebugStopReason DebugStopReason;
     typedef BNDebuggerAdapterOperation DebugAdapterOperation;
+	typedef BNDebuggerEventDeliveryPolicy DebuggerEventDeliveryPolicy;
+	typedef BNDebuggerOutputStream DebuggerOutputStream;
+	typedef BNDebugWatchpointType DebugWatchpointType;
 
 	struct TargetStoppedEventData
 	{
@@ -31,6 +34,9 @@ namespace BinaryNinjaDebugger {
 		std::uint32_t lastActiveThread;
 		size_t exitCode;
 		void* data;
+		// Only valid when the reason is Watchpoint
+		uint64_t watchpointAddress {};
+		DebugWatchpointType watchpointType {};
 	};
 
 
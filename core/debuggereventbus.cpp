@@ -0,0 +1,343 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <set>
+#include "binaryninjaapi.h"
+#include "debuggereventbus.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+DebuggerEventQueue::~DebuggerEventQueue()
+{
+	Node* node = m_head.exchange(nullptr);
+	while (node)
+	{
+		Node* next = node->next;
+		delete node;
+		node = next;
+	}
+}
+
+
+void DebuggerEventQueue::Push(Entry entry)
+{
+	if (entry.event.type == StdoutMessageEventType)
+		m_outputSize += entry.event.data.messageData.message.size();
+	Node* node = new Node {std::move(entry), m_head.load(std::memory_order_relaxed)};
+	while (!m_head.compare_exchange_weak(node->next, node))
+		;
+}
+
+
+std::vector<DebuggerEventQueue::Entry> DebuggerEventQueue::TakeAll()
+{
+	// The list is in the reverse order of the pushes
+	Node* node = m_head.exchange(nullptr);
+	std::vector<Entry> result;
+	while (node)
+	{
+		if (node->entry.event.type == StdoutMessageEventType)
+			m_outputSize -= node->entry.event.data.messageData.message.size();
+		result.push_back(std::move(node->entry));
+		Node* next = node->next;
+		delete node;
+		node = next;
+	}
+	std::reverse(result.begin(), result.end());
+	return result;
+}
+
+
+DebuggerEventBus::DebuggerEventBus() : m_callbacks(std::make_shared<const CallbackList>()) {}
+
+
+DebuggerEventBus::~DebuggerEventBus()
+{
+	Shutdown();
+}
+
+
+void DebuggerEventBus::Shutdown()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_workerMutex);
+		m_workerQuit = true;
+	}
+	m_workerCondition.notify_one();
+
+	// Not joined under the lock, since a worker callback may register or remove callbacks before it sees the flag
+	std::thread worker;
+	{
+		std::unique_lock<std::mutex> lock(m_registrationMutex);
+		worker = std::move(m_worker);
+	}
+	if (!worker.joinable())
+		return;
+
+	// A worker callback may drop the last reference to the controller, in which case this runs on the worker. The
+	// worker holds a reference to the bus, so the bus outlives it, and the thread can be let go.
+	if (worker.get_id() == std::this_thread::get_id())
+		worker.detach();
+	else
+		worker.join();
+}
+
+
+size_t DebuggerEventBus::RegisterCallback(
+	std::function<void(const DebuggerEvent&)> callback, const std::string& name, DebuggerEventDeliveryPolicy policy)
+{
+	std::unique_lock<std::mutex> lock(m_registrationMutex);
+	DebuggerEventCallback object;
+	object.function = std::move(callback);
+	object.index = m_callbackIndex++;
+	object.name = name;
+	object.policy = policy;
+	object.enabled = std::make_shared<std::atomic<bool>>(true);
+
+	auto callbacks = std::make_shared<CallbackList>(*std::atomic_load(&m_callbacks));
+	callbacks->push_back(object);
+	std::atomic_store(&m_callbacks, std::shared_ptr<const CallbackList>(std::move(callbacks)));
+
+	if ((policy == WorkerEventDelivery) && !m_worker.joinable() && !m_workerQuit)
+	{
+		std::shared_ptr<DebuggerEventBus> bus = shared_from_this();
+		m_worker = std::thread([bus]() { bus->WorkerThread(); });
+	}
+
+	return object.index;
+}
+
+
+bool DebuggerEventBus::RemoveCallback(size_t index)
+{
+	std::unique_lock<std::mutex> lock(m_registrationMutex);
+	auto callbacks = std::make_shared<CallbackList>(*std::atomic_load(&m_callbacks));
+	auto iter = std::find_if(callbacks->begin(), callbacks->end(),
+		[=](const DebuggerEventCallback& callback) { return callback.index == index; });
+	if (iter == callbacks->end())
+		return false;
+
+	iter->enabled->store(false);
+	callbacks->erase(iter);
+	std::atomic_store(&m_callbacks, std::shared_ptr<const CallbackList>(std::move(callbacks)));
+	return true;
+}
+
+
+void DebuggerEventBus::Post(const DebuggerEvent& event)
+{
+	std::shared_ptr<const CallbackList> callbacks = std::atomic_load(&m_callbacks);
+
+	bool synchronousDelivery = false;
+	bool mainThreadDelivery = false;
+	bool workerDelivery = false;
+	for (const DebuggerEventCallback& callback : *callbacks)
+	{
+		if (callback.policy == SynchronousEventDelivery)
+			synchronousDelivery = true;
+		else if (callback.policy == MainThreadEventDelivery)
+			mainThreadDelivery = true;
+		else if (callback.policy == WorkerEventDelivery)
+			workerDelivery = true;
+	}
+
+	if (IsSynchronous(event.type))
+	{
+		// Deliver the inline and the main thread callbacks together on the main thread, after the events that are
+		// already queued for it, and wait for them. No main thread callback of an earlier event can then see the
+		// views while they are being replaced.
+		BinaryNinja::ExecuteOnMainThreadAndWait([&]() {
+			DrainMainThreadQueue();
+			for (const DebuggerEventCallback& callback : *callbacks)
+			{
+				if ((callback.policy != WorkerEventDelivery) && callback.enabled->load())
+					callback.function(event);
+			}
+		});
+		mainThreadDelivery = false;
+	}
+	else
+	{
+		// The synchronous callbacks run first, so the inline ones see the state that the core handler updated. The
+		// events already queued for the main thread are delivered before them, to keep the order.
+		if (synchronousDelivery)
+		{
+			BinaryNinja::ExecuteOnMainThreadAndWait([&]() {
+				DrainMainThreadQueue();
+				for (const DebuggerEventCallback& callback : *callbacks)
+				{
+					if ((callback.policy == SynchronousEventDelivery) && callback.enabled->load())
+						callback.function(event);
+				}
+			});
+		}
+
+		for (const DebuggerEventCallback& callback : *callbacks)
+		{
+			if ((callback.policy == InlineEventDelivery) && callback.enabled->load())
+				callback.function(event);
+		}
+	}
+
+	if (event.type == StdoutMessageEventType)
+	{
+		size_t size = event.data.messageData.message.size();
+		if (m_mainThreadQueue.GetOutputSize() + size > MaxQueuedOutput)
+			mainThreadDelivery = false;
+		if (m_workerQueue.GetOutputSize() + size > MaxQueuedOutput)
+			workerDelivery = false;
+	}
+
+	if (mainThreadDelivery)
+	{
+		m_mainThreadQueue.Push({event, callbacks});
+		// Only one drain is pending on the main thread at a time; it delivers everything queued before it runs
+		if (!m_mainThreadDrainScheduled.exchange(true))
+		{
+			std::weak_ptr<DebuggerEventBus> weakBus = weak_from_this();
+			BinaryNinja::ExecuteOnMainThread([weakBus]() {
+				if (auto bus = weakBus.lock())
+					bus->DrainMainThreadQueue();
+			});
+		}
+	}
+
+	if (workerDelivery)
+	{
+		m_workerQueue.Push({event, callbacks});
+		{
+			std::unique_lock<std::mutex> lock(m_workerMutex);
+			m_workerPending = true;
+		}
+		m_workerCondition.notify_one();
+	}
+}
+
+
+bool DebuggerEventBus::IsSynchronous(DebuggerEventType type)
+{
+	// The callbacks of these events replace or drop the views that the debugger core keeps using, e.g., the UI
+	// rebases the input file and creates the live view when the module is loaded. The poster must not carry on
+	// before they are done.
+	switch (type)
+	{
+	case ModuleLoadedEvent:
+	case TargetExitedEventType:
+	case DetachedEventType:
+	case QuitDebuggingEventType:
+	case LaunchFailureEventType:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+bool DebuggerEventBus::IsCoalescible(DebuggerEventType type)
+{
+	// These events carry no data and only tell the callbacks to refresh, so only the last one of them matters
+	switch (type)
+	{
+	case RegisterChangedEvent:
+	case ThreadStateChangedEvent:
+	case DebuggerSettingsChangedEvent:
+	case ForceMemoryCacheUpdateEvent:
+		return true;
+	default:
+		return false;
+	}
+}
+
+
+void DebuggerEventBus::Coalesce(std::vector<DebuggerEventQueue::Entry>& entries)
+{
+	if (entries.size() < 2)
+		return;
+
+	// Merge the consecutive stdout messages into one
+	std::vector<DebuggerEventQueue::Entry> merged;
+	merged.reserve(entries.size());
+	for (auto& entry : entries)
+	{
+		if ((entry.event.type == StdoutMessageEventType) && !merged.empty()
+			&& (merged.back().event.type == StdoutMessageEventType) && (merged.back().callbacks == entry.callbacks))
+		{
+			merged.back().event.data.messageData.message += entry.event.data.messageData.message;
+			continue;
+		}
+		merged.push_back(std::move(entry));
+	}
+
+	// Walk backward, so that the last one of the redundant events is kept
+	std::vector<DebuggerEventQueue::Entry> result;
+	result.reserve(merged.size());
+	std::set<DebuggerEventType> seen;
+	for (auto iter = merged.rbegin(); iter != merged.rend(); iter++)
+	{
+		if (IsCoalescible(iter->event.type) && !seen.insert(iter->event.type).second)
+			continue;
+		result.push_back(std::move(*iter));
+	}
+	std::reverse(result.begin(), result.end());
+	entries = std::move(result);
+}
+
+
+void DebuggerEventBus::Deliver(
+	const std::vector<DebuggerEventQueue::Entry>& entries, DebuggerEventDeliveryPolicy policy)
+{
+	for (const DebuggerEventQueue::Entry& entry : entries)
+	{
+		for (const DebuggerEventCallback& callback : *entry.callbacks)
+		{
+			if ((callback.policy != policy) || !callback.enabled->load())
+				continue;
+
+			callback.function(entry.event);
+		}
+	}
+}
+
+
+void DebuggerEventBus::DrainMainThreadQueue()
+{
+	// Clear the flag before taking the events, so that an event pushed after this point schedules another drain
+	m_mainThreadDrainScheduled = false;
+	std::vector<DebuggerEventQueue::Entry> entries = m_mainThreadQueue.TakeAll();
+	Coalesce(entries);
+	Deliver(entries, MainThreadEventDelivery);
+}
+
+
+void DebuggerEventBus::WorkerThread()
+{
+	while (true)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_workerMutex);
+			m_workerCondition.wait(lock, [this]() { return m_workerPending || m_workerQuit; });
+			if (m_workerQuit)
+				return;
+			m_workerPending = false;
+		}
+
+		std::vector<DebuggerEventQueue::Entry> entries = m_workerQueue.TakeAll();
+		Coalesce(entries);
+		Deliver(entries, WorkerEventDelivery);
+	}
+}
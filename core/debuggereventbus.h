@@ -0,0 +1,118 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "debuggerevent.h"
+
+namespace BinaryNinjaDebugger {
+	struct DebuggerEventCallback
+	{
+		std::function<void(const DebuggerEvent& event)> function;
+		size_t index;
+		std::string name;
+		DebuggerEventDeliveryPolicy policy;
+		// Cleared when the callback is removed, so that the events that are already queued are not delivered to it
+		std::shared_ptr<std::atomic<bool>> enabled;
+	};
+
+
+	// A multi-producer, single-consumer queue. Producers push with a CAS on the head of a linked list, and the
+	// consumer takes the whole list at once, so neither side ever takes a lock.
+	class DebuggerEventQueue
+	{
+	public:
+		using CallbackList = std::vector<DebuggerEventCallback>;
+
+		struct Entry
+		{
+			DebuggerEvent event;
+			// The callbacks that were registered when the event was posted
+			std::shared_ptr<const CallbackList> callbacks;
+		};
+
+	private:
+		struct Node
+		{
+			Entry entry;
+			Node* next;
+		};
+		std::atomic<Node*> m_head = nullptr;
+		// The size of the target output in the queued StdoutMessageEventType events
+		std::atomic<size_t> m_outputSize = 0;
+
+	public:
+		~DebuggerEventQueue();
+		void Push(Entry entry);
+		// Returns the queued entries in the order they were pushed
+		std::vector<Entry> TakeAll();
+		bool IsEmpty() const { return m_head.load() == nullptr; }
+		size_t GetOutputSize() const { return m_outputSize.load(); }
+	};
+
+
+	// Dispatches the debugger events to the registered callbacks, according to the delivery policy of each callback.
+	// Posting an event waits for the synchronous callbacks only. The events for the other main thread callbacks and
+	// for the worker thread are queued.
+	class DebuggerEventBus : public std::enable_shared_from_this<DebuggerEventBus>
+	{
+		using CallbackList = DebuggerEventQueue::CallbackList;
+
+		// The target output that can wait in a queue. The output beyond it is not queued when the callbacks fall behind,
+		// but it can still be read from the output buffer of the debugger.
+		static constexpr size_t MaxQueuedOutput = 0x1000000;
+
+		// Copy-on-write list of callbacks. Readers only do an atomic load, the mutex serializes the writers.
+		std::shared_ptr<const CallbackList> m_callbacks;
+		std::mutex m_registrationMutex;
+		std::atomic<size_t> m_callbackIndex = 0;
+
+		DebuggerEventQueue m_mainThreadQueue;
+		std::atomic<bool> m_mainThreadDrainScheduled = false;
+
+		DebuggerEventQueue m_workerQueue;
+		std::thread m_worker;
+		std::mutex m_workerMutex;
+		std::condition_variable m_workerCondition;
+		bool m_workerPending = false;
+		std::atomic<bool> m_workerQuit = false;
+
+		static bool IsCoalescible(DebuggerEventType type);
+		static bool IsSynchronous(DebuggerEventType type);
+		static void Coalesce(std::vector<DebuggerEventQueue::Entry>& entries);
+		static void Deliver(const std::vector<DebuggerEventQueue::Entry>& entries, DebuggerEventDeliveryPolicy policy);
+		void DrainMainThreadQueue();
+		void WorkerThread();
+
+	public:
+		DebuggerEventBus();
+		~DebuggerEventBus();
+
+		size_t RegisterCallback(std::function<void(const DebuggerEvent& event)> callback, const std::string& name,
+			DebuggerEventDeliveryPolicy policy);
+		bool RemoveCallback(size_t index);
+		void Post(const DebuggerEvent& event);
+		// Stop the worker thread. The events that are still queued for it are not delivered.
+		void Shutdown();
+	};
+};  // namespace BinaryNinjaDebugger
@@ -15,6 +15,7 @@ limitations under the License.
 */
 
 #include <chrono>
+#include <cstring>
 #include <thread>
 #include <utility>
 #include <filesystem>
@@ -36,14 +37,34 @@ DebuggerRegisters::DebuggerRegisters(DebuggerState* state) : m_state(state)
 }
 
 
-void DebuggerRegisters::MarkDirty()
+void DebuggerRegisters::MarkDirtyLocked()
 {
 	m_dirty = true;
-	m_registerCache.clear();
+	m_values.clear();
+	m_changed.clear();
 }
 
 
-void DebuggerRegisters::Update()
+void DebuggerRegisters::MarkDirty()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	MarkDirtyLocked();
+}
+
+
+void DebuggerRegisters::MarkResumed()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	if (!m_values.empty())
+	{
+		m_previousSchema = m_schema;
+		m_previousValues = m_values;
+	}
+	MarkDirtyLocked();
+}
+
+
+void DebuggerRegisters::UpdateLocked()
 {
 	DebugAdapter* adapter = m_state->GetAdapter();
 	if (!adapter)
@@ -52,23 +73,90 @@ void DebuggerRegisters::Update()
 	if (!m_state->IsConnected())
 		return;
 
-	m_registerCache = adapter->ReadAllRegisters();
+	if (!adapter->ReadRegisterValues(m_schema, m_values))
+		m_values.clear();
+
+	m_changed.assign(m_values.size(), false);
+	if ((m_schema == m_previousSchema) && (m_values.size() == m_previousValues.size()))
+	{
+		for (size_t i = 0; i < m_values.size(); i++)
+			m_changed[i] = (m_values[i] != m_previousValues[i]);
+	}
 	m_dirty = false;
 }
 
 
+void DebuggerRegisters::UpdateIfDirtyLocked()
+{
+	if (m_dirty)
+		UpdateLocked();
+}
+
+
+void DebuggerRegisters::Update()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	UpdateLocked();
+}
+
+
+size_t DebuggerRegisters::GetRegisterIndex(const std::string& name)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	UpdateIfDirtyLocked();
+
+	if (!m_schema || m_values.empty())
+		return RegisterSchema::InvalidIndex;
+
+	return m_schema->GetIndex(name);
+}
+
+
 uint64_t DebuggerRegisters::GetRegisterValue(const std::string& name)
 {
 	// Unlike the Python implementation, we require the DebuggerState to explicitly check for dirty caches
 	// and update the values when necessary. This is mainly because the update can be expensive.
-	if (IsDirty())
-		Update();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	UpdateIfDirtyLocked();
+
+	if (!m_schema)
+		return 0x0;
+
+	size_t index = m_schema->GetIndex(name);
+	if (index >= m_values.size())
+		return 0x0;
+
+	return m_values[index];
+}
+
 
-	auto iter = m_registerCache.find(name);
-	if (iter == m_registerCache.end())
+uint64_t DebuggerRegisters::GetRegisterValue(size_t index)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	UpdateIfDirtyLocked();
+
+	if (index >= m_values.size())
 		return 0x0;
 
-	return iter->second.m_value;
+	return m_values[index];
+}
+
+
+std::shared_ptr<const RegisterSchema> DebuggerRegisters::GetSchema()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	UpdateIfDirtyLocked();
+
+	return m_schema;
+}
+
+
+std::vector<bool> DebuggerRegisters::GetChangedRegisters()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	UpdateIfDirtyLocked();
+
+	return m_changed;
 }
 
 
@@ -78,8 +166,7 @@ bool DebuggerRegisters::SetRegisterValue(const std::string& name, uint64_t value
 	if (!adapter)
 		return false;
 
-	auto iter = m_registerCache.find(name);
-	if (iter == m_registerCache.end())
+	if (GetRegisterIndex(name) == RegisterSchema::InvalidIndex)
 		return false;
 
 	bool ok = adapter->WriteRegister(name, value);
@@ -95,40 +182,122 @@ bool DebuggerRegisters::SetRegisterValue(const std::string& name, uint64_t value
 }
 
 
-std::vector<DebugRegister> DebuggerRegisters::GetAllRegisters()
+bool RegisterHintCache::Get(uint64_t value, uint64_t memoryGeneration, uint64_t moduleGeneration, std::string& hint)
 {
-	if (IsDirty())
-		Update();
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto iter = m_index.find(value);
+	if (iter == m_index.end())
+		return false;
+
+	auto entry = iter->second;
+	if ((entry->memoryGeneration != memoryGeneration) || (entry->moduleGeneration != moduleGeneration))
+		return false;
+
+	m_entries.splice(m_entries.begin(), m_entries, entry);
+	hint = entry->hint;
+	return true;
+}
+
+
+void RegisterHintCache::Put(
+	uint64_t value, uint64_t memoryGeneration, uint64_t moduleGeneration, const std::string& hint)
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	auto iter = m_index.find(value);
+	if (iter != m_index.end())
+	{
+		m_entries.erase(iter->second);
+		m_index.erase(iter);
+	}
+
+	m_entries.push_front({value, memoryGeneration, moduleGeneration, hint});
+	m_index[value] = m_entries.begin();
+
+	while (m_entries.size() > m_capacity)
+	{
+		m_index.erase(m_entries.back().value);
+		m_entries.pop_back();
+	}
+}
+
+
+void RegisterHintCache::Clear()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_entries.clear();
+	m_index.clear();
+}
 
+
+std::vector<DebugRegister> DebuggerRegisters::GetAllRegisters(bool withHints)
+{
 	std::vector<DebugRegister> result {};
-	for (auto& [reg_name, reg] : m_registerCache)
-		result.push_back(reg);
+	{
+		// The hints below are computed from this snapshot without holding the lock, since they read memory
+		std::unique_lock<std::mutex> lock(m_mutex);
+		UpdateIfDirtyLocked();
 
-	std::sort(result.begin(), result.end(), [](const DebugRegister& lhs, const DebugRegister& rhs) {
-		return lhs.m_registerIndex < rhs.m_registerIndex;
-	});
+		if (!m_schema)
+			return result;
+
+		// The schema is already in the order of the register indices
+		result.reserve(m_values.size());
+		for (size_t i = 0; i < m_values.size(); i++)
+		{
+			result.emplace_back(m_schema->GetName(i), m_values[i], m_schema->GetWidth(i), i);
+			result.back().m_changed = m_changed[i];
+		}
+	}
+
+	if (!withHints)
+		return result;
 
 	// TODO: maybe we should not hold a m_state at all; instead we just hold a m_controller
 	auto controller = m_state->GetController();
 	if (!controller->GetState()->IsConnected())
 		return result;
 
+	// Taken before the hints are computed, so a hint computed while the memory changes is not reused afterwards
+	uint64_t memoryGeneration = m_state->GetMemory()->GetGeneration();
+	uint64_t moduleGeneration = m_state->GetModules()->GetGeneration();
+
 	std::map<uint64_t, std::string> regHints;
-	for (auto& reg : result)
+	std::vector<uint64_t> missing;
+	for (const auto& reg : result)
 	{
-		auto it = regHints.find(reg.m_value);
-		if (it != regHints.end())
-        {
-            reg.m_hint = it->second;
-        }
+		if (regHints.find(reg.m_value) != regHints.end())
+			continue;
+
+		std::string hint;
+		if (m_hints.Get(reg.m_value, memoryGeneration, moduleGeneration, hint))
+			regHints[reg.m_value] = hint;
 		else
-        {
-            const std::string hint = controller->GetAddressInformation(reg.m_value);
-            regHints[reg.m_value] = hint;
-            reg.m_hint = hint;
-        }
+			missing.push_back(reg.m_value);
+	}
+	std::sort(missing.begin(), missing.end());
+	missing.erase(std::unique(missing.begin(), missing.end()), missing.end());
+
+	if (!missing.empty())
+	{
+		// GetAddressInformation() reads the memory each register points to. Fetch all of it at once, so the hints
+		// below are served from the memory cache rather than costing one backend read per register.
+		std::vector<DebugMemoryRange> ranges;
+		ranges.reserve(missing.size());
+		for (uint64_t value : missing)
+			ranges.emplace_back(value, 128);
+		controller->ReadMemoryBatch(ranges);
+
+		for (uint64_t value : missing)
+		{
+			const std::string hint = controller->GetAddressInformation(value);
+			m_hints.Put(value, memoryGeneration, moduleGeneration, hint);
+			regHints[value] = hint;
+		}
 	}
 
+	for (auto& reg : result)
+		reg.m_hint = regHints[reg.m_value];
+
 	return result;
 }
 
@@ -161,20 +330,24 @@ void DebuggerThreads::Update()
 	if (!adapter)
 		return;
 
-	m_frames.clear();
+	{
+		std::unique_lock<std::mutex> lock(m_framesMutex);
+		m_frames.clear();
+	}
+
+	// Only enumerate the threads here. Unwinding all of them is expensive for targets with lots of threads, and
+	// usually only the active one is looked at. GetFramesOfThread() unwinds them on demand.
+	std::unordered_map<uint32_t, bool> frozenState;
+	for (const DebugThread& thread : m_threads)
+		frozenState[thread.m_tid] = thread.m_isFrozen;
 
 	std::vector<DebugThread> newThreads = adapter->GetThreadList();
 	for (auto thread = newThreads.begin(); thread != newThreads.end(); thread++)
 	{
-		m_frames[thread->m_tid] = adapter->GetFramesOfThread(thread->m_tid);
-
 		// update thread states in new thread list
-		auto oldThread = std::find_if(m_threads.begin(), m_threads.end(), [&](DebugThread const& t) {
-			return t.m_tid == thread->m_tid;
-		});
-
-		if (oldThread != m_threads.end() && thread->m_isFrozen != oldThread->m_isFrozen)
-			thread->m_isFrozen = oldThread->m_isFrozen;
+		auto oldThread = frozenState.find(thread->m_tid);
+		if (oldThread != frozenState.end())
+			thread->m_isFrozen = oldThread->second;
 	}
 
 	m_threads.clear();
@@ -218,16 +391,33 @@ std::vector<DebugThread> DebuggerThreads::GetAllThreads()
 }
 
 
-std::vector<DebugFrame> DebuggerThreads::GetFramesOfThread(uint32_t tid)
+std::vector<DebugFrame> DebuggerThreads::GetFramesOfThread(uint32_t tid, size_t maxFrames)
 {
 	if (IsDirty())
 		Update();
 
+	std::unique_lock<std::mutex> lock(m_framesMutex);
 	auto iter = m_frames.find(tid);
 	if (iter != m_frames.end())
-		return iter->second;
+	{
+		const std::vector<DebugFrame>& frames = iter->second.frames;
+		if ((maxFrames != 0) && (frames.size() >= maxFrames))
+			return std::vector<DebugFrame>(frames.begin(), frames.begin() + maxFrames);
+		if (iter->second.complete)
+			return frames;
+	}
+
+	if (!m_state || !m_state->IsConnected())
+		return {};
 
-	return {};
+	DebugAdapter* adapter = m_state->GetAdapter();
+	if (!adapter)
+		return {};
+
+	ThreadFrames& cached = m_frames[tid];
+	cached.frames = adapter->GetFramesOfThread(tid, maxFrames);
+	cached.complete = (maxFrames == 0) || (cached.frames.size() < maxFrames);
+	return cached.frames;
 }
 
 
@@ -296,42 +486,132 @@ DebuggerModules::DebuggerModules(DebuggerState* state) : m_state(state)
 
 void DebuggerModules::MarkDirty()
 {
+	// The modules are kept, so that Update() only needs to apply the changes to the index
 	m_dirty = true;
+}
+
+
+void DebuggerModules::Clear()
+{
+	if (!m_modulesByAddress.empty())
+		m_generation++;
+
 	m_modules.clear();
+	m_modulesByAddress.clear();
+	m_basesByName.clear();
+}
+
+
+void DebuggerModules::AddToIndex(const DebugModule& module)
+{
+	ModuleKey key(module.m_address, module.m_name);
+	m_modulesByAddress[key] = module;
+
+	std::string baseName = DebugModule::GetPathBaseName(module.m_name);
+	m_basesByName[baseName].push_back(key);
+	std::string shortBaseName = DebugModule::GetPathBaseName(module.m_short_name);
+	if (shortBaseName != baseName)
+		m_basesByName[shortBaseName].push_back(key);
+}
+
+
+void DebuggerModules::RemoveFromIndex(const DebugModule& module)
+{
+	ModuleKey key(module.m_address, module.m_name);
+	m_modulesByAddress.erase(key);
+
+	for (const std::string& name : {module.m_name, module.m_short_name})
+	{
+		auto iter = m_basesByName.find(DebugModule::GetPathBaseName(name));
+		if (iter == m_basesByName.end())
+			continue;
+
+		auto& bases = iter->second;
+		bases.erase(std::remove(bases.begin(), bases.end(), key), bases.end());
+		if (bases.empty())
+			m_basesByName.erase(iter);
+	}
 }
 
 
 void DebuggerModules::Update()
 {
 	DebugAdapter* adapter = m_state->GetAdapter();
-	if (!adapter)
+	if (!adapter || !m_state->IsConnected())
+	{
+		Clear();
 		return;
+	}
 
-	if (!m_state->IsConnected())
-		return;
+	std::vector<DebugModule> newModules = adapter->GetModuleList();
+
+	// Only touch the index for the modules that got loaded or unloaded since the last update
+	std::map<ModuleKey, const DebugModule*> newModulesByAddress;
+	for (const DebugModule& module : newModules)
+		newModulesByAddress.emplace(ModuleKey(module.m_address, module.m_name), &module);
+
+	bool changed = false;
+	for (auto it = m_modulesByAddress.begin(); it != m_modulesByAddress.end();)
+	{
+		auto newModule = newModulesByAddress.find(it->first);
+		if (newModule != newModulesByAddress.end())
+		{
+			it->second = *newModule->second;
+			newModulesByAddress.erase(newModule);
+			it++;
+		}
+		else
+		{
+			DebugModule module = it->second;
+			it++;
+			RemoveFromIndex(module);
+			changed = true;
+		}
+	}
+
+	for (const auto& [address, module] : newModulesByAddress)
+		AddToIndex(*module);
 
-	m_modules = adapter->GetModuleList();
+	if (changed || !newModulesByAddress.empty())
+	{
+		m_generation++;
+		// Loading a module maps new regions
+		m_state->GetMemory()->MarkRegionsDirty();
+	}
+
+	m_modules = std::move(newModules);
 	m_dirty = false;
 }
 
 
+const DebugModule* DebuggerModules::FindModuleByName(const std::string& name)
+{
+	if (name.empty())
+		return nullptr;
+
+	auto iter = m_basesByName.find(DebugModule::GetPathBaseName(name));
+	if (iter == m_basesByName.end() || iter->second.empty())
+		return nullptr;
+
+	auto module = m_modulesByAddress.find(iter->second.front());
+	if (module == m_modulesByAddress.end())
+		return nullptr;
+
+	return &module->second;
+}
+
+
 bool DebuggerModules::GetModuleBase(const std::string& name, uint64_t& address)
 {
 	if (IsDirty())
 		Update();
 
-	if (name.empty())
+	const DebugModule* module = FindModuleByName(name);
+	if (!module)
 		return false;
 
-	for (const DebugModule& module : m_modules)
-	{
-		if (module.IsSameBaseModule(name))
-		{
-			address = module.m_address;
-			return true;
-		}
-	}
-	return false;
+	address = module->m_address;
+	return true;
 }
 
 
@@ -340,12 +620,11 @@ DebugModule DebuggerModules::GetModuleByName(const std::string& name)
 	if (IsDirty())
 		Update();
 
-	for (const DebugModule& module : m_modules)
-	{
-		if (module.IsSameBaseModule(name))
-			return module;
-	}
-	return DebugModule();
+	const DebugModule* module = FindModuleByName(name);
+	if (!module)
+		return DebugModule();
+
+	return *module;
 }
 
 
@@ -355,24 +634,20 @@ DebugModule DebuggerModules::GetModuleForAddress(uint64_t remoteAddress)
 		Update();
 
 	// lldb does not properly return the size of a module, so we have to find the nearest module base that is smaller
-	// than the remoteAddress
-	uint64_t closestAddress = 0;
-	DebugModule result {};
-
-	for (const DebugModule& module : m_modules)
-	{
-		// This is slighlty different from the Python implementation, which finds the largest module start that is
-		// smaller than the remoteAddress.
-		// if ((module.m_address <= remoteAddress) && (remoteAddress < module.m_address + module.m_size))
-		//	return module;
-		if ((module.m_address <= remoteAddress) && (module.m_address > closestAddress))
-		{
-			closestAddress = module.m_address;
-			result = module;
-		}
-	}
-
-	return result;
+	// than the remoteAddress. This is slighlty different from the Python implementation, which finds the largest
+	// module start that is smaller than the remoteAddress. Of the modules that share that base, the last one by name
+	// is taken.
+	auto iter = m_modulesByAddress.end();
+	if (remoteAddress != UINT64_MAX)
+		iter = m_modulesByAddress.lower_bound(ModuleKey(remoteAddress + 1, ""));
+	if (iter == m_modulesByAddress.begin())
+		return DebugModule();
+
+	iter--;
+	if (iter->first.first == 0)
+		return DebugModule();
+
+	return iter->second;
 }
 
 
@@ -402,21 +677,23 @@ uint64_t DebuggerModules::RelativeAddressToAbsolute(const ModuleNameAndOffset& r
 	if (IsDirty())
 		Update();
 
-	if (!relativeAddress.module.empty())
-	{
-		for (const DebugModule& module : m_modules)
-		{
-			if (module.IsSameBaseModule(relativeAddress.module))
-			{
-				return module.m_address + relativeAddress.offset;
-			}
-		}
-	}
+	const DebugModule* module = FindModuleByName(relativeAddress.module);
+	if (module)
+		return module->m_address + relativeAddress.offset;
 
 	return relativeAddress.offset;
 }
 
 
+uint64_t DebuggerModules::GetGeneration()
+{
+	if (IsDirty())
+		Update();
+
+	return m_generation;
+}
+
+
 std::vector<DebugModule> DebuggerModules::GetAllModules()
 {
 	if (IsDirty())
@@ -427,268 +704,1634 @@ std::vector<DebugModule> DebuggerModules::GetAllModules()
 
 
 DebuggerBreakpoints::DebuggerBreakpoints(DebuggerState* state, std::vector<ModuleNameAndOffset> initial) :
-	m_state(state), m_breakpoints(std::move(initial))
-{}
+	m_state(state), m_breakpoints(std::move(initial)), m_attributeSnapshot(std::make_shared<const AttributeMap>())
+{
+	m_recordCapacity = std::max<size_t>(Settings::Instance()->Get<uint64_t>("debugger.tracepointBufferSize"), 1);
+	RebuildIndex();
+}
 
 
-bool DebuggerBreakpoints::AddAbsolute(uint64_t remoteAddress)
+DebuggerBreakpoints::OffsetKey DebuggerBreakpoints::GetOffsetKey(const ModuleNameAndOffset& address)
 {
-	if (!m_state->GetAdapter())
-		return false;
+	return {ModuleNameAndOffset::GetPathBaseName(address.module), address.offset};
+}
 
-	bool result = false;
-	// Always add the breakpoint as long as the adapter is connected, even if it may be already present
-	if (m_state->IsConnected())
+
+void DebuggerBreakpoints::RebuildIndex()
+{
+	m_offsetIndex.clear();
+	std::vector<ModuleNameAndOffset> breakpoints;
+	breakpoints.reserve(m_breakpoints.size());
+	// Drop the duplicates, e.g., from old metadata, so that every breakpoint in the list has exactly one index entry
+	for (ModuleNameAndOffset& breakpoint : m_breakpoints)
 	{
-		m_state->GetAdapter()->AddBreakpoint(remoteAddress);
-		result = true;
+		if (m_offsetIndex.insert(GetOffsetKey(breakpoint)).second)
+			breakpoints.push_back(std::move(breakpoint));
 	}
+	m_breakpoints = std::move(breakpoints);
+	m_addressIndexValid = false;
 
-	if (!ContainsAbsolute(remoteAddress))
+	for (auto iter = m_attributes.begin(); iter != m_attributes.end();)
 	{
-		ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
-		m_breakpoints.push_back(info);
-		SerializeMetadata();
+		if (m_offsetIndex.find(iter->first) == m_offsetIndex.end())
+			iter = m_attributes.erase(iter);
+		else
+			iter++;
 	}
-
-	return result;
-}
-
-
-bool DebuggerBreakpoints::AddOffset(const ModuleNameAndOffset& address)
-{
-	if (!ContainsOffset(address))
+	for (const OffsetKey& key : m_offsetIndex)
 	{
-		m_breakpoints.push_back(address);
-		SerializeMetadata();
-
-		// If the adapter is already created, we ask it to add the breakpoint.
-		// Otherwise, all breakpoints will be added to the adapter when the adapter is created.
-		if (m_state->GetAdapter() && m_state->IsConnected())
-		{
-			m_state->GetAdapter()->AddBreakpoint(address);
-			return true;
-		}
-		return true;
+		if (m_attributes.find(key) == m_attributes.end())
+			m_attributes[key] = NewAttributes();
 	}
-	return false;
+	RebuildAttributeSnapshot();
 }
 
 
-bool DebuggerBreakpoints::RemoveAbsolute(uint64_t remoteAddress)
+bool DebuggerBreakpoints::UpdateAddressIndex()
 {
 	if (!m_state->GetAdapter())
 		return false;
 
-	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
-	if (ContainsOffset(info))
-	{
-		auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), info);
-		if (iter != m_breakpoints.end())
-		{
-			m_breakpoints.erase(iter);
-		}
-		SerializeMetadata();
-		m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
+	uint64_t generation = m_state->GetModules()->GetGeneration();
+	if (m_addressIndexValid && (generation == m_addressIndexGeneration))
 		return true;
-	}
-	return false;
+
+	// Every ModuleAndOffset can be converted to an absolute address, but there is no guarantee that it works backward,
+	// since lldb does not report the size of the loaded libraries. So the index is built from the relative addresses.
+	m_addressIndex.clear();
+	for (const ModuleNameAndOffset& breakpoint : m_breakpoints)
+		m_addressIndex[m_state->GetModules()->RelativeAddressToAbsolute(breakpoint)]++;
+
+	m_addressIndexValid = true;
+	m_addressIndexGeneration = generation;
+	RebuildAttributeSnapshot();
+	return true;
 }
 
 
-bool DebuggerBreakpoints::RemoveOffset(const ModuleNameAndOffset& address)
+void DebuggerBreakpoints::RebuildAttributeSnapshot()
 {
-	if (ContainsOffset(address))
+	auto snapshot = std::make_shared<AttributeMap>();
+	// The absolute addresses are unknown until the index is built against the current modules. Until then, every
+	// breakpoint stops the target unconditionally.
+	if (m_addressIndexValid && m_state->GetAdapter())
 	{
-		if (auto iter = std::find(m_breakpoints.begin(), m_breakpoints.end(), address); iter != m_breakpoints.end())
-			m_breakpoints.erase(iter);
-
-		SerializeMetadata();
-
-		if (m_state->GetAdapter() && m_state->IsConnected())
+		for (const auto& [key, attributes] : m_attributes)
 		{
-			uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(address);
-			m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
-			return true;
+			uint64_t address =
+				m_state->GetModules()->RelativeAddressToAbsolute(ModuleNameAndOffset(key.first, key.second));
+			(*snapshot)[address] = attributes;
 		}
-		return true;
 	}
-	return false;
+	std::atomic_store(&m_attributeSnapshot, std::shared_ptr<const AttributeMap>(std::move(snapshot)));
+	m_attributeSnapshotDirty = false;
 }
 
 
-bool DebuggerBreakpoints::ContainsOffset(const ModuleNameAndOffset& address)
+std::shared_ptr<const BreakpointAttributes> DebuggerBreakpoints::NewAttributes() const
 {
-	// If there is no backend, then only check if the breakpoint is in the list
-	// This is useful when we deal with the breakpoint before the target is launched
-	if (!m_state->GetAdapter())
-		return std::find(m_breakpoints.begin(), m_breakpoints.end(), address) != m_breakpoints.end();
-
-	// When the backend is live, convert the relative address to absolute address and check its existence
-	uint64_t absolute = m_state->GetModules()->RelativeAddressToAbsolute(address);
-	return ContainsAbsolute(absolute);
+	auto attributes = std::make_shared<BreakpointAttributes>();
+	attributes->hits = std::make_shared<BreakpointHits>(m_recordCapacity);
+	return attributes;
 }
 
 
-bool DebuggerBreakpoints::ContainsAbsolute(uint64_t address)
+void DebuggerBreakpoints::AddToAddressIndex(const ModuleNameAndOffset& address)
 {
-	if (!m_state->GetAdapter())
+	// An invalid index is rebuilt from scratch on the next query, so there is no need to update it
+	if (!m_addressIndexValid || !m_state->GetAdapter())
+		return;
+
+	m_addressIndex[m_state->GetModules()->RelativeAddressToAbsolute(address)]++;
+}
+
+
+void DebuggerBreakpoints::RemoveFromAddressIndex(const ModuleNameAndOffset& address)
+{
+	if (!m_addressIndexValid || !m_state->GetAdapter())
+		return;
+
+	auto iter = m_addressIndex.find(m_state->GetModules()->RelativeAddressToAbsolute(address));
+	if (iter == m_addressIndex.end())
+		return;
+
+	if (--iter->second == 0)
+		m_addressIndex.erase(iter);
+}
+
+
+bool DebuggerBreakpoints::InsertOffset(const ModuleNameAndOffset& address)
+{
+	OffsetKey key = GetOffsetKey(address);
+	if (!m_offsetIndex.insert(key).second)
+		return false;
+
+	m_breakpoints.push_back(address);
+	AddToAddressIndex(address);
+	m_attributes[key] = NewAttributes();
+	// Rebuilding the snapshot for every breakpoint would make adding them in bulk quadratic
+	m_attributeSnapshotDirty = true;
+	return true;
+}
+
+
+size_t DebuggerBreakpoints::EraseOffsets(const std::unordered_set<OffsetKey, OffsetKeyHash>& keys)
+{
+	if (keys.empty())
+		return 0;
+
+	size_t removed = 0;
+	auto end = std::remove_if(m_breakpoints.begin(), m_breakpoints.end(), [&](const ModuleNameAndOffset& breakpoint) {
+		OffsetKey key = GetOffsetKey(breakpoint);
+		if (keys.find(key) == keys.end())
+			return false;
+
+		RemoveFromAddressIndex(breakpoint);
+		m_offsetIndex.erase(key);
+		removed++;
+		return true;
+	});
+	m_breakpoints.erase(end, m_breakpoints.end());
+
+	for (const OffsetKey& key : keys)
+		m_attributes.erase(key);
+	m_attributeSnapshotDirty = true;
+
+	return removed;
+}
+
+
+bool DebuggerBreakpoints::AddAbsolute(uint64_t remoteAddress)
+{
+	if (!m_state->GetAdapter())
+		return false;
+
+	bool result = false;
+	// Always add the breakpoint as long as the adapter is connected, even if it may be already present
+	if (m_state->IsConnected())
+	{
+		m_state->GetAdapter()->AddBreakpoint(remoteAddress);
+		result = true;
+	}
+
+	if (!ContainsAbsolute(remoteAddress))
+	{
+		ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+		if (InsertOffset(info))
+			SerializeMetadata();
+	}
+
+	return result;
+}
+
+
+bool DebuggerBreakpoints::AddOffset(const ModuleNameAndOffset& address)
+{
+	if (!ContainsOffset(address) && InsertOffset(address))
+	{
+		SerializeMetadata();
+
+		// If the adapter is already created, we ask it to add the breakpoint.
+		// Otherwise, all breakpoints will be added to the adapter when the adapter is created.
+		if (m_state->GetAdapter() && m_state->IsConnected())
+		{
+			m_state->GetAdapter()->AddBreakpoint(address);
+			return true;
+		}
+		return true;
+	}
+	return false;
+}
+
+
+bool DebuggerBreakpoints::RemoveAbsolute(uint64_t remoteAddress)
+{
+	if (!m_state->GetAdapter())
+		return false;
+
+	ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	if (ContainsOffset(info))
+	{
+		EraseOffsets({GetOffsetKey(info)});
+		SerializeMetadata();
+		m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
+		return true;
+	}
+	return false;
+}
+
+
+bool DebuggerBreakpoints::RemoveOffset(const ModuleNameAndOffset& address)
+{
+	if (ContainsOffset(address))
+	{
+		EraseOffsets({GetOffsetKey(address)});
+		SerializeMetadata();
+
+		if (m_state->GetAdapter() && m_state->IsConnected())
+		{
+			uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(address);
+			m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
+			return true;
+		}
+		return true;
+	}
+	return false;
+}
+
+
+size_t DebuggerBreakpoints::AddAbsolutes(const std::vector<uint64_t>& remoteAddresses)
+{
+	if (!m_state->GetAdapter())
+		return 0;
+
+	size_t added = 0;
+	bool connected = m_state->IsConnected();
+	for (uint64_t remoteAddress : remoteAddresses)
+	{
+		if (connected)
+			m_state->GetAdapter()->AddBreakpoint(remoteAddress);
+
+		if (!ContainsAbsolute(remoteAddress)
+			&& InsertOffset(m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress)))
+			added++;
+	}
+
+	if (added > 0)
+		SerializeMetadata();
+
+	return added;
+}
+
+
+size_t DebuggerBreakpoints::AddOffsets(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	size_t added = 0;
+	bool connected = m_state->GetAdapter() && m_state->IsConnected();
+	for (const ModuleNameAndOffset& address : addresses)
+	{
+		if (ContainsOffset(address) || !InsertOffset(address))
+			continue;
+
+		added++;
+		if (connected)
+			m_state->GetAdapter()->AddBreakpoint(address);
+	}
+
+	if (added > 0)
+		SerializeMetadata();
+
+	return added;
+}
+
+
+size_t DebuggerBreakpoints::RemoveAbsolutes(const std::vector<uint64_t>& remoteAddresses)
+{
+	if (!m_state->GetAdapter())
+		return 0;
+
+	std::unordered_set<OffsetKey, OffsetKeyHash> keys;
+	std::vector<uint64_t> toRemove;
+	for (uint64_t remoteAddress : remoteAddresses)
+	{
+		ModuleNameAndOffset info = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+		if (!ContainsOffset(info))
+			continue;
+
+		keys.insert(GetOffsetKey(info));
+		toRemove.push_back(remoteAddress);
+	}
+
+	if (toRemove.empty())
+		return 0;
+
+	// Remove them from the adapter first, since the absolute addresses do not depend on the breakpoint list
+	for (uint64_t remoteAddress : toRemove)
+		m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
+
+	EraseOffsets(keys);
+	SerializeMetadata();
+	return toRemove.size();
+}
+
+
+size_t DebuggerBreakpoints::RemoveOffsets(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	std::unordered_set<OffsetKey, OffsetKeyHash> keys;
+	std::vector<uint64_t> toRemove;
+	bool connected = m_state->GetAdapter() && m_state->IsConnected();
+	size_t removed = 0;
+	for (const ModuleNameAndOffset& address : addresses)
+	{
+		if (!ContainsOffset(address) || !keys.insert(GetOffsetKey(address)).second)
+			continue;
+
+		removed++;
+		if (connected)
+			toRemove.push_back(m_state->GetModules()->RelativeAddressToAbsolute(address));
+	}
+
+	if (removed == 0)
+		return 0;
+
+	for (uint64_t remoteAddress : toRemove)
+		m_state->GetAdapter()->RemoveBreakpoint(remoteAddress);
+
+	EraseOffsets(keys);
+	SerializeMetadata();
+	return removed;
+}
+
+
+bool DebuggerBreakpoints::ContainsOffset(const ModuleNameAndOffset& address)
+{
+	// If there is no backend, then only check if the breakpoint is in the list
+	// This is useful when we deal with the breakpoint before the target is launched
+	if (!m_state->GetAdapter())
+		return m_offsetIndex.find(GetOffsetKey(address)) != m_offsetIndex.end();
+
+	// When the backend is live, convert the relative address to absolute address and check its existence
+	uint64_t absolute = m_state->GetModules()->RelativeAddressToAbsolute(address);
+	return ContainsAbsolute(absolute);
+}
+
+
+bool DebuggerBreakpoints::ContainsAbsolute(uint64_t address)
+{
+	if (!UpdateAddressIndex())
+		return false;
+
+	return m_addressIndex.find(address) != m_addressIndex.end();
+}
+
+
+bool DebuggerBreakpoints::UpdateAttributes(
+	const ModuleNameAndOffset& address, const std::function<void(BreakpointAttributes&)>& update)
+{
+	auto iter = m_attributes.find(GetOffsetKey(address));
+	if (iter == m_attributes.end())
+	{
+		LogWarn("There is no breakpoint at %s + 0x%" PRIx64, address.module.c_str(), address.offset);
+		return false;
+	}
+
+	// The adapter thread may be reading the old attributes, so they are replaced rather than modified
+	auto attributes = std::make_shared<BreakpointAttributes>(*iter->second);
+	update(*attributes);
+	iter->second = attributes;
+
+	UpdateAddressIndex();
+	RebuildAttributeSnapshot();
+	SerializeMetadata();
+	return true;
+}
+
+
+bool DebuggerBreakpoints::SetCondition(const ModuleNameAndOffset& address, const std::string& condition)
+{
+	std::shared_ptr<BreakpointCondition> compiled;
+	if (!condition.empty())
+	{
+		std::string error;
+		compiled = BreakpointCondition::Compile(condition, error);
+		if (!compiled)
+		{
+			LogWarn("Invalid breakpoint condition \"%s\": %s", condition.c_str(), error.c_str());
+			return false;
+		}
+	}
+
+	return UpdateAttributes(address, [&](BreakpointAttributes& attributes) { attributes.condition = compiled; });
+}
+
+
+bool DebuggerBreakpoints::SetLogTemplate(const ModuleNameAndOffset& address, const std::string& logTemplate)
+{
+	std::shared_ptr<TracepointTemplate> compiled;
+	if (!logTemplate.empty())
+	{
+		std::string error;
+		compiled = TracepointTemplate::Compile(logTemplate, error);
+		if (!compiled)
+		{
+			LogWarn("Invalid tracepoint log template \"%s\": %s", logTemplate.c_str(), error.c_str());
+			return false;
+		}
+	}
+
+	return UpdateAttributes(address, [&](BreakpointAttributes& attributes) { attributes.logTemplate = compiled; });
+}
+
+
+bool DebuggerBreakpoints::SetTracepoint(const ModuleNameAndOffset& address, bool tracepoint)
+{
+	return UpdateAttributes(address, [&](BreakpointAttributes& attributes) { attributes.tracepoint = tracepoint; });
+}
+
+
+bool DebuggerBreakpoints::SetIgnoreCount(const ModuleNameAndOffset& address, uint64_t ignoreCount)
+{
+	return UpdateAttributes(address, [&](BreakpointAttributes& attributes) { attributes.ignoreCount = ignoreCount; });
+}
+
+
+bool DebuggerBreakpoints::ResetHits(const ModuleNameAndOffset& address)
+{
+	auto iter = m_attributes.find(GetOffsetKey(address));
+	if (iter == m_attributes.end())
+		return false;
+
+	iter->second->hits->Reset();
+	return true;
+}
+
+
+std::shared_ptr<const BreakpointAttributes> DebuggerBreakpoints::GetAttributes(const ModuleNameAndOffset& address) const
+{
+	auto iter = m_attributes.find(GetOffsetKey(address));
+	if (iter == m_attributes.end())
+		return nullptr;
+
+	return iter->second;
+}
+
+
+void DebuggerBreakpoints::UpdateAttributeSnapshot()
+{
+	// This rebuilds the snapshot if the module bases have changed
+	if (!UpdateAddressIndex())
+		return;
+
+	if (m_attributeSnapshotDirty)
+		RebuildAttributeSnapshot();
+}
+
+
+std::shared_ptr<const BreakpointAttributes> DebuggerBreakpoints::GetAttributesAt(uint64_t remoteAddress) const
+{
+	std::shared_ptr<const AttributeMap> snapshot = std::atomic_load(&m_attributeSnapshot);
+	auto iter = snapshot->find(remoteAddress);
+	if (iter == snapshot->end())
+		return nullptr;
+
+	return iter->second;
+}
+
+
+void DebuggerBreakpoints::SerializeMetadata()
+{
+	// TODO: who should free these Metadata objects?
+	std::vector<Ref<Metadata>> breakpoints;
+	for (const ModuleNameAndOffset& bp : m_breakpoints)
+	{
+		std::map<std::string, Ref<Metadata>> info;
+		info["module"] = new Metadata(bp.module);
+		info["offset"] = new Metadata(bp.offset);
+		auto iter = m_attributes.find(GetOffsetKey(bp));
+		if (iter != m_attributes.end())
+		{
+			const BreakpointAttributes& attributes = *iter->second;
+			if (attributes.condition)
+				info["condition"] = new Metadata(attributes.condition->GetText());
+			if (attributes.logTemplate)
+				info["log"] = new Metadata(attributes.logTemplate->GetText());
+			if (attributes.tracepoint)
+				info["tracepoint"] = new Metadata(true);
+			if (attributes.ignoreCount != 0)
+				info["ignoreCount"] = new Metadata(attributes.ignoreCount);
+		}
+		breakpoints.push_back(new Metadata(info));
+	}
+	m_state->GetController()->GetData()->StoreMetadata("debugger.breakpoints", new Metadata(breakpoints));
+}
+
+
+void DebuggerBreakpoints::UnserializedMetadata()
+{
+	Ref<Metadata> metadata = m_state->GetController()->GetData()->QueryMetadata("debugger.breakpoints");
+	if (!metadata || (!metadata->IsArray()))
+		return;
+
+	vector<Ref<Metadata>> array = metadata->GetArray();
+	std::vector<ModuleNameAndOffset> newBreakpoints;
+	m_attributes.clear();
+
+	for (auto& element : array)
+	{
+		if (!element || (!element->IsKeyValueStore()))
+			continue;
+
+		std::map<std::string, Ref<Metadata>> info = element->GetKeyValueStore();
+		ModuleNameAndOffset address;
+
+		if (!(info["module"] && info["module"]->IsString()))
+			continue;
+
+		address.module = info["module"]->GetString();
+
+		if (!(info["offset"] && info["offset"]->IsUnsignedInteger()))
+			continue;
+
+		address.offset = info["offset"]->GetUnsignedInteger();
+		newBreakpoints.push_back(address);
+
+		auto attributes = std::make_shared<BreakpointAttributes>();
+		attributes->hits = std::make_shared<BreakpointHits>(m_recordCapacity);
+		std::string error;
+		if (info["condition"] && info["condition"]->IsString())
+		{
+			std::string text = info["condition"]->GetString();
+			attributes->condition = BreakpointCondition::Compile(text, error);
+			if (!attributes->condition)
+				LogWarn("Dropping invalid breakpoint condition \"%s\": %s", text.c_str(), error.c_str());
+		}
+		if (info["log"] && info["log"]->IsString())
+		{
+			std::string text = info["log"]->GetString();
+			attributes->logTemplate = TracepointTemplate::Compile(text, error);
+			if (!attributes->logTemplate)
+				LogWarn("Dropping invalid tracepoint log template \"%s\": %s", text.c_str(), error.c_str());
+		}
+		if (info["tracepoint"] && info["tracepoint"]->IsBoolean())
+			attributes->tracepoint = info["tracepoint"]->GetBoolean();
+		if (info["ignoreCount"] && info["ignoreCount"]->IsUnsignedInteger())
+			attributes->ignoreCount = info["ignoreCount"]->GetUnsignedInteger();
+		m_attributes[GetOffsetKey(address)] = attributes;
+	}
+
+	m_breakpoints = newBreakpoints;
+	RebuildIndex();
+}
+
+
+void DebuggerBreakpoints::Apply()
+{
+	if (!m_state->GetAdapter())
+		return;
+
+	// The module bases are about to change, e.g., when the target is relaunched
+	m_addressIndexValid = false;
+	RebuildAttributeSnapshot();
+	for (const ModuleNameAndOffset& address : m_breakpoints)
+		m_state->GetAdapter()->AddBreakpoint(address);
+}
+
+
+DebuggerWatchpoints::DebuggerWatchpoints(DebuggerState* state) : m_state(state)
+{
+}
+
+
+bool DebuggerWatchpoints::IsValid(uint64_t address, size_t size, DebugWatchpointType type)
+{
+	if ((size != 1) && (size != 2) && (size != 4) && (size != 8))
+	{
+		LogWarn("Invalid watchpoint size %d, it must be 1, 2, 4 or 8", (int)size);
+		return false;
+	}
+
+	if ((address & (size - 1)) != 0)
+	{
+		LogWarn("Watchpoint address 0x%" PRIx64 " is not aligned to its size %d", address, (int)size);
+		return false;
+	}
+
+	if ((type != WatchpointRead) && (type != WatchpointWrite) && (type != WatchpointAccess))
+	{
+		LogWarn("Invalid watchpoint type %d", (int)type);
+		return false;
+	}
+
+	return true;
+}
+
+
+std::vector<DebuggerWatchpoint>::iterator DebuggerWatchpoints::Find(const ModuleNameAndOffset& address)
+{
+	return std::find_if(m_watchpoints.begin(), m_watchpoints.end(),
+		[&](const DebuggerWatchpoint& watchpoint) { return watchpoint.address == address; });
+}
+
+
+bool DebuggerWatchpoints::AddAbsolute(uint64_t remoteAddress, size_t size, DebugWatchpointType type)
+{
+	if (!m_state->GetAdapter())
+		return false;
+
+	ModuleNameAndOffset address = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	return AddOffset(address, size, type);
+}
+
+
+bool DebuggerWatchpoints::AddOffset(const ModuleNameAndOffset& address, size_t size, DebugWatchpointType type)
+{
+	// Module bases are page-aligned, so the offset is aligned whenever the absolute address is
+	if (!IsValid(address.offset, size, type))
+		return false;
+
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		if (Find(address) != m_watchpoints.end())
+			return false;
+
+		// Unlike a breakpoint, a watchpoint that the adapter rejects is not kept, since the hardware most likely
+		// cannot support it, e.g., it runs out of debug registers
+		if (m_state->GetAdapter() && m_state->IsConnected())
+		{
+			uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(address);
+			if (!m_state->GetAdapter()->AddWatchpoint(remoteAddress, size, type))
+				return false;
+		}
+
+		m_watchpoints.push_back({address, size, type});
+	}
+
+	SerializeMetadata();
+	return true;
+}
+
+
+bool DebuggerWatchpoints::RemoveAbsolute(uint64_t remoteAddress)
+{
+	if (!m_state->GetAdapter())
+		return false;
+
+	ModuleNameAndOffset address = m_state->GetModules()->AbsoluteAddressToRelative(remoteAddress);
+	return RemoveOffset(address);
+}
+
+
+bool DebuggerWatchpoints::RemoveOffset(const ModuleNameAndOffset& address)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		auto iter = Find(address);
+		if (iter == m_watchpoints.end())
+			return false;
+
+		m_watchpoints.erase(iter);
+		if (m_state->GetAdapter() && m_state->IsConnected())
+		{
+			uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(address);
+			m_state->GetAdapter()->RemoveWatchpoint(remoteAddress);
+		}
+	}
+
+	SerializeMetadata();
+	return true;
+}
+
+
+std::vector<DebuggerWatchpoint> DebuggerWatchpoints::GetWatchpointList() const
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_watchpoints;
+}
+
+
+void DebuggerWatchpoints::Apply()
+{
+	if (!m_state->GetAdapter())
+		return;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (const DebuggerWatchpoint& watchpoint : m_watchpoints)
+	{
+		uint64_t remoteAddress = m_state->GetModules()->RelativeAddressToAbsolute(watchpoint.address);
+		if (!m_state->GetAdapter()->AddWatchpoint(remoteAddress, watchpoint.size, watchpoint.type))
+			LogWarn("Failed to apply the watchpoint at 0x%" PRIx64, remoteAddress);
+	}
+}
+
+
+void DebuggerWatchpoints::SerializeMetadata()
+{
+	std::vector<Ref<Metadata>> watchpoints;
+	for (const DebuggerWatchpoint& watchpoint : GetWatchpointList())
+	{
+		std::map<std::string, Ref<Metadata>> info;
+		info["module"] = new Metadata(watchpoint.address.module);
+		info["offset"] = new Metadata(watchpoint.address.offset);
+		info["size"] = new Metadata((uint64_t)watchpoint.size);
+		info["type"] = new Metadata((uint64_t)watchpoint.type);
+		watchpoints.push_back(new Metadata(info));
+	}
+	m_state->GetController()->GetData()->StoreMetadata("debugger.watchpoints", new Metadata(watchpoints));
+}
+
+
+void DebuggerWatchpoints::UnserializedMetadata()
+{
+	Ref<Metadata> metadata = m_state->GetController()->GetData()->QueryMetadata("debugger.watchpoints");
+	if (!metadata || (!metadata->IsArray()))
+		return;
+
+	std::vector<DebuggerWatchpoint> watchpoints;
+	for (auto& element : metadata->GetArray())
+	{
+		if (!element || (!element->IsKeyValueStore()))
+			continue;
+
+		std::map<std::string, Ref<Metadata>> info = element->GetKeyValueStore();
+		if (!(info["module"] && info["module"]->IsString()) || !(info["offset"] && info["offset"]->IsUnsignedInteger())
+			|| !(info["size"] && info["size"]->IsUnsignedInteger())
+			|| !(info["type"] && info["type"]->IsUnsignedInteger()))
+			continue;
+
+		DebuggerWatchpoint watchpoint;
+		watchpoint.address = ModuleNameAndOffset(info["module"]->GetString(), info["offset"]->GetUnsignedInteger());
+		watchpoint.size = info["size"]->GetUnsignedInteger();
+		watchpoint.type = (DebugWatchpointType)info["type"]->GetUnsignedInteger();
+		if (!IsValid(watchpoint.address.offset, watchpoint.size, watchpoint.type))
+			continue;
+
+		watchpoints.push_back(watchpoint);
+	}
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_watchpoints = std::move(watchpoints);
+}
+
+
+DebuggerMemory::DebuggerMemory(DebuggerState* state) : m_state(state)
+{
+	LoadSettings();
+}
+
+
+DebuggerMemory::~DebuggerMemory()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_prefetchMutex);
+		m_prefetchThreadExit = true;
+	}
+	m_prefetchCv.notify_all();
+	if (m_prefetchThread.joinable())
+		m_prefetchThread.join();
+}
+
+
+void DebuggerMemory::LoadSettings()
+{
+	Ref<Settings> settings = Settings::Instance();
+	m_prefetchLimit = settings->Get<uint64_t>("debugger.memoryPrefetchLimit");
+	m_backgroundPrefetch = settings->Get<bool>("debugger.memoryPrefetchInBackground");
+	m_retainStablePages = !settings->Get<bool>("debugger.aggressiveAnalysisUpdate");
+}
+
+
+// A page is stable if it is fully covered by a non-writable segment of the input binary. The target cannot change its
+// content, so it remains valid across stops. Writes from the debugger itself invalidate it explicitly.
+bool DebuggerMemory::IsPageStable(uint64_t page)
+{
+	DebuggerController* controller = m_state->GetController();
+	if (!controller)
+		return false;
+
+	BinaryViewRef data = controller->GetData();
+	if (!data)
+		return false;
+
+	// The segments are only meaningful after the input view is rebased to the address where the module is loaded
+	uint64_t remoteBase;
+	if (!m_state->GetRemoteBase(remoteBase) || (remoteBase != data->GetStart()))
+		return false;
+
+	Ref<Segment> segment = data->GetSegmentAt(page);
+	if (!segment)
+		return false;
+
+	if ((segment->GetStart() > page) || (segment->GetEnd() < page + PageSize))
+		return false;
+
+	uint32_t flags = segment->GetFlags();
+	if (flags & SegmentWritable)
 		return false;
 
-	// We need to convert every ModuleAndOffset to absolute address and compare with the input address
-	// Because every ModuleAndOffset can be converted to an absolute address, but there is no guarantee that it works
-	// backward
-	// Well, that is because lldb does not report the size of the loaded libraries, so it is currently screwed up
-	for (const ModuleNameAndOffset& breakpoint : m_breakpoints)
+	return (flags & (SegmentReadable | SegmentExecutable)) != 0;
+}
+
+
+void DebuggerMemory::MarkDirty()
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	LoadSettings();
+	for (auto it = m_pageCache.begin(); it != m_pageCache.end();)
+	{
+		if (it->second.stable && m_retainStablePages)
+			it++;
+		else
+			it = m_pageCache.erase(it);
+	}
+	m_statistics.retainedPages = m_pageCache.size();
+	// The memory map of the target can change while it is running, so previously unreadable pages must be retried
+	m_errorCache.clear();
+	// The target may have mapped, unmapped or protected memory while it ran, e.g., committed reserved memory, so the
+	// map is fetched again the first time it is needed
+	m_regionsValid = false;
+	ResetAccessPattern();
+	m_generation++;
+}
+
+
+void DebuggerMemory::Clear()
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	m_pageCache.clear();
+	m_errorCache.clear();
+	m_regions.clear();
+	m_regionsValid = false;
+	m_statistics.retainedPages = 0;
+	ResetAccessPattern();
+	m_generation++;
+}
+
+
+void DebuggerMemory::InvalidateRangeInternal(uint64_t address, size_t size)
+{
+	if (size == 0)
+		return;
+
+	uint64_t start = address & ~(PageSize - 1);
+	uint64_t end = address + size;
+	m_pageCache.erase(m_pageCache.lower_bound(start), m_pageCache.lower_bound(end));
+	m_errorCache.erase(m_errorCache.lower_bound(start), m_errorCache.lower_bound(end));
+	m_generation++;
+}
+
+
+void DebuggerMemory::InvalidateRange(uint64_t address, size_t size)
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	InvalidateRangeInternal(address, size);
+}
+
+
+void DebuggerMemory::MarkRegionsDirty()
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	m_regionsValid = false;
+}
+
+
+void DebuggerMemory::UpdateRegions()
+{
+	m_regions.clear();
+
+	DebugAdapter* adapter = m_state->GetAdapter();
+	if (adapter && m_state->IsConnected())
+		m_regions = adapter->GetMemoryRegions();
+	// An empty map is not cached, since the adapter also returns one when it cannot query the target at the moment
+	m_regionsValid = !m_regions.empty();
+}
+
+
+const DebugMemoryRegion* DebuggerMemory::FindRegion(uint64_t address) const
+{
+	auto iter = std::upper_bound(m_regions.begin(), m_regions.end(), address,
+		[](uint64_t value, const DebugMemoryRegion& region) { return value < region.m_start; });
+	if (iter == m_regions.begin())
+		return nullptr;
+
+	iter--;
+	if (address >= iter->m_end)
+		return nullptr;
+
+	return &*iter;
+}
+
+
+// Whether the memory map allows reading the page. The map is fetched once per stop, and then answers without a round
+// trip to the backend.
+bool DebuggerMemory::IsPageReadable(uint64_t page)
+{
+	if (!m_regionsValid)
+		UpdateRegions();
+
+	// The adapter does not know the memory map
+	if (m_regions.empty())
+		return true;
+
+	const DebugMemoryRegion* region = FindRegion(page);
+	return region && region->m_readable;
+}
+
+
+std::vector<DebugMemoryRegion> DebuggerMemory::GetMemoryRegions()
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	if (!m_regionsValid)
+		UpdateRegions();
+	return m_regions;
+}
+
+
+// Add the pages covering [offset, offset + len) that are not in the cache to `missing`. Stops at the first page that
+// is known to be unreadable, since a read never returns anything past it.
+void DebuggerMemory::CollectMissingPages(uint64_t offset, size_t len, std::set<uint64_t>& missing)
+{
+	uint64_t cacheStart = offset & ~(PageSize - 1);
+	uint64_t cacheEnd = (offset + len + PageSize - 1) & ~(PageSize - 1);
+	for (uint64_t page = cacheStart; page < cacheEnd; page += PageSize)
+	{
+		if (m_errorCache.find(page) != m_errorCache.end())
+			return;
+
+		auto iter = m_pageCache.find(page);
+		if ((iter == m_pageCache.end()) && !IsPageReadable(page))
+		{
+			m_statistics.unmappedReads++;
+			return;
+		}
+
+		if (iter != m_pageCache.end())
+		{
+			m_statistics.hits++;
+			if (iter->second.prefetched)
+			{
+				m_statistics.prefetchHits++;
+				iter->second.prefetched = false;
+			}
+		}
+		else if (missing.insert(page).second)
+		{
+			m_statistics.misses++;
+		}
+	}
+}
+
+
+// Merge runs of adjacent pages, so each run is a single read on the backend
+static std::vector<DebugMemoryRange> GetPageRuns(const std::set<uint64_t>& pages)
+{
+	std::vector<DebugMemoryRange> runs;
+	for (uint64_t page : pages)
+	{
+		if (!runs.empty() && (runs.back().m_address + runs.back().m_size == page))
+			runs.back().m_size += DebuggerMemory::PageSize;
+		else
+			runs.emplace_back(page, DebuggerMemory::PageSize);
+	}
+	return runs;
+}
+
+
+// Does not need m_memoryMutex, so a read does not block the readers of cached pages
+std::vector<DataBuffer> DebuggerMemory::ReadRuns(const std::vector<DebugMemoryRange>& runs)
+{
+	DebugAdapter* adapter = m_state->GetAdapter();
+	if (!adapter || runs.empty())
+		return {};
+
+	// The adapters cannot serve reads from two threads at the same time
+	std::unique_lock<std::mutex> lock(m_adapterReadMutex);
+	return adapter->ReadMemoryBatch(runs);
+}
+
+
+// Expects m_memoryMutex to be held. The pages that are not in `pages` are read ahead of time. A page that is cached in
+// the meantime is kept as it is.
+void DebuggerMemory::StorePages(
+	const std::vector<DebugMemoryRange>& runs, const std::vector<DataBuffer>& buffers, const std::set<uint64_t>& pages)
+{
+	m_statistics.adapterReads += runs.size();
+	for (size_t i = 0; i < runs.size(); i++)
+	{
+		const DataBuffer& buffer = i < buffers.size() ? buffers[i] : DataBuffer();
+		for (uint64_t offset = 0; offset < runs[i].m_size; offset += PageSize)
+		{
+			uint64_t page = runs[i].m_address + offset;
+			if (offset >= buffer.GetLength())
+			{
+				// The read stopped before this page, so it is not readable. The pages after it are left alone; they
+				// will be read again if anyone asks for them.
+				if (m_pageCache.find(page) == m_pageCache.end())
+					m_errorCache.insert(page);
+				break;
+			}
+
+			CachedPage cachedPage;
+			cachedPage.data = buffer.GetSlice(offset, std::min<uint64_t>(PageSize, buffer.GetLength() - offset));
+			cachedPage.stable = IsPageStable(page);
+			cachedPage.prefetched = (pages.find(page) == pages.end());
+			if (m_pageCache.emplace(page, cachedPage).second && cachedPage.prefetched)
+				m_statistics.prefetchedPages++;
+		}
+	}
+}
+
+
+// Read `pages` and `prefetch` from the adapter. The pages in `prefetch` are only read ahead of time, so failing to
+// read them must not affect the ones that were actually requested.
+void DebuggerMemory::FetchPages(const std::set<uint64_t>& pages, const std::set<uint64_t>& prefetch)
+{
+	if ((pages.empty() && prefetch.empty()) || !m_state->GetAdapter())
+		return;
+
+	std::set<uint64_t> allPages = pages;
+	allPages.insert(prefetch.begin(), prefetch.end());
+	std::vector<DebugMemoryRange> runs = GetPageRuns(allPages);
+	StorePages(runs, ReadRuns(runs), pages);
+
+	// A run stops at its first unreadable page, but the pages after it can still be readable, e.g., when the run
+	// merges adjacent pages of different ranges of a batch, or has an unreadable prefetched page in front of a
+	// requested one. Read the requested pages that got lost this way again, without the prefetched ones. Every round
+	// caches or rejects the first page of each run, so this ends.
+	std::set<uint64_t> retry;
+	for (uint64_t page : pages)
+	{
+		if ((m_pageCache.find(page) == m_pageCache.end()) && (m_errorCache.find(page) == m_errorCache.end()))
+			retry.insert(page);
+	}
+	if (!retry.empty())
+		FetchPages(retry);
+}
+
+
+void DebuggerMemory::ResetAccessPattern()
+{
+	m_lastAccessPage = 0;
+	m_lastStride = 0;
+	m_strideConfidence = 0;
+	m_stackPointer = 0;
+	m_stackPrefetched = false;
+
+	std::unique_lock<std::mutex> lock(m_prefetchMutex);
+	m_prefetchQueue.clear();
+}
+
+
+// Guess which pages will be read next, given that [offset, offset + len) is being read now. Three patterns are
+// recognized:
+//   1. sequential access, e.g., scrolling the linear view or the hex view, in either direction;
+//   2. strided access, i.e., the start of the reads moves by the same distance every time;
+//   3. access to the stack, which is read around the stack pointer by the stack widget, the register hints and the
+//      stack variable annotation.
+// The number of pages read ahead grows as the same pattern keeps repeating, up to m_prefetchLimit.
+std::set<uint64_t> DebuggerMemory::PredictNextPages(uint64_t offset, size_t len)
+{
+	std::set<uint64_t> result;
+	if ((m_prefetchLimit == 0) || (len == 0))
+		return result;
+
+	uint64_t firstPage = offset & ~(PageSize - 1);
+	uint64_t lastPage = (offset + len - 1) & ~(PageSize - 1);
+
+	if (!m_stackPrefetched)
 	{
-		uint64_t absolute = m_state->GetModules()->RelativeAddressToAbsolute(breakpoint);
-		if (absolute == address)
-			return true;
+		if (m_stackPointer == 0)
+			m_stackPointer = m_state->StackPointer();
+
+		uint64_t stackPage = m_stackPointer & ~(PageSize - 1);
+		if ((m_stackPointer != 0) && (firstPage + PageSize >= stackPage) && (firstPage <= stackPage + PageSize))
+		{
+			// The stack grows down, so the frames of the callers are above the stack pointer
+			m_stackPrefetched = true;
+			for (uint64_t page = stackPage - PageSize; result.size() < m_prefetchLimit; page += PageSize)
+				result.insert(page);
+			return result;
+		}
 	}
-	return false;
+
+	// Reads within the same page tell nothing new about the pattern
+	if (firstPage == m_lastAccessPage)
+		return result;
+
+	const int64_t maxStride = 64 * PageSize;
+	int64_t stride = (int64_t)(firstPage - m_lastAccessPage);
+	m_lastAccessPage = firstPage;
+	if ((stride > maxStride) || (stride < -maxStride))
+	{
+		m_lastStride = 0;
+		m_strideConfidence = 0;
+		return result;
+	}
+
+	if (stride == m_lastStride)
+	{
+		m_strideConfidence++;
+	}
+	else
+	{
+		m_lastStride = stride;
+		m_strideConfidence = 1;
+	}
+
+	// A sequential read is trusted right away. An arbitrary stride has to be seen twice in a row.
+	bool sequential = (stride == (int64_t)PageSize) || (stride == -(int64_t)PageSize);
+	if (!sequential && (m_strideConfidence < 2))
+		return result;
+
+	size_t depth = (size_t)1 << std::min<size_t>(m_strideConfidence, 16);
+	uint64_t span = lastPage - firstPage;
+	for (size_t i = 1; (i <= depth) && (result.size() < m_prefetchLimit); i++)
+	{
+		uint64_t nextStart = firstPage + stride * (int64_t)i;
+		for (uint64_t page = nextStart; (page <= nextStart + span) && (result.size() < m_prefetchLimit);
+			 page += PageSize)
+			result.insert(page);
+	}
+	return result;
 }
 
 
-void DebuggerBreakpoints::SerializeMetadata()
+void DebuggerMemory::SchedulePrefetch(const std::set<uint64_t>& pages)
 {
-	// TODO: who should free these Metadata objects?
-	std::vector<Ref<Metadata>> breakpoints;
-	for (const ModuleNameAndOffset& bp : m_breakpoints)
+	if (pages.empty())
+		return;
+
 	{
-		std::map<std::string, Ref<Metadata>> info;
-		info["module"] = new Metadata(bp.module);
-		info["offset"] = new Metadata(bp.offset);
-		breakpoints.push_back(new Metadata(info));
+		std::unique_lock<std::mutex> lock(m_prefetchMutex);
+		m_prefetchQueue.insert(pages.begin(), pages.end());
+		if (!m_prefetchThread.joinable())
+			m_prefetchThread = std::thread([this]() { PrefetchWorker(); });
 	}
-	m_state->GetController()->GetData()->StoreMetadata("debugger.breakpoints", new Metadata(breakpoints));
+	m_prefetchCv.notify_one();
 }
 
 
-void DebuggerBreakpoints::UnserializedMetadata()
+void DebuggerMemory::SuspendPrefetch()
 {
-	Ref<Metadata> metadata = m_state->GetController()->GetData()->QueryMetadata("debugger.breakpoints");
-	if (!metadata || (!metadata->IsArray()))
-		return;
+	{
+		std::unique_lock<std::mutex> lock(m_prefetchMutex);
+		m_prefetchQueue.clear();
+	}
 
-	vector<Ref<Metadata>> array = metadata->GetArray();
-	std::vector<ModuleNameAndOffset> newBreakpoints;
+	// Waits for the read in progress
+	std::unique_lock<std::mutex> lock(m_adapterReadMutex);
+	m_prefetchSuspended = true;
+}
 
-	for (auto& element : array)
+
+void DebuggerMemory::ResumePrefetch()
+{
+	std::unique_lock<std::mutex> lock(m_adapterReadMutex);
+	m_prefetchSuspended = false;
+}
+
+
+void DebuggerMemory::PrefetchWorker()
+{
+	while (true)
 	{
-		if (!element || (!element->IsKeyValueStore()))
-			continue;
+		std::set<uint64_t> pages;
+		{
+			std::unique_lock<std::mutex> lock(m_prefetchMutex);
+			m_prefetchCv.wait(lock, [this]() { return m_prefetchThreadExit || !m_prefetchQueue.empty(); });
+			if (m_prefetchThreadExit)
+				return;
+			pages.swap(m_prefetchQueue);
+		}
 
-		std::map<std::string, Ref<Metadata>> info = element->GetKeyValueStore();
-		ModuleNameAndOffset address;
+		std::vector<DebugMemoryRange> runs;
+		uint64_t generation = 0;
+		{
+			std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+			if (!m_state->IsConnected() || m_state->IsRunning())
+				continue;
 
-		if (!(info["module"] && info["module"]->IsString()))
+			std::set<uint64_t> missing;
+			for (uint64_t page : pages)
+			{
+				if ((m_pageCache.find(page) == m_pageCache.end()) && (m_errorCache.find(page) == m_errorCache.end())
+					&& IsPageReadable(page))
+					missing.insert(page);
+			}
+			runs = GetPageRuns(missing);
+			generation = m_generation;
+		}
+		if (runs.empty())
 			continue;
 
-		address.module = info["module"]->GetString();
+		// The memory lock is not held during the read, so the readers of cached pages do not wait for it. The target
+		// can be resumed once the pages are picked, so the adapter read lock tells whether it is still stopped.
+		std::vector<DataBuffer> buffers;
+		{
+			std::unique_lock<std::mutex> lock(m_adapterReadMutex);
+			DebugAdapter* adapter = m_state->GetAdapter();
+			if (m_prefetchSuspended || !adapter)
+				continue;
+			buffers = adapter->ReadMemoryBatch(runs);
+		}
 
-		if (!(info["offset"] && info["offset"]->IsUnsignedInteger()))
+		// The target may have resumed, or the pages may have been dropped or written, while they were being read
+		std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+		if ((m_generation != generation) || !m_state->IsConnected() || m_state->IsRunning())
 			continue;
+		StorePages(runs, buffers, {});
+	}
+}
 
-		address.offset = info["offset"]->GetUnsignedInteger();
-		newBreakpoints.push_back(address);
+
+// Assemble [offset, offset + len) from the cached pages. The result is truncated at the first page that is missing or
+// only partially readable.
+DataBuffer DebuggerMemory::ReadFromCache(uint64_t offset, size_t len)
+{
+	DataBuffer result;
+	uint64_t cacheStart = offset & ~(PageSize - 1);
+	uint64_t cacheEnd = (offset + len + PageSize - 1) & ~(PageSize - 1);
+	for (uint64_t page = cacheStart; page < cacheEnd; page += PageSize)
+	{
+		auto iter = m_pageCache.find(page);
+		if (iter == m_pageCache.end())
+			return result;
+
+		const DataBuffer& cached = iter->second.data;
+		uint64_t sliceStart = (offset > page) ? offset - page : 0;
+		uint64_t sliceEnd = std::min<uint64_t>(offset + len - page, cached.GetLength());
+		if (sliceEnd <= sliceStart)
+			return result;
+
+		result.Append(cached.GetSlice(sliceStart, sliceEnd - sliceStart));
+		// The backend returned a partial page, the rest of the range is not readable
+		if (sliceEnd < std::min<uint64_t>(offset + len - page, PageSize))
+			return result;
 	}
+	return result;
+}
 
-	m_breakpoints = newBreakpoints;
+
+DataBuffer DebuggerMemory::ReadMemory(uint64_t offset, size_t len)
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+
+	// The cache works on pages, which is also the granularity at which the target's memory is mapped and protected.
+	std::set<uint64_t> missing;
+	CollectMissingPages(offset, len, missing);
+
+	std::set<uint64_t> prefetch;
+	for (uint64_t page : PredictNextPages(offset, len))
+	{
+		if ((missing.find(page) == missing.end()) && (m_pageCache.find(page) == m_pageCache.end())
+			&& (m_errorCache.find(page) == m_errorCache.end()) && IsPageReadable(page))
+			prefetch.insert(page);
+	}
+
+	if (m_backgroundPrefetch)
+	{
+		FetchPages(missing);
+		SchedulePrefetch(prefetch);
+	}
+	else
+	{
+		// Read ahead in the same batch as the missing pages, which often merges them into the same backend read
+		FetchPages(missing, prefetch);
+	}
+
+	return ReadFromCache(offset, len);
 }
 
 
-void DebuggerBreakpoints::Apply()
+std::vector<DataBuffer> DebuggerMemory::ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges)
 {
-	if (!m_state->GetAdapter())
-		return;
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
 
-	for (const ModuleNameAndOffset& address : m_breakpoints)
-		m_state->GetAdapter()->AddBreakpoint(address);
+	std::set<uint64_t> missing;
+	for (const auto& range : ranges)
+		CollectMissingPages(range.m_address, range.m_size, missing);
+	FetchPages(missing);
+
+	std::vector<DataBuffer> result;
+	result.reserve(ranges.size());
+	for (const auto& range : ranges)
+		result.push_back(ReadFromCache(range.m_address, range.m_size));
+	return result;
 }
 
 
-DebuggerMemory::DebuggerMemory(DebuggerState* state) : m_state(state) {}
+// Like ReadRuns, the memory lock is not held during the read, so a large read does not block the cached ones
+DataBuffer DebuggerMemory::ReadUncached(uint64_t offset, size_t len)
+{
+	DebugAdapter* adapter = m_state->GetAdapter();
+	if (!adapter)
+		return {};
 
+	{
+		std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+		m_statistics.adapterReads++;
+	}
 
-void DebuggerMemory::MarkDirty()
+	std::unique_lock<std::mutex> lock(m_adapterReadMutex);
+	return adapter->ReadMemory(offset, len);
+}
+
+
+bool DebuggerMemory::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
 {
 	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
-	m_valueCache.clear();
-	m_errorCache.clear();
+
+	DebugAdapter* adapter = m_state->GetAdapter();
+	if (!adapter)
+		return false;
+
+	{
+		std::unique_lock<std::mutex> lock(m_adapterReadMutex);
+		if (!adapter->WriteMemory(address, buffer))
+			return false;
+	}
+
+	InvalidateRangeInternal(address, buffer.GetLength());
+	return true;
 }
 
 
-DataBuffer DebuggerMemory::ReadMemory(uint64_t offset, size_t len)
+DebuggerMemoryCacheStatistics DebuggerMemory::GetStatistics()
+{
+	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	DebuggerMemoryCacheStatistics result = m_statistics;
+	result.cachedPages = m_pageCache.size();
+	return result;
+}
+
+
+void DebuggerMemory::ResetStatistics()
 {
 	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	m_statistics = DebuggerMemoryCacheStatistics {};
+}
 
-	DataBuffer result;
 
-	// ProcessView implements read caching in a manner inspired by CPU cache:
-	// Reads are aligned on 256-byte boundaries and 256 bytes long
+DebuggerOutput::DebuggerOutput(DebuggerState* state) : m_state(state)
+{
+	LoadSettings();
+}
+
+
+DebuggerOutput::~DebuggerOutput()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		m_flushThreadExit = true;
+	}
+	m_flushCv.notify_all();
+	if (m_flushThread.joinable())
+		m_flushThread.join();
+
+	for (Stream& stream : m_streams)
+		ResetStream(stream);
+}
+
+
+void DebuggerOutput::LoadSettings()
+{
+	Ref<Settings> settings = Settings::Instance();
+	m_capacity = std::max<size_t>(settings->Get<uint64_t>("debugger.outputBufferSize"), 0x1000);
+	m_flushSize = std::max<size_t>(settings->Get<uint64_t>("debugger.outputFlushSize"), 1);
+	m_flushInterval = std::chrono::milliseconds(settings->Get<uint64_t>("debugger.outputFlushInterval"));
+
+	// The writer is the listener thread of the adapter, which must never wait for the output to be read
+	std::string policy = settings->Get<std::string>("debugger.outputOverflowPolicy");
+	m_policy = (policy == "spill") ? SpillOverflow : DropOverflow;
+	m_spillLimit = std::max<uint64_t>(settings->Get<uint64_t>("debugger.outputSpillLimit"), 0x1000);
+}
+
+
+// The spilled output can exceed 2 GB, which a long offset cannot address on every platform
+static bool SeekFile(FILE* file, uint64_t offset)
+{
+#ifdef WIN32
+	return _fseeki64(file, (int64_t)offset, SEEK_SET) == 0;
+#else
+	return fseeko(file, (off_t)offset, SEEK_SET) == 0;
+#endif
+}
+
+
+void DebuggerOutput::ResetStream(Stream& stream)
+{
+	if (stream.spill)
+		fclose(stream.spill);
+
+	stream = Stream();
+}
+
+
+void DebuggerOutput::Append(Stream& stream, const char* data, size_t length)
+{
+	if (stream.buffer.empty())
+		stream.buffer.resize(m_capacity);
+
+	if ((m_policy == DropOverflow) && (length > stream.buffer.size()))
+	{
+		// Only the newest part of the output can survive anyway
+		stream.dropped += length - stream.buffer.size();
+		data += length - stream.buffer.size();
+		length = stream.buffer.size();
+	}
 
-	// Cache read start: round down addr to nearest 256 byte boundary
-	size_t cacheStart = offset & (~0xffLL);
-	// Cache read end: round up addr+length to nearest 256 byte boundary
-	size_t cacheEnd = (offset + len + 0xFF) & (~0xffLL);
-	// List of 256-byte block addresses to read into the cache to fully cover this region
-	for (uint64_t block = cacheStart; block < cacheEnd; block += 0x100)
+	size_t capacity = stream.buffer.size();
+	while (length > 0)
 	{
-		// If any block cannot be read, then return false
-		if (m_errorCache.find(block) != m_errorCache.end())
+		// Once something is spilled, everything after it goes to the file as well, until the file is read
+		if (stream.spill && (stream.spillWritten > stream.spillRead || stream.size == capacity))
 		{
-			return result;
+			// The file only shrinks once everything in it has been read, so nothing else bounds it
+			size_t room = (size_t)std::min<uint64_t>(length, m_spillLimit - std::min(m_spillLimit, stream.spillWritten));
+			if ((room < length) && !stream.spillFull)
+			{
+				LogWarn("The target output exceeds the spill limit of %" PRIu64
+						" bytes, the rest is dropped until it is read",
+					m_spillLimit);
+				stream.spillFull = true;
+			}
+
+			size_t written = 0;
+			if ((room > 0) && SeekFile(stream.spill, stream.spillWritten))
+				written = fwrite(data, 1, room, stream.spill);
+			stream.spillWritten += written;
+			stream.dropped += length - written;
+			return;
 		}
 
-		auto iter = m_valueCache.find(block);
-		if (iter == m_valueCache.end())
+		if (stream.size == capacity)
 		{
-			// The ReadMemory() function should return the number of bytes read
-			DataBuffer buffer = m_state->GetAdapter()->ReadMemory(block, 0x100);
-			// TODO: what if the buffer's size is smaller than 0x100
-			if (buffer.GetLength() > 0)
+			switch (m_policy)
 			{
-				m_valueCache[block] = buffer;
-			}
-			else
+			case SpillOverflow:
+				stream.spill = tmpfile();
+				if (!stream.spill)
+				{
+					LogWarn("Failed to create a temporary file for the target output, the output is dropped");
+					stream.dropped += length;
+					return;
+				}
+				break;
+			case DropOverflow:
+			default:
 			{
-				m_errorCache.insert(block);
-				return result;
+				size_t discard = std::min(length, capacity);
+				stream.head = (stream.head + discard) % capacity;
+				stream.size -= discard;
+				stream.dropped += discard;
+				break;
 			}
+			}
+			continue;
 		}
 
-		DataBuffer cached = m_valueCache[block];
-		if (offset + len < block + cached.GetLength())
-		{
-			// Last block
-			cached = cached.GetSlice(0, offset + len - block);
-		}
-		// Note a block can be both the fist and the last block, so we should not put an else here
-		if (offset > block)
+		size_t count = std::min(capacity - stream.size, length);
+		size_t tail = (stream.head + stream.size) % capacity;
+		size_t first = std::min(count, capacity - tail);
+		memcpy(stream.buffer.data() + tail, data, first);
+		memcpy(stream.buffer.data(), data + first, count - first);
+		stream.size += count;
+		data += count;
+		length -= count;
+	}
+}
+
+
+void DebuggerOutput::Write(DebuggerOutputStream stream, const std::string& data)
+{
+	if (data.empty() || (stream > StderrOutputStream))
+		return;
+
+	bool flushNow = false;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Append(m_streams[stream], data.data(), data.size());
+
+		// The batches are only for display, and Read() still has everything the policy keeps
+		m_pending += data;
+		if (m_pending.size() > m_capacity)
+			m_pending.erase(0, m_pending.size() - m_capacity);
+
+		flushNow = m_pending.size() >= m_flushSize;
+		if (!flushNow && !m_flushThread.joinable())
+			m_flushThread = std::thread([this]() { FlushWorker(); });
+	}
+
+	if (flushNow)
+		Flush();
+	else
+		m_flushCv.notify_all();
+}
+
+
+std::string DebuggerOutput::Read(DebuggerOutputStream streamType, size_t maxLength)
+{
+	if (streamType > StderrOutputStream)
+		return "";
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Stream& stream = m_streams[streamType];
+	size_t available = stream.size + (size_t)(stream.spillWritten - stream.spillRead);
+	size_t count = maxLength ? std::min(maxLength, available) : available;
+
+	std::string result;
+	result.reserve(count);
+
+	size_t fromBuffer = std::min(count, stream.size);
+	if (fromBuffer > 0)
+	{
+		size_t capacity = stream.buffer.size();
+		size_t first = std::min(fromBuffer, capacity - stream.head);
+		result.append(stream.buffer.data() + stream.head, first);
+		result.append(stream.buffer.data(), fromBuffer - first);
+		stream.head = (stream.head + fromBuffer) % capacity;
+		stream.size -= fromBuffer;
+	}
+
+	if ((count > fromBuffer) && stream.spill)
+	{
+		size_t fromFile = count - fromBuffer;
+		std::vector<char> buffer(fromFile);
+		size_t read = 0;
+		if (SeekFile(stream.spill, stream.spillRead))
+			read = fread(buffer.data(), 1, fromFile, stream.spill);
+		result.append(buffer.data(), read);
+		stream.spillRead += read;
+		// The file is reused from the start once everything in it has been read
+		if ((read < fromFile) || (stream.spillRead == stream.spillWritten))
 		{
-			// First block
-			cached = cached.GetSlice(offset - block, cached.GetLength() - (offset - block));
+			stream.spillRead = 0;
+			stream.spillWritten = 0;
+			stream.spillFull = false;
 		}
-		result.Append(cached);
 	}
+
 	return result;
 }
 
 
-bool DebuggerMemory::WriteMemory(std::uintptr_t address, const DataBuffer& buffer)
+size_t DebuggerOutput::GetAvailable(DebuggerOutputStream streamType)
 {
-	std::unique_lock<std::recursive_mutex> memoryLock(m_memoryMutex);
+	if (streamType > StderrOutputStream)
+		return 0;
 
-	DebugAdapter* adapter = m_state->GetAdapter();
-	if (!adapter)
-		return false;
+	std::unique_lock<std::mutex> lock(m_mutex);
+	const Stream& stream = m_streams[streamType];
+	return stream.size + (size_t)(stream.spillWritten - stream.spillRead);
+}
 
-	if (!adapter->WriteMemory(address, buffer))
-		return false;
 
-	//	TODO: Assume any memory change invalidates memory cache (suboptimal, may not be necessary)
-	MarkDirty();
-	return true;
+uint64_t DebuggerOutput::GetDropped(DebuggerOutputStream streamType)
+{
+	if (streamType > StderrOutputStream)
+		return 0;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	return m_streams[streamType].dropped;
+}
+
+
+void DebuggerOutput::Flush()
+{
+	std::unique_lock<std::mutex> flushLock(m_flushMutex);
+	std::string output;
+	{
+		std::unique_lock<std::mutex> lock(m_mutex);
+		output.swap(m_pending);
+	}
+
+	if (output.empty())
+		return;
+
+	// stdout and stderr are not distinguished in the events, they can be read separately with Read()
+	DebuggerEvent event;
+	event.type = StdoutMessageEventType;
+	event.data.messageData.message = output;
+	m_state->GetController()->PostDebuggerEvent(event);
+}
+
+
+void DebuggerOutput::Close()
+{
+	Flush();
+}
+
+
+void DebuggerOutput::Clear()
+{
+	std::unique_lock<std::mutex> flushLock(m_flushMutex);
+	std::unique_lock<std::mutex> lock(m_mutex);
+	for (Stream& stream : m_streams)
+		ResetStream(stream);
+	m_pending.clear();
+	LoadSettings();
+}
+
+
+void DebuggerOutput::FlushWorker()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	while (!m_flushThreadExit)
+	{
+		if (m_pending.empty())
+		{
+			m_flushCv.wait(lock);
+			continue;
+		}
+
+		// Give the target some time to write more, so that the output is delivered in fewer events
+		m_flushCv.wait_for(lock, m_flushInterval, [this]() { return m_flushThreadExit; });
+		if (m_flushThreadExit)
+			break;
+
+		lock.unlock();
+		Flush();
+		lock.lock();
+	}
 }
 
 
@@ -702,7 +2345,10 @@ DebuggerState::DebuggerState(BinaryViewRef data, DebuggerController* controller)
 	m_threads = new DebuggerThreads(this);
 	m_breakpoints = new DebuggerBreakpoints(this);
 	m_breakpoints->UnserializedMetadata();
+	m_watchpoints = new DebuggerWatchpoints(this);
+	m_watchpoints->UnserializedMetadata();
 	m_memory = new DebuggerMemory(this);
+	m_output = new DebuggerOutput(this);
 
 	// TODO: A better way to deal with this is to have the adapters return a fitness score, and then we pick the highest
 	// one from the list. Similar to what we do for the views.
@@ -790,12 +2436,15 @@ DebuggerState::DebuggerState(BinaryViewRef data, DebuggerController* controller)
 
 DebuggerState::~DebuggerState()
 {
+	// The output and the memory cache may be working on background threads, stop them before the adapter goes away
+	delete m_output;
+	delete m_memory;
 	delete m_adapter;
 	delete m_modules;
 	delete m_registers;
 	delete m_threads;
 	delete m_breakpoints;
-	delete m_memory;
+	delete m_watchpoints;
 }
 
 
@@ -823,6 +2472,30 @@ void DebuggerState::DeleteBreakpoint(const ModuleNameAndOffset& address)
 }
 
 
+size_t DebuggerState::AddBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	return m_breakpoints->AddAbsolutes(addresses);
+}
+
+
+size_t DebuggerState::AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	return m_breakpoints->AddOffsets(addresses);
+}
+
+
+size_t DebuggerState::DeleteBreakpoints(const std::vector<uint64_t>& addresses)
+{
+	return m_breakpoints->RemoveAbsolutes(addresses);
+}
+
+
+size_t DebuggerState::DeleteBreakpoints(const std::vector<ModuleNameAndOffset>& addresses)
+{
+	return m_breakpoints->RemoveOffsets(addresses);
+}
+
+
 uint64_t DebuggerState::IP()
 {
 	if (!IsConnected())
@@ -853,7 +2526,7 @@ bool DebuggerState::SetActiveThread(const DebugThread& thread)
 
 void DebuggerState::MarkDirty()
 {
-	m_registers->MarkDirty();
+	m_registers->MarkResumed();
 	m_threads->MarkDirty();
 	m_modules->MarkDirty();
 	m_memory->MarkDirty();
@@ -16,11 +16,20 @@ limitations under the License.
 
 #pragma once
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <list>
+#include <thread>
+#include <unordered_set>
 #include "binaryninjaapi.h"
 #include "ui/uitypes.h"
 #include "processview.h"
 #include "debugadaptertype.h"
 #include "debuggercommon.h"
+#include "breakpointattributes.h"
+#include "registerschema.h"
 #include "semaphore.h"
 #include "ffi_global.h"
 #include "refcountobject.h"
@@ -33,22 +42,72 @@ namespace BinaryNinjaDebugger {
 	typedef BNDebugAdapterConnectionStatus DebugAdapterConnectionStatus;
 	typedef BNDebugAdapterTargetStatus DebugAdapterTargetStatus;
 
+	// The hints of register values, i.e., what the values point to. Computing a hint reads the memory and looks up the
+	// analysis, so a hint is reused for as long as the memory and the modules of the target do not change. The least
+	// recently used hints are evicted first.
+	class RegisterHintCache
+	{
+		struct Entry
+		{
+			uint64_t value;
+			uint64_t memoryGeneration;
+			uint64_t moduleGeneration;
+			std::string hint;
+		};
+
+		std::mutex m_mutex;
+		size_t m_capacity;
+		// The most recently used entry comes first
+		std::list<Entry> m_entries;
+		std::unordered_map<uint64_t, std::list<Entry>::iterator> m_index;
+
+	public:
+		RegisterHintCache(size_t capacity = 1024) : m_capacity(capacity) {}
+		bool Get(uint64_t value, uint64_t memoryGeneration, uint64_t moduleGeneration, std::string& hint);
+		void Put(uint64_t value, uint64_t memoryGeneration, uint64_t moduleGeneration, const std::string& hint);
+		void Clear();
+	};
+
+
 	class DebuggerRegisters
 	{
 	private:
 		DebuggerState* m_state;
-		std::unordered_map<std::string, DebugRegister> m_registerCache;
-		bool m_dirty;
+		// The values are in the order of the schema, and empty if they are not read yet
+		std::shared_ptr<const RegisterSchema> m_schema;
+		std::vector<uint64_t> m_values;
+		// The values at the previous stop, which tell the registers that changed since then
+		std::shared_ptr<const RegisterSchema> m_previousSchema;
+		std::vector<uint64_t> m_previousValues;
+		std::vector<bool> m_changed;
+		std::atomic<bool> m_dirty;
+		RegisterHintCache m_hints;
+		// The widgets compute the hints on a worker thread, while the controller updates the values
+		std::mutex m_mutex;
+
+		// These expect m_mutex to be held
+		void MarkDirtyLocked();
+		void UpdateLocked();
+		void UpdateIfDirtyLocked();
 
 	public:
 		DebuggerRegisters(DebuggerState* state);
 		// DebugRegister operator[](std::string name);
 		uint64_t GetRegisterValue(const std::string& name);
+		uint64_t GetRegisterValue(size_t index);
+		// RegisterSchema::InvalidIndex if there is no such register
+		size_t GetRegisterIndex(const std::string& name);
+		std::shared_ptr<const RegisterSchema> GetSchema();
+		// Whether each register of the schema changed since the previous stop
+		std::vector<bool> GetChangedRegisters();
 		bool SetRegisterValue(const std::string& name, uint64_t value);
 		void MarkDirty();
+		// The target is about to run, so the current values become the ones of the previous stop
+		void MarkResumed();
 		bool IsDirty() const { return m_dirty; }
 		void Update();
-		std::vector<DebugRegister> GetAllRegisters();
+		// The hints are left empty unless requested, since they are much more expensive than the values
+		std::vector<DebugRegister> GetAllRegisters(bool withHints);
 	};
 
 
@@ -59,11 +118,29 @@ namespace BinaryNinjaDebugger {
 		std::vector<DebugModule> m_modules;
 		bool m_dirty;
 
+		// A module is identified by its base address and its name, since several modules can share a base, e.g., the
+		// ones whose base the adapter cannot find are all at 0
+		using ModuleKey = std::pair<uint64_t, std::string>;
+		// Modules sorted by their base address, for address lookups
+		std::map<ModuleKey, DebugModule> m_modulesByAddress;
+		// Keys of the modules, keyed by the base name of both their full and short names. Module names are compared by
+		// their base name (see DebugModule::IsSameBaseModule), so this is computed once per module here rather than on
+		// every comparison.
+		std::unordered_map<std::string, std::vector<ModuleKey>> m_basesByName;
+		// Bumped whenever a module is loaded or unloaded, so that users of the module bases know when to recompute
+		uint64_t m_generation = 0;
+
+		void AddToIndex(const DebugModule& module);
+		void RemoveFromIndex(const DebugModule& module);
+		void Clear();
+		const DebugModule* FindModuleByName(const std::string& name);
+
 	public:
 		DebuggerModules(DebuggerState* state);
 		void MarkDirty();
 		void Update();
 		bool IsDirty() const { return m_dirty; }
+		uint64_t GetGeneration();
 
 		std::vector<DebugModule> GetAllModules();
 		// TODO: These conversion functions are not very robust for lookup failures. They need to be improved for it.
@@ -79,16 +156,74 @@ namespace BinaryNinjaDebugger {
 	{
 	private:
 		DebuggerState* m_state;
+		// Kept in the order the breakpoints are added, which is the order they are listed in
 		std::vector<ModuleNameAndOffset> m_breakpoints;
 
+		// ModuleNameAndOffset compares the base names of the modules, so the index is keyed by the base name as well
+		using OffsetKey = std::pair<std::string, uint64_t>;
+		struct OffsetKeyHash
+		{
+			size_t operator()(const OffsetKey& key) const
+			{
+				return std::hash<std::string>()(key.first) ^ (std::hash<uint64_t>()(key.second) * 31);
+			}
+		};
+		std::unordered_set<OffsetKey, OffsetKeyHash> m_offsetIndex;
+
+		// Absolute address of every breakpoint, mapped to the number of breakpoints that resolve to it. This depends on
+		// the module bases, so it is rebuilt lazily when the module generation changes.
+		std::unordered_map<uint64_t, size_t> m_addressIndex;
+		bool m_addressIndexValid = false;
+		uint64_t m_addressIndexGeneration = 0;
+
+		// Every breakpoint has attributes, so that its hits are counted
+		std::unordered_map<OffsetKey, std::shared_ptr<const BreakpointAttributes>, OffsetKeyHash> m_attributes;
+		// The attributes keyed by the absolute address. The adapter thread uses them while the target is running, so it
+		// only ever reads an immutable copy, which is swapped atomically when anything changes.
+		using AttributeMap = std::unordered_map<uint64_t, std::shared_ptr<const BreakpointAttributes>>;
+		std::shared_ptr<const AttributeMap> m_attributeSnapshot;
+		bool m_attributeSnapshotDirty = false;
+		size_t m_recordCapacity;
+
+		static OffsetKey GetOffsetKey(const ModuleNameAndOffset& address);
+		bool UpdateAddressIndex();
+		void RebuildAttributeSnapshot();
+		std::shared_ptr<const BreakpointAttributes> NewAttributes() const;
+		bool UpdateAttributes(
+			const ModuleNameAndOffset& address, const std::function<void(BreakpointAttributes&)>& update);
+		void AddToAddressIndex(const ModuleNameAndOffset& address);
+		void RemoveFromAddressIndex(const ModuleNameAndOffset& address);
+		void RebuildIndex();
+		bool InsertOffset(const ModuleNameAndOffset& address);
+		size_t EraseOffsets(const std::unordered_set<OffsetKey, OffsetKeyHash>& keys);
+
 	public:
 		DebuggerBreakpoints(DebuggerState* state, std::vector<ModuleNameAndOffset> initial = {});
 		bool AddAbsolute(uint64_t remoteAddress);
 		bool AddOffset(const ModuleNameAndOffset& address);
 		bool RemoveAbsolute(uint64_t remoteAddress);
 		bool RemoveOffset(const ModuleNameAndOffset& address);
+		// The bulk versions only write the metadata once, and return the number of breakpoints added or removed
+		size_t AddAbsolutes(const std::vector<uint64_t>& remoteAddresses);
+		size_t AddOffsets(const std::vector<ModuleNameAndOffset>& addresses);
+		size_t RemoveAbsolutes(const std::vector<uint64_t>& remoteAddresses);
+		size_t RemoveOffsets(const std::vector<ModuleNameAndOffset>& addresses);
 		bool ContainsAbsolute(uint64_t address);
 		bool ContainsOffset(const ModuleNameAndOffset& address);
+		// An empty condition or log template removes it. They return false if there is no such breakpoint, or the
+		// condition or the template is invalid.
+		bool SetCondition(const ModuleNameAndOffset& address, const std::string& condition);
+		bool SetLogTemplate(const ModuleNameAndOffset& address, const std::string& logTemplate);
+		bool SetTracepoint(const ModuleNameAndOffset& address, bool tracepoint);
+		bool SetIgnoreCount(const ModuleNameAndOffset& address, uint64_t ignoreCount);
+		bool ResetHits(const ModuleNameAndOffset& address);
+		// Returns nullptr if there is no such breakpoint
+		std::shared_ptr<const BreakpointAttributes> GetAttributes(const ModuleNameAndOffset& address) const;
+		// Brings the absolute addresses of the attributes up-to-date with the module bases
+		void UpdateAttributeSnapshot();
+		// Safe to call from any thread. Returns nullptr if there is no breakpoint at the address, or its absolute
+		// address is not known yet.
+		std::shared_ptr<const BreakpointAttributes> GetAttributesAt(uint64_t remoteAddress) const;
 		void Apply();
 		void SerializeMetadata();
 		void UnserializedMetadata();
@@ -96,14 +231,61 @@ namespace BinaryNinjaDebugger {
 	};
 
 
+	struct DebuggerWatchpoint
+	{
+		ModuleNameAndOffset address;
+		size_t size;
+		DebugWatchpointType type;
+	};
+
+
+	// Hardware watchpoints. Unlike breakpoints, they can only be added to a live process, so the ones added before the
+	// launch are applied when the target stops for the first time.
+	class DebuggerWatchpoints
+	{
+	private:
+		DebuggerState* m_state;
+		// The watchpoints are added and removed from the API while the controller applies them after a launch
+		mutable std::mutex m_mutex;
+		std::vector<DebuggerWatchpoint> m_watchpoints;
+
+		static bool IsValid(uint64_t address, size_t size, DebugWatchpointType type);
+		// Expects m_mutex to be held
+		std::vector<DebuggerWatchpoint>::iterator Find(const ModuleNameAndOffset& address);
+
+	public:
+		DebuggerWatchpoints(DebuggerState* state);
+		// There can only be one watchpoint at an address. The size must be 1, 2, 4 or 8, and the address must be
+		// aligned to it. They return false if the watchpoint is invalid, or the adapter fails to add it, e.g., it runs
+		// out of debug registers.
+		bool AddAbsolute(uint64_t remoteAddress, size_t size, DebugWatchpointType type);
+		bool AddOffset(const ModuleNameAndOffset& address, size_t size, DebugWatchpointType type);
+		bool RemoveAbsolute(uint64_t remoteAddress);
+		bool RemoveOffset(const ModuleNameAndOffset& address);
+		void Apply();
+		void SerializeMetadata();
+		void UnserializedMetadata();
+		std::vector<DebuggerWatchpoint> GetWatchpointList() const;
+	};
+
+
 	class DebuggerThreads
 	{
 	private:
 		DebuggerState* m_state;
 		std::vector<DebugThread> m_threads;
-		std::map<uint32_t, std::vector<DebugFrame>> m_frames;
 		bool m_dirty;
 
+		struct ThreadFrames
+		{
+			std::vector<DebugFrame> frames;
+			// False if only the innermost frames have been unwound
+			bool complete = false;
+		};
+		// Stacks are only unwound when someone asks for them, and the result is kept until the target resumes
+		std::unordered_map<uint32_t, ThreadFrames> m_frames;
+		std::mutex m_framesMutex;
+
 	public:
 		DebuggerThreads(DebuggerState* state);
 		void MarkDirty();
@@ -112,25 +294,204 @@ namespace BinaryNinjaDebugger {
 		bool SetActiveThread(const DebugThread& thread);
 		bool IsDirty() const { return m_dirty; }
 		std::vector<DebugThread> GetAllThreads();
-		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid);
+		// If maxFrames is not zero, at most maxFrames innermost frames are returned
+		std::vector<DebugFrame> GetFramesOfThread(uint32_t tid, size_t maxFrames = 0);
 		bool SuspendThread(std::uint32_t tid);
 		bool ResumeThread(std::uint32_t tid);
 	};
 
 
+	struct DebuggerMemoryCacheStatistics
+	{
+		// Number of page lookups that were served from the cache
+		uint64_t hits = 0;
+		// Number of page lookups that had to go to the adapter
+		uint64_t misses = 0;
+		// Number of contiguous spans the cache read from the adapter. Adjacent missing pages are read together.
+		uint64_t adapterReads = 0;
+		// Number of pages that were kept when the cache was marked dirty, i.e., read-only and executable pages
+		uint64_t retainedPages = 0;
+		// Number of pages currently held in the cache
+		uint64_t cachedPages = 0;
+		// Number of pages read ahead of time by the prefetcher
+		uint64_t prefetchedPages = 0;
+		// Number of prefetched pages that were actually requested afterwards
+		uint64_t prefetchHits = 0;
+		// Number of reads rejected without asking the adapter, because the memory map says they are unmapped
+		uint64_t unmappedReads = 0;
+	};
+
+
 	class DebuggerMemory
 	{
+	public:
+		static constexpr uint64_t PageSize = 0x1000;
+
+	private:
+		struct CachedPage
+		{
+			DataBuffer data;
+			// Stable pages are not writable by the target, so their content remains valid after the target resumes.
+			bool stable = false;
+			// Read ahead by the prefetcher and not requested by anyone yet
+			bool prefetched = false;
+		};
+
 		DebuggerState* m_state;
-		std::map<uint64_t, DataBuffer> m_valueCache;
+		std::map<uint64_t, CachedPage> m_pageCache;
 		std::set<uint64_t> m_errorCache;
 		std::recursive_mutex m_memoryMutex;
+		// Serializes the reads and writes of the adapter, which the prefetcher does without m_memoryMutex. It is taken
+		// after m_memoryMutex, never before.
+		std::mutex m_adapterReadMutex;
+		DebuggerMemoryCacheStatistics m_statistics;
+		// Bumped whenever cached memory is dropped, so that what is derived from the memory knows when to recompute
+		std::atomic<uint64_t> m_generation = 0;
+
+		// The memory map, sorted by the start of the regions. It is fetched again at the first use after every stop,
+		// and when a module is loaded.
+		std::vector<DebugMemoryRegion> m_regions;
+		bool m_regionsValid = false;
+
+		// Settings, refreshed every time the target resumes
+		size_t m_prefetchLimit = 0;
+		bool m_backgroundPrefetch = false;
+		// With debugger.aggressiveAnalysisUpdate on, code is expected to be modified at runtime, so no page survives
+		bool m_retainStablePages = true;
+
+		// Access pattern of the recent reads, used to decide what to read ahead
+		uint64_t m_lastAccessPage = 0;
+		int64_t m_lastStride = 0;
+		size_t m_strideConfidence = 0;
+		uint64_t m_stackPointer = 0;
+		bool m_stackPrefetched = false;
+
+		std::thread m_prefetchThread;
+		std::mutex m_prefetchMutex;
+		std::condition_variable m_prefetchCv;
+		std::set<uint64_t> m_prefetchQueue;
+		bool m_prefetchThreadExit = false;
+		// Set while the target is resumed by the controller, so the prefetcher does not read from a running target.
+		// Guarded by m_adapterReadMutex.
+		bool m_prefetchSuspended = false;
+
+		bool IsPageStable(uint64_t page);
+		void UpdateRegions();
+		const DebugMemoryRegion* FindRegion(uint64_t address) const;
+		bool IsPageReadable(uint64_t page);
+		void InvalidateRangeInternal(uint64_t address, size_t size);
+		void CollectMissingPages(uint64_t offset, size_t len, std::set<uint64_t>& missing);
+		std::vector<DataBuffer> ReadRuns(const std::vector<DebugMemoryRange>& runs);
+		void StorePages(const std::vector<DebugMemoryRange>& runs, const std::vector<DataBuffer>& buffers,
+			const std::set<uint64_t>& pages);
+		void FetchPages(const std::set<uint64_t>& pages, const std::set<uint64_t>& prefetch = {});
+		DataBuffer ReadFromCache(uint64_t offset, size_t len);
+
+		void LoadSettings();
+		void ResetAccessPattern();
+		std::set<uint64_t> PredictNextPages(uint64_t offset, size_t len);
+		void SchedulePrefetch(const std::set<uint64_t>& pages);
+		void PrefetchWorker();
 
 	public:
 		DebuggerMemory(DebuggerState* state);
+		~DebuggerMemory();
 
+		// Drop the pages that the target can modify. Read-only and executable pages are kept.
 		void MarkDirty();
+		// Drop everything, e.g., when the target exits or a new target is launched
+		void Clear();
+		void InvalidateRange(uint64_t address, size_t size);
+		uint64_t GetGeneration() const { return m_generation; }
 		DataBuffer ReadMemory(uint64_t offset, size_t len);
+		// Read several ranges, fetching all the pages they miss from the adapter in a single batch
+		std::vector<DataBuffer> ReadMemoryBatch(const std::vector<DebugMemoryRange>& ranges);
 		bool WriteMemory(std::uintptr_t address, const DataBuffer& buffer);
+		// Read straight from the adapter, bypassing the cache, for bulk reads that would only evict useful pages
+		DataBuffer ReadUncached(uint64_t offset, size_t len);
+		// Drops the queued prefetches and waits for the one being read. No prefetch is read until ResumePrefetch().
+		void SuspendPrefetch();
+		void ResumePrefetch();
+
+		// The memory map of the target, fetched again after every stop
+		std::vector<DebugMemoryRegion> GetMemoryRegions();
+		void MarkRegionsDirty();
+
+		DebuggerMemoryCacheStatistics GetStatistics();
+		void ResetStatistics();
+	};
+
+
+	// The stdout and stderr of the target. Each stream is kept in a bounded ring buffer that can be read directly, and
+	// the output is also forwarded to the event callbacks in batches, flushed by size or after a short delay.
+	class DebuggerOutput
+	{
+	public:
+		// What to do when the output arrives faster than it is read
+		enum OverflowPolicy
+		{
+			// Discard the oldest output
+			DropOverflow,
+			// Keep the output that does not fit in a temporary file, and drop the newest output once it is full
+			SpillOverflow,
+		};
+
+	private:
+		struct Stream
+		{
+			std::vector<char> buffer;
+			// Offset of the oldest byte in the buffer
+			size_t head = 0;
+			size_t size = 0;
+			uint64_t dropped = 0;
+			// Output that did not fit in the buffer. It is always newer than the content of the buffer.
+			FILE* spill = nullptr;
+			uint64_t spillRead = 0;
+			uint64_t spillWritten = 0;
+			// Whether the spill file reached the limit since it was last read
+			bool spillFull = false;
+		};
+
+		DebuggerState* m_state;
+		Stream m_streams[2];
+		std::mutex m_mutex;
+
+		// Settings, refreshed every time a target is launched
+		size_t m_capacity = 0;
+		size_t m_flushSize = 0;
+		std::chrono::milliseconds m_flushInterval {};
+		OverflowPolicy m_policy = DropOverflow;
+		uint64_t m_spillLimit = 0;
+
+		// Output from both streams that is not delivered to the event callbacks yet, in the order it arrived. It never
+		// grows beyond the buffer size; the oldest part is dropped if the batches cannot be delivered fast enough.
+		std::string m_pending;
+		// Held while delivering a batch, so that the batches are delivered in order
+		std::mutex m_flushMutex;
+		std::thread m_flushThread;
+		std::condition_variable m_flushCv;
+		bool m_flushThreadExit = false;
+
+		void LoadSettings();
+		void ResetStream(Stream& stream);
+		void Append(Stream& stream, const char* data, size_t length);
+		void FlushWorker();
+
+	public:
+		DebuggerOutput(DebuggerState* state);
+		~DebuggerOutput();
+
+		void Write(DebuggerOutputStream stream, const std::string& data);
+		// Read and remove up to maxLength bytes from the stream. 0 means everything that is available.
+		std::string Read(DebuggerOutputStream stream, size_t maxLength = 0);
+		size_t GetAvailable(DebuggerOutputStream stream);
+		uint64_t GetDropped(DebuggerOutputStream stream);
+		// Deliver the pending output to the event callbacks now
+		void Flush();
+		// Deliver the output that is still pending, e.g., when the target exits
+		void Close();
+		// Drop everything, e.g., when a new target is launched
+		void Clear();
 	};
 
 
@@ -153,7 +514,9 @@ namespace BinaryNinjaDebugger {
 		DebuggerRegisters* m_registers;
 		DebuggerThreads* m_threads;
 		DebuggerBreakpoints* m_breakpoints;
+		DebuggerWatchpoints* m_watchpoints;
 		DebuggerMemory* m_memory;
+		DebuggerOutput* m_output;
 
 		std::string m_executablePath;
 		std::string m_inputFile;
@@ -179,9 +542,11 @@ namespace BinaryNinjaDebugger {
 
 		DebuggerModules* GetModules() const { return m_modules; }
 		DebuggerBreakpoints* GetBreakpoints() const { return m_breakpoints; }
+		DebuggerWatchpoints* GetWatchpoints() const { return m_watchpoints; }
 		DebuggerRegisters* GetRegisters() const { return m_registers; }
 		DebuggerThreads* GetThreads() const { return m_threads; }
 		DebuggerMemory* GetMemory() const { return m_memory; }
+		DebuggerOutput* GetOutput() const { return m_output; }
 		// This is no longer a remote architecture, because we do not really read the remote arch
 		Ref<Architecture> GetRemoteArchitecture() const;
 
@@ -212,6 +577,10 @@ namespace BinaryNinjaDebugger {
 		void AddBreakpoint(const ModuleNameAndOffset& address);
 		void DeleteBreakpoint(uint64_t address);
 		void DeleteBreakpoint(const ModuleNameAndOffset& address);
+		size_t AddBreakpoints(const std::vector<uint64_t>& addresses);
+		size_t AddBreakpoints(const std::vector<ModuleNameAndOffset>& addresses);
+		size_t DeleteBreakpoints(const std::vector<uint64_t>& addresses);
+		size_t DeleteBreakpoints(const std::vector<ModuleNameAndOffset>& addresses);
 
 		uint64_t IP();
 		uint64_t StackPointer();
@@ -0,0 +1,532 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include "elfcore.h"
+
+using namespace BinaryNinjaDebugger;
+using namespace BinaryNinjaDebugger::ElfCore;
+
+
+// The offsets follow the structures in include/uapi/linux/elfcore.h. The 64-bit structures have the same layout on all
+// architectures, only pr_reg differs.
+static const ElfCoreLayout X86_64Layout = {62, true, 336, 32, 112,
+	{"r15", "r14", "r13", "r12", "rbp", "rbx", "r11", "r10", "r9", "r8", "rax", "rcx", "rdx", "rsi", "rdi", "orig_rax",
+		"rip", "cs", "rflags|eflags", "rsp", "ss", "fs_base", "gs_base", "ds", "es", "fs", "gs"},
+	136, 24, 40, 56};
+
+static const ElfCoreLayout AArch64Layout = {183, true, 392, 32, 112,
+	{"x0", "x1", "x2", "x3", "x4", "x5", "x6", "x7", "x8", "x9", "x10", "x11", "x12", "x13", "x14", "x15", "x16",
+		"x17", "x18", "x19", "x20", "x21", "x22", "x23", "x24", "x25", "x26", "x27", "x28", "x29|fp", "x30|lr", "sp",
+		"pc", "cpsr|pstate"},
+	136, 24, 40, 56};
+
+static const ElfCoreLayout X86Layout = {3, false, 144, 24, 72,
+	{"ebx", "ecx", "edx", "esi", "edi", "ebp", "eax", "ds", "es", "fs", "gs", "orig_eax", "eip", "cs", "eflags",
+		"esp", "ss"},
+	124, 12, 28, 44};
+
+static const ElfCoreLayout ArmLayout = {40, false, 148, 24, 72,
+	{"r0", "r1", "r2", "r3", "r4", "r5", "r6", "r7", "r8", "r9", "r10", "r11|fp", "r12|ip", "sp|r13", "lr|r14",
+		"pc|r15", "cpsr", "orig_r0"},
+	124, 12, 28, 44};
+
+
+const ElfCoreLayout* ElfCoreLayout::ForArchitecture(const std::string& arch)
+{
+	if ((arch == "x86_64") || (arch == "amd64"))
+		return &X86_64Layout;
+	if ((arch == "aarch64") || (arch.rfind("arm64", 0) == 0))
+		return &AArch64Layout;
+	if ((arch == "x86") || (arch == "i386") || (arch == "i486") || (arch == "i586") || (arch == "i686"))
+		return &X86Layout;
+	if ((arch.rfind("arm", 0) == 0) || (arch.rfind("thumb", 0) == 0))
+		return &ArmLayout;
+	return nullptr;
+}
+
+
+const ElfCoreLayout* ElfCoreLayout::ForMachine(uint16_t machine)
+{
+	for (const ElfCoreLayout* layout : {&X86_64Layout, &AArch64Layout, &X86Layout, &ArmLayout})
+	{
+		if (layout->machine == machine)
+			return layout;
+	}
+	return nullptr;
+}
+
+
+// Core files of the supported architectures are little endian
+static void Put(std::vector<uint8_t>& buffer, size_t offset, uint64_t value, size_t size)
+{
+	if (buffer.size() < offset + size)
+		buffer.resize(offset + size);
+	for (size_t i = 0; i < size; i++)
+		buffer[offset + i] = (uint8_t)(value >> (8 * i));
+}
+
+
+static void Append(std::vector<uint8_t>& buffer, uint64_t value, size_t size)
+{
+	Put(buffer, buffer.size(), value, size);
+}
+
+
+static uint64_t Get(const uint8_t* data, size_t size)
+{
+	uint64_t value = 0;
+	for (size_t i = 0; i < size; i++)
+		value |= (uint64_t)data[i] << (8 * i);
+	return value;
+}
+
+
+static void AppendNote(std::vector<uint8_t>& notes, uint32_t type, const std::vector<uint8_t>& desc)
+{
+	static const char name[] = "CORE";
+	Append(notes, sizeof(name), 4);
+	Append(notes, desc.size(), 4);
+	Append(notes, type, 4);
+	notes.insert(notes.end(), name, name + sizeof(name));
+	notes.resize((notes.size() + 3) & ~3);
+	notes.insert(notes.end(), desc.begin(), desc.end());
+	notes.resize((notes.size() + 3) & ~3);
+}
+
+
+ElfCoreWriter::ElfCoreWriter(const ElfCoreLayout& layout, uint32_t pid, const std::string& processName,
+	const std::string& commandLine) :
+	m_layout(layout),
+	m_pid(pid), m_processName(processName), m_commandLine(commandLine)
+{}
+
+
+std::vector<uint8_t> ElfCoreWriter::BuildNotes() const
+{
+	std::vector<uint8_t> notes;
+	size_t wordSize = m_layout.GetWordSize();
+
+	for (const ElfCoreThread& thread : m_threads)
+	{
+		std::vector<uint8_t> prStatus(m_layout.prStatusSize, 0);
+		Put(prStatus, m_layout.prStatusPidOffset, thread.tid, 4);
+		for (size_t i = 0; i < m_layout.registers.size(); i++)
+		{
+			// Try each name of the register, until one is known to the adapter
+			const std::string& names = m_layout.registers[i];
+			for (size_t start = 0; start <= names.size();)
+			{
+				size_t end = std::min(names.find('|', start), names.size());
+				auto iter = thread.registers.find(names.substr(start, end - start));
+				if (iter != thread.registers.end())
+				{
+					Put(prStatus, m_layout.prStatusRegistersOffset + i * wordSize, iter->second, wordSize);
+					break;
+				}
+				start = end + 1;
+			}
+		}
+		AppendNote(notes, NT_PRSTATUS, prStatus);
+	}
+
+	std::vector<uint8_t> prPsInfo(m_layout.prPsInfoSize, 0);
+	Put(prPsInfo, m_layout.prPsInfoPidOffset, m_pid, 4);
+	// pr_fname is 16 bytes and pr_psargs is 80 bytes, both null-terminated if they fit
+	memcpy(prPsInfo.data() + m_layout.prPsInfoNameOffset, m_processName.data(),
+		std::min<size_t>(m_processName.size(), 15));
+	memcpy(prPsInfo.data() + m_layout.prPsInfoArgsOffset, m_commandLine.data(),
+		std::min<size_t>(m_commandLine.size(), 79));
+	AppendNote(notes, NT_PRPSINFO, prPsInfo);
+
+	if (!m_files.empty())
+	{
+		std::vector<uint8_t> files;
+		Append(files, m_files.size(), wordSize);
+		Append(files, PageSize, wordSize);
+		for (const ElfCoreMappedFile& file : m_files)
+		{
+			Append(files, file.start, wordSize);
+			Append(files, file.end, wordSize);
+			Append(files, file.offset / PageSize, wordSize);
+		}
+		for (const ElfCoreMappedFile& file : m_files)
+			files.insert(files.end(), file.path.c_str(), file.path.c_str() + file.path.size() + 1);
+		AppendNote(notes, NT_FILE, files);
+	}
+
+	return notes;
+}
+
+
+bool ElfCoreWriter::Write(const std::string& path, const ReadFunction& read, const ProgressFunction& progress)
+{
+	// e_phnum cannot hold more, and the extended numbering of program headers is rarely supported by the readers
+	if (m_segments.size() + 1 >= 0xffff)
+	{
+		m_error = "Too many memory regions for a core file";
+		return false;
+	}
+
+	FILE* file = fopen(path.c_str(), "wb");
+	if (!file)
+	{
+		m_error = "Failed to open " + path;
+		return false;
+	}
+
+	auto fail = [&](const std::string& error) {
+		m_error = error;
+		fclose(file);
+		remove(path.c_str());
+		return false;
+	};
+
+	bool is64Bit = m_layout.is64Bit;
+	size_t wordSize = m_layout.GetWordSize();
+	size_t headerSize = is64Bit ? 64 : 52;
+	size_t programHeaderSize = is64Bit ? 56 : 32;
+	size_t programHeaderCount = m_segments.size() + 1;
+
+	std::vector<uint8_t> notes = BuildNotes();
+	uint64_t notesOffset = headerSize + programHeaderSize * programHeaderCount;
+	// The memory starts at a page boundary, like in the core files of the kernel
+	uint64_t dataOffset = (notesOffset + notes.size() + PageSize - 1) & ~(PageSize - 1);
+
+	std::vector<uint8_t> headers;
+	headers.insert(headers.end(), {0x7f, 'E', 'L', 'F', (uint8_t)(is64Bit ? 2 : 1), 1, 1, 0});
+	headers.resize(16, 0);
+	Append(headers, ET_CORE, 2);
+	Append(headers, m_layout.machine, 2);
+	Append(headers, 1, 4);
+	Append(headers, 0, wordSize);  // e_entry
+	Append(headers, headerSize, wordSize);  // e_phoff
+	Append(headers, 0, wordSize);  // e_shoff
+	Append(headers, 0, 4);  // e_flags
+	Append(headers, headerSize, 2);
+	Append(headers, programHeaderSize, 2);
+	Append(headers, programHeaderCount, 2);
+	Append(headers, 0, 2);  // e_shentsize
+	Append(headers, 0, 2);  // e_shnum
+	Append(headers, 0, 2);  // e_shstrndx
+
+	// The fields of the program headers are in a different order in ELF64, to keep the 64-bit fields aligned
+	auto appendProgramHeader = [&](uint32_t type, uint32_t flags, uint64_t offset, uint64_t address, uint64_t fileSize,
+								   uint64_t memorySize, uint64_t align) {
+		Append(headers, type, 4);
+		if (is64Bit)
+			Append(headers, flags, 4);
+		Append(headers, offset, wordSize);
+		Append(headers, address, wordSize);
+		Append(headers, 0, wordSize);  // p_paddr
+		Append(headers, fileSize, wordSize);
+		Append(headers, memorySize, wordSize);
+		if (!is64Bit)
+			Append(headers, flags, 4);
+		Append(headers, align, wordSize);
+	};
+
+	appendProgramHeader(PT_NOTE, 0, notesOffset, 0, notes.size(), 0, 4);
+	uint64_t offset = dataOffset;
+	size_t total = 0;
+	for (const ElfCoreSegment& segment : m_segments)
+	{
+		uint32_t flags = (segment.readable ? PF_R : 0) | (segment.writable ? PF_W : 0)
+			| (segment.executable ? PF_X : 0);
+		uint64_t size = segment.end - segment.start;
+		uint64_t fileSize = segment.readable ? size : 0;
+		appendProgramHeader(PT_LOAD, flags, offset, segment.start, fileSize, size, PageSize);
+		offset += fileSize;
+		total += fileSize;
+	}
+
+	headers.insert(headers.end(), notes.begin(), notes.end());
+	headers.resize(dataOffset, 0);
+	if (fwrite(headers.data(), 1, headers.size(), file) != headers.size())
+		return fail("Failed to write " + path);
+
+	// The memory that cannot be read is written as zeros, so that the segments stay where the headers say they are
+	static const std::vector<uint8_t> zeros(PageSize, 0);
+	std::vector<uint8_t> data;
+	size_t done = 0;
+	for (const ElfCoreSegment& segment : m_segments)
+	{
+		if (!segment.readable)
+			continue;
+
+		uint64_t address = segment.start;
+		while (address < segment.end)
+		{
+			if (progress && !progress(done, total))
+				return fail("Cancelled");
+
+			size_t size = std::min<uint64_t>(ChunkSize, segment.end - address);
+			size_t bytesRead = std::min(read(address, size, data), size);
+			if (fwrite(data.data(), 1, bytesRead, file) != bytesRead)
+				return fail("Failed to write " + path);
+
+			// Skip the page where the read stopped, and try again after it
+			uint64_t next = address + size;
+			if (bytesRead < size)
+				next = std::min<uint64_t>(((address + bytesRead) & ~(PageSize - 1)) + PageSize, next);
+			for (uint64_t padding = next - address - bytesRead; padding > 0;)
+			{
+				size_t length = std::min<uint64_t>(padding, zeros.size());
+				if (fwrite(zeros.data(), 1, length, file) != length)
+					return fail("Failed to write " + path);
+				padding -= length;
+			}
+
+			done += next - address;
+			address = next;
+		}
+	}
+
+	if (progress)
+		progress(total, total);
+
+	if (fclose(file) != 0)
+	{
+		m_error = "Failed to write " + path;
+		remove(path.c_str());
+		return false;
+	}
+	return true;
+}
+
+
+void ElfCoreReader::ParseNote(uint32_t type, const uint8_t* desc, size_t size)
+{
+	size_t wordSize = m_layout->GetWordSize();
+	switch (type)
+	{
+	case NT_PRSTATUS:
+	{
+		if (size < m_layout->prStatusRegistersOffset + m_layout->registers.size() * wordSize)
+			break;
+
+		ElfCoreThread thread {(uint32_t)Get(desc + m_layout->prStatusPidOffset, 4), {}};
+		for (size_t i = 0; i < m_layout->registers.size(); i++)
+		{
+			const std::string& names = m_layout->registers[i];
+			thread.registers[names.substr(0, names.find('|'))] =
+				Get(desc + m_layout->prStatusRegistersOffset + i * wordSize, wordSize);
+		}
+		// pr_cursig follows the three integers of pr_info
+		if (m_threads.empty())
+			m_signal = (uint32_t)Get(desc + 12, 2);
+		m_threads.push_back(thread);
+		break;
+	}
+	case NT_PRPSINFO:
+	{
+		if (size < m_layout->prPsInfoSize)
+			break;
+
+		auto getString = [&](size_t offset, size_t maxLength) {
+			const char* start = (const char*)desc + offset;
+			return std::string(start, std::find(start, start + maxLength, '\0'));
+		};
+		m_pid = (uint32_t)Get(desc + m_layout->prPsInfoPidOffset, 4);
+		m_processName = getString(m_layout->prPsInfoNameOffset, 16);
+		m_commandLine = getString(m_layout->prPsInfoArgsOffset, 80);
+		break;
+	}
+	case NT_FILE:
+	{
+		if (size < 2 * wordSize)
+			break;
+
+		uint64_t count = Get(desc, wordSize);
+		uint64_t pageSize = Get(desc + wordSize, wordSize);
+		size_t namesOffset = 2 * wordSize + count * 3 * wordSize;
+		if ((count > size) || (namesOffset > size))
+			break;
+
+		const char* name = (const char*)desc + namesOffset;
+		const char* namesEnd = (const char*)desc + size;
+		for (uint64_t i = 0; (i < count) && (name < namesEnd); i++)
+		{
+			const uint8_t* entry = desc + 2 * wordSize + i * 3 * wordSize;
+			const char* nameEnd = std::find(name, namesEnd, '\0');
+			m_files.push_back({Get(entry, wordSize), Get(entry + wordSize, wordSize),
+				Get(entry + 2 * wordSize, wordSize) * pageSize, std::string(name, nameEnd)});
+			name = nameEnd + 1;
+		}
+		break;
+	}
+	default:
+		break;
+	}
+}
+
+
+bool ElfCoreReader::Parse()
+{
+	const uint8_t* data = m_mapped.GetData();
+	size_t size = m_mapped.GetSize();
+	if ((size < 52) || (memcmp(data, "\x7f" "ELF", 4) != 0))
+	{
+		m_error = "not an ELF file";
+		return false;
+	}
+
+	bool is64Bit = data[4] == 2;
+	if ((is64Bit && (size < 64)) || (data[5] != 1))
+	{
+		m_error = "only little endian core files are supported";
+		return false;
+	}
+
+	if (Get(data + 16, 2) != ET_CORE)
+	{
+		m_error = "not a core file";
+		return false;
+	}
+
+	m_layout = ElfCoreLayout::ForMachine((uint16_t)Get(data + 18, 2));
+	if (!m_layout || (m_layout->is64Bit != is64Bit))
+	{
+		m_error = "the architecture is not supported";
+		return false;
+	}
+
+	size_t wordSize = m_layout->GetWordSize();
+	uint64_t programHeaderOffset = Get(data + (is64Bit ? 32 : 28), wordSize);
+	uint64_t programHeaderSize = Get(data + (is64Bit ? 54 : 42), 2);
+	uint64_t programHeaderCount = Get(data + (is64Bit ? 56 : 44), 2);
+	if ((programHeaderSize < (is64Bit ? 56 : 32)) || (programHeaderOffset > size)
+		|| (programHeaderCount * programHeaderSize > size - programHeaderOffset))
+	{
+		m_error = "the program headers are truncated";
+		return false;
+	}
+
+	for (uint64_t i = 0; i < programHeaderCount; i++)
+	{
+		const uint8_t* header = data + programHeaderOffset + i * programHeaderSize;
+		uint32_t type = (uint32_t)Get(header, 4);
+		uint32_t flags;
+		uint64_t offset, address, fileSize, memorySize;
+		if (is64Bit)
+		{
+			flags = (uint32_t)Get(header + 4, 4);
+			offset = Get(header + 8, 8);
+			address = Get(header + 16, 8);
+			fileSize = Get(header + 32, 8);
+			memorySize = Get(header + 40, 8);
+		}
+		else
+		{
+			offset = Get(header + 4, 4);
+			address = Get(header + 8, 4);
+			fileSize = Get(header + 16, 4);
+			memorySize = Get(header + 20, 4);
+			flags = (uint32_t)Get(header + 24, 4);
+		}
+
+		// A truncated core file still has the segments that made it to the disk
+		if (offset > size)
+			fileSize = 0;
+		fileSize = std::min(fileSize, size - std::min<uint64_t>(offset, size));
+
+		if ((type == PT_LOAD) && (memorySize != 0))
+		{
+			m_segments.push_back({address, address + memorySize, offset, std::min(fileSize, memorySize),
+				(flags & PF_R) != 0, (flags & PF_W) != 0, (flags & PF_X) != 0});
+		}
+		else if (type == PT_NOTE)
+		{
+			const uint8_t* note = data + offset;
+			const uint8_t* notesEnd = note + fileSize;
+			while (notesEnd - note >= 12)
+			{
+				uint64_t nameSize = Get(note, 4);
+				uint64_t descSize = Get(note + 4, 4);
+				uint32_t noteType = (uint32_t)Get(note + 8, 4);
+				uint64_t descOffset = 12 + ((nameSize + 3) & ~3);
+				uint64_t noteSize = descOffset + ((descSize + 3) & ~3);
+				if (noteSize > (uint64_t)(notesEnd - note))
+					break;
+
+				// The kernel also writes notes owned by "LINUX", whose types overlap with the ones here
+				if ((nameSize == 5) && (memcmp(note + 12, "CORE", 5) == 0))
+					ParseNote(noteType, note + descOffset, descSize);
+				note += noteSize;
+			}
+		}
+	}
+
+	std::sort(m_segments.begin(), m_segments.end(),
+		[](const Segment& a, const Segment& b) { return a.start < b.start; });
+
+	if (m_threads.empty())
+	{
+		m_error = "the core file has no threads";
+		return false;
+	}
+	if (m_pid == 0)
+		m_pid = m_threads.front().tid;
+	return true;
+}
+
+
+bool ElfCoreReader::Open(const std::string& path)
+{
+	Close();
+	if (!m_mapped.Open(path, m_error) || !Parse())
+	{
+		std::string error = m_error;
+		Close();
+		m_error = error;
+		return false;
+	}
+	return true;
+}
+
+
+void ElfCoreReader::Close()
+{
+	m_mapped.Close();
+	m_layout = nullptr;
+	m_pid = 0;
+	m_processName.clear();
+	m_commandLine.clear();
+	m_signal = 0;
+	m_threads.clear();
+	m_segments.clear();
+	m_files.clear();
+	m_error.clear();
+}
+
+
+const uint8_t* ElfCoreReader::GetPointer(uint64_t address, size_t& available) const
+{
+	available = 0;
+	auto iter = std::upper_bound(m_segments.begin(), m_segments.end(), address,
+		[](uint64_t value, const Segment& segment) { return value < segment.start; });
+	if (iter == m_segments.begin())
+		return nullptr;
+
+	const Segment& segment = *(--iter);
+	if (address - segment.start >= segment.fileSize)
+		return nullptr;
+
+	available = segment.fileSize - (address - segment.start);
+	return m_mapped.GetData() + segment.offset + (address - segment.start);
+}
@@ -0,0 +1,198 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "mappedfile.h"
+
+namespace BinaryNinjaDebugger {
+	// Constants of the ELF core file format, as written by the Linux kernel and read by gdb and lldb
+	namespace ElfCore {
+		constexpr uint16_t ET_CORE = 4;
+		constexpr uint32_t PT_LOAD = 1;
+		constexpr uint32_t PT_NOTE = 4;
+		constexpr uint32_t PF_X = 1;
+		constexpr uint32_t PF_W = 2;
+		constexpr uint32_t PF_R = 4;
+		constexpr uint32_t NT_PRSTATUS = 1;
+		constexpr uint32_t NT_PRPSINFO = 3;
+		constexpr uint32_t NT_FILE = 0x46494c45;
+		constexpr uint64_t PageSize = 0x1000;
+	};  // namespace ElfCore
+
+
+	// The layout of the per-architecture structures in the notes of a Linux core file
+	struct ElfCoreLayout
+	{
+		uint16_t machine;
+		bool is64Bit;
+
+		// struct elf_prstatus, which holds the general purpose registers of one thread
+		size_t prStatusSize;
+		size_t prStatusPidOffset;
+		size_t prStatusRegistersOffset;
+		// The registers in elf_prstatus.pr_reg, in order. Each entry lists the names the adapters use for the register,
+		// separated by '|'. The first one is the name to show.
+		std::vector<std::string> registers;
+
+		// struct elf_prpsinfo, which holds the name and the command line of the process
+		size_t prPsInfoSize;
+		size_t prPsInfoPidOffset;
+		size_t prPsInfoNameOffset;
+		size_t prPsInfoArgsOffset;
+
+		size_t GetWordSize() const { return is64Bit ? 8 : 4; }
+
+		// The architecture is named the way the adapters name it, e.g., "x86_64" or "arm64". Returns nullptr if core
+		// files are not supported on the architecture.
+		static const ElfCoreLayout* ForArchitecture(const std::string& arch);
+		static const ElfCoreLayout* ForMachine(uint16_t machine);
+	};
+
+
+	struct ElfCoreThread
+	{
+		uint32_t tid;
+		std::unordered_map<std::string, uint64_t> registers;
+	};
+
+
+	struct ElfCoreSegment
+	{
+		uint64_t start;
+		uint64_t end;
+		bool readable;
+		bool writable;
+		bool executable;
+	};
+
+
+	// A file mapped into the process, i.e., an entry of NT_FILE
+	struct ElfCoreMappedFile
+	{
+		uint64_t start;
+		uint64_t end;
+		uint64_t offset;
+		std::string path;
+	};
+
+
+	// Writes a core file of a stopped process. The memory of the segments is streamed into the file in chunks, so the
+	// whole process is never held in memory at once.
+	class ElfCoreWriter
+	{
+	public:
+		// Reads [address, address + size) into `data`. Returns the number of bytes read, which is less than `size` if
+		// the read stops at memory that is not readable.
+		using ReadFunction = std::function<size_t(uint64_t address, size_t size, std::vector<uint8_t>& data)>;
+		// Called with the number of bytes of memory written so far and the total. Returns false to cancel.
+		using ProgressFunction = std::function<bool(size_t done, size_t total)>;
+
+		static constexpr size_t ChunkSize = 0x400000;
+
+	private:
+		const ElfCoreLayout& m_layout;
+		uint32_t m_pid;
+		std::string m_processName;
+		std::string m_commandLine;
+		std::vector<ElfCoreThread> m_threads;
+		std::vector<ElfCoreSegment> m_segments;
+		std::vector<ElfCoreMappedFile> m_files;
+		std::string m_error;
+
+		std::vector<uint8_t> BuildNotes() const;
+
+	public:
+		ElfCoreWriter(const ElfCoreLayout& layout, uint32_t pid, const std::string& processName,
+			const std::string& commandLine);
+
+		// The first thread is the one that the debuggers select when they load the core file
+		void AddThread(const ElfCoreThread& thread) { m_threads.push_back(thread); }
+		void AddSegment(const ElfCoreSegment& segment) { m_segments.push_back(segment); }
+		void AddMappedFile(const ElfCoreMappedFile& file) { m_files.push_back(file); }
+
+		// Returns false if the file cannot be written or the progress callback cancels. The partial file is deleted.
+		bool Write(const std::string& path, const ReadFunction& read, const ProgressFunction& progress);
+		const std::string& GetError() const { return m_error; }
+	};
+
+
+	// Reads a core file written by ElfCoreWriter or by the Linux kernel. The file is mapped into memory, so reading
+	// the memory of the process costs no more than a copy out of the page cache.
+	class ElfCoreReader
+	{
+	public:
+		struct Segment
+		{
+			uint64_t start;
+			uint64_t end;
+			// Where the content of the segment is in the file. The memory past fileSize was not saved.
+			uint64_t offset;
+			uint64_t fileSize;
+			bool readable;
+			bool writable;
+			bool executable;
+		};
+
+	private:
+		MappedFile m_mapped;
+		const ElfCoreLayout* m_layout = nullptr;
+		uint32_t m_pid = 0;
+		std::string m_processName;
+		std::string m_commandLine;
+		// The signal that stopped the first thread, i.e., the one that caused the crash
+		uint32_t m_signal = 0;
+		std::vector<ElfCoreThread> m_threads;
+		// Sorted by the start of the segments
+		std::vector<Segment> m_segments;
+		std::vector<ElfCoreMappedFile> m_files;
+		std::string m_error;
+
+		bool Parse();
+		void ParseNote(uint32_t type, const uint8_t* desc, size_t size);
+
+	public:
+		ElfCoreReader() = default;
+		ElfCoreReader(const ElfCoreReader&) = delete;
+		ElfCoreReader& operator=(const ElfCoreReader&) = delete;
+		~ElfCoreReader() { Close(); }
+
+		bool Open(const std::string& path);
+		void Close();
+		bool IsOpen() const { return m_mapped.IsOpen(); }
+		const std::string& GetError() const { return m_error; }
+
+		const ElfCoreLayout* GetLayout() const { return m_layout; }
+		uint32_t GetPid() const { return m_pid; }
+		const std::string& GetProcessName() const { return m_processName; }
+		const std::string& GetCommandLine() const { return m_commandLine; }
+		uint32_t GetSignal() const { return m_signal; }
+		// The registers are named after the first name of each register in the layout
+		const std::vector<ElfCoreThread>& GetThreads() const { return m_threads; }
+		const std::vector<Segment>& GetSegments() const { return m_segments; }
+		const std::vector<ElfCoreMappedFile>& GetMappedFiles() const { return m_files; }
+
+		// Returns a pointer to the saved memory at the address, which stays valid until the reader is closed, and sets
+		// `available` to the number of bytes that can be read from it. Returns nullptr if the memory was not saved.
+		const uint8_t* GetPointer(uint64_t address, size_t& available) const;
+	};
+};  // namespace BinaryNinjaDebugger
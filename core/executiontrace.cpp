@@ -0,0 +1,318 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cerrno>
+#include <cstring>
+#include "executiontrace.h"
+
+
+using namespace BinaryNinjaDebugger;
+
+static constexpr char TraceMagic[8] = {'B', 'N', 'D', 'B', 'G', 'T', 'R', 'C'};
+static constexpr uint32_t TraceVersion = 1;
+static constexpr size_t TraceCountOffset = 16;
+static constexpr size_t TraceBufferSize = 1024 * 1024;
+
+enum TraceRecordFlags : uint8_t
+{
+	TraceThreadChanged = 1,
+	TraceRegistersChanged = 2,
+};
+
+
+static void WriteFixed(std::vector<uint8_t>& buffer, uint64_t value, size_t size)
+{
+	for (size_t i = 0; i < size; i++)
+		buffer.push_back((uint8_t)(value >> (8 * i)));
+}
+
+
+static void WriteVarint(std::vector<uint8_t>& buffer, uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		buffer.push_back((uint8_t)(value | 0x80));
+		value >>= 7;
+	}
+	buffer.push_back((uint8_t)value);
+}
+
+
+// Small negative deltas, e.g., a backward jump, are encoded as small numbers
+static void WriteSignedVarint(std::vector<uint8_t>& buffer, uint64_t delta)
+{
+	int64_t value = (int64_t)delta;
+	WriteVarint(buffer, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+
+static bool ReadFixed(const uint8_t* data, size_t size, size_t& pos, size_t length, uint64_t& value)
+{
+	if ((size < length) || (pos > size - length))
+		return false;
+
+	value = 0;
+	for (size_t i = 0; i < length; i++)
+		value |= (uint64_t)data[pos + i] << (8 * i);
+	pos += length;
+	return true;
+}
+
+
+static bool ReadVarint(const uint8_t* data, size_t size, size_t& pos, uint64_t& value)
+{
+	value = 0;
+	for (size_t shift = 0; shift < 64; shift += 7)
+	{
+		if (pos >= size)
+			return false;
+
+		uint8_t byte = data[pos++];
+		value |= (uint64_t)(byte & 0x7f) << shift;
+		if ((byte & 0x80) == 0)
+			return true;
+	}
+	return false;
+}
+
+
+static bool ReadSignedVarint(const uint8_t* data, size_t size, size_t& pos, uint64_t& delta)
+{
+	uint64_t value = 0;
+	if (!ReadVarint(data, size, pos, value))
+		return false;
+
+	delta = (value >> 1) ^ (0 - (value & 1));
+	return true;
+}
+
+
+ExecutionTraceWriter::~ExecutionTraceWriter()
+{
+	Close();
+}
+
+
+bool ExecutionTraceWriter::Open(
+	const std::string& path, uint32_t addressSize, const std::vector<std::string>& registers, std::string& error)
+{
+	Close();
+
+	m_file = fopen(path.c_str(), "wb");
+	if (!m_file)
+	{
+		error = strerror(errno);
+		return false;
+	}
+
+	m_buffer.clear();
+	m_buffer.reserve(TraceBufferSize + 256);
+	m_buffer.insert(m_buffer.end(), TraceMagic, TraceMagic + sizeof(TraceMagic));
+	WriteFixed(m_buffer, TraceVersion, 4);
+	WriteFixed(m_buffer, addressSize, 4);
+	WriteFixed(m_buffer, 0, 8);
+	WriteFixed(m_buffer, registers.size(), 4);
+	for (const std::string& name : registers)
+	{
+		WriteFixed(m_buffer, name.size(), 2);
+		m_buffer.insert(m_buffer.end(), name.begin(), name.end());
+	}
+
+	m_lastTid = 0;
+	m_lastAddress = 0;
+	m_lastValues.assign(registers.size(), 0);
+	m_count = 0;
+	return FlushBuffer();
+}
+
+
+bool ExecutionTraceWriter::FlushBuffer()
+{
+	if (!m_file)
+		return false;
+
+	bool ok = fwrite(m_buffer.data(), 1, m_buffer.size(), m_file) == m_buffer.size();
+	m_buffer.clear();
+	return ok;
+}
+
+
+void ExecutionTraceWriter::Append(uint32_t tid, uint64_t address, const std::vector<uint64_t>& registerValues)
+{
+	if (!m_file)
+		return;
+
+	size_t flagsPos = m_buffer.size();
+	uint8_t flags = 0;
+	m_buffer.push_back(0);
+
+	if (tid != m_lastTid)
+	{
+		flags |= TraceThreadChanged;
+		WriteVarint(m_buffer, tid);
+		m_lastTid = tid;
+	}
+
+	WriteSignedVarint(m_buffer, address - m_lastAddress);
+	m_lastAddress = address;
+
+	size_t changed = 0;
+	for (size_t i = 0; (i < registerValues.size()) && (i < m_lastValues.size()); i++)
+		if (registerValues[i] != m_lastValues[i])
+			changed++;
+
+	if (changed != 0)
+	{
+		flags |= TraceRegistersChanged;
+		WriteVarint(m_buffer, changed);
+		for (size_t i = 0; (i < registerValues.size()) && (i < m_lastValues.size()); i++)
+		{
+			if (registerValues[i] == m_lastValues[i])
+				continue;
+
+			WriteVarint(m_buffer, i);
+			WriteSignedVarint(m_buffer, registerValues[i] - m_lastValues[i]);
+			m_lastValues[i] = registerValues[i];
+		}
+	}
+
+	m_buffer[flagsPos] = flags;
+	m_count++;
+
+	if (m_buffer.size() >= TraceBufferSize)
+		FlushBuffer();
+}
+
+
+bool ExecutionTraceWriter::Close()
+{
+	if (!m_file)
+		return false;
+
+	bool ok = FlushBuffer();
+
+	std::vector<uint8_t> count;
+	WriteFixed(count, m_count, 8);
+	ok = ok && (fseek(m_file, TraceCountOffset, SEEK_SET) == 0);
+	ok = ok && (fwrite(count.data(), 1, count.size(), m_file) == count.size());
+	ok = (fclose(m_file) == 0) && ok;
+	m_file = nullptr;
+	return ok;
+}
+
+
+bool ExecutionTrace::ParseHeader(std::string& error)
+{
+	const uint8_t* data = m_mapped.GetData();
+	size_t size = m_mapped.GetSize();
+	if ((size < sizeof(TraceMagic)) || (memcmp(data, TraceMagic, sizeof(TraceMagic)) != 0))
+	{
+		error = "not a trace file";
+		return false;
+	}
+
+	size_t pos = sizeof(TraceMagic);
+	uint64_t version = 0, addressSize = 0, count = 0, registerCount = 0;
+	if (!ReadFixed(data, size, pos, 4, version) || !ReadFixed(data, size, pos, 4, addressSize)
+		|| !ReadFixed(data, size, pos, 8, count) || !ReadFixed(data, size, pos, 4, registerCount))
+	{
+		error = "truncated header";
+		return false;
+	}
+
+	if (version != TraceVersion)
+	{
+		error = "unsupported trace version " + std::to_string(version);
+		return false;
+	}
+
+	m_addressSize = (uint32_t)addressSize;
+	m_count = count;
+	m_registers.clear();
+	for (uint64_t i = 0; i < registerCount; i++)
+	{
+		uint64_t length = 0;
+		if (!ReadFixed(data, size, pos, 2, length) || (length > size - pos))
+		{
+			error = "truncated header";
+			return false;
+		}
+		m_registers.emplace_back((const char*)data + pos, length);
+		pos += length;
+	}
+
+	m_recordsStart = pos;
+	return true;
+}
+
+
+std::unique_ptr<ExecutionTrace> ExecutionTrace::Open(const std::string& path, std::string& error)
+{
+	auto trace = std::make_unique<ExecutionTrace>();
+	if (!trace->m_mapped.Open(path, error) || !trace->ParseHeader(error))
+		return nullptr;
+	return trace;
+}
+
+
+bool ExecutionTrace::ForEach(const std::function<bool(const ExecutionTraceRecord&)>& callback) const
+{
+	const uint8_t* data = m_mapped.GetData();
+	size_t size = m_mapped.GetSize();
+	ExecutionTraceRecord record {0, 0, {}};
+	std::vector<uint64_t> values(m_registers.size(), 0);
+
+	size_t pos = m_recordsStart;
+	while (pos < size)
+	{
+		uint8_t flags = data[pos++];
+		if (flags & TraceThreadChanged)
+		{
+			uint64_t tid = 0;
+			if (!ReadVarint(data, size, pos, tid))
+				return false;
+			record.tid = (uint32_t)tid;
+		}
+
+		uint64_t delta = 0;
+		if (!ReadSignedVarint(data, size, pos, delta))
+			return false;
+		record.address += delta;
+
+		record.registers.clear();
+		if (flags & TraceRegistersChanged)
+		{
+			uint64_t changed = 0;
+			if (!ReadVarint(data, size, pos, changed))
+				return false;
+
+			for (uint64_t i = 0; i < changed; i++)
+			{
+				uint64_t index = 0;
+				if (!ReadVarint(data, size, pos, index) || (index >= values.size())
+					|| !ReadSignedVarint(data, size, pos, delta))
+					return false;
+
+				values[index] += delta;
+				record.registers.emplace_back((uint32_t)index, values[index]);
+			}
+		}
+
+		if (!callback(record))
+			return true;
+	}
+	return true;
+}
@@ -0,0 +1,111 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+#include "debuggerevent.h"
+#include "mappedfile.h"
+
+namespace BinaryNinjaDebugger {
+	typedef BNDebugTraceGranularity DebugTraceGranularity;
+
+	struct ExecutionTraceOptions
+	{
+		std::string path;
+		DebugTraceGranularity granularity = TraceInstructions;
+		// 0 means no limit
+		uint64_t maxRecords = 0;
+		// The trace ends after it reaches one of these addresses, or a breakpoint
+		std::vector<uint64_t> stopAddresses;
+		// The registers whose changes are recorded along with the addresses
+		std::vector<std::string> registers;
+	};
+
+
+	struct ExecutionTraceRecord
+	{
+		uint32_t tid;
+		uint64_t address;
+		// The registers that change at this record, as indices into the register names of the trace, and their new
+		// values
+		std::vector<std::pair<uint32_t, uint64_t>> registers;
+	};
+
+
+	// The trace file is a fixed header followed by a stream of records. Each record is a flags byte, the thread ID if
+	// it differs from the previous record, the address as a zigzag varint delta from the previous address, and the
+	// registers that changed, each as its index and a zigzag varint delta from its previous value. A straight-line
+	// step is then two bytes. The record count in the header is written when the trace is closed.
+	class ExecutionTraceWriter
+	{
+		FILE* m_file = nullptr;
+		std::vector<uint8_t> m_buffer;
+		uint32_t m_lastTid = 0;
+		uint64_t m_lastAddress = 0;
+		std::vector<uint64_t> m_lastValues;
+		uint64_t m_count = 0;
+
+		bool FlushBuffer();
+
+	public:
+		~ExecutionTraceWriter();
+
+		bool Open(const std::string& path, uint32_t addressSize, const std::vector<std::string>& registers,
+			std::string& error);
+		// The register values are in the order of the register names given to Open()
+		void Append(uint32_t tid, uint64_t address, const std::vector<uint64_t>& registerValues);
+		bool Close();
+
+		uint64_t GetCount() const { return m_count; }
+	};
+
+
+	// A trace file mapped into memory, which is decoded as it is iterated
+	class ExecutionTrace
+	{
+		MappedFile m_mapped;
+		size_t m_recordsStart = 0;
+		uint32_t m_addressSize = 0;
+		uint64_t m_count = 0;
+		std::vector<std::string> m_registers;
+
+		bool ParseHeader(std::string& error);
+
+	public:
+		ExecutionTrace() = default;
+		ExecutionTrace(const ExecutionTrace&) = delete;
+		ExecutionTrace& operator=(const ExecutionTrace&) = delete;
+
+		// Returns nullptr and sets error if the file cannot be mapped or is not a trace
+		static std::unique_ptr<ExecutionTrace> Open(const std::string& path, std::string& error);
+
+		// Stops early if the callback returns false. Returns false if the trace is truncated or corrupted, after
+		// calling back with every record before the damage.
+		bool ForEach(const std::function<bool(const ExecutionTraceRecord&)>& callback) const;
+
+		uint32_t GetAddressSize() const { return m_addressSize; }
+		// 0 if the trace is not closed properly, e.g., Binary Ninja crashes while tracing
+		uint64_t GetCount() const { return m_count; }
+		const std::vector<std::string>& GetRegisters() const { return m_registers; }
+	};
+};  // namespace BinaryNinjaDebugger
@@ -205,6 +205,145 @@ bool BNDebuggerWriteMemory(BNDebuggerController* controller, uint64_t address, B
 }
 
 
+BNDebuggerMemoryCacheStatistics BNDebuggerGetMemoryCacheStatistics(BNDebuggerController* controller)
+{
+	DebuggerMemoryCacheStatistics statistics = controller->object->GetMemoryCacheStatistics();
+	BNDebuggerMemoryCacheStatistics result;
+	result.hits = statistics.hits;
+	result.misses = statistics.misses;
+	result.adapterReads = statistics.adapterReads;
+	result.retainedPages = statistics.retainedPages;
+	result.cachedPages = statistics.cachedPages;
+	result.prefetchedPages = statistics.prefetchedPages;
+	result.prefetchHits = statistics.prefetchHits;
+	result.unmappedReads = statistics.unmappedReads;
+	return result;
+}
+
+
+void BNDebuggerResetMemoryCacheStatistics(BNDebuggerController* controller)
+{
+	controller->object->ResetMemoryCacheStatistics();
+}
+
+
+BNDebugMemoryRegion* BNDebuggerGetMemoryRegions(BNDebuggerController* controller, size_t* count)
+{
+	std::vector<DebugMemoryRegion> regions = controller->object->GetMemoryRegions();
+
+	*count = regions.size();
+	BNDebugMemoryRegion* results = new BNDebugMemoryRegion[regions.size()];
+	for (size_t i = 0; i < regions.size(); i++)
+	{
+		results[i].start = regions[i].m_start;
+		results[i].end = regions[i].m_end;
+		results[i].readable = regions[i].m_readable;
+		results[i].writable = regions[i].m_writable;
+		results[i].executable = regions[i].m_executable;
+		results[i].name = BNDebuggerAllocString(regions[i].m_name.c_str());
+	}
+	return results;
+}
+
+
+void BNDebuggerFreeMemoryRegions(BNDebugMemoryRegion* regions, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		BNDebuggerFreeString(regions[i].name);
+	delete[] regions;
+}
+
+
+size_t BNDebuggerSearchMemory(BNDebuggerController* controller, const uint8_t* pattern, const uint8_t* mask,
+	size_t length, uint64_t start, uint64_t end, size_t maxResults, void* ctxt,
+	bool (*callback)(void* ctxt, uint64_t address))
+{
+	std::vector<uint8_t> bytes(pattern, pattern + length);
+	std::vector<uint8_t> maskBytes;
+	if (mask)
+		maskBytes.assign(mask, mask + length);
+
+	return controller->object->SearchMemory(
+		bytes, maskBytes, start, end, maxResults, [&](uint64_t address) { return callback(ctxt, address); });
+}
+
+
+void BNDebuggerCancelMemorySearch(BNDebuggerController* controller)
+{
+	controller->object->CancelMemorySearch();
+}
+
+
+bool BNDebuggerSaveCoreFile(BNDebuggerController* controller, const char* path, void* ctxt,
+	bool (*progress)(void* ctxt, size_t done, size_t total))
+{
+	if (!progress)
+		return controller->object->SaveCoreFile(path);
+
+	return controller->object->SaveCoreFile(
+		path, [&](size_t done, size_t total) { return progress(ctxt, done, total); });
+}
+
+
+void BNDebuggerTrackMemoryChanges(BNDebuggerController* controller, uint64_t start, uint64_t end)
+{
+	controller->object->TrackMemoryChanges(start, end);
+}
+
+
+void BNDebuggerUntrackMemoryChanges(BNDebuggerController* controller, uint64_t start, uint64_t end)
+{
+	controller->object->UntrackMemoryChanges(start, end);
+}
+
+
+static BNDebugAddressRange* AllocAddressRanges(const std::vector<MemoryDiffTracker::Range>& ranges, size_t* count)
+{
+	*count = ranges.size();
+	BNDebugAddressRange* results = new BNDebugAddressRange[ranges.size()];
+	for (size_t i = 0; i < ranges.size(); i++)
+	{
+		results[i].start = ranges[i].start;
+		results[i].end = ranges[i].end;
+	}
+	return results;
+}
+
+
+BNDebugAddressRange* BNDebuggerGetTrackedMemoryRanges(BNDebuggerController* controller, size_t* count)
+{
+	return AllocAddressRanges(controller->object->GetTrackedMemoryRanges(), count);
+}
+
+
+BNDebugAddressRange* BNDebuggerGetChangedMemoryRanges(BNDebuggerController* controller, size_t* count)
+{
+	return AllocAddressRanges(controller->object->GetChangedMemoryRanges(), count);
+}
+
+
+void BNDebuggerFreeAddressRanges(BNDebugAddressRange* ranges)
+{
+	delete[] ranges;
+}
+
+
+uint64_t* BNDebuggerGetChangedMemoryPages(BNDebuggerController* controller, size_t* count)
+{
+	std::vector<uint64_t> pages = controller->object->GetChangedMemoryPages();
+	*count = pages.size();
+	uint64_t* results = new uint64_t[pages.size()];
+	std::copy(pages.begin(), pages.end(), results);
+	return results;
+}
+
+
+void BNDebuggerFreeChangedMemoryPages(uint64_t* pages)
+{
+	delete[] pages;
+}
+
+
 BNDebugProcess* BNDebuggerGetProcessList(BNDebuggerController* controller, size_t* size)
 {
 	std::vector<DebugProcess> processes = controller->object->GetProcessList();
@@ -291,7 +430,14 @@ bool BNDebuggerResumeThread(BNDebuggerController* controller, uint32_t tid)
 
 BNDebugFrame* BNDebuggerGetFramesOfThread(BNDebuggerController* controller, uint32_t tid, size_t* count)
 {
-	std::vector<DebugFrame> frames = controller->object->GetFramesOfThread(tid);
+	return BNDebuggerGetTopFramesOfThread(controller, tid, 0, count);
+}
+
+
+BNDebugFrame* BNDebuggerGetTopFramesOfThread(
+	BNDebuggerController* controller, uint32_t tid, size_t maxFrames, size_t* count)
+{
+	std::vector<DebugFrame> frames = controller->object->GetFramesOfThread(tid, maxFrames);
 	*count = frames.size();
 
 	BNDebugFrame* results = new BNDebugFrame[frames.size()];
@@ -354,9 +500,9 @@ void BNDebuggerFreeModules(BNDebugModule* modules, size_t count)
 }
 
 
-BNDebugRegister* BNDebuggerGetRegisters(BNDebuggerController* controller, size_t* size)
+static BNDebugRegister* GetRegisters(BNDebuggerController* controller, bool withHints, size_t* size)
 {
-	std::vector<DebugRegister> registers = controller->object->GetAllRegisters();
+	std::vector<DebugRegister> registers = controller->object->GetAllRegisters(withHints);
 
 	*size = registers.size();
 	BNDebugRegister* results = new BNDebugRegister[registers.size()];
@@ -368,12 +514,25 @@ BNDebugRegister* BNDebuggerGetRegisters(BNDebuggerController* controller, size_t
 		results[i].m_width = registers[i].m_width;
 		results[i].m_registerIndex = registers[i].m_registerIndex;
 		results[i].m_hint = BNDebuggerAllocString(registers[i].m_hint.c_str());
+		results[i].m_changed = registers[i].m_changed;
 	}
 
 	return results;
 }
 
 
+BNDebugRegister* BNDebuggerGetRegisters(BNDebuggerController* controller, size_t* size)
+{
+	return GetRegisters(controller, true, size);
+}
+
+
+BNDebugRegister* BNDebuggerGetRegistersWithoutHints(BNDebuggerController* controller, size_t* size)
+{
+	return GetRegisters(controller, false, size);
+}
+
+
 void BNDebuggerFreeRegisters(BNDebugRegister* registers, size_t count)
 {
 	for (size_t i = 0; i < count; i++)
@@ -759,6 +918,14 @@ BNDebugBreakpoint* BNDebuggerGetBreakpoints(BNDebuggerController* controller, si
 		result[i].offset = breakpoints[i].offset;
 		result[i].address = remoteAddress;
 		result[i].enabled = enabled;
+		auto attributes = state->GetBreakpoints()->GetAttributes(breakpoints[i]);
+		std::string condition = (attributes && attributes->condition) ? attributes->condition->GetText() : "";
+		std::string logTemplate = (attributes && attributes->logTemplate) ? attributes->logTemplate->GetText() : "";
+		result[i].condition = BNDebuggerAllocString(condition.c_str());
+		result[i].logTemplate = BNDebuggerAllocString(logTemplate.c_str());
+		result[i].tracepoint = attributes && attributes->tracepoint;
+		result[i].ignoreCount = attributes ? attributes->ignoreCount : 0;
+		result[i].hitCount = attributes ? attributes->hits->GetCount() : 0;
 	}
 	return result;
 }
@@ -769,6 +936,8 @@ void BNDebuggerFreeBreakpoints(BNDebugBreakpoint* breakpoints, size_t count)
 	for (size_t i = 0; i < count; i++)
 	{
 		BNDebuggerFreeString(breakpoints[i].module);
+		BNDebuggerFreeString(breakpoints[i].condition);
+		BNDebuggerFreeString(breakpoints[i].logTemplate);
 	}
 	delete[] breakpoints;
 }
@@ -798,6 +967,42 @@ void BNDebuggerAddRelativeBreakpoint(BNDebuggerController* controller, const cha
 }
 
 
+static std::vector<ModuleNameAndOffset> ConvertRelativeAddresses(const BNModuleNameAndOffset* addresses, size_t count)
+{
+	std::vector<ModuleNameAndOffset> result;
+	result.reserve(count);
+	for (size_t i = 0; i < count; i++)
+		result.emplace_back(addresses[i].module ? addresses[i].module : "", addresses[i].offset);
+	return result;
+}
+
+
+size_t BNDebuggerDeleteAbsoluteBreakpoints(BNDebuggerController* controller, const uint64_t* addresses, size_t count)
+{
+	return controller->object->DeleteBreakpoints(std::vector<uint64_t>(addresses, addresses + count));
+}
+
+
+size_t BNDebuggerDeleteRelativeBreakpoints(
+	BNDebuggerController* controller, const BNModuleNameAndOffset* addresses, size_t count)
+{
+	return controller->object->DeleteBreakpoints(ConvertRelativeAddresses(addresses, count));
+}
+
+
+size_t BNDebuggerAddAbsoluteBreakpoints(BNDebuggerController* controller, const uint64_t* addresses, size_t count)
+{
+	return controller->object->AddBreakpoints(std::vector<uint64_t>(addresses, addresses + count));
+}
+
+
+size_t BNDebuggerAddRelativeBreakpoints(
+	BNDebuggerController* controller, const BNModuleNameAndOffset* addresses, size_t count)
+{
+	return controller->object->AddBreakpoints(ConvertRelativeAddresses(addresses, count));
+}
+
+
 uint64_t BNDebuggerGetIP(BNDebuggerController* controller)
 {
 	return controller->object->GetCurrentIP();
@@ -844,6 +1049,245 @@ bool BNDebuggerContainsRelativeBreakpoint(BNDebuggerController* controller, cons
 }
 
 
+bool BNDebuggerSetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address, const char* condition)
+{
+	return controller->object->SetBreakpointCondition(address, condition);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointCondition(
+	BNDebuggerController* controller, const char* module, uint64_t offset, const char* condition)
+{
+	return controller->object->SetBreakpointCondition(ModuleNameAndOffset(module, offset), condition);
+}
+
+
+char* BNDebuggerGetAbsoluteBreakpointCondition(BNDebuggerController* controller, uint64_t address)
+{
+	return BNDebuggerAllocString(controller->object->GetBreakpointCondition(address).c_str());
+}
+
+
+char* BNDebuggerGetRelativeBreakpointCondition(BNDebuggerController* controller, const char* module, uint64_t offset)
+{
+	std::string condition = controller->object->GetBreakpointCondition(ModuleNameAndOffset(module, offset));
+	return BNDebuggerAllocString(condition.c_str());
+}
+
+
+static ModuleNameAndOffset AbsoluteBreakpointToRelative(BNDebuggerController* controller, uint64_t address)
+{
+	return controller->object->GetState()->GetModules()->AbsoluteAddressToRelative(address);
+}
+
+
+bool BNDebuggerSetAbsoluteBreakpointTracepoint(BNDebuggerController* controller, uint64_t address, bool tracepoint)
+{
+	return controller->object->SetBreakpointTracepoint(AbsoluteBreakpointToRelative(controller, address), tracepoint);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointTracepoint(
+	BNDebuggerController* controller, const char* module, uint64_t offset, bool tracepoint)
+{
+	return controller->object->SetBreakpointTracepoint(ModuleNameAndOffset(module, offset), tracepoint);
+}
+
+
+bool BNDebuggerSetAbsoluteBreakpointLogTemplate(
+	BNDebuggerController* controller, uint64_t address, const char* logTemplate)
+{
+	return controller->object->SetBreakpointLogTemplate(AbsoluteBreakpointToRelative(controller, address), logTemplate);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointLogTemplate(
+	BNDebuggerController* controller, const char* module, uint64_t offset, const char* logTemplate)
+{
+	return controller->object->SetBreakpointLogTemplate(ModuleNameAndOffset(module, offset), logTemplate);
+}
+
+
+bool BNDebuggerSetAbsoluteBreakpointIgnoreCount(
+	BNDebuggerController* controller, uint64_t address, uint64_t ignoreCount)
+{
+	return controller->object->SetBreakpointIgnoreCount(AbsoluteBreakpointToRelative(controller, address), ignoreCount);
+}
+
+
+bool BNDebuggerSetRelativeBreakpointIgnoreCount(
+	BNDebuggerController* controller, const char* module, uint64_t offset, uint64_t ignoreCount)
+{
+	return controller->object->SetBreakpointIgnoreCount(ModuleNameAndOffset(module, offset), ignoreCount);
+}
+
+
+uint64_t BNDebuggerGetRelativeBreakpointHitCount(BNDebuggerController* controller, const char* module, uint64_t offset)
+{
+	auto attributes = controller->object->GetBreakpointAttributes(ModuleNameAndOffset(module, offset));
+	if (!attributes)
+		return 0;
+
+	return attributes->hits->GetCount();
+}
+
+
+uint64_t BNDebuggerGetAbsoluteBreakpointHitCount(BNDebuggerController* controller, uint64_t address)
+{
+	ModuleNameAndOffset relative = AbsoluteBreakpointToRelative(controller, address);
+	return BNDebuggerGetRelativeBreakpointHitCount(controller, relative.module.c_str(), relative.offset);
+}
+
+
+BNBreakpointRecord* BNDebuggerGetRelativeBreakpointRecords(
+	BNDebuggerController* controller, const char* module, uint64_t offset, size_t* count)
+{
+	std::vector<BreakpointRecord> records;
+	auto attributes = controller->object->GetBreakpointAttributes(ModuleNameAndOffset(module, offset));
+	if (attributes)
+		records = attributes->hits->GetRecords();
+
+	*count = records.size();
+	BNBreakpointRecord* result = new BNBreakpointRecord[records.size()];
+	for (size_t i = 0; i < records.size(); i++)
+	{
+		result[i].hit = records[i].hit;
+		result[i].message = BNDebuggerAllocString(records[i].message.c_str());
+	}
+	return result;
+}
+
+
+BNBreakpointRecord* BNDebuggerGetAbsoluteBreakpointRecords(
+	BNDebuggerController* controller, uint64_t address, size_t* count)
+{
+	ModuleNameAndOffset relative = AbsoluteBreakpointToRelative(controller, address);
+	return BNDebuggerGetRelativeBreakpointRecords(controller, relative.module.c_str(), relative.offset, count);
+}
+
+
+void BNDebuggerFreeBreakpointRecords(BNBreakpointRecord* records, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		BNDebuggerFreeString(records[i].message);
+	delete[] records;
+}
+
+
+bool BNDebuggerResetAbsoluteBreakpointHits(BNDebuggerController* controller, uint64_t address)
+{
+	return controller->object->ResetBreakpointHits(AbsoluteBreakpointToRelative(controller, address));
+}
+
+
+bool BNDebuggerResetRelativeBreakpointHits(BNDebuggerController* controller, const char* module, uint64_t offset)
+{
+	return controller->object->ResetBreakpointHits(ModuleNameAndOffset(module, offset));
+}
+
+
+BNDebugWatchpoint* BNDebuggerGetWatchpoints(BNDebuggerController* controller, size_t* count)
+{
+	DebuggerState* state = controller->object->GetState();
+	std::vector<DebuggerWatchpoint> watchpoints = controller->object->GetWatchpoints();
+	*count = watchpoints.size();
+
+	BNDebugWatchpoint* result = new BNDebugWatchpoint[watchpoints.size()];
+	for (size_t i = 0; i < watchpoints.size(); i++)
+	{
+		result[i].module = BNDebuggerAllocString(watchpoints[i].address.module.c_str());
+		result[i].offset = watchpoints[i].address.offset;
+		result[i].address = state->GetModules()->RelativeAddressToAbsolute(watchpoints[i].address);
+		result[i].size = watchpoints[i].size;
+		result[i].type = watchpoints[i].type;
+	}
+	return result;
+}
+
+
+void BNDebuggerFreeWatchpoints(BNDebugWatchpoint* watchpoints, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+		BNDebuggerFreeString(watchpoints[i].module);
+	delete[] watchpoints;
+}
+
+
+bool BNDebuggerAddAbsoluteWatchpoint(
+	BNDebuggerController* controller, uint64_t address, size_t size, BNDebugWatchpointType type)
+{
+	return controller->object->AddWatchpoint(address, size, type);
+}
+
+
+bool BNDebuggerAddRelativeWatchpoint(
+	BNDebuggerController* controller, const char* module, uint64_t offset, size_t size, BNDebugWatchpointType type)
+{
+	return controller->object->AddWatchpoint(ModuleNameAndOffset(module, offset), size, type);
+}
+
+
+bool BNDebuggerDeleteAbsoluteWatchpoint(BNDebuggerController* controller, uint64_t address)
+{
+	return controller->object->DeleteWatchpoint(address);
+}
+
+
+bool BNDebuggerDeleteRelativeWatchpoint(BNDebuggerController* controller, const char* module, uint64_t offset)
+{
+	return controller->object->DeleteWatchpoint(ModuleNameAndOffset(module, offset));
+}
+
+
+static ExecutionTraceOptions MakeTraceOptions(const char* path, BNDebugTraceGranularity granularity,
+	uint64_t maxRecords, const uint64_t* stopAddresses, size_t stopCount, const char** registers, size_t registerCount)
+{
+	ExecutionTraceOptions options;
+	options.path = path;
+	options.granularity = granularity;
+	options.maxRecords = maxRecords;
+	options.stopAddresses.assign(stopAddresses, stopAddresses + stopCount);
+	for (size_t i = 0; i < registerCount; i++)
+		options.registers.emplace_back(registers[i]);
+	return options;
+}
+
+
+bool BNDebuggerTrace(BNDebuggerController* controller, const char* path, BNDebugTraceGranularity granularity,
+	uint64_t maxRecords, const uint64_t* stopAddresses, size_t stopCount, const char** registers, size_t registerCount)
+{
+	return controller->object->Trace(
+		MakeTraceOptions(path, granularity, maxRecords, stopAddresses, stopCount, registers, registerCount));
+}
+
+
+BNDebugStopReason BNDebuggerTraceAndWait(BNDebuggerController* controller, const char* path,
+	BNDebugTraceGranularity granularity, uint64_t maxRecords, const uint64_t* stopAddresses, size_t stopCount,
+	const char** registers, size_t registerCount)
+{
+	return controller->object->TraceAndWait(
+		MakeTraceOptions(path, granularity, maxRecords, stopAddresses, stopCount, registers, registerCount));
+}
+
+
+void BNDebuggerCancelTrace(BNDebuggerController* controller)
+{
+	controller->object->CancelTrace();
+}
+
+
+bool BNDebuggerIsTracing(BNDebuggerController* controller)
+{
+	return controller->object->IsTracing();
+}
+
+
+int64_t BNDebuggerHighlightTrace(BNDebuggerController* controller, const char* path, uint32_t color)
+{
+	return controller->object->HighlightTrace(path, (BNHighlightStandardColor)color);
+}
+
+
 uint64_t BNDebuggerRelativeAddressToAbsolute(BNDebuggerController* controller, const char* module, uint64_t offset)
 {
 	DebuggerState* state = controller->object->GetState();
@@ -887,6 +1331,14 @@ bool BNDebuggerIsSameBaseModule(const char* module1, const char* module2)
 
 size_t BNDebuggerRegisterEventCallback(
 	BNDebuggerController* controller, void (*callback)(void* ctx, BNDebuggerEvent* event), const char* name, void* ctx)
+{
+	return BNDebuggerRegisterEventCallbackWithPolicy(controller, callback, name, ctx, SynchronousEventDelivery);
+}
+
+
+size_t BNDebuggerRegisterEventCallbackWithPolicy(BNDebuggerController* controller,
+	void (*callback)(void* ctx, BNDebuggerEvent* event), const char* name, void* ctx,
+	BNDebuggerEventDeliveryPolicy policy)
 {
 	return controller->object->RegisterEventCallback(
 		[=](const DebuggerEvent& event) {
@@ -897,6 +1349,8 @@ size_t BNDebuggerRegisterEventCallback(
 			evt->data.targetStoppedData.exitCode = event.data.targetStoppedData.exitCode;
 			evt->data.targetStoppedData.lastActiveThread = event.data.targetStoppedData.lastActiveThread;
 			evt->data.targetStoppedData.data = event.data.targetStoppedData.data;
+			evt->data.targetStoppedData.watchpointAddress = event.data.targetStoppedData.watchpointAddress;
+			evt->data.targetStoppedData.watchpointType = event.data.targetStoppedData.watchpointType;
 
 			evt->data.errorData.error = BNDebuggerAllocString(event.data.errorData.error.c_str());
 			evt->data.errorData.shortError = BNDebuggerAllocString(event.data.errorData.shortError.c_str());
@@ -919,7 +1373,7 @@ size_t BNDebuggerRegisterEventCallback(
 			BNDebuggerFreeString(evt->data.messageData.message);
 			delete evt;
 		},
-		name);
+		name, policy);
 }
 
 
@@ -941,6 +1395,27 @@ void BNDebuggerWriteStdin(BNDebuggerController* controller, const char* data, si
 }
 
 
+BNDataBuffer* BNDebuggerReadTargetOutput(
+	BNDebuggerController* controller, BNDebuggerOutputStream stream, size_t maxLength)
+{
+	std::string output = controller->object->GetState()->GetOutput()->Read(stream, maxLength);
+	DataBuffer* data = new DataBuffer(output.data(), output.size());
+	return data->GetBufferObject();
+}
+
+
+size_t BNDebuggerGetTargetOutputAvailable(BNDebuggerController* controller, BNDebuggerOutputStream stream)
+{
+	return controller->object->GetState()->GetOutput()->GetAvailable(stream);
+}
+
+
+uint64_t BNDebuggerGetTargetOutputDropped(BNDebuggerController* controller, BNDebuggerOutputStream stream)
+{
+	return controller->object->GetState()->GetOutput()->GetDropped(stream);
+}
+
+
 DEBUGGER_FFI_API char* BNDebuggerInvokeBackendCommand(BNDebuggerController* controller, const char* cmd)
 {
 	std::string output = controller->object->InvokeBackendCommand(std::string(cmd));
@@ -987,6 +1462,39 @@ char* BNDebuggerGetAddressInformation(BNDebuggerController* controller, uint64_t
 }
 
 
+BNDebugStackSlot* BNDebuggerGetStackWindow(
+	BNDebuggerController* controller, size_t before, size_t after, size_t depth, size_t* count)
+{
+	std::vector<DebugStackSlot> slots = controller->object->GetStackWindow(before, after, depth);
+
+	*count = slots.size();
+	BNDebugStackSlot* results = new BNDebugStackSlot[slots.size()];
+	for (size_t i = 0; i < slots.size(); i++)
+	{
+		results[i].offset = slots[i].offset;
+		results[i].address = slots[i].address;
+		results[i].value = slots[i].value;
+		results[i].valid = slots[i].valid;
+		results[i].chainCount = slots[i].chain.size();
+		results[i].chain = new uint64_t[slots[i].chain.size()];
+		std::copy(slots[i].chain.begin(), slots[i].chain.end(), results[i].chain);
+		results[i].hint = BNDebuggerAllocString(slots[i].hint.c_str());
+	}
+	return results;
+}
+
+
+void BNDebuggerFreeStackWindow(BNDebugStackSlot* slots, size_t count)
+{
+	for (size_t i = 0; i < count; i++)
+	{
+		delete[] slots[i].chain;
+		BNDebuggerFreeString(slots[i].hint);
+	}
+	delete[] slots;
+}
+
+
 bool BNDebuggerIsFirstLaunch(BNDebuggerController* controller)
 {
 	return controller->object->IsFirstLaunch();
@@ -1001,6 +1509,8 @@ void BNDebuggerPostDebuggerEvent(BNDebuggerController* controller, BNDebuggerEve
 	evt.data.targetStoppedData.exitCode = event->data.targetStoppedData.exitCode;
 	evt.data.targetStoppedData.lastActiveThread = event->data.targetStoppedData.lastActiveThread;
 	evt.data.targetStoppedData.data = event->data.targetStoppedData.data;
+	evt.data.targetStoppedData.watchpointAddress = event->data.targetStoppedData.watchpointAddress;
+	evt.data.targetStoppedData.watchpointType = event->data.targetStoppedData.watchpointType;
 
 	evt.data.errorData.error = event->data.errorData.error;
 	evt.data.errorData.shortError = event->data.errorData.shortError;
@@ -0,0 +1,260 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include "iladdresscache.h"
+#include "lowlevelilinstruction.h"
+#include "mediumlevelilinstruction.h"
+#include "highlevelilinstruction.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+ILAddressSet::ILAddressSet(std::vector<uint64_t> addresses) : m_addresses(std::move(addresses))
+{
+	std::sort(m_addresses.begin(), m_addresses.end());
+	m_addresses.erase(std::unique(m_addresses.begin(), m_addresses.end()), m_addresses.end());
+}
+
+
+bool ILAddressSet::Contains(uint64_t address) const
+{
+	return std::binary_search(m_addresses.begin(), m_addresses.end(), address);
+}
+
+
+ILFlowGraph::ILFlowGraph(std::vector<Block> blocks) : m_blocks(std::move(blocks))
+{
+	for (size_t block = 0; block < m_blocks.size(); block++)
+	{
+		const std::vector<uint64_t>& addresses = m_blocks[block].addresses;
+		for (size_t position = 0; position < addresses.size(); position++)
+			m_positions[addresses[position]].emplace_back(block, position);
+	}
+}
+
+
+bool ILFlowGraph::GetNextInstructionStarts(uint64_t address, std::unordered_set<uint64_t>& starts) const
+{
+	auto iter = m_positions.find(address);
+	if (iter == m_positions.end())
+		return false;
+
+	for (const auto& [block, position] : iter->second)
+	{
+		// The machine code of the instructions in a block can be interleaved, so any of the rest can come next. The
+		// ones at the same address are passed by the step anyway.
+		const std::vector<uint64_t>& addresses = m_blocks[block].addresses;
+		for (size_t i = position + 1; i < addresses.size(); i++)
+		{
+			if (addresses[i] != address)
+				starts.insert(addresses[i]);
+		}
+
+		for (size_t successor : m_blocks[block].successors)
+		{
+			if (!m_blocks[successor].addresses.empty())
+				starts.insert(m_blocks[successor].addresses.front());
+		}
+	}
+	return true;
+}
+
+
+template <typename T>
+static std::shared_ptr<const ILAddressSet> CollectInstructionStarts(const T& il)
+{
+	std::vector<uint64_t> addresses;
+	addresses.reserve(il->GetInstructionCount());
+	for (size_t i = 0; i < il->GetInstructionCount(); i++)
+		addresses.push_back(il->GetInstruction(i).address);
+	return std::make_shared<const ILAddressSet>(std::move(addresses));
+}
+
+
+template <typename T>
+static std::shared_ptr<const ILFlowGraph> CollectFlowGraph(const T& il)
+{
+	std::vector<Ref<BasicBlock>> basicBlocks = il->GetBasicBlocks();
+	std::unordered_map<BNBasicBlock*, size_t> indices;
+	for (size_t i = 0; i < basicBlocks.size(); i++)
+		indices[basicBlocks[i]->GetObject()] = i;
+
+	std::vector<ILFlowGraph::Block> blocks(basicBlocks.size());
+	for (size_t i = 0; i < basicBlocks.size(); i++)
+	{
+		for (size_t j = basicBlocks[i]->GetStart(); j < basicBlocks[i]->GetEnd(); j++)
+			blocks[i].addresses.push_back(il->GetInstruction(j).address);
+
+		for (const BasicBlockEdge& edge : basicBlocks[i]->GetOutgoingEdges())
+		{
+			if (!edge.target)
+				continue;
+			auto iter = indices.find(edge.target->GetObject());
+			if (iter != indices.end())
+				blocks[i].successors.push_back(iter->second);
+		}
+	}
+	return std::make_shared<const ILFlowGraph>(std::move(blocks));
+}
+
+
+static std::shared_ptr<const ILAddressSet> CollectCallSites(const LowLevelILFunctionRef& llil)
+{
+	std::vector<uint64_t> addresses;
+	for (size_t i = 0; i < llil->GetInstructionCount(); i++)
+	{
+		LowLevelILInstruction instruction = llil->GetInstruction(i);
+		switch (instruction.operation)
+		{
+		case LLIL_CALL:
+		case LLIL_CALL_STACK_ADJUST:
+		case LLIL_TAILCALL:
+			addresses.push_back(instruction.address);
+			break;
+		default:
+			break;
+		}
+	}
+	return std::make_shared<const ILAddressSet>(std::move(addresses));
+}
+
+
+ILAddressCache::Entry& ILAddressCache::GetEntry(const FunctionRef& func)
+{
+	Entry& entry = m_entries[func->GetObject()];
+	if (!entry.function)
+		entry.function = func;
+	return entry;
+}
+
+
+std::shared_ptr<const ILAddressSet> ILAddressCache::GetInstructionStarts(
+	const FunctionRef& func, BNFunctionGraphType il)
+{
+	switch (il)
+	{
+	case LowLevelILFunctionGraph:
+	{
+		LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
+		if (!llil)
+			return nullptr;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Entry& entry = GetEntry(func);
+		if (!entry.llil || (entry.llil->GetObject() != llil->GetObject()))
+		{
+			entry.llil = llil;
+			entry.llilStarts = CollectInstructionStarts(llil);
+			entry.llilFlow = nullptr;
+			entry.callSites = nullptr;
+		}
+		return entry.llilStarts;
+	}
+	case MediumLevelILFunctionGraph:
+	{
+		MediumLevelILFunctionRef mlil = func->GetMediumLevelILIfAvailable();
+		if (!mlil)
+			return nullptr;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Entry& entry = GetEntry(func);
+		if (!entry.mlil || (entry.mlil->GetObject() != mlil->GetObject()))
+		{
+			entry.mlil = mlil;
+			entry.mlilStarts = CollectInstructionStarts(mlil);
+			entry.mlilFlow = nullptr;
+		}
+		return entry.mlilStarts;
+	}
+	case HighLevelILFunctionGraph:
+	case HighLevelLanguageRepresentationFunctionGraph:
+	{
+		HighLevelILFunctionRef hlil = func->GetHighLevelILIfAvailable();
+		if (!hlil)
+			return nullptr;
+
+		std::unique_lock<std::mutex> lock(m_mutex);
+		Entry& entry = GetEntry(func);
+		if (!entry.hlil || (entry.hlil->GetObject() != hlil->GetObject()))
+		{
+			entry.hlil = hlil;
+			entry.hlilStarts = CollectInstructionStarts(hlil);
+			entry.hlilFlow = nullptr;
+		}
+		return entry.hlilStarts;
+	}
+	default:
+		return nullptr;
+	}
+}
+
+
+std::shared_ptr<const ILFlowGraph> ILAddressCache::GetFlowGraph(const FunctionRef& func, BNFunctionGraphType il)
+{
+	// This brings the IL of the entry up-to-date, and drops the flow graph that is built from an older one
+	if (!GetInstructionStarts(func, il))
+		return nullptr;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Entry& entry = GetEntry(func);
+	switch (il)
+	{
+	case LowLevelILFunctionGraph:
+		if (!entry.llilFlow && entry.llil)
+			entry.llilFlow = CollectFlowGraph(entry.llil);
+		return entry.llilFlow;
+	case MediumLevelILFunctionGraph:
+		if (!entry.mlilFlow && entry.mlil)
+			entry.mlilFlow = CollectFlowGraph(entry.mlil);
+		return entry.mlilFlow;
+	case HighLevelILFunctionGraph:
+	case HighLevelLanguageRepresentationFunctionGraph:
+		if (!entry.hlilFlow && entry.hlil)
+			entry.hlilFlow = CollectFlowGraph(entry.hlil);
+		return entry.hlilFlow;
+	default:
+		return nullptr;
+	}
+}
+
+
+std::shared_ptr<const ILAddressSet> ILAddressCache::GetCallSites(const FunctionRef& func)
+{
+	LowLevelILFunctionRef llil = func->GetLowLevelILIfAvailable();
+	if (!llil)
+		return nullptr;
+
+	std::unique_lock<std::mutex> lock(m_mutex);
+	Entry& entry = GetEntry(func);
+	if (!entry.llil || (entry.llil->GetObject() != llil->GetObject()))
+	{
+		entry.llil = llil;
+		entry.llilStarts = CollectInstructionStarts(llil);
+		entry.llilFlow = nullptr;
+		entry.callSites = nullptr;
+	}
+	if (!entry.callSites)
+		entry.callSites = CollectCallSites(llil);
+	return entry.callSites;
+}
+
+
+void ILAddressCache::Clear()
+{
+	std::unique_lock<std::mutex> lock(m_mutex);
+	m_entries.clear();
+}
@@ -0,0 +1,103 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include "binaryninjaapi.h"
+
+using namespace BinaryNinja;
+
+namespace BinaryNinjaDebugger {
+	// A sorted set of addresses
+	class ILAddressSet
+	{
+		std::vector<uint64_t> m_addresses;
+
+	public:
+		ILAddressSet(std::vector<uint64_t> addresses);
+
+		bool Contains(uint64_t address) const;
+		const std::vector<uint64_t>& GetAddresses() const { return m_addresses; }
+	};
+
+
+	// The basic blocks of an IL function, by the addresses of their instructions. It tells where the target can be next
+	// at the IL level, so an IL step only needs breakpoints on those addresses.
+	class ILFlowGraph
+	{
+	public:
+		struct Block
+		{
+			std::vector<uint64_t> addresses;
+			std::vector<size_t> successors;
+		};
+
+	private:
+		std::vector<Block> m_blocks;
+		// The blocks and the positions within them of the IL instructions that start at an address
+		std::unordered_map<uint64_t, std::vector<std::pair<size_t, size_t>>> m_positions;
+
+	public:
+		ILFlowGraph(std::vector<Block> blocks);
+
+		// Adds the starts of the IL instructions that can follow the ones at the address: the rest of their blocks,
+		// and the first instructions of the successor blocks. Returns false if no IL instruction starts at it.
+		bool GetNextInstructionStarts(uint64_t address, std::unordered_set<uint64_t>& starts) const;
+	};
+
+
+	// The addresses where the IL instructions of a function start, for each IL level, and the addresses of its calls.
+	// Re-analyzing a function creates new IL functions, so the IL function a set is built from serves as the analysis
+	// generation of the set: it is rebuilt once the function has a different one. The cache holds a reference to the
+	// IL function, so its handle cannot be reused by another one in the meantime.
+	class ILAddressCache
+	{
+		struct Entry
+		{
+			FunctionRef function;
+			LowLevelILFunctionRef llil;
+			MediumLevelILFunctionRef mlil;
+			HighLevelILFunctionRef hlil;
+			std::shared_ptr<const ILAddressSet> llilStarts;
+			std::shared_ptr<const ILAddressSet> mlilStarts;
+			std::shared_ptr<const ILAddressSet> hlilStarts;
+			std::shared_ptr<const ILFlowGraph> llilFlow;
+			std::shared_ptr<const ILFlowGraph> mlilFlow;
+			std::shared_ptr<const ILFlowGraph> hlilFlow;
+			std::shared_ptr<const ILAddressSet> callSites;
+		};
+
+		std::mutex m_mutex;
+		std::unordered_map<BNFunction*, Entry> m_entries;
+
+		Entry& GetEntry(const FunctionRef& func);
+
+	public:
+		// Returns nullptr if the IL is not available, e.g., the function is still being analyzed
+		std::shared_ptr<const ILAddressSet> GetInstructionStarts(const FunctionRef& func, BNFunctionGraphType il);
+		// Returns nullptr if the IL is not available
+		std::shared_ptr<const ILFlowGraph> GetFlowGraph(const FunctionRef& func, BNFunctionGraphType il);
+		// The LLIL calls and tail calls
+		std::shared_ptr<const ILAddressSet> GetCallSites(const FunctionRef& func);
+		void Clear();
+	};
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,48 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace BinaryNinjaDebugger {
+	// A file mapped read-only into memory, e.g., a core file or an execution trace, so it is read without copying it.
+	// The mapping is released when the file is closed or destroyed.
+	class MappedFile
+	{
+		const uint8_t* m_data = nullptr;
+		size_t m_size = 0;
+#ifdef WIN32
+		void* m_file = nullptr;
+		void* m_mapping = nullptr;
+#endif
+
+	public:
+		MappedFile() = default;
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		~MappedFile() { Close(); }
+
+		// Returns false and sets error if the file cannot be opened or mapped, or it is empty
+		bool Open(const std::string& path, std::string& error);
+		void Close();
+		bool IsOpen() const { return m_data != nullptr; }
+		const uint8_t* GetData() const { return m_data; }
+		size_t GetSize() const { return m_size; }
+	};
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,337 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "memoryclassifier.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define DEBUGGER_X86_64
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#define DEBUGGER_TARGET_AVX2
+	#else
+		#define DEBUGGER_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+// The classifiers compute two masks for each 64-byte block, one bit per byte: whether the byte is printable, and
+// whether it is zero. The runs of all three encodings are then counted on the masks, 64 bytes at a time.
+struct BlockMasks
+{
+	uint64_t printable;
+	uint64_t zero;
+};
+
+
+static inline bool IsPrintableChar(uint8_t c)
+{
+	return (c == '\r') || (c == '\n') || (c == '\t') || ((c >= 0x20) && (c <= 0x7e));
+}
+
+
+static inline size_t CountTrailingOnes(uint64_t value)
+{
+	value = ~value;
+	if (value == 0)
+		return 64;
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward64(&index, value);
+	return index;
+#else
+	return __builtin_ctzll(value);
+#endif
+}
+
+
+#ifdef DEBUGGER_X86_64
+static BlockMasks ComputeMasksSSE2(const uint8_t* block)
+{
+	const __m128i low = _mm_set1_epi8(0x1f);
+	const __m128i high = _mm_set1_epi8(0x7f);
+	const __m128i tab = _mm_set1_epi8('\t');
+	const __m128i lf = _mm_set1_epi8('\n');
+	const __m128i cr = _mm_set1_epi8('\r');
+	const __m128i zero = _mm_setzero_si128();
+
+	BlockMasks masks {0, 0};
+	for (size_t i = 0; i < 4; i++)
+	{
+		__m128i bytes = _mm_loadu_si128((const __m128i*)(block + i * 16));
+		// The comparisons are signed, so the bytes from 0x80 upwards are negative and fail the first one
+		__m128i printable = _mm_and_si128(_mm_cmpgt_epi8(bytes, low), _mm_cmplt_epi8(bytes, high));
+		printable = _mm_or_si128(printable, _mm_cmpeq_epi8(bytes, tab));
+		printable = _mm_or_si128(printable, _mm_cmpeq_epi8(bytes, lf));
+		printable = _mm_or_si128(printable, _mm_cmpeq_epi8(bytes, cr));
+		masks.printable |= (uint64_t)(uint16_t)_mm_movemask_epi8(printable) << (i * 16);
+		masks.zero |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(bytes, zero)) << (i * 16);
+	}
+	return masks;
+}
+
+
+DEBUGGER_TARGET_AVX2 static BlockMasks ComputeMasksAVX2(const uint8_t* block)
+{
+	const __m256i low = _mm256_set1_epi8(0x1f);
+	const __m256i high = _mm256_set1_epi8(0x7f);
+	const __m256i tab = _mm256_set1_epi8('\t');
+	const __m256i lf = _mm256_set1_epi8('\n');
+	const __m256i cr = _mm256_set1_epi8('\r');
+	const __m256i zero = _mm256_setzero_si256();
+
+	BlockMasks masks {0, 0};
+	for (size_t i = 0; i < 2; i++)
+	{
+		__m256i bytes = _mm256_loadu_si256((const __m256i*)(block + i * 32));
+		__m256i printable = _mm256_and_si256(_mm256_cmpgt_epi8(bytes, low), _mm256_cmpgt_epi8(high, bytes));
+		printable = _mm256_or_si256(printable, _mm256_cmpeq_epi8(bytes, tab));
+		printable = _mm256_or_si256(printable, _mm256_cmpeq_epi8(bytes, lf));
+		printable = _mm256_or_si256(printable, _mm256_cmpeq_epi8(bytes, cr));
+		masks.printable |= (uint64_t)(uint32_t)_mm256_movemask_epi8(printable) << (i * 32);
+		masks.zero |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(bytes, zero)) << (i * 32);
+	}
+	return masks;
+}
+#endif
+
+
+// Only the masks differ between the implementations, so the counting is shared. The masks of the next block are
+// needed as well, since the upper bytes of a character at the end of a block are in the next one.
+template <BlockMasks (*ComputeMasks)(const uint8_t*)>
+static inline BlockMasks ComputeBlock(const uint8_t* data, size_t length, size_t offset)
+{
+	if (offset >= length)
+		return {0, 0};
+
+	if (length - offset >= 64)
+		return ComputeMasks(data + offset);
+
+	// The last block is padded, and the bits beyond the end are cleared, so no character extends past the end
+	uint8_t block[64] = {};
+	size_t remaining = length - offset;
+	memcpy(block, data + offset, remaining);
+	BlockMasks masks = ComputeMasks(block);
+	uint64_t valid = (1ULL << remaining) - 1;
+	masks.printable &= valid;
+	masks.zero &= valid;
+	return masks;
+}
+
+
+template <BlockMasks (*ComputeMasks)(const uint8_t*)>
+static inline PrintableRuns CountPrintableRuns(const uint8_t* data, size_t length)
+{
+	// Bit i of the UTF-16 mask is the first byte of a character, i.e., i is a multiple of 2, and so on
+	const uint64_t utf16Starts = 0x5555555555555555ULL;
+	const uint64_t utf32Starts = 0x1111111111111111ULL;
+
+	PrintableRuns runs;
+	bool asciiDone = false, utf16Done = false, utf32Done = false;
+	BlockMasks current = ComputeBlock<ComputeMasks>(data, length, 0);
+	for (size_t offset = 0; offset < length; offset += 64)
+	{
+		BlockMasks next = ComputeBlock<ComputeMasks>(data, length, offset + 64);
+		// Whether the byte 1, 2 and 3 positions after each byte is zero
+		uint64_t zero1 = (current.zero >> 1) | (next.zero << 63);
+		uint64_t zero2 = (current.zero >> 2) | (next.zero << 62);
+		uint64_t zero3 = (current.zero >> 3) | (next.zero << 61);
+
+		if (!asciiDone)
+		{
+			size_t count = CountTrailingOnes(current.printable);
+			runs.ascii += count;
+			asciiDone = count < 64;
+		}
+
+		if (!utf16Done)
+		{
+			uint64_t starts = current.printable & zero1 & utf16Starts;
+			size_t count = CountTrailingOnes(starts | ~utf16Starts);
+			runs.utf16 += count / 2;
+			utf16Done = count < 64;
+		}
+
+		if (!utf32Done)
+		{
+			uint64_t starts = current.printable & zero1 & zero2 & zero3 & utf32Starts;
+			size_t count = CountTrailingOnes(starts | ~utf32Starts);
+			runs.utf32 += count / 4;
+			utf32Done = count < 64;
+		}
+
+		if (asciiDone && utf16Done && utf32Done)
+			break;
+
+		current = next;
+	}
+	return runs;
+}
+
+
+// Without vector instructions, computing the masks of a whole block costs more than it saves, so each encoding is
+// scanned until its first non-printable character instead
+PrintableRuns BinaryNinjaDebugger::ClassifyPrintableScalar(const uint8_t* data, size_t length)
+{
+	PrintableRuns runs;
+	while ((runs.ascii < length) && IsPrintableChar(data[runs.ascii]))
+		runs.ascii++;
+
+	for (size_t i = 0; (i + 2 <= length) && IsPrintableChar(data[i]) && (data[i + 1] == 0); i += 2)
+		runs.utf16++;
+
+	for (size_t i = 0; (i + 4 <= length) && IsPrintableChar(data[i]) && (data[i + 1] == 0) && (data[i + 2] == 0)
+		 && (data[i + 3] == 0);
+		 i += 4)
+		runs.utf32++;
+
+	return runs;
+}
+
+
+#ifdef DEBUGGER_X86_64
+PrintableRuns BinaryNinjaDebugger::ClassifyPrintableSSE2(const uint8_t* data, size_t length)
+{
+	return CountPrintableRuns<ComputeMasksSSE2>(data, length);
+}
+
+
+DEBUGGER_TARGET_AVX2 PrintableRuns BinaryNinjaDebugger::ClassifyPrintableAVX2(const uint8_t* data, size_t length)
+{
+	return CountPrintableRuns<ComputeMasksAVX2>(data, length);
+}
+
+
+bool BinaryNinjaDebugger::IsAVX2Supported()
+{
+#ifdef _MSC_VER
+	int info[4];
+	__cpuid(info, 0);
+	if (info[0] < 7)
+		return false;
+
+	// The OS must save the YMM registers, and the CPU must support AVX and AVX2
+	__cpuid(info, 1);
+	bool osxsave = (info[2] & (1 << 27)) != 0;
+	bool avx = (info[2] & (1 << 28)) != 0;
+	if (!osxsave || !avx || ((_xgetbv(0) & 6) != 6))
+		return false;
+
+	__cpuidex(info, 7, 0);
+	return (info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+
+using PrintableClassifier = std::pair<PrintableRuns (*)(const uint8_t*, size_t), const char*>;
+
+
+static PrintableClassifier DetectPrintableClassifier()
+{
+#ifdef DEBUGGER_X86_64
+	if (IsAVX2Supported())
+		return {ClassifyPrintableAVX2, "avx2"};
+	return {ClassifyPrintableSSE2, "sse2"};
+#else
+	return {ClassifyPrintableScalar, "scalar"};
+#endif
+}
+
+
+static PrintableClassifier SelectPrintableClassifier()
+{
+	// The CPU does not change, so it is only detected once
+	static const PrintableClassifier classifier = DetectPrintableClassifier();
+	return classifier;
+}
+
+
+PrintableRuns BinaryNinjaDebugger::ClassifyPrintable(const uint8_t* data, size_t length)
+{
+	return SelectPrintableClassifier().first(data, length);
+}
+
+
+const char* BinaryNinjaDebugger::GetPrintableClassifierName()
+{
+	return SelectPrintableClassifier().second;
+}
+
+
+AddressIntervals::AddressIntervals(std::vector<std::pair<uint64_t, uint64_t>> intervals)
+{
+	std::sort(intervals.begin(), intervals.end());
+	for (const auto& [start, end] : intervals)
+	{
+		if (start >= end)
+			continue;
+
+		if (!m_intervals.empty() && (start <= m_intervals.back().second))
+			m_intervals.back().second = std::max(m_intervals.back().second, end);
+		else
+			m_intervals.emplace_back(start, end);
+	}
+}
+
+
+bool AddressIntervals::Contains(uint64_t address) const
+{
+	auto iter = std::upper_bound(m_intervals.begin(), m_intervals.end(), address,
+		[](uint64_t value, const std::pair<uint64_t, uint64_t>& interval) { return value < interval.first; });
+	if (iter == m_intervals.begin())
+		return false;
+
+	iter--;
+	return address < iter->second;
+}
+
+
+void BinaryNinjaDebugger::ClassifyPointers(const uint64_t* values, size_t count, const AddressIntervals& modules,
+	uint64_t minimum, std::vector<PointerKind>& kinds)
+{
+	kinds.resize(count);
+	if (modules.IsEmpty())
+	{
+		for (size_t i = 0; i < count; i++)
+			kinds[i] = values[i] < minimum ? PointerKind::NotPointer : PointerKind::OtherPointer;
+		return;
+	}
+
+	// Most values on the stack are not near any module, so they are rejected by the bounds of all modules before the
+	// intervals are searched
+	uint64_t lowest = modules.GetIntervals().front().first;
+	uint64_t highest = modules.GetIntervals().back().second;
+	for (size_t i = 0; i < count; i++)
+	{
+		uint64_t value = values[i];
+		if (value < minimum)
+			kinds[i] = PointerKind::NotPointer;
+		else if ((value >= lowest) && (value < highest) && modules.Contains(value))
+			kinds[i] = PointerKind::ModulePointer;
+		else
+			kinds[i] = PointerKind::OtherPointer;
+	}
+}
@@ -0,0 +1,78 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// These kernels only depend on the standard library, so that they can be built into the benchmark on their own
+namespace BinaryNinjaDebugger {
+	// The number of printable characters at the start of a buffer, when it is read as ASCII, UTF-16 and UTF-32. A
+	// UTF-16 or UTF-32 character is printable if its low byte is printable and the other bytes are zero.
+	struct PrintableRuns
+	{
+		size_t ascii = 0;
+		size_t utf16 = 0;
+		size_t utf32 = 0;
+	};
+
+	// Classifies the buffer for all three encodings in one pass, with the widest vector instructions the CPU supports
+	PrintableRuns ClassifyPrintable(const uint8_t* data, size_t length);
+	// The name of the implementation ClassifyPrintable() uses, i.e., "avx2", "sse2" or "scalar"
+	const char* GetPrintableClassifierName();
+
+	// The individual implementations, which are exposed for the benchmark
+	PrintableRuns ClassifyPrintableScalar(const uint8_t* data, size_t length);
+#if defined(__x86_64__) || defined(_M_X64)
+	PrintableRuns ClassifyPrintableSSE2(const uint8_t* data, size_t length);
+	PrintableRuns ClassifyPrintableAVX2(const uint8_t* data, size_t length);
+	bool IsAVX2Supported();
+#endif
+
+
+	// A set of disjoint [start, end) ranges, e.g., the address ranges of the loaded modules
+	class AddressIntervals
+	{
+		std::vector<std::pair<uint64_t, uint64_t>> m_intervals;
+
+	public:
+		AddressIntervals() = default;
+		// The ranges can be given in any order, and overlapping ones are merged
+		AddressIntervals(std::vector<std::pair<uint64_t, uint64_t>> intervals);
+
+		bool Contains(uint64_t address) const;
+		bool IsEmpty() const { return m_intervals.empty(); }
+		const std::vector<std::pair<uint64_t, uint64_t>>& GetIntervals() const { return m_intervals; }
+	};
+
+
+	enum class PointerKind : uint8_t
+	{
+		// Zero, or so small that it is far more likely a counter or an offset
+		NotPointer,
+		// Points into one of the modules, i.e., code or global data
+		ModulePointer,
+		// Might point to the heap, the stack, or other mapped memory
+		OtherPointer
+	};
+
+	// Classifies pointer-sized values in bulk. Values below `minimum` are not pointers.
+	void ClassifyPointers(const uint64_t* values, size_t count, const AddressIntervals& modules, uint64_t minimum,
+		std::vector<PointerKind>& kinds);
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,331 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <cstring>
+#include "memorydiff.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+static constexpr uint64_t Prime1 = 0x9E3779B185EBCA87ULL;
+static constexpr uint64_t Prime2 = 0xC2B2AE3D27D4EB4FULL;
+static constexpr uint64_t Prime3 = 0x165667B19E3779F9ULL;
+static constexpr uint64_t Prime4 = 0x85EBCA77C2B2AE63ULL;
+static constexpr uint64_t Prime5 = 0x27D4EB2F165667C5ULL;
+
+
+static inline uint64_t RotateLeft(uint64_t value, int bits)
+{
+	return (value << bits) | (value >> (64 - bits));
+}
+
+
+static inline uint64_t Read64(const uint8_t* data)
+{
+	uint64_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+static inline uint32_t Read32(const uint8_t* data)
+{
+	uint32_t value;
+	memcpy(&value, data, sizeof(value));
+	return value;
+}
+
+
+static inline uint64_t Round(uint64_t accumulator, uint64_t input)
+{
+	accumulator += input * Prime2;
+	accumulator = RotateLeft(accumulator, 31);
+	return accumulator * Prime1;
+}
+
+
+static inline uint64_t MergeRound(uint64_t accumulator, uint64_t value)
+{
+	accumulator ^= Round(0, value);
+	return accumulator * Prime1 + Prime4;
+}
+
+
+static inline uint64_t MergeLanes(const uint64_t* lanes)
+{
+	uint64_t hash =
+		RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) + RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+	for (size_t i = 0; i < 4; i++)
+		hash = MergeRound(hash, lanes[i]);
+	return hash;
+}
+
+
+static inline uint64_t Avalanche(uint64_t hash)
+{
+	hash ^= hash >> 33;
+	hash *= Prime2;
+	hash ^= hash >> 29;
+	hash *= Prime3;
+	hash ^= hash >> 32;
+	return hash;
+}
+
+
+static uint64_t AlignDown(uint64_t address)
+{
+	return address & ~(MemoryDiffTracker::PageSize - 1);
+}
+
+
+static uint64_t AlignUp(uint64_t address)
+{
+	if (address > ~(MemoryDiffTracker::PageSize - 1))
+		return ~(MemoryDiffTracker::PageSize - 1);
+	return AlignDown(address + MemoryDiffTracker::PageSize - 1);
+}
+
+
+uint64_t MemoryDiffTracker::Hash(const uint8_t* data, size_t size, uint64_t seed)
+{
+	const uint8_t* current = data;
+	const uint8_t* end = data + size;
+	uint64_t hash;
+
+	if (size >= 32)
+	{
+		uint64_t lanes[4] = {seed + Prime1 + Prime2, seed + Prime2, seed, seed - Prime1};
+		for (; current + 32 <= end; current += 32)
+		{
+			for (size_t i = 0; i < 4; i++)
+				lanes[i] = Round(lanes[i], Read64(current + i * 8));
+		}
+		hash = MergeLanes(lanes);
+	}
+	else
+	{
+		hash = seed + Prime5;
+	}
+
+	hash += size;
+	for (; current + 8 <= end; current += 8)
+	{
+		hash ^= Round(0, Read64(current));
+		hash = RotateLeft(hash, 27) * Prime1 + Prime4;
+	}
+	if (current + 4 <= end)
+	{
+		hash ^= Read32(current) * Prime1;
+		hash = RotateLeft(hash, 23) * Prime2 + Prime3;
+		current += 4;
+	}
+	for (; current < end; current++)
+	{
+		hash ^= *current * Prime5;
+		hash = RotateLeft(hash, 11) * Prime1;
+	}
+
+	return Avalanche(hash);
+}
+
+
+MemoryDiffTracker::PageHashes MemoryDiffTracker::HashPage(const uint8_t* data)
+{
+	static_assert(BlockSize % 32 == 0, "The blocks must be whole stripes");
+	PageHashes hashes;
+	hashes.readable = data != nullptr;
+	if (!data)
+	{
+		hashes.blocks.fill(0);
+		return hashes;
+	}
+
+	// Same as Hash() of every block, but the blocks are hashed side by side. The rounds of the same lane in different
+	// blocks are independent and laid out contiguously, so the compiler turns the inner loop into vector
+	// multiplications where the target has them, and interleaves 64 independent chains where it does not.
+	constexpr size_t Lanes = BlocksPerPage * 4;
+	uint64_t lanes[Lanes];
+	for (size_t i = 0; i < Lanes; i += 4)
+	{
+		lanes[i] = Prime1 + Prime2;
+		lanes[i + 1] = Prime2;
+		lanes[i + 2] = 0;
+		lanes[i + 3] = 0 - Prime1;
+	}
+	for (size_t stripe = 0; stripe < BlockSize; stripe += 32)
+	{
+		for (size_t i = 0; i < Lanes; i++)
+			lanes[i] = Round(lanes[i], Read64(data + (i / 4) * BlockSize + stripe + (i % 4) * 8));
+	}
+	for (size_t i = 0; i < BlocksPerPage; i++)
+		hashes.blocks[i] = Avalanche(MergeLanes(lanes + i * 4) + BlockSize);
+	return hashes;
+}
+
+
+void MemoryDiffTracker::Track(uint64_t start, uint64_t end)
+{
+	Range range = {AlignDown(start), AlignUp(end)};
+	if (range.start >= range.end)
+		return;
+
+	// Merge with the ranges that overlap or touch the new one
+	std::vector<Range> ranges;
+	for (const Range& current : m_ranges)
+	{
+		if ((current.end < range.start) || (current.start > range.end))
+		{
+			ranges.push_back(current);
+			continue;
+		}
+		range.start = std::min(range.start, current.start);
+		range.end = std::max(range.end, current.end);
+	}
+	ranges.push_back(range);
+	std::sort(ranges.begin(), ranges.end(), [](const Range& a, const Range& b) { return a.start < b.start; });
+	m_ranges = std::move(ranges);
+}
+
+
+void MemoryDiffTracker::Untrack(uint64_t start, uint64_t end)
+{
+	start = AlignDown(start);
+	end = AlignUp(end);
+	if (start >= end)
+		return;
+
+	std::vector<Range> ranges;
+	for (const Range& current : m_ranges)
+	{
+		if ((current.end <= start) || (current.start >= end))
+		{
+			ranges.push_back(current);
+			continue;
+		}
+		if (current.start < start)
+			ranges.push_back({current.start, start});
+		if (current.end > end)
+			ranges.push_back({end, current.end});
+	}
+	m_ranges = std::move(ranges);
+
+	for (auto iter = m_snapshot.begin(); iter != m_snapshot.end();)
+	{
+		if ((iter->first >= start) && (iter->first < end))
+			iter = m_snapshot.erase(iter);
+		else
+			iter++;
+	}
+}
+
+
+void MemoryDiffTracker::HashRange(const Range& range, const ReadFunction& read,
+	const std::function<void(uint64_t page, const PageHashes& hashes)>& onPage)
+{
+	std::vector<uint8_t> data;
+	uint64_t address = range.start;
+	while (address < range.end)
+	{
+		size_t size = std::min<uint64_t>(ChunkSize, range.end - address);
+		size_t bytesRead = read(address, size, data);
+		bytesRead = std::min(bytesRead, data.size());
+		size_t pagesRead = bytesRead / PageSize;
+		for (size_t i = 0; i < pagesRead; i++)
+			onPage(address + i * PageSize, HashPage(data.data() + i * PageSize));
+
+		address += pagesRead * PageSize;
+		if (bytesRead < size)
+		{
+			// The read stopped at a page that is not readable. Skip it, and carry on with the next one.
+			onPage(address, HashPage(nullptr));
+			address += PageSize;
+		}
+	}
+}
+
+
+void MemoryDiffTracker::TakeSnapshot(uint64_t start, uint64_t end, const ReadFunction& read)
+{
+	start = AlignDown(start);
+	end = AlignUp(end);
+	for (const Range& range : m_ranges)
+	{
+		Range overlap = {std::max(range.start, start), std::min(range.end, end)};
+		if (overlap.start >= overlap.end)
+			continue;
+
+		HashRange(overlap, read, [&](uint64_t page, const PageHashes& hashes) { m_snapshot.emplace(page, hashes); });
+	}
+}
+
+
+void MemoryDiffTracker::AddChange(uint64_t start, uint64_t end)
+{
+	if (!m_changedRanges.empty() && (m_changedRanges.back().end == start))
+		m_changedRanges.back().end = end;
+	else
+		m_changedRanges.push_back({start, end});
+
+	uint64_t page = AlignDown(start);
+	if (m_changedPages.empty() || (m_changedPages.back() != page))
+		m_changedPages.push_back(page);
+}
+
+
+void MemoryDiffTracker::ComparePage(uint64_t page, const PageHashes& hashes)
+{
+	auto iter = m_snapshot.find(page);
+	if (iter == m_snapshot.end())
+	{
+		// Nothing to compare with the first time the page is hashed
+		m_snapshot.emplace(page, hashes);
+		return;
+	}
+
+	PageHashes& previous = iter->second;
+	if (previous.readable != hashes.readable)
+	{
+		AddChange(page, page + PageSize);
+	}
+	else if (hashes.readable)
+	{
+		for (size_t i = 0; i < BlocksPerPage; i++)
+		{
+			if (previous.blocks[i] != hashes.blocks[i])
+				AddChange(page + i * BlockSize, page + (i + 1) * BlockSize);
+		}
+	}
+	previous = hashes;
+}
+
+
+void MemoryDiffTracker::Update(const ReadFunction& read)
+{
+	m_changedRanges.clear();
+	m_changedPages.clear();
+	// The ranges are sorted, so the changes are found in ascending order
+	for (const Range& range : m_ranges)
+		HashRange(range, read, [&](uint64_t page, const PageHashes& hashes) { ComparePage(page, hashes); });
+}
+
+
+void MemoryDiffTracker::Reset()
+{
+	m_snapshot.clear();
+	m_changedRanges.clear();
+	m_changedPages.clear();
+}
@@ -0,0 +1,92 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	// Finds out which memory of the target changed between two stops. At every stop, the tracked ranges are hashed in
+	// blocks, and the hashes are compared with the ones of the previous stop. Only the hashes are kept, not the memory,
+	// so the changes are accurate to a block rather than to a byte.
+	class MemoryDiffTracker
+	{
+	public:
+		struct Range
+		{
+			uint64_t start;
+			uint64_t end;
+		};
+
+		// Reads [address, address + size) into `data`. Returns the number of bytes read, which is less than `size` if
+		// the read stops at memory that is not readable.
+		using ReadFunction = std::function<size_t(uint64_t address, size_t size, std::vector<uint8_t>& data)>;
+
+		static constexpr uint64_t PageSize = 0x1000;
+		static constexpr size_t BlockSize = 0x100;
+		static constexpr size_t BlocksPerPage = PageSize / BlockSize;
+		static constexpr size_t ChunkSize = 0x100000;
+
+		// XXH64 of the data. It keeps four independent lanes, so the multiplications of each 32-byte stripe do not
+		// wait for each other.
+		static uint64_t Hash(const uint8_t* data, size_t size, uint64_t seed = 0);
+
+	private:
+		struct PageHashes
+		{
+			bool readable;
+			std::array<uint64_t, BlocksPerPage> blocks;
+		};
+
+		// Sorted, page aligned and not overlapping or adjacent
+		std::vector<Range> m_ranges;
+		std::unordered_map<uint64_t, PageHashes> m_snapshot;
+		std::vector<Range> m_changedRanges;
+		std::vector<uint64_t> m_changedPages;
+
+		static PageHashes HashPage(const uint8_t* data);
+		void HashRange(const Range& range, const ReadFunction& read,
+			const std::function<void(uint64_t page, const PageHashes& hashes)>& onPage);
+		void AddChange(uint64_t start, uint64_t end);
+		void ComparePage(uint64_t page, const PageHashes& hashes);
+
+	public:
+		// The range is extended to whole pages. Its pages are compared from the stop after they are first hashed.
+		void Track(uint64_t start, uint64_t end);
+		// Stop tracking the pages within [start, end), and drop their hashes
+		void Untrack(uint64_t start, uint64_t end);
+		const std::vector<Range>& GetTrackedRanges() const { return m_ranges; }
+		bool IsTracking() const { return !m_ranges.empty(); }
+
+		// Hash the tracked pages within [start, end) that have no hashes yet, without comparing anything. This lets a
+		// range that is tracked while the target is stopped be compared at the next stop.
+		void TakeSnapshot(uint64_t start, uint64_t end, const ReadFunction& read);
+		// Hash all the tracked pages and compare them with the previous hashes. A page that becomes readable or stops
+		// being readable counts as changed as a whole.
+		void Update(const ReadFunction& read);
+		// Drop the hashes and the changes, e.g., when the target exits. The ranges are kept.
+		void Reset();
+
+		// The changes found by the last Update(), sorted and merged. The ranges are aligned to BlockSize.
+		const std::vector<Range>& GetChangedRanges() const { return m_changedRanges; }
+		const std::vector<uint64_t>& GetChangedPages() const { return m_changedPages; }
+	};
+};  // namespace BinaryNinjaDebugger
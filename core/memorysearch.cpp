@@ -0,0 +1,202 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <thread>
+#include "memorysearch.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+MemorySearch::MemorySearch(const PatternMatcher& matcher, ReadFunction read, MatchFunction onMatch,
+	size_t maxResults, const MemorySearchCancelToken* cancel) :
+	m_matcher(matcher),
+	m_read(std::move(read)), m_onMatch(std::move(onMatch)), m_maxResults(maxResults), m_cancel(cancel)
+{}
+
+
+size_t MemorySearch::Run(const std::vector<Range>& ranges)
+{
+	if (m_matcher.GetLength() == 0)
+		return 0;
+
+	struct Chunk
+	{
+		size_t index;
+		uint64_t address;
+		// Only the matches that start in the first `owned` bytes belong to this chunk. The rest of the data overlaps
+		// with the next chunk, so that the matches that cross the boundary are found.
+		size_t owned;
+		std::vector<uint8_t> data;
+	};
+
+	const uint64_t pageSize = 0x1000;
+	const size_t overlap = m_matcher.GetLength() - 1;
+
+	size_t chunkCount = 0;
+	for (const Range& range : ranges)
+	{
+		if (range.end > range.start)
+			chunkCount += (range.end - range.start + ChunkSize - 1) / ChunkSize;
+	}
+	if (chunkCount == 0)
+		return 0;
+
+	// The reads are serialized by the adapter, so there is no point in more workers than can keep up with them
+	size_t workerCount = std::min<size_t>({std::max<size_t>(std::thread::hardware_concurrency(), 1), 8, chunkCount});
+	size_t maxQueued = workerCount * 2;
+
+	std::mutex mutex;
+	std::condition_variable workAvailable;
+	std::condition_variable resultsAvailable;
+	std::deque<Chunk> queue;
+	// The matches of the chunks that are done, keyed by the index of the chunk
+	std::map<size_t, std::vector<uint64_t>> completed;
+	bool readingDone = false;
+	std::atomic<bool> stop = false;
+
+	auto isCancelled = [&]() { return stop || (m_cancel && m_cancel->IsCancelled()); };
+
+	auto worker = [&]() {
+		while (true)
+		{
+			Chunk chunk;
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				workAvailable.wait(lock, [&]() { return !queue.empty() || readingDone || stop; });
+				if (stop || queue.empty())
+					return;
+				chunk = std::move(queue.front());
+				queue.pop_front();
+			}
+			resultsAvailable.notify_all();
+
+			std::vector<uint64_t> matches;
+			m_matcher.Find(chunk.data.data(), chunk.data.size(), [&](size_t offset) {
+				// The matches come in ascending order, so the ones after this belong to the next chunk as well
+				if (offset >= chunk.owned)
+					return false;
+				matches.push_back(chunk.address + offset);
+				return !isCancelled() && ((m_maxResults == 0) || (matches.size() < m_maxResults));
+			});
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				completed[chunk.index] = std::move(matches);
+			}
+			resultsAvailable.notify_all();
+		}
+	};
+
+	std::vector<std::thread> workers;
+	for (size_t i = 0; i < workerCount; i++)
+		workers.emplace_back(worker);
+
+	// Report the matches of the chunks that are done, in the order of the chunks. Called with the lock held, which is
+	// released while the callback runs.
+	size_t nextIndex = 0;
+	size_t reported = 0;
+	auto deliver = [&](std::unique_lock<std::mutex>& lock) {
+		while (!stop)
+		{
+			auto iter = completed.find(nextIndex);
+			if (iter == completed.end())
+				return;
+
+			std::vector<uint64_t> matches = std::move(iter->second);
+			completed.erase(iter);
+			nextIndex++;
+
+			lock.unlock();
+			for (uint64_t address : matches)
+			{
+				if (isCancelled())
+				{
+					stop = true;
+					break;
+				}
+				reported++;
+				if (!m_onMatch(address) || ((m_maxResults != 0) && (reported >= m_maxResults)))
+				{
+					stop = true;
+					break;
+				}
+			}
+			lock.lock();
+		}
+	};
+
+	size_t index = 0;
+	for (const Range& range : ranges)
+	{
+		uint64_t address = range.start;
+		while ((address < range.end) && !isCancelled())
+		{
+			size_t owned = std::min<uint64_t>(ChunkSize, range.end - address);
+			size_t size = std::min<uint64_t>(owned + overlap, range.end - address);
+
+			Chunk chunk {index++, address, 0, {}};
+			size_t read = m_read(address, size, chunk.data);
+			chunk.data.resize(read);
+			chunk.owned = std::min(owned, read);
+
+			// The chunk runs into memory that cannot be read. Skip the page where the read stopped.
+			uint64_t next = address + owned;
+			if (read < owned)
+				next = std::min<uint64_t>(((address + read) & ~(pageSize - 1)) + pageSize, next);
+
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				resultsAvailable.wait(lock, [&]() { return (queue.size() < maxQueued) || stop; });
+				if (chunk.data.empty())
+					completed[chunk.index] = {};
+				else
+					queue.push_back(std::move(chunk));
+				deliver(lock);
+			}
+			workAvailable.notify_one();
+			address = next;
+		}
+	}
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		readingDone = true;
+	}
+	workAvailable.notify_all();
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		while (true)
+		{
+			deliver(lock);
+			if (stop || (nextIndex == index))
+				break;
+			resultsAvailable.wait(lock, [&]() { return (completed.find(nextIndex) != completed.end()) || stop; });
+		}
+		stop = true;
+	}
+	workAvailable.notify_all();
+
+	for (auto& thread : workers)
+		thread.join();
+
+	return reported;
+}
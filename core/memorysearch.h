@@ -0,0 +1,72 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+#include "patternmatcher.h"
+
+namespace BinaryNinjaDebugger {
+	// Stops a memory search from another thread
+	class MemorySearchCancelToken
+	{
+		std::atomic<bool> m_cancelled = false;
+
+	public:
+		void Cancel() { m_cancelled = true; }
+		bool IsCancelled() const { return m_cancelled; }
+	};
+
+
+	// Searches ranges of the target's memory for a pattern. The calling thread reads the ranges in large chunks, while
+	// worker threads match the chunks that are already read. The matches are reported on the calling thread, in
+	// ascending order of their addresses.
+	class MemorySearch
+	{
+	public:
+		struct Range
+		{
+			uint64_t start;
+			uint64_t end;
+		};
+
+		// Reads [address, address + size) into `data`. Returns the number of bytes read, which is less than `size` if
+		// the read stops at memory that is not readable.
+		using ReadFunction = std::function<size_t(uint64_t address, size_t size, std::vector<uint8_t>& data)>;
+		// Returns false to stop the search
+		using MatchFunction = std::function<bool(uint64_t address)>;
+
+		static constexpr size_t ChunkSize = 0x100000;
+
+	private:
+		const PatternMatcher& m_matcher;
+		ReadFunction m_read;
+		MatchFunction m_onMatch;
+		size_t m_maxResults;
+		const MemorySearchCancelToken* m_cancel;
+
+	public:
+		// `maxResults` of 0 means no limit. `cancel` can be nullptr.
+		MemorySearch(const PatternMatcher& matcher, ReadFunction read, MatchFunction onMatch, size_t maxResults,
+			const MemorySearchCancelToken* cancel);
+
+		// Returns the number of matches reported
+		size_t Run(const std::vector<Range>& ranges);
+	};
+};  // namespace BinaryNinjaDebugger
@@ -0,0 +1,184 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <cstring>
+#include "patternmatcher.h"
+#include "memoryclassifier.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+	#define DEBUGGER_X86_64
+	#include <immintrin.h>
+	#ifdef _MSC_VER
+		#define DEBUGGER_TARGET_AVX2
+	#else
+		#define DEBUGGER_TARGET_AVX2 __attribute__((target("avx2")))
+	#endif
+#endif
+
+#ifdef _MSC_VER
+	#include <intrin.h>
+#endif
+
+using namespace BinaryNinjaDebugger;
+
+
+static inline size_t CountTrailingZeros(uint32_t value)
+{
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, value);
+	return index;
+#else
+	return __builtin_ctz(value);
+#endif
+}
+
+
+PatternMatcher::PatternMatcher(const std::vector<uint8_t>& bytes, const std::vector<uint8_t>& mask) :
+	m_bytes(bytes), m_mask(mask)
+{
+	m_mask.resize(m_bytes.size(), 0xff);
+
+	// Zero and 0xff are the most common bytes in memory, so they make poor anchors if there is anything else
+	for (bool rareOnly : {true, false})
+	{
+		for (size_t i = 0; i < m_bytes.size(); i++)
+		{
+			if ((m_mask[i] != 0xff) || (rareOnly && ((m_bytes[i] == 0) || (m_bytes[i] == 0xff))))
+				continue;
+
+			if (!m_hasAnchor)
+				m_firstAnchor = i;
+			m_lastAnchor = i;
+			m_hasAnchor = true;
+		}
+		if (m_hasAnchor)
+			break;
+	}
+
+	for (size_t i = 0; i < m_bytes.size(); i++)
+	{
+		m_bytes[i] &= m_mask[i];
+		m_exact = m_exact && (m_mask[i] == 0xff);
+	}
+}
+
+
+bool PatternMatcher::Matches(const uint8_t* data) const
+{
+	if (m_exact)
+		return memcmp(data, m_bytes.data(), m_bytes.size()) == 0;
+
+	for (size_t i = 0; i < m_bytes.size(); i++)
+	{
+		if ((data[i] & m_mask[i]) != m_bytes[i])
+			return false;
+	}
+	return true;
+}
+
+
+// Looks for the first anchor with memchr(), and checks the whole pattern wherever it is found
+bool PatternMatcher::FindScalar(
+	const uint8_t* data, size_t length, size_t start, const std::function<bool(size_t)>& onMatch) const
+{
+	size_t positions = length - m_bytes.size() + 1;
+	for (size_t i = start; i < positions; i++)
+	{
+		if (m_hasAnchor)
+		{
+			const void* found = memchr(data + i + m_firstAnchor, m_bytes[m_firstAnchor], positions - i);
+			if (!found)
+				return true;
+			i = (const uint8_t*)found - data - m_firstAnchor;
+		}
+
+		if (Matches(data + i) && !onMatch(i))
+			return false;
+	}
+	return true;
+}
+
+
+#ifdef DEBUGGER_X86_64
+bool PatternMatcher::FindSSE2(const uint8_t* data, size_t length, const std::function<bool(size_t)>& onMatch) const
+{
+	const __m128i first = _mm_set1_epi8((char)m_bytes[m_firstAnchor]);
+	const __m128i last = _mm_set1_epi8((char)m_bytes[m_lastAnchor]);
+
+	// The loads at the anchors never reach past the last byte of the pattern, so they stay within the buffer
+	size_t positions = length - m_bytes.size() + 1;
+	size_t i = 0;
+	for (; i + 16 <= positions; i += 16)
+	{
+		__m128i firstMatches = _mm_cmpeq_epi8(first, _mm_loadu_si128((const __m128i*)(data + i + m_firstAnchor)));
+		__m128i lastMatches = _mm_cmpeq_epi8(last, _mm_loadu_si128((const __m128i*)(data + i + m_lastAnchor)));
+		uint32_t candidates = (uint32_t)_mm_movemask_epi8(_mm_and_si128(firstMatches, lastMatches));
+		for (; candidates != 0; candidates &= candidates - 1)
+		{
+			size_t offset = i + CountTrailingZeros(candidates);
+			if (Matches(data + offset) && !onMatch(offset))
+				return false;
+		}
+	}
+	return FindScalar(data, length, i, onMatch);
+}
+
+
+DEBUGGER_TARGET_AVX2 bool PatternMatcher::FindAVX2(
+	const uint8_t* data, size_t length, const std::function<bool(size_t)>& onMatch) const
+{
+	const __m256i first = _mm256_set1_epi8((char)m_bytes[m_firstAnchor]);
+	const __m256i last = _mm256_set1_epi8((char)m_bytes[m_lastAnchor]);
+
+	size_t positions = length - m_bytes.size() + 1;
+	size_t i = 0;
+	for (; i + 32 <= positions; i += 32)
+	{
+		__m256i firstMatches =
+			_mm256_cmpeq_epi8(first, _mm256_loadu_si256((const __m256i*)(data + i + m_firstAnchor)));
+		__m256i lastMatches = _mm256_cmpeq_epi8(last, _mm256_loadu_si256((const __m256i*)(data + i + m_lastAnchor)));
+		uint32_t candidates = (uint32_t)_mm256_movemask_epi8(_mm256_and_si256(firstMatches, lastMatches));
+		for (; candidates != 0; candidates &= candidates - 1)
+		{
+			size_t offset = i + CountTrailingZeros(candidates);
+			if (Matches(data + offset) && !onMatch(offset))
+				return false;
+		}
+	}
+	return FindScalar(data, length, i, onMatch);
+}
+#endif
+
+
+bool PatternMatcher::Find(const uint8_t* data, size_t length, const std::function<bool(size_t)>& onMatch) const
+{
+	if (m_bytes.empty() || (length < m_bytes.size()))
+		return true;
+
+	// A pattern of wildcards only has nothing to compare in bulk
+	if (!m_hasAnchor)
+		return FindScalar(data, length, 0, onMatch);
+
+#ifdef DEBUGGER_X86_64
+	static const bool avx2 = IsAVX2Supported();
+	if (avx2)
+		return FindAVX2(data, length, onMatch);
+	return FindSSE2(data, length, onMatch);
+#else
+	return FindScalar(data, length, 0, onMatch);
+#endif
+}
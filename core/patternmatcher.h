@@ -0,0 +1,57 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	// Finds a byte pattern with a mask in a buffer. A byte of the buffer matches if it equals the byte of the pattern
+	// in the bits that are set in the mask, so a mask byte of 0xff is an exact byte and 0x00 is a wildcard.
+	//
+	// Two bytes of the pattern that must match exactly serve as anchors. They are compared against 16 or 32 positions
+	// of the buffer at once, and only the positions where both anchors match are compared with the whole pattern.
+	class PatternMatcher
+	{
+		std::vector<uint8_t> m_bytes;
+		std::vector<uint8_t> m_mask;
+		bool m_exact = true;
+		bool m_hasAnchor = false;
+		size_t m_firstAnchor = 0;
+		size_t m_lastAnchor = 0;
+
+		bool Matches(const uint8_t* data) const;
+		bool FindScalar(
+			const uint8_t* data, size_t length, size_t start, const std::function<bool(size_t)>& onMatch) const;
+#if defined(__x86_64__) || defined(_M_X64)
+		bool FindSSE2(const uint8_t* data, size_t length, const std::function<bool(size_t)>& onMatch) const;
+		bool FindAVX2(const uint8_t* data, size_t length, const std::function<bool(size_t)>& onMatch) const;
+#endif
+
+	public:
+		// The mask is either empty, i.e., all bytes are exact, or as long as the pattern
+		PatternMatcher(const std::vector<uint8_t>& bytes, const std::vector<uint8_t>& mask = {});
+
+		size_t GetLength() const { return m_bytes.size(); }
+
+		// Calls `onMatch` with the offset of every match in the buffer, in ascending order. The search stops when
+		// `onMatch` returns false, in which case this returns false as well.
+		bool Find(const uint8_t* data, size_t length, const std::function<bool(size_t)>& onMatch) const;
+	};
+};  // namespace BinaryNinjaDebugger
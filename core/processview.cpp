@@ -14,6 +14,9 @@ See the License for the specific language governing permissions and
 limitations under the License.
 */
 
+#include <algorithm>
+#include <iterator>
+#include <tuple>
 #include "processview.h"
 #include "debuggerstate.h"
 #include "debuggercontroller.h"
@@ -38,7 +41,7 @@ DebugProcessView::DebugProcessView(DebugNullView* nullView, BinaryView* parent):
 
 	m_endian = parent->GetDefaultEndianness();
 
-	// TODO: Read segments from debugger
+	// The segments of the mapped regions are added once the target stops, see UpdateSegments()
 	uint64_t length = PerformGetLength();
 	// If we do not add any segments, BN will malfunction. If we add a binary view that is large, e.g., 0xffffffff,
 	// it will be truncated to the size of the parent view. And the region from 0x0 to the size of the parent view will
@@ -138,6 +141,124 @@ void BinaryNinjaDebugger::InitDebugProcessViewType()
 }
 
 
+bool DebugProcessView::FindRegion(uint64_t address, DebugMemoryRegion& region)
+{
+	std::unique_lock<std::mutex> lock(m_regionsMutex);
+	auto iter = std::upper_bound(m_regions.begin(), m_regions.end(), address,
+		[](uint64_t value, const DebugMemoryRegion& entry) { return value < entry.m_start; });
+	if (iter == m_regions.begin())
+		return false;
+
+	iter--;
+	if (address >= iter->m_end)
+		return false;
+
+	region = *iter;
+	return true;
+}
+
+
+// These only consult the copy of the memory map, so they never cost a round trip to the backend
+bool DebugProcessView::PerformIsValidOffset(uint64_t addr)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_regionsMutex);
+		if (m_regions.empty())
+			return true;
+	}
+	DebugMemoryRegion region;
+	return FindRegion(addr, region);
+}
+
+
+bool DebugProcessView::PerformIsOffsetReadable(uint64_t addr)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_regionsMutex);
+		if (m_regions.empty())
+			return BinaryView::PerformIsOffsetReadable(addr);
+	}
+	DebugMemoryRegion region;
+	return FindRegion(addr, region) && region.m_readable;
+}
+
+
+bool DebugProcessView::PerformIsOffsetWritable(uint64_t addr)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_regionsMutex);
+		if (m_regions.empty())
+			return BinaryView::PerformIsOffsetWritable(addr);
+	}
+	DebugMemoryRegion region;
+	return FindRegion(addr, region) && region.m_writable;
+}
+
+
+bool DebugProcessView::PerformIsOffsetExecutable(uint64_t addr)
+{
+	{
+		std::unique_lock<std::mutex> lock(m_regionsMutex);
+		if (m_regions.empty())
+			return BinaryView::PerformIsOffsetExecutable(addr);
+	}
+	DebugMemoryRegion region;
+	return FindRegion(addr, region) && region.m_executable;
+}
+
+
+// Mirror the memory map of the target with segments. The segments are not backed by the parent view, so the reads
+// still go through PerformRead(). The map is cached by the controller, so this only costs a round trip after a
+// module is loaded.
+void DebugProcessView::UpdateSegments()
+{
+	std::vector<DebugMemoryRegion> regions = m_controller->GetMemoryRegions();
+	std::vector<DebugMemoryRegion> oldRegions;
+	{
+		std::unique_lock<std::mutex> lock(m_regionsMutex);
+		if (regions == m_regions)
+			return;
+		oldRegions = m_regions;
+		m_regions = regions;
+	}
+
+	// Only the segments that changed are touched, since every change makes the core rebuild its segment list. Two
+	// regions that only differ in their name are the same segment.
+	auto segmentFlags = [](const DebugMemoryRegion& region) {
+		uint32_t flags = 0;
+		if (region.m_readable)
+			flags |= SegmentReadable;
+		if (region.m_writable)
+			flags |= SegmentWritable;
+		if (region.m_executable)
+			flags |= SegmentExecutable;
+		return flags;
+	};
+	auto segmentLess = [&](const DebugMemoryRegion& a, const DebugMemoryRegion& b) {
+		return std::make_tuple(a.m_start, a.m_end, segmentFlags(a))
+			< std::make_tuple(b.m_start, b.m_end, segmentFlags(b));
+	};
+	// The segment at 0x0 is kept as it is, see the constructor
+	auto isWorkaroundSegment = [](const DebugMemoryRegion& region) { return region.m_start == 0; };
+	oldRegions.erase(std::remove_if(oldRegions.begin(), oldRegions.end(), isWorkaroundSegment), oldRegions.end());
+	regions.erase(std::remove_if(regions.begin(), regions.end(), isWorkaroundSegment), regions.end());
+	std::sort(oldRegions.begin(), oldRegions.end(), segmentLess);
+	std::sort(regions.begin(), regions.end(), segmentLess);
+
+	std::vector<DebugMemoryRegion> removed;
+	std::vector<DebugMemoryRegion> added;
+	std::set_difference(oldRegions.begin(), oldRegions.end(), regions.begin(), regions.end(),
+		std::back_inserter(removed), segmentLess);
+	std::set_difference(regions.begin(), regions.end(), oldRegions.begin(), oldRegions.end(),
+		std::back_inserter(added), segmentLess);
+
+	for (const DebugMemoryRegion& region : removed)
+		RemoveAutoSegment(region.m_start, region.m_end - region.m_start);
+	for (const DebugMemoryRegion& region : added)
+		AddAutoSegment(region.m_start, region.m_end - region.m_start, 0, 0, segmentFlags(region));
+}
+
+
 size_t DebugProcessView::PerformRead(void* dest, uint64_t offset, size_t len)
 {
 	DataBuffer buffer = m_controller->ReadMemory(offset, len);
@@ -159,17 +280,128 @@ size_t DebugProcessView::PerformWrite(uint64_t offset, const void* data, size_t
 }
 
 
+// How far below the stack pointer the target can write without moving it, e.g., the red zone of the x86_64 ABI
+static constexpr uint64_t StackRedZone = 0x80;
+// How much of the stack above the stack pointer a step is assumed to modify
+static constexpr uint64_t StackWindowSize = 0x1000;
+// Two stack pointers that are further apart are on different stacks, e.g., when the active thread changed
+static constexpr uint64_t MaxStackDistance = 0x100000;
+
+
+void DebugProcessView::AddStackRanges(std::vector<DebugMemoryRange>& ranges)
+{
+	auto addWindow = [&](uint64_t low, uint64_t high) {
+		uint64_t start = low > StackRedZone ? low - StackRedZone : 0;
+		uint64_t end = high + std::min(StackWindowSize, UINT64_MAX - high);
+		// Do not spill into the neighbouring regions, if the memory map is known
+		DebugMemoryRegion region;
+		if (FindRegion(low, region))
+		{
+			start = std::max(start, region.m_start);
+			end = std::min(end, region.m_end);
+		}
+		if (start < end)
+			ranges.emplace_back(start, end - start);
+	};
+
+	uint64_t stackPointer = m_controller->GetState()->StackPointer();
+	if (stackPointer == 0)
+		return;
+
+	uint64_t low = std::min(stackPointer, m_lastStackPointer);
+	uint64_t high = std::max(stackPointer, m_lastStackPointer);
+	if ((m_lastStackPointer != 0) && (high - low <= MaxStackDistance))
+	{
+		addWindow(low, high);
+	}
+	else
+	{
+		addWindow(stackPointer, stackPointer);
+		if (m_lastStackPointer != 0)
+			addWindow(m_lastStackPointer, m_lastStackPointer);
+	}
+	m_lastStackPointer = stackPointer;
+}
+
+
+bool DebugProcessView::AddRegionRanges(std::vector<DebugMemoryRange>& ranges, bool executableOnly)
+{
+	std::unique_lock<std::mutex> lock(m_regionsMutex);
+	if (m_regions.empty())
+		return false;
+
+	for (const DebugMemoryRegion& region : m_regions)
+	{
+		if (region.m_readable && (region.m_executable || !executableOnly))
+			ranges.emplace_back(region.m_start, region.m_end - region.m_start);
+	}
+	return true;
+}
+
+
+void DebugProcessView::NotifyRanges(std::vector<DebugMemoryRange>& ranges)
+{
+	std::sort(ranges.begin(), ranges.end(),
+		[](const DebugMemoryRange& a, const DebugMemoryRange& b) { return a.m_address < b.m_address; });
+
+	// Merge the ranges that overlap or touch, so every byte is notified once
+	std::vector<DebugMemoryRange> merged;
+	for (const DebugMemoryRange& range : ranges)
+	{
+		if (range.m_size == 0)
+			continue;
+
+		if (!merged.empty() && (range.m_address <= merged.back().m_address + merged.back().m_size))
+		{
+			uint64_t end = std::max<uint64_t>(merged.back().m_address + merged.back().m_size,
+				range.m_address + range.m_size);
+			merged.back().m_size = end - merged.back().m_address;
+			continue;
+		}
+		merged.push_back(range);
+	}
+
+	for (const DebugMemoryRange& range : merged)
+		BinaryView::NotifyDataWritten(range.m_address, range.m_size);
+}
+
+
+// Only notify the memory that is known to have changed, so the analysis update after a step is proportional to what
+// changed: the memory written by the debugger, the stack around the stack pointer, and the tracked memory that changed
 void DebugProcessView::MarkDirty()
 {
+	std::vector<DebugMemoryRange> ranges = m_controller->TakeWrittenMemoryRanges();
+	AddStackRanges(ranges);
+
+	bool tracking = m_controller->IsTrackingMemoryChanges();
+	for (const MemoryDiffTracker::Range& range : m_controller->TakeChangedMemoryRanges())
+		ranges.emplace_back(range.start, range.end - range.start);
+
+	// With debugger.aggressiveAnalysisUpdate on, the code is expected to be modified at runtime. Without knowing
+	// which memory changed, all the executable memory is updated, or the whole address space without a memory map.
+	if (m_aggressiveAnalysisUpdate && !tracking && !AddRegionRanges(ranges, true))
+	{
+		BinaryView::NotifyDataWritten(0, GetLength());
+		return;
+	}
+
 	// This hack will let the views (linear/graph) update its display
-	uint64_t end = m_aggressiveAnalysisUpdate ? GetLength() : 1;
-	BinaryView::NotifyDataWritten(0, end);
+	if (ranges.empty())
+		ranges.emplace_back(0, 1);
+	NotifyRanges(ranges);
 }
 
 
 void DebugProcessView::ForceMemoryCacheUpdate()
 {
-	BinaryView::NotifyDataWritten(0, GetLength());
+	// Nothing outside the mapped regions can be read, so there is nothing to update there
+	std::vector<DebugMemoryRange> ranges;
+	if (!AddRegionRanges(ranges, false))
+	{
+		BinaryView::NotifyDataWritten(0, GetLength());
+		return;
+	}
+	NotifyRanges(ranges);
 }
 
 
@@ -180,6 +412,7 @@ void DebugProcessView::eventHandler(const DebuggerEvent &event)
 	case TargetStoppedEventType:
 	// We should not call MarkDirty() in case of a TargetExitedEvent, since the debugger binary view is about to be
 	// deleted. And it can cause a crash in certain cases.
+		UpdateSegments();
 		MarkDirty();
 		break;
 	case ForceMemoryCacheUpdateEvent:
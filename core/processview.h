@@ -16,8 +16,10 @@ limitations under the License.
 
 #pragma once
 
+#include <mutex>
 #include "binaryninjaapi.h"
 #include "debuggerevent.h"
+#include "debugadapter.h"
 #include "refcountobject.h"
 
 using namespace BinaryNinja;
@@ -40,13 +42,30 @@ namespace BinaryNinjaDebugger
 
 		bool m_aggressiveAnalysisUpdate;
 
+		// The memory map of the target, which the segments of the view mirror. Empty if the adapter does not know it.
+		std::mutex m_regionsMutex;
+		std::vector<DebugMemoryRegion> m_regions;
+
+		bool FindRegion(uint64_t address, DebugMemoryRegion& region);
+		void UpdateSegments();
+
+		// The stack pointer at the previous stop. The stack between it and the current one was pushed or popped.
+		uint64_t m_lastStackPointer = 0;
+		void AddStackRanges(std::vector<DebugMemoryRange>& ranges);
+		// Returns false if the memory map is not known
+		bool AddRegionRanges(std::vector<DebugMemoryRange>& ranges, bool executableOnly);
+		void NotifyRanges(std::vector<DebugMemoryRange>& ranges);
+
 		virtual uint64_t PerformGetEntryPoint() const override;
 
 		virtual bool PerformIsExecutable() const override { return true; }
 		virtual BNEndianness PerformGetDefaultEndianness() const override;
 		virtual bool PerformIsRelocatable() const override { return true; };
 		virtual size_t PerformGetAddressSize() const override;
-		virtual bool PerformIsValidOffset(uint64_t addr) override { return true; }
+		virtual bool PerformIsValidOffset(uint64_t addr) override;
+		virtual bool PerformIsOffsetReadable(uint64_t addr) override;
+		virtual bool PerformIsOffsetWritable(uint64_t addr) override;
+		virtual bool PerformIsOffsetExecutable(uint64_t addr) override;
 		virtual uint64_t PerformGetLength() const override;
 
 		virtual size_t PerformRead(void* dest, uint64_t offset, size_t len) override;
@@ -0,0 +1,79 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include <mutex>
+#include "registerschema.h"
+
+using namespace BinaryNinjaDebugger;
+
+
+RegisterSchema::RegisterSchema(
+	const std::string& architecture, const std::vector<std::pair<std::string, size_t>>& registers) :
+	m_architecture(architecture)
+{
+	m_names.reserve(registers.size());
+	m_widths.reserve(registers.size());
+	for (const auto& [name, width] : registers)
+	{
+		// The first register of a name wins, like the lookups by name always did
+		m_indices.emplace(name, m_names.size());
+		m_names.push_back(name);
+		m_widths.push_back(width);
+	}
+}
+
+
+std::shared_ptr<const RegisterSchema> RegisterSchema::Intern(
+	const std::string& architecture, const std::vector<std::pair<std::string, size_t>>& registers)
+{
+	static std::mutex mutex;
+	static std::unordered_map<std::string, std::vector<std::shared_ptr<const RegisterSchema>>> schemas;
+
+	std::unique_lock<std::mutex> lock(mutex);
+	auto& known = schemas[architecture];
+	for (const auto& schema : known)
+	{
+		if (schema->Matches(registers))
+			return schema;
+	}
+
+	auto schema = std::make_shared<const RegisterSchema>(architecture, registers);
+	known.push_back(schema);
+	return schema;
+}
+
+
+size_t RegisterSchema::GetIndex(const std::string& name) const
+{
+	auto iter = m_indices.find(name);
+	if (iter == m_indices.end())
+		return InvalidIndex;
+	return iter->second;
+}
+
+
+bool RegisterSchema::Matches(const std::vector<std::pair<std::string, size_t>>& registers) const
+{
+	if (registers.size() != m_names.size())
+		return false;
+
+	for (size_t i = 0; i < registers.size(); i++)
+	{
+		if ((registers[i].first != m_names[i]) || (registers[i].second != m_widths[i]))
+			return false;
+	}
+	return true;
+}
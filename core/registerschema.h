@@ -0,0 +1,55 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace BinaryNinjaDebugger {
+	// The registers of an architecture, in the order the adapter reports them. A register is referred to by its index
+	// in the schema, so the values of all registers are a flat array, and the names are only stored here.
+	class RegisterSchema
+	{
+		std::string m_architecture;
+		std::vector<std::string> m_names;
+		std::vector<size_t> m_widths;
+		std::unordered_map<std::string, size_t> m_indices;
+
+	public:
+		static constexpr size_t InvalidIndex = SIZE_MAX;
+
+		// The name and width in bits of each register
+		RegisterSchema(const std::string& architecture, const std::vector<std::pair<std::string, size_t>>& registers);
+
+		// Returns the schema already known for the architecture if it has the same registers, so that the schemas of
+		// all stops compare equal by their address
+		static std::shared_ptr<const RegisterSchema> Intern(
+			const std::string& architecture, const std::vector<std::pair<std::string, size_t>>& registers);
+
+		const std::string& GetArchitecture() const { return m_architecture; }
+		size_t GetCount() const { return m_names.size(); }
+		const std::string& GetName(size_t index) const { return m_names[index]; }
+		size_t GetWidth(size_t index) const { return m_widths[index]; }
+		// InvalidIndex if there is no such register
+		size_t GetIndex(const std::string& name) const;
+		bool Matches(const std::vector<std::pair<std::string, size_t>>& registers) const;
+	};
+};  // namespace BinaryNinjaDebugger
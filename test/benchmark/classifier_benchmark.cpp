@@ -0,0 +1,193 @@
+/*
+Copyright 2020-2024 Vector 35 Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+// Compares the string and pointer classifiers used for the register and stack hints with the byte-by-byte scans
+// they replaced. Build with:
+//   cmake -S test/benchmark -B build-benchmark && cmake --build build-benchmark
+//   ./build-benchmark/classifier_benchmark
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include "memoryclassifier.h"
+
+using namespace BinaryNinjaDebugger;
+
+static constexpr size_t WindowSize = 128;
+static constexpr size_t WindowCount = 4096;
+static constexpr size_t Iterations = 200;
+
+
+static inline bool IsPrintableChar(uint8_t c)
+{
+	return (c == '\r') || (c == '\n') || (c == '\t') || ((c >= 0x20) && (c <= 0x7e));
+}
+
+
+// The scans used before the classifiers, which walk the buffer once per encoding
+static std::string LegacyCheckForString(const uint8_t* data, size_t length, size_t width)
+{
+	std::string result;
+	for (size_t i = 0; i + width <= length; i += width)
+	{
+		bool upperZero = true;
+		for (size_t j = 1; j < width; j++)
+			upperZero = upperZero && (data[i + j] == 0);
+		if (!IsPrintableChar(data[i]) || !upperZero)
+			break;
+		result += data[i];
+	}
+	return result.length() >= 4 ? result : "";
+}
+
+
+static std::string LegacyCheckForPrintableString(const uint8_t* data, size_t length)
+{
+	for (size_t width : {1, 2, 4})
+	{
+		std::string result = LegacyCheckForString(data, length, width);
+		if (!result.empty())
+			return result;
+	}
+	return "";
+}
+
+
+template <PrintableRuns (*Classify)(const uint8_t*, size_t)>
+static std::string CheckForPrintableString(const uint8_t* data, size_t length)
+{
+	PrintableRuns runs = Classify(data, length);
+	size_t count = 0, width = 1;
+	if (runs.ascii >= 4)
+		count = runs.ascii;
+	else if (runs.utf16 >= 4)
+		count = runs.utf16, width = 2;
+	else if (runs.utf32 >= 4)
+		count = runs.utf32, width = 4;
+
+	std::string result(count, '\0');
+	for (size_t i = 0; i < count; i++)
+		result[i] = data[i * width];
+	return result;
+}
+
+
+// A mix of what registers and stack slots point to: ASCII and wide strings, pointers, and small integers
+static std::vector<uint8_t> MakeWindows()
+{
+	std::mt19937_64 random(0x5eed);
+	std::vector<uint8_t> windows(WindowSize * WindowCount);
+	for (size_t i = 0; i < WindowCount; i++)
+	{
+		uint8_t* window = windows.data() + i * WindowSize;
+		size_t length = random() % WindowSize;
+		switch (i % 4)
+		{
+		case 0:
+			for (size_t j = 0; j < WindowSize; j++)
+				window[j] = j < length ? (uint8_t)(0x20 + random() % 95) : 0;
+			break;
+		case 1:
+			for (size_t j = 0; j < WindowSize; j++)
+				window[j] = ((j % 2) == 0) && (j < length) ? (uint8_t)(0x20 + random() % 95) : 0;
+			break;
+		default:
+			for (size_t j = 0; j < WindowSize; j += 8)
+			{
+				uint64_t value = (i % 4) == 2 ? 0x7ff000000000ULL + (random() % 0x100000) : random() % 0x100;
+				memcpy(window + j, &value, 8);
+			}
+			break;
+		}
+	}
+	return windows;
+}
+
+
+template <typename Function>
+static void Measure(const char* name, Function&& function)
+{
+	size_t checksum = 0;
+	auto start = std::chrono::steady_clock::now();
+	for (size_t i = 0; i < Iterations; i++)
+		checksum += function();
+	auto end = std::chrono::steady_clock::now();
+
+	double nanoseconds = std::chrono::duration<double, std::nano>(end - start).count();
+	printf("%-28s %10.1f ns per window   (checksum %zu)\n", name, nanoseconds / (Iterations * WindowCount), checksum);
+}
+
+
+int main()
+{
+	std::vector<uint8_t> windows = MakeWindows();
+	auto measureStrings = [&](const char* name, std::string (*check)(const uint8_t*, size_t)) {
+		Measure(name, [&]() {
+			size_t total = 0;
+			for (size_t i = 0; i < WindowCount; i++)
+				total += check(windows.data() + i * WindowSize, WindowSize).size();
+			return total;
+		});
+	};
+
+	printf("string classification of %zu-byte windows, dispatching to %s\n", WindowSize, GetPrintableClassifierName());
+	measureStrings("legacy byte-by-byte", LegacyCheckForPrintableString);
+	measureStrings("scalar", CheckForPrintableString<ClassifyPrintableScalar>);
+#if defined(__x86_64__) || defined(_M_X64)
+	measureStrings("sse2", CheckForPrintableString<ClassifyPrintableSSE2>);
+	if (IsAVX2Supported())
+		measureStrings("avx2", CheckForPrintableString<ClassifyPrintableAVX2>);
+#endif
+
+	// The pointer-sized words of the same windows, against modules spread over the address space
+	std::map<uint64_t, uint64_t> modulesByAddress;
+	std::vector<std::pair<uint64_t, uint64_t>> moduleRanges;
+	for (uint64_t i = 0; i < 64; i++)
+	{
+		uint64_t base = 0x7ff000000000ULL + i * 0x8000;
+		modulesByAddress[base] = base + 0x4000;
+		moduleRanges.emplace_back(base, base + 0x4000);
+	}
+	AddressIntervals modules(moduleRanges);
+
+	std::vector<uint64_t> values(windows.size() / 8);
+	memcpy(values.data(), windows.data(), values.size() * 8);
+
+	printf("\npointer classification of %zu words against %zu modules\n", values.size(), moduleRanges.size());
+	Measure("legacy lookup per word", [&]() {
+		size_t total = 0;
+		for (uint64_t value : values)
+		{
+			auto iter = modulesByAddress.upper_bound(value);
+			if ((value >= 0x1000) && (iter != modulesByAddress.begin()) && (value < (--iter)->second))
+				total++;
+		}
+		return total;
+	});
+	std::vector<PointerKind> kinds;
+	Measure("bulk", [&]() {
+		ClassifyPointers(values.data(), values.size(), modules, 0x1000, kinds);
+		size_t total = 0;
+		for (PointerKind kind : kinds)
+			total += kind == PointerKind::ModulePointer;
+		return total;
+	});
+	return 0;
+}
@@ -6,15 +6,17 @@ import os
 import sys
 import time
 import platform
+import struct
 import threading
 import subprocess
+import tempfile
 import unittest
 
 from binaryninja import load
 try:
-    from debugger import DebuggerController, DebugStopReason
+    from debugger import DebuggerController, DebugStopReason, BreakpointRecord, DebugMemorySearchPattern
 except:
-    from binaryninja.debugger import DebuggerController, DebugStopReason
+    from binaryninja.debugger import DebuggerController, DebugStopReason, BreakpointRecord, DebugMemorySearchPattern
 
 # 'helloworld' -> '{BN_SOURCE_ROOT}\public\debugger\test\binaries\Windows-x64\helloworld.exe' (windows)
 # 'helloworld' -> '{BN_SOURCE_ROOT}/public/debugger/test/binaries/Darwin/arm64/helloworld' (linux, macOS)
@@ -44,6 +46,85 @@ def is_wow64(fpath):
     return a == '64bit' and b.startswith('Windows')
 
 
+def get_symbol_address(bv, name):
+    # The symbols of Mach-O files have a leading underscore
+    for candidate in [name, '_' + name]:
+        symbols = bv.get_symbols_by_name(candidate)
+        if symbols:
+            return symbols[0].address
+    return None
+
+
+# The breakpoint condition expression of an integer argument, at the entry of the function
+def argument_expression(arch_name, index):
+    if arch_name == 'x86':
+        return f'dword[esp + {4 * (index + 1)}]'
+    elif arch_name == 'x86_64':
+        if platform.system() == 'Windows':
+            return ['rcx', 'rdx', 'r8', 'r9'][index]
+        return ['rdi', 'rsi', 'rdx', 'rcx'][index]
+    else:
+        return f'x{index}'
+
+
+def read_argument(dbg, arch_name, index):
+    if arch_name == 'x86':
+        address = dbg.get_reg_value('esp') + 4 * (index + 1)
+        return int.from_bytes(dbg.read_memory(address, 4), 'little')
+    return dbg.get_reg_value(argument_expression(arch_name, index)) & 0xffffffff
+
+
+# Decode a trace file, see ExecutionTraceWriter in core/executiontrace.h for the format. Returns the address size, the
+# record count in the header, and the records as (tid, address, {register: value}).
+def read_trace(path):
+    with open(path, 'rb') as f:
+        data = f.read()
+    if data[:8] != b'BNDBGTRC':
+        raise ValueError(f'{path} is not a trace file')
+
+    version, address_size, count, register_count = struct.unpack_from('<IIQI', data, 8)
+    pos = 28
+    registers = []
+    for i in range(register_count):
+        (length,) = struct.unpack_from('<H', data, pos)
+        registers.append(data[pos + 2:pos + 2 + length].decode())
+        pos += 2 + length
+
+    def read_varint():
+        nonlocal pos
+        value = 0
+        shift = 0
+        while True:
+            byte = data[pos]
+            pos += 1
+            value |= (byte & 0x7f) << shift
+            shift += 7
+            if (byte & 0x80) == 0:
+                return value
+
+    def read_signed_varint():
+        value = read_varint()
+        return (value >> 1) ^ -(value & 1)
+
+    mask = (1 << 64) - 1
+    tid = 0
+    address = 0
+    values = [0] * register_count
+    records = []
+    while pos < len(data):
+        flags = data[pos]
+        pos += 1
+        if flags & 1:
+            tid = read_varint()
+        address = (address + read_signed_varint()) & mask
+        if flags & 2:
+            for i in range(read_varint()):
+                index = read_varint()
+                values[index] = (values[index] + read_signed_varint()) & mask
+        records.append((tid, address, dict(zip(registers, values))))
+    return address_size, count, records
+
+
 class DebuggerAPI(unittest.TestCase):
     # Always skip the base class so it will never be executed
     @unittest.skip("do not run the base test class")
@@ -182,6 +263,86 @@ class DebuggerAPI(unittest.TestCase):
         self.assertEqual(dbg.ip, entry)
         dbg.quit_and_wait()
 
+    def test_breakpoint_condition(self):
+        fpath = name_to_fpath('helloworld_func', self.arch)
+        bv = load(fpath)
+        dbg = DebuggerController(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        # hello() is called with 0, 1, 2 and 3
+        arch_name = bv.arch.name
+        hello = get_symbol_address(dbg.data, 'hello')
+        self.assertIsNotNone(hello)
+        arg = argument_expression(arch_name, 0)
+        dbg.add_breakpoint(hello)
+
+        # A condition that does not parse is rejected, and the breakpoint keeps its previous condition
+        for condition in ['1 +', '(1 + 2', '[sp', '1 2', '0x', '1 @ 2', '']:
+            self.assertEqual(dbg.set_breakpoint_condition(hello, condition), condition == '')
+        self.assertEqual(dbg.get_breakpoint_condition(hello), '')
+        self.assertFalse(dbg.set_breakpoint_condition(hello + 1, '1'))
+
+        # * binds tighter than +, so this only holds for 2. Evaluated from left to right, it would hold for 1.
+        condition = f'{arg} + 1 * 2 == 4'
+        self.assertTrue(dbg.set_breakpoint_condition(hello, condition))
+        self.assertEqual(dbg.get_breakpoint_condition(hello), condition)
+        self.assertEqual(dbg.go_and_wait(), DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, hello)
+        self.assertEqual(read_argument(dbg, arch_name, 0), 2)
+
+        # && binds tighter than ||, so this holds for 3. Evaluated from left to right, it would never hold.
+        self.assertTrue(dbg.set_breakpoint_condition(hello, f'{arg} == 3 || {arg} == 1 && {arg} == 0'))
+        self.assertEqual(dbg.go_and_wait(), DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, hello)
+        self.assertEqual(read_argument(dbg, arch_name, 0), 3)
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
+    def test_tracepoint(self):
+        fpath = name_to_fpath('helloworld_func', self.arch)
+        bv = load(fpath)
+        dbg = DebuggerController(bv)
+        dbg.cmd_line = 'foobar'
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        arch_name = bv.arch.name
+        main = get_symbol_address(dbg.data, 'main')
+        hello = get_symbol_address(dbg.data, 'hello')
+        self.assertIsNotNone(main)
+        self.assertIsNotNone(hello)
+        dbg.add_breakpoint(main)
+        dbg.add_breakpoint(hello)
+
+        for template in ['hello {', 'hello }', 'hello {1 +}', 'hello {1:q}']:
+            self.assertFalse(dbg.set_breakpoint_log_template(hello, template))
+
+        # main never stops, but records argv[1], which is the command line
+        argv = argument_expression(arch_name, 1)
+        self.assertTrue(dbg.set_tracepoint(main))
+        self.assertTrue(dbg.set_breakpoint_log_template(
+            main, '{{argv[1]}} = {[' + argv + ' + ' + str(bv.arch.address_size) + ']:s}'))
+
+        # hello() is called with 0, 1, 2 and 3. Every hit is recorded, but only the last one stops.
+        self.assertTrue(dbg.set_breakpoint_log_template(hello, 'hello({' + argument_expression(arch_name, 0) + ':d})'))
+        self.assertTrue(dbg.set_breakpoint_ignore_count(hello, 3))
+
+        self.assertEqual(dbg.go_and_wait(), DebugStopReason.Breakpoint)
+        self.assertEqual(dbg.ip, hello)
+        self.assertEqual(read_argument(dbg, arch_name, 0), 3)
+
+        self.assertEqual(dbg.get_breakpoint_hit_count(main), 1)
+        self.assertEqual(dbg.get_breakpoint_records(main), [BreakpointRecord(1, '{argv[1]} = foobar')])
+        self.assertEqual(dbg.get_breakpoint_hit_count(hello), 4)
+        self.assertEqual(dbg.get_breakpoint_records(hello), [BreakpointRecord(i + 1, f'hello({i})') for i in range(4)])
+
+        self.assertTrue(dbg.reset_breakpoint_hits(hello))
+        self.assertEqual(dbg.get_breakpoint_hit_count(hello), 0)
+        self.assertEqual(dbg.get_breakpoint_records(hello), [])
+
+        reason = dbg.go_and_wait()
+        self.assertEqual(reason, DebugStopReason.ProcessExited)
+
     def test_register_read_write(self):
         fpath = name_to_fpath('helloworld', self.arch)
         bv = load(fpath)
@@ -234,6 +395,58 @@ class DebuggerAPI(unittest.TestCase):
 
         dbg.quit_and_wait()
 
+    def test_memory_search(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = DebuggerController(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        arch_name = bv.arch.name
+        if arch_name == 'x86':
+            sp = 'esp'
+        elif arch_name == 'x86_64':
+            sp = 'rsp'
+        else:
+            sp = 'sp'
+
+        # Two copies of a pattern on the stack, which only differ in their third byte
+        addr = (dbg.get_reg_value(sp) - 0x400) & ~0xf
+        first = b'\x5a\xc3\x11\x9e\x27\x64\xb8\x0d'
+        second = b'\x5a\xc3\x22\x9e\x27\x64\xb8\x0d'
+        data = dbg.read_memory(addr, 0x100)
+        self.assertTrue(dbg.write_memory(addr, first))
+        self.assertTrue(dbg.write_memory(addr + 0x80, second))
+        start = addr - 0x1000
+        end = addr + 0x1000
+
+        self.assertEqual(dbg.search(first, start, end), [addr])
+        self.assertEqual(dbg.search(DebugMemorySearchPattern.from_int(0x0db864279e11c35a), start, end), [addr])
+        self.assertEqual(dbg.search('5a c3 ?? 9e 2? 64', start, end), [addr, addr + 0x80])
+        mask = b'\xff\xff\x00\xff\xf0\xff\xff\xff'
+        self.assertEqual(dbg.search(DebugMemorySearchPattern(first, mask), start, end), [addr, addr + 0x80])
+
+        # The matches are in ascending order, so the limit and the callback keep the first one
+        self.assertEqual(dbg.search('5a c3 ?? 9e', start, end, limit=1), [addr])
+        found = []
+
+        def on_match(match):
+            found.append(match)
+            return False
+
+        self.assertEqual(dbg.search('5a c3 ?? 9e', start, end, match_callback=on_match), [addr])
+        self.assertEqual(found, [addr])
+
+        # The range excludes its end
+        self.assertEqual(dbg.search(second, start, addr + 0x87), [])
+        self.assertEqual(dbg.search(second, start, addr + 0x88), [addr + 0x80])
+
+        for pattern in ['5a c', '5a zz', '']:
+            self.assertRaises(ValueError, DebugMemorySearchPattern.from_hex, pattern)
+        self.assertRaises(ValueError, DebugMemorySearchPattern, first, b'\xff')
+
+        dbg.write_memory(addr, data)
+        dbg.quit_and_wait()
+
     # @unittest.skip
     def test_thread(self):
         fpath = name_to_fpath('helloworld_thread', self.arch)
@@ -287,6 +500,88 @@ class DebuggerAPI(unittest.TestCase):
             reason = dbg.go_and_wait()
             self.assertEqual(reason, DebugStopReason.ProcessExited)
 
+    def test_trace(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = DebuggerController(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+        arch_name = bv.arch.name
+        if arch_name == 'x86':
+            sp = 'esp'
+        elif arch_name == 'x86_64':
+            sp = 'rsp'
+        else:
+            sp = 'sp'
+
+        ip = dbg.ip
+        stack_pointer = dbg.get_reg_value(sp)
+        with tempfile.TemporaryDirectory() as directory:
+            trace_path = os.path.join(directory, 'helloworld.trace')
+            reason = dbg.trace_and_wait(trace_path, max_records=100, registers=[sp])
+            self.assertEqual(reason, DebugStopReason.SingleStep)
+
+            # The first record is where the trace starts, and the last one is where it stops
+            address_size, count, records = read_trace(trace_path)
+            self.assertEqual(address_size, bv.arch.address_size)
+            self.assertEqual(count, 100)
+            self.assertEqual(len(records), 100)
+            self.assertEqual(records[0][1:], (ip, {sp: stack_pointer}))
+            self.assertEqual(records[-1][1:], (dbg.ip, {sp: dbg.get_reg_value(sp)}))
+            self.assertEqual({record[0] for record in records}, {dbg.active_thread.tid})
+
+            # The core reads the trace back the same way
+            self.assertGreater(dbg.highlight_trace(trace_path), 0)
+
+            not_a_trace = os.path.join(directory, 'not_a_trace')
+            with open(not_a_trace, 'wb') as f:
+                f.write(b'\x00' * 64)
+            self.assertEqual(dbg.highlight_trace(not_a_trace), -1)
+
+        dbg.quit_and_wait()
+
+    @unittest.skipIf(platform.system() != 'Linux', 'Core files are only saved for ELF targets')
+    def test_core_file(self):
+        fpath = name_to_fpath('helloworld', self.arch)
+        bv = load(fpath)
+        dbg = DebuggerController(bv)
+        self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+        dbg.step_into_and_wait()
+
+        arch_name = bv.arch.name
+        if arch_name == 'x86':
+            sp = 'esp'
+        elif arch_name == 'x86_64':
+            sp = 'rsp'
+        else:
+            sp = 'sp'
+
+        ip = dbg.ip
+        stack_pointer = dbg.get_reg_value(sp)
+        tids = sorted(thread.tid for thread in dbg.threads)
+        input_name = os.path.basename(fpath)
+        input_base = [module.address for module in dbg.modules if module.short_name == input_name]
+        code = dbg.read_memory(ip, 16)
+        stack = dbg.read_memory(stack_pointer, 64)
+
+        with tempfile.TemporaryDirectory() as directory:
+            core_path = os.path.join(directory, 'helloworld.core')
+            self.assertTrue(dbg.save_core_file(core_path))
+            dbg.quit_and_wait()
+
+            # Reopen the core file, which must show the target as it was saved
+            dbg.adapter_type = 'CORE_FILE'
+            dbg.executable_path = core_path
+            self.assertNotIn(dbg.launch_and_wait(), [DebugStopReason.ProcessExited, DebugStopReason.InternalError])
+
+            self.assertEqual(sorted(thread.tid for thread in dbg.threads), tids)
+            self.assertEqual(dbg.ip, ip)
+            self.assertEqual(dbg.get_reg_value(sp), stack_pointer)
+            self.assertEqual([module.address for module in dbg.modules if module.short_name == input_name], input_base)
+            self.assertEqual(dbg.read_memory(ip, 16), code)
+            self.assertEqual(dbg.read_memory(stack_pointer, 64), stack)
+            dbg.quit_and_wait()
+
     @unittest.skipIf(platform.system() == 'Linux', 'Cannot attach to pid unless running as root')
     def test_attach(self):
         pid = None
@@ -94,6 +94,7 @@ void DebuggerWidget::uiEventHandler(const DebuggerEvent& event)
 	case AbsoluteBreakpointAddedEvent:
 	case RelativeBreakpointRemovedEvent:
 	case AbsoluteBreakpointRemovedEvent:
+	case BreakpointsChangedEvent:
 		m_breakpointsWidget->updateContent();
 		break;
 	default:
@@ -21,6 +21,8 @@ limitations under the License.
 #include <QGuiApplication>
 #include <QMimeData>
 #include <QClipboard>
+#include <QPointer>
+#include <thread>
 #include "pane.h"
 #include "util.h"
 #include "clickablelabel.h"
@@ -244,10 +246,6 @@ void DebugRegistersListModel::updateRows(std::vector<DebugRegister> newRows)
 	// TODO: This might cause performance problems. We can instead only update the chained registers.
 	// However, the cost for that is we need to attach an index to each item and sort accordingly
 	beginResetModel();
-	std::map<std::string, uint64_t> oldRegValues;
-	for (const DebugRegisterItem& item : m_items)
-		oldRegValues[item.name()] = item.value();
-
 	m_items.clear();
 	if (newRows.size() == 0)
 	{
@@ -257,23 +255,8 @@ void DebugRegistersListModel::updateRows(std::vector<DebugRegister> newRows)
 
 	for (const DebugRegister& reg : newRows)
 	{
-		auto iter = oldRegValues.find(reg.m_name);
-		DebugRegisterValueStatus status;
-		if (iter == oldRegValues.end())
-		{
-			status = DebugRegisterValueNormal;
-		}
-		else
-		{
-			if (iter->second == reg.m_value)
-			{
-				status = DebugRegisterValueNormal;
-			}
-			else
-			{
-				status = DebugRegisterValueChanged;
-			}
-		}
+		// The debugger tracks which registers changed since the previous stop
+		DebugRegisterValueStatus status = reg.m_changed ? DebugRegisterValueChanged : DebugRegisterValueNormal;
 
 		// If we get an empty list of used registers, we wish to show all regs
 		bool used = (emptyUsedRegisters || (usedRegisterNames.find(reg.m_name) != usedRegisterNames.end()));
@@ -283,6 +266,27 @@ void DebugRegistersListModel::updateRows(std::vector<DebugRegister> newRows)
 }
 
 
+void DebugRegistersListModel::updateHints(const std::vector<DebugRegister>& registers)
+{
+	std::map<std::string, const DebugRegister*> byName;
+	for (const DebugRegister& reg : registers)
+		byName[reg.m_name] = &reg;
+
+	for (size_t i = 0; i < m_items.size(); i++)
+	{
+		auto iter = byName.find(m_items[i].name());
+		if ((iter == byName.end()) || (iter->second->m_value != m_items[i].value()))
+			continue;
+		if (iter->second->m_hint == m_items[i].hint())
+			continue;
+
+		m_items[i].setHint(iter->second->m_hint);
+		QModelIndex hintIndex = index((int)i, HintColumn);
+		emit dataChanged(hintIndex, hintIndex);
+	}
+}
+
+
 bool DebugRegistersListModel::setData(const QModelIndex& index, const QVariant& value, int role)
 {
 	if ((flags(index) & Qt::ItemIsEditable) != Qt::ItemIsEditable)
@@ -500,10 +504,51 @@ DebugRegistersWidget::DebugRegistersWidget(ViewFrame* view, BinaryViewRef data,
 
 	connect(this, &QTableView::doubleClicked, this, &DebugRegistersWidget::onDoubleClicked);
 
+	m_hintThread = std::thread([this]() { hintWorker(); });
 	updateContent();
 }
 
 
+DebugRegistersWidget::~DebugRegistersWidget()
+{
+	{
+		std::unique_lock<std::mutex> lock(m_hintMutex);
+		m_hintThreadExit = true;
+	}
+	m_hintCv.notify_all();
+	if (m_hintThread.joinable())
+		m_hintThread.join();
+}
+
+
+void DebugRegistersWidget::hintWorker()
+{
+	uint64_t served = 0;
+	std::unique_lock<std::mutex> lock(m_hintMutex);
+	while (true)
+	{
+		m_hintCv.wait(lock, [&]() { return m_hintThreadExit || (m_hintRequest != served); });
+		if (m_hintThreadExit)
+			break;
+
+		uint64_t request = m_hintRequest;
+		served = request;
+		lock.unlock();
+
+		std::vector<DebugRegister> hinted = m_controller->GetRegisters(true);
+		QPointer<DebugRegistersWidget> widget(this);
+		ExecuteOnMainThread([=]() {
+			if (!widget || (widget->m_hintRequest != request))
+				return;
+			widget->m_model->updateHints(hinted);
+			widget->updateColumnWidths();
+		});
+
+		lock.lock();
+	}
+}
+
+
 void DebugRegistersWidget::notifyRegistersChanged(std::vector<DebugRegister> regs)
 {
 	m_model->updateRows(regs);
@@ -528,8 +573,16 @@ void DebugRegistersWidget::updateContent()
 	if (!m_controller->IsConnected())
 		return;
 
-	std::vector<DebugRegister> registers = m_controller->GetRegisters();
+	std::vector<DebugRegister> registers = m_controller->GetRegisters(false);
 	notifyRegistersChanged(registers);
+
+	// The values are shown right away, and the hints are filled in once they are ready, unless the registers are
+	// updated again in the meantime
+	{
+		std::unique_lock<std::mutex> lock(m_hintMutex);
+		m_hintRequest++;
+	}
+	m_hintCv.notify_all();
 }
 
 
@@ -22,6 +22,9 @@ limitations under the License.
 #include <QTableView>
 #include <QStyledItemDelegate>
 #include <QSortFilterProxyModel>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 #include "inttypes.h"
 #include "binaryninjaapi.h"
 #include "dockhandler.h"
@@ -67,6 +70,7 @@ public:
 	DebugRegisterValueStatus valueStatus() const { return m_valueStatus; }
 	void setValueStatus(DebugRegisterValueStatus newStatus) { m_valueStatus = newStatus; }
 	std::string hint() const { return m_hint; }
+	void setHint(const std::string& hint) { m_hint = hint; }
 	bool operator==(const DebugRegisterItem& other) const;
 	bool operator!=(const DebugRegisterItem& other) const;
 	bool operator<(const DebugRegisterItem& other) const;
@@ -113,6 +117,8 @@ public:
 	virtual QVariant data(const QModelIndex& i, int role) const override;
 	virtual QVariant headerData(int column, Qt::Orientation orientation, int role) const override;
 	void updateRows(std::vector<DebugRegister> newRows);
+	// Fill in the hints of the rows whose registers still have the same values
+	void updateHints(const std::vector<DebugRegister>& registers);
 	bool setData(const QModelIndex& index, const QVariant& value, int role = Qt::EditRole) override;
 
 	std::set<std::string> getUsedRegisterNames();
@@ -173,6 +179,15 @@ class DebugRegistersWidget : public QTableView, public FilterTarget
 	QTimer* m_hoverTimer;
 	QPointF m_previewPos;
 
+	// The register hints read the memory the registers point to, so they are computed on a worker thread. Only the
+	// latest request is served, which m_hintRequest identifies.
+	std::thread m_hintThread;
+	std::mutex m_hintMutex;
+	std::condition_variable m_hintCv;
+	uint64_t m_hintRequest = 0;
+	bool m_hintThreadExit = false;
+	void hintWorker();
+
 	virtual void contextMenuEvent(QContextMenuEvent* event) override;
 
 	bool selectionNotEmpty();
@@ -191,6 +206,7 @@ class DebugRegistersWidget : public QTableView, public FilterTarget
 
 public:
 	DebugRegistersWidget(ViewFrame* view, BinaryViewRef data, Menu* menu);
+	~DebugRegistersWidget();
 	void notifyRegistersChanged(std::vector<DebugRegister> regs);
 	void updateFonts();
 
@@ -436,80 +436,18 @@ void DebugStackWidget::updateContent()
 		return;
 
 	std::vector<DebugStackItem> stackItems;
-	BinaryReader* reader = new BinaryReader(m_controller->GetLiveView());
-	uint64_t stackPointer = m_controller->StackPointer();
-	size_t addressSize = m_controller->GetRemoteArchitecture()->GetAddressSize();
-	for (ptrdiff_t i = -8; i < 60 + 1; i++)
+	for (const DebugStackSlot& slot : m_controller->GetStackWindow(8, 60, 3))
 	{
-		ptrdiff_t offset = i * addressSize;
-		if ((offset < 0) && (stackPointer < (uint64_t)-offset))
-			continue;
-
-		uint64_t address = stackPointer + offset;
-
-		reader->Seek(address);
-
-		uint64_t value = -1ULL;
-
-		try
-		{
-			switch (addressSize)
-			{
-			case 1:
-				value = reader->Read8();
-				break;
-			case 2:
-				value = reader->Read16();
-				break;
-			case 4:
-				value = reader->Read32();
-				break;
-			case 8:
-				value = reader->Read64();
-				break;
-			default:
-				break;
-			}
-		}
-		catch (const std::exception&)
-		{
-			/* TODO: just ignoring this is probably not a great idea... */
-		}
-
-		std::string hint {};
-		if (m_controller)
-		{
-			const DataBuffer memory = m_controller->ReadMemory(value, 128);
-			std::string reg_string;
-			if (memory.GetLength() > 0)
-				reg_string = std::string((const char*)memory.GetData(), memory.GetLength());
-			else
-				reg_string = "x";
-			const auto can_print = std::all_of(reg_string.begin(), reg_string.end(), [](unsigned char c) {
-				return c == '\n' || std::isprint(c);
-			});
-
-			if (!reg_string.empty() && reg_string.size() > 3 && can_print)
-			{
-				hint = fmt::format("\"{}\"", reg_string);
-			}
-			else
-			{
-				DataBuffer buffer = m_controller->ReadMemory(value, addressSize);
-				if (buffer.GetLength() > 0)
-				{
-					hint = fmt::format("{:x}", *reinterpret_cast<std::uintptr_t*>(buffer.GetData()));
-				}
-				else
-				{
-					hint = "";
-				}
-			}
-		}
-
-		stackItems.emplace_back(offset, address, value, hint);
+		std::string hint;
+		for (uint64_t value : slot.m_chain)
+			hint += fmt::format("{:x} -> ", value);
+		if (!slot.m_hint.empty())
+			hint += slot.m_hint;
+		else if (hint.size() >= 4)
+			hint.resize(hint.size() - 4);
+
+		stackItems.emplace_back(slot.m_offset, slot.m_address, slot.m_valid ? slot.m_value : -1ULL, hint);
 	}
-	delete reader;
 
 	notifyStackChanged(stackItems);
 }
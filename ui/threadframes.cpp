@@ -177,26 +177,55 @@ void ThreadFrameModel::updateRows(DebuggerController* controller)
 		rootItem = new FrameItem();
 	}
 
-	QList<FrameItem*> parents;
-	parents << rootItem;
-
+	// Only list the threads here. Their frames are added by fetchMore() when a thread gets expanded.
 	std::vector<DebugThread> threads = controller->GetThreads();
 	for (const DebugThread& thread : threads)
-	{
-		parents.last()->appendChild(new FrameItem(thread, parents.last()));
+		rootItem->appendChild(new FrameItem(thread, rootItem));
 
-		parents << parents.last()->child(parents.last()->childCount() - 1);
+	endResetModel();
+}
 
-		std::vector<DebugFrame> frames = controller->GetFramesOfThread(thread.m_tid);
-		for (const DebugFrame& frame : frames)
-		{
-			parents.last()->appendChild(new FrameItem(thread, frame, parents.last()));
-		}
 
-		parents.pop_back();
-	}
+bool ThreadFrameModel::hasChildren(const QModelIndex& parent) const
+{
+	if (!parent.isValid())
+		return rootItem->childCount() > 0;
 
-	endResetModel();
+	FrameItem* item = static_cast<FrameItem*>(parent.internalPointer());
+	if (!item || item->isFrame())
+		return false;
+
+	return !item->framesFetched() || (item->childCount() > 0);
+}
+
+
+bool ThreadFrameModel::canFetchMore(const QModelIndex& parent) const
+{
+	if (!parent.isValid())
+		return false;
+
+	FrameItem* item = static_cast<FrameItem*>(parent.internalPointer());
+	return item && !item->isFrame() && !item->framesFetched();
+}
+
+
+void ThreadFrameModel::fetchMore(const QModelIndex& parent)
+{
+	if (!canFetchMore(parent) || !m_controller)
+		return;
+
+	FrameItem* item = static_cast<FrameItem*>(parent.internalPointer());
+	item->setFramesFetched(true);
+
+	std::vector<DebugFrame> frames = m_controller->GetFramesOfThread(item->tid());
+	if (frames.empty())
+		return;
+
+	DebugThread thread(item->tid(), item->threadPc());
+	beginInsertRows(parent, 0, (int)frames.size() - 1);
+	for (const DebugFrame& frame : frames)
+		item->appendChild(new FrameItem(thread, frame, item));
+	endInsertRows();
 }
 
 
@@ -642,6 +671,7 @@ ThreadFramesWidget::~ThreadFramesWidget()
 
 void ThreadFramesWidget::expandCurrentThread()
 {
+	auto activeTid = m_debugger->GetActiveThread().m_tid;
 	for (int i = 0; i < m_model->rowCount(); i++)
 	{
 		auto index = m_model->index(i, 0);
@@ -652,7 +682,7 @@ void ThreadFramesWidget::expandCurrentThread()
 		if (!item)
 			return;
 
-		if (m_debugger->GetActiveThread().m_tid == item->tid())
+		if (activeTid == item->tid())
 		{
 			expand(index);
 			return;
@@ -74,9 +74,13 @@ public:
 	size_t frameIndex() const { return m_frameIndex; }
 	std::string module() const { return m_module; }
 	std::string function() const { return m_function; }
+	bool framesFetched() const { return m_framesFetched; }
+	void setFramesFetched(bool fetched) { m_framesFetched = fetched; }
 
 private:
 	bool m_isFrame {false};
+	// For thread items, whether the frames of the thread have been added as children
+	bool m_framesFetched {false};
 	bool m_isFrozen {false};
 	uint32_t m_tid {};
 	uint64_t m_threadPc {};
@@ -118,6 +122,10 @@ public:
 	QModelIndex index(int row, int column, const QModelIndex& parent = QModelIndex()) const override;
 	QModelIndex parent(const QModelIndex& index) const override;
 	int rowCount(const QModelIndex& parent = QModelIndex()) const override;
+	// The frames of a thread are only unwound when the thread is expanded
+	bool hasChildren(const QModelIndex& parent = QModelIndex()) const override;
+	bool canFetchMore(const QModelIndex& parent) const override;
+	void fetchMore(const QModelIndex& parent) override;
 	int columnCount(const QModelIndex& parent = QModelIndex()) const override
 	{
 		(void)parent;
@@ -30,7 +30,10 @@ limitations under the License.
 #include "codedatarenderer.h"
 #include "adaptersettings.h"
 #include <thread>
+#include <algorithm>
+#include <iterator>
 #include <QInputDialog>
+#include <QFileDialog>
 #include <filesystem>
 #include <QMessageBox>
 #include "debugserversetting.h"
@@ -813,6 +816,42 @@ void GlobalDebuggerUI::SetupMenu(UIContext* context)
 			connectedAndStopped));
 	debuggerMenu->addAction("Force Update Memory Cache", "Misc");
 
+	UIAction::registerAction("Save Core File...");
+	context->globalActions()->bindAction("Save Core File...",
+		UIAction(
+			[=](const UIActionContext& ctxt) {
+				if (!ctxt.binaryView)
+					return;
+
+				auto controller = DebuggerController::GetController(ctxt.binaryView);
+				if (!controller)
+					return;
+
+				QString path = QFileDialog::getSaveFileName(context->mainWindow(), "Save Core File", "core");
+				if (path.isEmpty())
+					return;
+
+				bool result = false;
+				bool cancelled = false;
+				QString text = QString("Saving the memory and the registers of the target...");
+				ProgressTask* task = new ProgressTask(context->mainWindow(), "Saving core file", text, "Cancel",
+					[&](std::function<bool(size_t, size_t)> progress) {
+						result = controller->SaveCoreFile(path.toStdString(), [&](size_t done, size_t total) {
+							if (!progress(done, total))
+								cancelled = true;
+							return !cancelled;
+						});
+					});
+				task->wait();
+
+				// The partial file is already deleted, so a cancel needs no message
+				if (!result && !cancelled)
+					QMessageBox::warning(context->mainWindow(), "Failed to save core file",
+						"Failed to save the core file. Check the log for details.");
+			},
+			connectedAndStopped));
+	debuggerMenu->addAction("Save Core File...", "Misc");
+
 #ifdef WIN32
 	UIAction::registerAction("Reinstall DbgEng Redistributable");
 	context->globalActions()->bindAction("Reinstall DbgEng Redistributable", UIAction([=](const UIActionContext& ctxt) {
@@ -853,14 +892,7 @@ DebuggerUI::DebuggerUI(UIContext* context, DebuggerControllerRef controller) :
 	// Since the Controller is constructed earlier than the UI, any breakpoints added before the construction of the UI,
 	// e.g. the entry point breakpoint, will be missing the visual indicator.
 	// Here, we forcibly add them.
-	for (auto bp : m_controller->GetBreakpoints())
-	{
-		DebuggerEvent event;
-		event.type = RelativeBreakpointAddedEvent;
-		event.data.relativeAddress.module = bp.module;
-		event.data.relativeAddress.offset = bp.offset;
-		updateUI(event);
-	}
+	updateBreakpointTags();
 }
 
 
@@ -966,6 +998,93 @@ TagTypeRef DebuggerUI::getBreakpointTagType(BinaryViewRef data)
 }
 
 
+std::vector<std::pair<BinaryViewRef, uint64_t>> DebuggerUI::getBreakpointTagLocations(
+	const ModuleNameAndOffset& breakpoint)
+{
+	std::vector<std::pair<BinaryViewRef, uint64_t>> dataAndAddress;
+	if (m_controller->GetLiveView())
+		dataAndAddress.emplace_back(m_controller->GetLiveView(), m_controller->RelativeAddressToAbsolute(breakpoint));
+
+	if (DebugModule::IsSameBaseModule(breakpoint.module, m_controller->GetInputFile()))
+		dataAndAddress.emplace_back(m_controller->GetData(), m_controller->GetData()->GetStart() + breakpoint.offset);
+
+	return dataAndAddress;
+}
+
+
+void DebuggerUI::addBreakpointTag(const ModuleNameAndOffset& breakpoint)
+{
+	m_taggedBreakpoints.insert(breakpoint);
+	for (auto& [data, address] : getBreakpointTagLocations(breakpoint))
+	{
+		for (FunctionRef func : data->GetAnalysisFunctionsContainingAddress(address))
+		{
+			bool tagFound = false;
+			for (TagRef tag : func->GetAddressTags(data->GetDefaultArchitecture(), address))
+			{
+				if (tag->GetType() == getBreakpointTagType(data))
+				{
+					tagFound = true;
+					break;
+				}
+			}
+
+			if (!tagFound)
+			{
+				auto id = data->BeginUndoActions();
+				func->SetAutoInstructionHighlight(data->GetDefaultArchitecture(), address, RedHighlightColor);
+				func->CreateUserAddressTag(
+					data->GetDefaultArchitecture(), address, getBreakpointTagType(data), "breakpoint");
+				data->ForgetUndoActions(id);
+			}
+		}
+	}
+}
+
+
+void DebuggerUI::removeBreakpointTag(const ModuleNameAndOffset& breakpoint)
+{
+	m_taggedBreakpoints.erase(breakpoint);
+	for (auto& [data, address] : getBreakpointTagLocations(breakpoint))
+	{
+		for (FunctionRef func : data->GetAnalysisFunctionsContainingAddress(address))
+		{
+			func->SetAutoInstructionHighlight(data->GetDefaultArchitecture(), address, NoHighlightColor);
+			for (TagRef tag : func->GetAddressTags(data->GetDefaultArchitecture(), address))
+			{
+				if (tag->GetType() != getBreakpointTagType(data))
+					continue;
+
+				auto id = data->BeginUndoActions();
+				func->RemoveUserAddressTag(data->GetDefaultArchitecture(), address, tag);
+				data->ForgetUndoActions(id);
+			}
+		}
+	}
+}
+
+
+void DebuggerUI::updateBreakpointTags()
+{
+	// Only touch the breakpoints that are added or removed since the tags were last updated
+	std::set<ModuleNameAndOffset> breakpoints;
+	for (const DebugBreakpoint& bp : m_controller->GetBreakpoints())
+		breakpoints.insert({bp.module, bp.offset});
+
+	std::vector<ModuleNameAndOffset> removed;
+	std::set_difference(m_taggedBreakpoints.begin(), m_taggedBreakpoints.end(), breakpoints.begin(),
+		breakpoints.end(), std::back_inserter(removed));
+	std::vector<ModuleNameAndOffset> added;
+	std::set_difference(breakpoints.begin(), breakpoints.end(), m_taggedBreakpoints.begin(),
+		m_taggedBreakpoints.end(), std::back_inserter(added));
+
+	for (const ModuleNameAndOffset& breakpoint : removed)
+		removeBreakpointTag(breakpoint);
+	for (const ModuleNameAndOffset& breakpoint : added)
+		addBreakpointTag(breakpoint);
+}
+
+
 // Navigate to the address. This has some special handling of the process which is useful for a debugging scenario.
 // I believe at least some logic should be built into the default navigation behavior.
 void DebuggerUI::navigateDebugger(uint64_t address)
@@ -1257,147 +1376,20 @@ void DebuggerUI::updateUI(const DebuggerEvent& event)
 	}
 
 	case RelativeBreakpointAddedEvent:
-	{
-		uint64_t address = m_controller->RelativeAddressToAbsolute(event.data.relativeAddress);
-
-		std::vector<std::pair<BinaryViewRef, uint64_t>> dataAndAddress;
-		if (m_controller->GetLiveView())
-			dataAndAddress.emplace_back(m_controller->GetLiveView(), address);
-
-		if (DebugModule::IsSameBaseModule(event.data.relativeAddress.module, m_controller->GetInputFile()))
-		{
-			dataAndAddress.emplace_back(m_controller->GetData(), m_controller->GetData()->GetStart() + event.data.relativeAddress.offset);
-		}
-
-		for (auto& [data, addr] : dataAndAddress)
-		{
-			for (FunctionRef func : data->GetAnalysisFunctionsContainingAddress(addr))
-			{
-				bool tagFound = false;
-				for (TagRef tag : func->GetAddressTags(data->GetDefaultArchitecture(), addr))
-				{
-					if (tag->GetType() == getBreakpointTagType(data))
-					{
-						tagFound = true;
-						break;
-					}
-				}
-
-				if (!tagFound)
-				{
-					auto id = data->BeginUndoActions();
-					func->SetAutoInstructionHighlight(data->GetDefaultArchitecture(), addr, RedHighlightColor);
-					func->CreateUserAddressTag(data->GetDefaultArchitecture(), addr, getBreakpointTagType(data), "breakpoint");
-					data->ForgetUndoActions(id);
-				}
-			}
-		}
+		addBreakpointTag(event.data.relativeAddress);
 		break;
-	}
 	case AbsoluteBreakpointAddedEvent:
-	{
-		uint64_t address = event.data.absoluteAddress;
-
-		std::vector<std::pair<BinaryViewRef, uint64_t>> dataAndAddress;
-		BinaryViewRef data = m_controller->GetLiveView();
-		if (data)
-			dataAndAddress.emplace_back(data, address);
-
-		ModuleNameAndOffset relative = m_controller->AbsoluteAddressToRelative(address);
-		if (DebugModule::IsSameBaseModule(relative.module, m_controller->GetInputFile()))
-		{
-			dataAndAddress.emplace_back(m_controller->GetData(), m_controller->GetData()->GetStart() + relative.offset);
-		}
-
-		for (auto& [data, address] : dataAndAddress)
-		{
-			for (FunctionRef func : data->GetAnalysisFunctionsContainingAddress(address))
-			{
-				bool tagFound = false;
-				for (TagRef tag : func->GetAddressTags(data->GetDefaultArchitecture(), address))
-				{
-					if (tag->GetType() == getBreakpointTagType(data))
-					{
-						tagFound = true;
-						break;
-					}
-				}
-
-				if (!tagFound)
-				{
-					auto id = data->BeginUndoActions();
-					func->SetAutoInstructionHighlight(data->GetDefaultArchitecture(), address, RedHighlightColor);
-					func->CreateUserAddressTag(data->GetDefaultArchitecture(), address, getBreakpointTagType(data), "breakpoint");
-					data->ForgetUndoActions(id);
-				}
-			}
-		}
+		addBreakpointTag(m_controller->AbsoluteAddressToRelative(event.data.absoluteAddress));
 		break;
-	}
 	case RelativeBreakpointRemovedEvent:
-	{
-		uint64_t address = m_controller->RelativeAddressToAbsolute(event.data.relativeAddress);
-
-		std::vector<std::pair<BinaryViewRef, uint64_t>> dataAndAddress;
-		if (m_controller->GetLiveView())
-			dataAndAddress.emplace_back(m_controller->GetLiveView(), address);
-
-		if (DebugModule::IsSameBaseModule(event.data.relativeAddress.module, m_controller->GetInputFile()))
-		{
-			dataAndAddress.emplace_back(m_controller->GetData(), m_controller->GetData()->GetStart() + event.data.relativeAddress.offset);
-		}
-
-		for (auto& [data, address] : dataAndAddress)
-		{
-			for (FunctionRef func : data->GetAnalysisFunctionsContainingAddress(address))
-			{
-				func->SetAutoInstructionHighlight(data->GetDefaultArchitecture(), address, NoHighlightColor);
-				for (TagRef tag : func->GetAddressTags(data->GetDefaultArchitecture(), address))
-				{
-					if (tag->GetType() != getBreakpointTagType(data))
-						continue;
-
-					auto id = data->BeginUndoActions();
-					func->RemoveUserAddressTag(data->GetDefaultArchitecture(), address, tag);
-					data->ForgetUndoActions(id);
-				}
-			}
-		}
+		removeBreakpointTag(event.data.relativeAddress);
 		break;
-	}
 	case AbsoluteBreakpointRemovedEvent:
-	{
-		uint64_t address = event.data.absoluteAddress;
-
-		std::vector<std::pair<BinaryViewRef, uint64_t>> dataAndAddress;
-		BinaryViewRef data = m_controller->GetLiveView();
-		if (data)
-			dataAndAddress.emplace_back(data, address);
-
-		ModuleNameAndOffset relative = m_controller->AbsoluteAddressToRelative(address);
-		if (DebugModule::IsSameBaseModule(relative.module, m_controller->GetInputFile()))
-		{
-			dataAndAddress.emplace_back(m_controller->GetData(), m_controller->GetData()->GetStart() + relative.offset);
-		}
-
-		for (auto& [data, address] : dataAndAddress)
-		{
-			for (FunctionRef func : data->GetAnalysisFunctionsContainingAddress(address))
-			{
-				func->SetAutoInstructionHighlight(data->GetDefaultArchitecture(), address, NoHighlightColor);
-				for (TagRef tag : func->GetAddressTags(data->GetDefaultArchitecture(), address))
-				{
-					if (tag->GetType() != getBreakpointTagType(data))
-						continue;
-
-					auto id = data->BeginUndoActions();
-					func->RemoveUserAddressTag(data->GetDefaultArchitecture(), address, tag);
-					data->ForgetUndoActions(id);
-				}
-			}
-		}
+		removeBreakpointTag(m_controller->AbsoluteAddressToRelative(event.data.absoluteAddress));
+		break;
+	case BreakpointsChangedEvent:
+		updateBreakpointTags();
 		break;
-	}
 	case RegisterChangedEvent:
 	{
 		navigateToCurrentIP();
@@ -21,6 +21,7 @@ limitations under the License.
 #include <QToolButton>
 #include <QIcon>
 #include <QLineEdit>
+#include <set>
 #include "binaryninjaapi.h"
 #include "uicontext.h"
 #include "debuggerwidget.h"
@@ -70,6 +71,13 @@ private:
 
 	size_t m_eventCallback;
 
+	// The breakpoints that are tagged in the views, so a bulk change only touches the ones that change
+	std::set<ModuleNameAndOffset> m_taggedBreakpoints;
+	std::vector<std::pair<BinaryViewRef, uint64_t>> getBreakpointTagLocations(const ModuleNameAndOffset& breakpoint);
+	void addBreakpointTag(const ModuleNameAndOffset& breakpoint);
+	void removeBreakpointTag(const ModuleNameAndOffset& breakpoint);
+	void updateBreakpointTags();
+
 public:
 	DebuggerUI(UIContext* context, DebuggerControllerRef controller);
 	~DebuggerUI();